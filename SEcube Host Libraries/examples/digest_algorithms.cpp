@@ -133,6 +133,9 @@ int digest_example() {
 		cout << "\nPlease enter the number associated to the algorithm for the digest computation:" << endl;
 		cout << "0) SHA-256" << endl;
 		cout << "1) HMAC-SHA-256" << endl;
+		cout << "2) BLAKE2s-256" << endl;
+		cout << "3) BLAKE2s-256 keyed" << endl;
+		cout << "4) AES-CMAC" << endl;
 		if(!(cin >> sel)){
 			cout << "Input error...quit." << endl;
 			l1->L1Logout();
@@ -150,7 +153,14 @@ int digest_example() {
 				data_digest.algorithm = L1Algorithms::Algorithms::SHA256;
 				l1->L1Digest(testsize, input_data, data_digest);
 				break;
+			case 2:
+				// BLAKE2s-256 is used exactly like SHA-256, it is just faster on the SEcube
+				data_digest.algorithm = L1Algorithms::Algorithms::BLAKE2S;
+				l1->L1Digest(testsize, input_data, data_digest);
+				break;
 			case 1:
+			case 3: // keyed BLAKE2s-256 and AES-CMAC take the same parameters as HMAC-SHA-256
+			case 4:
 				/* when using HMAC-SHA-256, we also need to provide other details. this type of digest is
 				 * authenticated by means of a shared secret (i.e. a symmetric key), therefore we must provide
 				 * the ID of the key to be used for authentication. we also need to set the value of the usenonce
@@ -184,12 +194,13 @@ int digest_example() {
 				}
 				data_digest.key_id = keys.at(ch).first; // use the selected key ID
 				data_digest.usenonce = false; // we don't want to provide a specific nonce manually
-				data_digest.algorithm = L1Algorithms::Algorithms::HMACSHA256;
+				data_digest.algorithm = (sel == 1) ? L1Algorithms::Algorithms::HMACSHA256 :
+						((sel == 3) ? L1Algorithms::Algorithms::BLAKE2S_KEYED : L1Algorithms::Algorithms::AES_CMAC);
 				l1->L1Digest(testsize, input_data, data_digest);
 				// this is used to verify the digest in case of HMAC-SHA-256 recomputing the digest using the nonce set by the previous computation
 				temp.key_id = keys.at(ch).first;
 				temp.usenonce = true;
-				temp.algorithm = L1Algorithms::Algorithms::HMACSHA256;
+				temp.algorithm = data_digest.algorithm;
 				temp.digest_nonce = data_digest.digest_nonce;
 				l1->L1Digest(testsize, input_data, temp);
 				break;
@@ -207,7 +218,8 @@ int digest_example() {
 		}
 
 		// print also recomputed digest (if any)
-		if(data_digest.algorithm == L1Algorithms::Algorithms::HMACSHA256){
+		if((data_digest.algorithm == L1Algorithms::Algorithms::HMACSHA256) || (data_digest.algorithm == L1Algorithms::Algorithms::BLAKE2S_KEYED) ||
+		   (data_digest.algorithm == L1Algorithms::Algorithms::AES_CMAC)){
 			cout << "\n\nThe hex value of the recomputed digest is:" << endl;
 			for(uint8_t i : temp.digest){
 				printf("%02x ", i);
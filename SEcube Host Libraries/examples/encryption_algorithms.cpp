@@ -128,6 +128,9 @@ int encrypt_example() {
 		cout << "7) AES-CTR + HMAC-SHA-256" << endl;
 		cout << "8) AES-CFB + HMAC-SHA-256" << endl;
 		cout << "9) AES-OFB + HMAC-SHA-256" << endl;
+		cout << "10) AES-GCM" << endl;
+		cout << "11) ChaCha20-Poly1305 (256-bit keys only)" << endl;
+		cout << "12) AES-EAX (AES-CTR + AES-CMAC with one key)" << endl;
 		sel = 0;
 		if(!(cin >> sel)){
 			cout << "Input error...quit." << endl;
@@ -203,6 +206,15 @@ int encrypt_example() {
 			case 9:
 				l1->L1Encrypt(TESTSIZE, plaintext, encrypted_data, L1Algorithms::Algorithms::AES_HMACSHA256, CryptoInitialisation::Modes::OFB, key);
 				break;
+			case 10:
+				l1->L1Encrypt(TESTSIZE, plaintext, encrypted_data, L1Algorithms::Algorithms::AES_GCM, CryptoInitialisation::Modes::GCM, key);
+				break;
+			case 11:
+				l1->L1Encrypt(TESTSIZE, plaintext, encrypted_data, L1Algorithms::Algorithms::CHACHA20_POLY1305, 0, key); // ChaCha20-Poly1305 has no modes
+				break;
+			case 12:
+				l1->L1Encrypt(TESTSIZE, plaintext, encrypted_data, L1Algorithms::Algorithms::AES_EAX, CryptoInitialisation::Modes::CTR, key);
+				break;
 			default:
 				cout << "Input error...quit." << endl;
 				l1->L1Logout();
@@ -0,0 +1,953 @@
+/**
+  ******************************************************************************
+  * File Name          : secube_bench.cpp
+  * Description        : microbenchmarks of the L0 and L1 APIs.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  secube_bench.cpp
+ *  \brief Microbenchmarks of the L0 and L1 APIs, with results in JSON.
+ *  \version SEcube SDK 1.5.1
+ *
+ *  Every benchmark runs a few warm-up iterations, then repeats the operation until both
+ *  --iterations and --min-time are reached, and reports the percentiles of the latency of
+ *  a single operation. The device is selected among the ones returned by GetDeviceList();
+ *  to run against the in-process emulator, build with -DSE3_CUBESIM (see se3_cubesim.h in
+ *  the firmware) and set SE3_CUBESIM_PATH, the emulated device is listed first.
+ *
+ *  L0Echo/long-poll and L1RoundTrip/long-poll compare the latency of a small request when the reply is polled
+ *  and when the SEcube holds the read until the reply is ready (L0SetLongPoll()). On the emulator, set
+ *  SE3_CUBESIM_SERVICE to give the requests a service time.
+ *
+ *  L0Transport compares the two ways requests reach the device: the magic file and the
+ *  vendor CDBs sent with SG_IO (SE3_L0_TRANSPORT, see L0_base.h). The vendor CDBs need
+ *  CAP_SYS_RAWIO on a real device; the comparison is skipped if they are not available.
+ *  The requests of the largest size are followed by the cycles spent by the SEcube on each block of the
+ *  protocol file, to locate it and copy it to or from its slot.
+ *
+ *  L1CryptoUpdate/pipelined sends the same requests as L1CryptoUpdate/serial with L1CryptoUpdateSend(), keeping
+ *  L1MaxOutstanding() of them in flight (see L0Send()), so that a request is transferred while the previous one executes.
+ *
+ *  L1CryptoSession/churn keeps a set of sessions open and replaces one of them at each iteration
+ *  (FINIT, then CRYPTO_INIT), with a single algorithm or with algorithms of different context
+ *  sizes; the usage of the session memory at the end is printed.
+ *
+ *  L1CryptoInit/.../key-cache-miss uses more keys in turn than the key cache of the SEcube holds,
+ *  so that every key is read from the flash and its context initialized again. The cycles spent
+ *  by the SEcube on each CRYPTO_INIT are printed, the latency on the host includes the transfers.
+ *  L1CryptoInit/.../fragmented does the same with the session memory filled by sessions of every
+ *  algorithm, every other one released.
+ *
+ *  Storage (emulator only) reads and writes the SD card through the block I/O of the mass
+ *  storage, with 64 KiB sequential and 4 KiB sequential and random requests; 4 KiB sequential
+ *  reads are served by the read-ahead of the firmware. Set SE3_CUBESIM_SD_LATENCY to give the
+ *  emulated card the latency of a real one, e.g. "200:20".
+ *
+ *  The entries of L1Encrypt and L1Decrypt are followed by the cycles per byte spent by the SEcube
+ *  on each algorithm and mode, for the encryption and for the decryption, which compare the modes of
+ *  AES and the authenticated modes (AES-HMACSHA256, AES-GCM, ...) without
+ *  the cost of the transfers. The L1Digest entries do the same for the digests and MACs
+ *  (HMACSHA256, AES-CMAC, ...), and also give the cycles per block of the compression function.
+ *
+ *  L1Encrypt/AES-CTR/1024/session-cache encrypts 1 KiB messages with the idle sessions kept by L1Encrypt() for
+ *  reuse, no-session-cache opens and closes a session on the SEcube for each of them; both print messages per second.
+ *
+ *  The lz4 entries run L1Encrypt and L1Decrypt with L1SetCompression() on JSON log lines
+ *  and on random data, the throughput is computed on the uncompressed size.
+ *
+ *  Usage: secube_bench [--device N] [--pin PIN] [--iterations N] [--min-time MS]
+ *                      [--filter TEXT] [--out FILE] [--factory-init]
+ *  --factory-init sets a serial number on a device without one (i.e. a new emulator).
+ *  The PIN is the admin PIN, all zeros if not given. Keys are added in the manual range
+ *  (see L1Key::Id) for the duration of the run and deleted at the end.
+ */
+
+#include "../sources/L1/L1.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+struct BenchConfig {
+	int device = 0;
+	array<uint8_t, L1Parameters::Size::PIN> pin = {0};
+	size_t iterations = 20;
+	uint64_t min_time_ms = 200;
+	string filter;
+	string out;
+	bool factory_init = false;
+};
+
+struct BenchResult {
+	string name;
+	vector<double> ns; // latency of each iteration
+	size_t bytes; // bytes processed by each iteration, 0 if not meaningful
+};
+
+BenchConfig config;
+vector<BenchResult> results;
+
+double Percentile(const vector<double>& sorted, double p) {
+	if(sorted.empty()){
+		return 0;
+	}
+	size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[min(i, sorted.size() - 1)];
+}
+
+bool Selected(const string& name) {
+	return config.filter.empty() || (name.find(config.filter) != string::npos);
+}
+
+/* run op until both the iteration count and the minimum time are reached; setup runs
+ * before every iteration and is not timed */
+void Run(const string& name, size_t bytes, function<void()> op, function<void()> setup = nullptr) {
+	if(!Selected(name)){
+		return;
+	}
+	BenchResult r;
+	r.name = name;
+	r.bytes = bytes;
+	for(int i = 0; i < 2; i++){ // warm-up
+		if(setup) setup();
+		op();
+	}
+	auto start = chrono::steady_clock::now();
+	while(r.ns.size() < config.iterations ||
+		  chrono::steady_clock::now() - start < chrono::milliseconds(config.min_time_ms)){
+		if(setup) setup();
+		auto t0 = chrono::steady_clock::now();
+		op();
+		auto t1 = chrono::steady_clock::now();
+		r.ns.push_back((double)chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+	}
+	cerr << name << ": " << r.ns.size() << " iterations" << endl;
+	results.push_back(move(r));
+}
+
+void WriteJson(ostream& os, const string& device) {
+	os << "{\n  \"context\": {\"device\": \"" << device << "\", \"iterations\": " << config.iterations
+	   << ", \"min_time_ms\": " << config.min_time_ms << "},\n  \"benchmarks\": [";
+	for(size_t i = 0; i < results.size(); i++){
+		BenchResult& r = results[i];
+		vector<double> s = r.ns;
+		sort(s.begin(), s.end());
+		double mean = 0;
+		for(double v : s){
+			mean += v;
+		}
+		mean /= s.size();
+		os << ((i == 0) ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": " << s.size()
+		   << ", \"time_unit\": \"ns\", \"mean\": " << (uint64_t)mean << ", \"min\": " << (uint64_t)s.front()
+		   << ", \"p50\": " << (uint64_t)Percentile(s, 0.50) << ", \"p90\": " << (uint64_t)Percentile(s, 0.90)
+		   << ", \"p99\": " << (uint64_t)Percentile(s, 0.99) << ", \"max\": " << (uint64_t)s.back();
+		if(r.bytes > 0){
+			os << ", \"bytes_per_second\": " << (uint64_t)(r.bytes * 1e9 / Percentile(s, 0.50));
+		}
+		os << "}";
+	}
+	os << "\n  ]\n}\n";
+}
+
+bool ParseArgs(int argc, char* argv[]) {
+	for(int i = 1; i < argc; i++){
+		string a = argv[i];
+		bool more = (i + 1 < argc);
+		if(a == "--device" && more){
+			config.device = atoi(argv[++i]);
+		} else if(a == "--pin" && more){
+			string pin = argv[++i];
+			if(pin.size() > config.pin.size()){
+				return false;
+			}
+			config.pin.fill(0);
+			memcpy(config.pin.data(), pin.data(), pin.size());
+		} else if(a == "--iterations" && more){
+			config.iterations = max(1, atoi(argv[++i]));
+		} else if(a == "--min-time" && more){
+			config.min_time_ms = strtoull(argv[++i], nullptr, 10);
+		} else if(a == "--filter" && more){
+			config.filter = argv[++i];
+		} else if(a == "--out" && more){
+			config.out = argv[++i];
+		} else if(a == "--factory-init"){
+			config.factory_init = true;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* IDs of the manual range not used on the device, highest first */
+vector<uint32_t> FreeKeyIds(L1* l1, size_t n) {
+	vector<pair<uint32_t, uint16_t>> keys;
+	vector<uint32_t> ids;
+	l1->L1KeyList(keys);
+	for(uint32_t id = L1Key::Id::MANUAL_ID_END; id >= L1Key::Id::MANUAL_ID_BEGIN && ids.size() < n; id--){
+		bool used = false;
+		for(auto& k : keys){
+			used = used || (k.first == id);
+		}
+		if(!used){
+			ids.push_back(id);
+		}
+	}
+	return ids;
+}
+
+void AddKey(L1* l1, uint32_t id, uint16_t policy = L1Key::Policy::NONE) {
+	array<uint8_t, 32> data;
+	L0Support::Se3Rand(data.size(), data.data());
+	se3Key k;
+	k.id = id;
+	k.dataSize = (uint16_t)data.size();
+	k.data = data.data();
+	k.policy = policy;
+	l1->L1KeyEdit(k, L1Commands::KeyOpEdit::SE3_KEY_OP_ADD);
+}
+
+void DeleteKey(L1* l1, uint32_t id) {
+	se3Key k;
+	k.id = id;
+	k.dataSize = 0;
+	k.data = nullptr;
+	l1->L1KeyEdit(k, L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE);
+}
+
+const size_t sizes[] = {1024, 16 * 1024, 256 * 1024};
+
+void BenchEcho(L0* l0) {
+	const uint16_t echoSizes[] = {16, 256, 1024, 4096, L0Request::Size::MAX_DATA};
+	vector<uint8_t> in(L0Request::Size::MAX_DATA), out(L0Request::Size::MAX_DATA);
+	L0Support::Se3Rand(in.size(), in.data());
+	for(uint16_t n : echoSizes){
+		Run("L0Echo/" + to_string(n), n, [&]{ l0->L0Echo(in.data(), n, out.data()); });
+	}
+}
+
+/* L0Echo with the requests sent through the magic file and through the vendor CDBs,
+ * available on Linux only */
+/* round trips with the reply polled (a sleep of 1 ms before each read on Linux) and with the read held by the
+ * SEcube until the reply is ready (long-poll); L1 runs L1FindKey(), a command that does not touch the flash */
+void BenchLongPoll(L0* l0, L1* l1, uint32_t key) {
+	const uint16_t n = 16;
+	vector<uint8_t> in(n), out(n);
+	bool found = false;
+	L0Support::Se3Rand(in.size(), in.data());
+	for(bool longPoll : {false, true}){
+		string mode = longPoll ? "long-poll" : "polling";
+		l0->L0SetLongPoll(longPoll);
+		l1->L1SetLongPoll(longPoll);
+		if(longPoll && !l0->L0LongPoll()){
+			cerr << "L0Echo/long-poll: not supported by the SEcube, skipped" << endl;
+			break;
+		}
+		Run("L0Echo/" + mode + "/" + to_string(n), n, [&]{ l0->L0Echo(in.data(), n, out.data()); });
+		Run("L1RoundTrip/" + mode, 0, [&]{ l1->L1FindKey(key, found); });
+	}
+	l0->L0SetLongPoll(false);
+	l1->L1SetLongPoll(false);
+}
+
+/* cycles spent by the SEcube per block of the protocol file written and read by the host, since the
+ * last reset of the counters: the lookup of the block and its copy, without the transfers */
+void PrintProtoCycles(L1* l1, const string& name) {
+	const char* directions[] = {"written", "read"};
+	se3PerfCounters counters;
+	l1->L1PerfCounters(counters, true);
+	for(size_t i = 0; i < counters.proto.size(); i++){
+		const se3PerfEntry& e = counters.proto[i];
+		if(e.count > 0){
+			cerr << name << ": " << e.cycles / e.count << " device cycles per block " << directions[i] << endl;
+		}
+	}
+}
+
+void BenchTransport(uint8_t device, L1* l1) {
+#ifndef _WIN32
+	const uint16_t echoSizes[] = {16, 1024, L0Request::Size::MAX_DATA};
+	const char* transports[] = {"file", "scsi"};
+	vector<uint8_t> in(L0Request::Size::MAX_DATA), out(L0Request::Size::MAX_DATA);
+	L0Support::Se3Rand(in.size(), in.data());
+	const char* saved = getenv(SE3_TRANSPORT_ENV);
+	string previous = (saved == nullptr) ? "" : saved;
+	for(const char* t : transports){
+		L0 l0;
+		setenv(SE3_TRANSPORT_ENV, t, 1);
+		l0.L0Open(device);
+		if(l0.GetDeviceScsi() != (strcmp(t, "scsi") == 0)){
+			cerr << "L0Transport/" << t << ": not available, skipped" << endl;
+			l0.L0Close();
+			continue;
+		}
+		for(uint16_t n : echoSizes){
+			string name = "L0Transport/" + string(t) + "/" + to_string(n);
+			l1->L1PerfReset();
+			Run(name, n, [&]{ l0.L0Echo(in.data(), n, out.data()); });
+			if(n == L0Request::Size::MAX_DATA && Selected(name)){ // every block of the protocol file but the discovery one
+				PrintProtoCycles(l1, name);
+			}
+		}
+		l0.L0Close();
+	}
+	if(saved == nullptr){
+		unsetenv(SE3_TRANSPORT_ENV);
+	} else {
+		setenv(SE3_TRANSPORT_ENV, previous.c_str(), 1);
+	}
+#endif
+}
+
+/* mass storage of the emulator: READ(10) and WRITE(10) of the blocks past the magic file,
+ * served by the SD card driver of the firmware. A write returns once queued, the card is
+ * synchronized after each write entry */
+void BenchStorage(const string& path) {
+#if defined(SE3_CUBESIM) && !defined(_WIN32)
+	const uint32_t first = 2048, end = SE3_CUBESIM_SD_BLOCKS;
+	const uint16_t seqBlocks = 128, rndBlocks = 8;
+	const size_t rndBytes = rndBlocks * L0Communication::Parameter::COMM_BLOCK;
+	const char* sim = getenv("SE3_CUBESIM_PATH");
+	if(sim == nullptr || path.compare(0, strlen(sim), sim) != 0){
+		cerr << "Storage: not the emulator, skipped" << endl;
+		return;
+	}
+	vector<uint8_t> buf(seqBlocks * L0Communication::Parameter::COMM_BLOCK);
+	L0Support::Se3Rand(buf.size(), buf.data());
+	uint32_t next = first, lcg = 1;
+	auto check = [](bool ok){
+		if(!ok){
+			throw runtime_error("storage I/O failed");
+		}
+	};
+	auto sequential = [&](uint16_t n){
+		uint32_t b = next;
+		next = (next + 2 * n > end) ? (first) : (next + n);
+		return b;
+	};
+	auto random = [&](uint16_t n){
+		lcg = lcg * 1103515245 + 12345;
+		return first + ((lcg >> 8) % ((end - first) / n)) * n;
+	};
+	Run("Storage/seq-write/" + to_string(buf.size()), buf.size(), [&]{
+		check(se3_cubesim_storage_write(sequential(seqBlocks), buf.data(), seqBlocks));
+	});
+	check(se3_cubesim_storage_sync());
+	next = first;
+	Run("Storage/seq-read/" + to_string(buf.size()), buf.size(), [&]{
+		check(se3_cubesim_storage_read(sequential(seqBlocks), buf.data(), seqBlocks));
+	});
+	next = first;
+	Run("Storage/seq-read/" + to_string(rndBytes), rndBytes, [&]{
+		check(se3_cubesim_storage_read(sequential(rndBlocks), buf.data(), rndBlocks));
+	});
+	Run("Storage/random-write/" + to_string(rndBytes), rndBytes, [&]{
+		check(se3_cubesim_storage_write(random(rndBlocks), buf.data(), rndBlocks));
+	});
+	check(se3_cubesim_storage_sync());
+	Run("Storage/random-read/" + to_string(rndBytes), rndBytes, [&]{
+		check(se3_cubesim_storage_read(random(rndBlocks), buf.data(), rndBlocks));
+	});
+#endif
+}
+
+void BenchLogin(L1* l1) {
+	Run("L1Login", 0, [&]{ l1->L1Login(config.pin, SE3_ACCESS_ADMIN, true); }, [&]{
+		if(l1->L1GetSessionLoggedIn()){
+			l1->L1Logout();
+		}
+	});
+	if(!l1->L1GetSessionLoggedIn()){
+		l1->L1Login(config.pin, SE3_ACCESS_ADMIN, true);
+	}
+}
+
+void BenchCryptoSession(L1* l1, uint32_t key) {
+	const uint16_t chunk = 4096;
+	unique_ptr<uint8_t[]> in(new uint8_t[chunk]), out(new uint8_t[chunk]);
+	memset(in.get(), 0x5A, chunk);
+	uint16_t outLen = 0;
+	uint32_t sid = 0;
+	bool open = false;
+	uint16_t mode = CryptoInitialisation::Modes::CTR | CryptoInitialisation::Direction::ENCRYPT;
+	auto release = [&]{ // release the session of the previous iteration, FINIT needs some data
+		if(open){
+			l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, 0, nullptr, B5_AES_BLK_SIZE, in.get(), &outLen, out.get());
+			open = false;
+		}
+	};
+	Run("L1CryptoInit/AES-CTR", 0, [&]{ l1->L1CryptoInit(L1Algorithms::Algorithms::AES, mode, key, sid); open = true; }, release);
+	release();
+	l1->L1CryptoInit(L1Algorithms::Algorithms::AES, mode, key, sid);
+	array<uint8_t, B5_AES_BLK_SIZE> nonce = {0};
+	l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::SETNONCE, (uint16_t)nonce.size(), nonce.data(), 0, nullptr, &outLen, nullptr);
+	Run("L1CryptoUpdate/AES-CTR/" + to_string(chunk), chunk, [&]{
+		l1->L1CryptoUpdate(sid, 0, 0, nullptr, chunk, in.get(), &outLen, out.get());
+	});
+	open = true;
+	release();
+	Run("L1CryptoUpdate/FINIT/" + to_string(B5_AES_BLK_SIZE), B5_AES_BLK_SIZE, [&]{
+		l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, 0, nullptr, B5_AES_BLK_SIZE, in.get(), &outLen, out.get());
+	}, [&]{
+		l1->L1CryptoInit(L1Algorithms::Algorithms::AES, mode, key, sid);
+	});
+}
+
+/* the same AES-CTR requests of the largest size (about 7.5 KB), one at a time and with L1MaxOutstanding() in flight; the pipelined
+ * entry is faster when the SEcube receives the next request while it encrypts the current one */
+void BenchPipeline(L1* l1, uint32_t key) {
+	const uint16_t chunk = L1Crypto::UpdateSize::DATAIN;
+	const size_t n = 8; // requests per iteration
+	unique_ptr<uint8_t[]> in(new uint8_t[chunk]), out(new uint8_t[chunk]);
+	memset(in.get(), 0x5A, chunk);
+	uint16_t outLen = 0;
+	uint32_t sid = 0;
+	uint16_t mode = CryptoInitialisation::Modes::CTR | CryptoInitialisation::Direction::ENCRYPT;
+	if(!Selected("L1CryptoUpdate/serial/7.5K") && !Selected("L1CryptoUpdate/pipelined/7.5K")){
+		return;
+	}
+	l1->L1CryptoInit(L1Algorithms::Algorithms::AES, mode, key, sid);
+	array<uint8_t, B5_AES_BLK_SIZE> nonce = {0};
+	l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::SETNONCE, (uint16_t)nonce.size(), nonce.data(), 0, nullptr, &outLen, nullptr);
+	Run("L1CryptoUpdate/serial/7.5K", n * chunk, [&]{
+		for(size_t i = 0; i < n; i++){
+			l1->L1CryptoUpdate(sid, 0, 0, nullptr, chunk, in.get(), &outLen, out.get());
+		}
+	});
+	size_t depth = l1->L1MaxOutstanding();
+	Run("L1CryptoUpdate/pipelined/7.5K", n * chunk, [&]{
+		size_t sent = 0, done = 0;
+		while(done < n){
+			while((sent < n) && (sent - done < depth)){
+				l1->L1CryptoUpdateSend(sid, 0, 0, nullptr, chunk, in.get());
+				sent++;
+			}
+			l1->L1CryptoUpdateReceive(&outLen, out.get());
+			done++;
+		}
+	});
+	cerr << "L1CryptoUpdate/pipelined/7.5K: " << depth << " requests in flight" << endl;
+	l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, 0, nullptr, B5_AES_BLK_SIZE, in.get(), &outLen, out.get());
+}
+
+struct SessionAlgo {
+	const char* name;
+	uint16_t algorithm;
+	uint16_t mode;
+	bool keyed;
+};
+
+/* algorithms with different context sizes on the SEcube */
+const SessionAlgo sessionAlgos[] = {
+	{"AES", L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR | CryptoInitialisation::Direction::ENCRYPT, true},
+	{"AES-HMACSHA256", L1Algorithms::Algorithms::AES_HMACSHA256, CryptoInitialisation::Modes::CTR | CryptoInitialisation::Direction::ENCRYPT, true},
+	{"SHA256", L1Algorithms::Algorithms::SHA256, 0, false},
+	{"HMACSHA256", L1Algorithms::Algorithms::HMACSHA256, 0, true},
+	{"AES-GCM", L1Algorithms::Algorithms::AES_GCM, CryptoInitialisation::Modes::GCM | CryptoInitialisation::Direction::ENCRYPT, true},
+	{"CHACHA20-POLY1305", L1Algorithms::Algorithms::CHACHA20_POLY1305, CryptoInitialisation::Direction::ENCRYPT, true},
+	{"BLAKE2S", L1Algorithms::Algorithms::BLAKE2S, 0, false},
+	{"BLAKE2S-KEYED", L1Algorithms::Algorithms::BLAKE2S_KEYED, 0, true},
+	{"AES-CMAC", L1Algorithms::Algorithms::AES_CMAC, 0, true},
+	{"AES-EAX", L1Algorithms::Algorithms::AES_EAX, CryptoInitialisation::Modes::CTR | CryptoInitialisation::Direction::ENCRYPT, true}
+};
+
+uint32_t OpenSession(L1* l1, const SessionAlgo& a, uint32_t key) {
+	uint32_t sid = 0;
+	l1->L1CryptoInit(a.algorithm, a.mode, a.keyed ? key : (uint32_t)L1Key::Id::NULL_ID, sid);
+	return sid;
+}
+
+/* FINIT releases the session only if the request is valid for its algorithm */
+void CloseSession(L1* l1, const SessionAlgo& a, uint32_t sid) {
+	uint8_t in[B5_AES_BLK_SIZE] = {0};
+	uint8_t out[L1Crypto::UpdateSize::DATAIN];
+	uint16_t outLen = 0;
+	switch(a.algorithm){
+		case L1Algorithms::Algorithms::AES:
+		case L1Algorithms::Algorithms::AES_HMACSHA256:
+			l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, 0, nullptr, B5_AES_BLK_SIZE, in, &outLen, out);
+			break;
+		case L1Algorithms::Algorithms::AES_GCM:
+		case L1Algorithms::Algorithms::CHACHA20_POLY1305:
+		case L1Algorithms::Algorithms::AES_EAX: // an empty message
+			l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::RESET | L1Crypto::UpdateFlags::FINIT, L1Crypto::GcmSize::IV, in, 0, nullptr, &outLen, out);
+			break;
+		default: // digest of in
+			l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, B5_AES_BLK_SIZE, in, 0, nullptr, &outLen, out);
+			break;
+	}
+}
+
+/* replace one of the open sessions at each iteration; slots and algorithms are chosen by a fixed
+ * pseudo-random sequence, so that runs with the same number of iterations can be compared */
+void BenchSessionChurn(L1* l1, uint32_t key) {
+	const size_t live = 24;
+	struct { const char* name; size_t first; size_t count; } mixes[] = {
+		{"AES", 0, 1},
+		{"mixed", 0, sizeof(sessionAlgos) / sizeof(sessionAlgos[0])}
+	};
+	for(auto& m : mixes){
+		string name = "L1CryptoSession/churn/" + string(m.name);
+		if(!Selected(name)){
+			continue;
+		}
+		vector<pair<const SessionAlgo*, uint32_t>> open;
+		uint32_t seed = 1;
+		auto next = [&]{ seed = seed * 1103515245 + 12345; return (seed >> 16); };
+		l1->L1CryptoSessionsRelease();
+		for(size_t i = 0; i < live; i++){
+			const SessionAlgo& a = sessionAlgos[m.first + next() % m.count];
+			open.push_back({&a, OpenSession(l1, a, key)});
+		}
+		Run(name, 0, [&]{
+			auto& s = open[next() % live];
+			CloseSession(l1, *s.first, s.second);
+			s.first = &sessionAlgos[m.first + next() % m.count];
+			s.second = OpenSession(l1, *s.first, key);
+		});
+		se3CryptoSessionsStatus status;
+		l1->L1CryptoSessionsList(status);
+		cerr << name << ": " << status.sessions.size() << " sessions, " << status.bytesUsed << " bytes used, "
+			 << status.bytesInternal << " internal and " << status.bytesExternal << " external fragmentation, " << status.failures << " failures" << endl;
+		for(auto& s : open){
+			CloseSession(l1, *s.first, s.second);
+		}
+	}
+}
+
+/* print the cycles spent by the SEcube on each CRYPTO_INIT, and reset the counters */
+void PrintInitCycles(L1* l1, const string& name) {
+	se3PerfCounters counters;
+	l1->L1PerfCounters(counters, true);
+	const se3PerfEntry& e = counters.cmd1.at(L1Commands::Codes::CRYPTO_INIT);
+	if(e.count > 0){
+		cerr << name << ": " << (e.cycles / e.count) << " device cycles per CRYPTO_INIT" << endl;
+	}
+}
+
+/* CRYPTO_INIT with the same key (the context is copied from the key cache), and with keys in turn */
+void BenchKeyCache(L1* l1, uint32_t key) {
+	const size_t n = 8; // twice the entries of the key cache
+	vector<uint32_t> ids = FreeKeyIds(l1, n);
+	if(ids.size() < n){
+		return;
+	}
+	for(uint32_t id : ids){
+		AddKey(l1, id);
+	}
+	for(size_t i : {(size_t)0, (size_t)4}){ // AES, AES-GCM
+		const SessionAlgo& a = sessionAlgos[i];
+		uint32_t sid = 0;
+		bool open = false;
+		size_t next = 0;
+		auto release = [&]{
+			if(open){
+				CloseSession(l1, a, sid);
+				open = false;
+			}
+		};
+		string name = "L1CryptoInit/" + string(a.name) + "/key-cache-hit";
+		l1->L1PerfReset();
+		Run(name, 0, [&]{ sid = OpenSession(l1, a, key); open = true; }, release);
+		release();
+		PrintInitCycles(l1, name);
+		name = "L1CryptoInit/" + string(a.name) + "/key-cache-miss";
+		Run(name, 0, [&]{
+			sid = OpenSession(l1, a, ids[next]);
+			open = true;
+			next = (next + 1) % n;
+		}, release);
+		release();
+		PrintInitCycles(l1, name);
+	}
+	for(uint32_t id : ids){
+		DeleteKey(l1, id);
+	}
+}
+
+/* CRYPTO_INIT on an empty session memory, and on a session memory that has been full for a while */
+void BenchFragmented(L1* l1, uint32_t key) {
+	const size_t n = sizeof(sessionAlgos) / sizeof(sessionAlgos[0]);
+	for(size_t i : {(size_t)0, (size_t)4}){ // AES, AES-GCM
+		for(bool fragmented : {false, true}){
+			const SessionAlgo& a = sessionAlgos[i];
+			string name = "L1CryptoInit/" + string(a.name) + (fragmented ? "/fragmented" : "/empty");
+			if(!Selected(name)){
+				continue;
+			}
+			vector<pair<const SessionAlgo*, uint32_t>> open;
+			l1->L1CryptoSessionsRelease();
+			if(fragmented){
+				try{
+					while(true){ // until the session memory or the session table is full
+						const SessionAlgo& s = sessionAlgos[open.size() % n];
+						open.push_back({&s, OpenSession(l1, s, key)});
+					}
+				} catch (L1CryptoInitException& e) {
+				}
+				for(size_t j = 0; j < open.size(); j += 2){
+					CloseSession(l1, *open[j].first, open[j].second);
+				}
+			}
+			uint32_t sid = 0;
+			bool opened = false;
+			auto release = [&]{
+				if(opened){
+					CloseSession(l1, a, sid);
+					opened = false;
+				}
+			};
+			l1->L1PerfReset();
+			Run(name, 0, [&]{ sid = OpenSession(l1, a, key); opened = true; }, release);
+			release();
+			PrintInitCycles(l1, name);
+			l1->L1CryptoSessionsRelease();
+		}
+	}
+}
+
+/* cycles spent by the SEcube in the update of algorithm per input byte, and per block of block bytes
+ * if not 0, since the last reset of the counters; unlike the latency on the host, this does not include
+ * the transfers */
+void PrintAlgoCycles(L1* l1, const string& name, uint16_t algorithm, size_t block = 0) {
+	se3PerfCounters counters;
+	l1->L1PerfCounters(counters, true);
+	if(algorithm < counters.algo.size() && counters.algo[algorithm].bytes > 0){
+		const se3PerfEntry& e = counters.algo[algorithm];
+		cerr << name << ": " << (double)(e.cycles * 10 / e.bytes) / 10 << " device cycles per byte";
+		if(block > 0){
+			cerr << ", " << e.cycles * block / e.bytes << " per " << block << "-byte block";
+		}
+		cerr << endl;
+	}
+}
+
+void BenchEncryptDecrypt(L1* l1, uint32_t key) {
+	struct { const char* name; uint16_t algorithm; uint16_t mode; } algos[] = {
+		{"AES-ECB", L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::ECB},
+		{"AES-CBC", L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CBC},
+		{"AES-CTR", L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR},
+		{"AES-CFB", L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CFB},
+		{"AES-OFB", L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::OFB},
+		{"AES-HMACSHA256-CBC", L1Algorithms::Algorithms::AES_HMACSHA256, CryptoInitialisation::Modes::CBC},
+		{"AES-HMACSHA256-CTR", L1Algorithms::Algorithms::AES_HMACSHA256, CryptoInitialisation::Modes::CTR},
+		{"AES-GCM", L1Algorithms::Algorithms::AES_GCM, CryptoInitialisation::Modes::GCM},
+		{"CHACHA20-POLY1305", L1Algorithms::Algorithms::CHACHA20_POLY1305, 0},
+		{"AES-EAX", L1Algorithms::Algorithms::AES_EAX, CryptoInitialisation::Modes::CTR}
+	};
+	const size_t nSizes = sizeof(sizes) / sizeof(sizes[0]);
+	se3PerfCounters counters;
+	for(auto& a : algos){
+		bool encrypt = false, decrypt = false;
+		SEcube_ciphertext encrypted[nSizes];
+		l1->L1PerfCounters(counters, true);
+		for(size_t i = 0; i < nSizes; i++){ // the encryption of every size, then the decryption
+			size_t n = sizes[i];
+			string size = string(a.name) + "/" + to_string(n);
+			if(!Selected("L1Encrypt/" + size) && !Selected("L1Decrypt/" + size)){
+				continue;
+			}
+			encrypt = encrypt || Selected("L1Encrypt/" + size);
+			decrypt = decrypt || Selected("L1Decrypt/" + size);
+			shared_ptr<uint8_t[]> plaintext(new uint8_t[n]);
+			L0Support::Se3Rand(n, plaintext.get());
+			Run("L1Encrypt/" + size, n, [&]{
+				encrypted[i].reset();
+				l1->L1Encrypt(n, plaintext, encrypted[i], a.algorithm, a.mode, key);
+			});
+			if(encrypted[i].ciphertext == nullptr){ // filtered out
+				l1->L1Encrypt(n, plaintext, encrypted[i], a.algorithm, a.mode, key);
+			}
+		}
+		if(encrypt){
+			PrintAlgoCycles(l1, "L1Encrypt/" + string(a.name), a.algorithm);
+		}
+		l1->L1PerfCounters(counters, true);
+		for(size_t i = 0; i < nSizes; i++){
+			size_t n = sizes[i];
+			shared_ptr<uint8_t[]> decrypted;
+			size_t decryptedSize = 0;
+			if(encrypted[i].ciphertext == nullptr){
+				continue;
+			}
+			Run("L1Decrypt/" + string(a.name) + "/" + to_string(n), n, [&]{
+				l1->L1Decrypt(encrypted[i], decryptedSize, decrypted);
+			});
+		}
+		if(decrypt){
+			PrintAlgoCycles(l1, "L1Decrypt/" + string(a.name), a.algorithm);
+		}
+	}
+}
+
+/* small messages with the idle sessions of L1Encrypt() reused (the default) and with a new session for each
+ * message (L1SetCryptoSessionCacheSize(0)); the rate is printed in messages per second */
+void BenchSessionCache(L1* l1, uint32_t key) {
+	const size_t n = 1024;
+	shared_ptr<uint8_t[]> plaintext(new uint8_t[n]);
+	L0Support::Se3Rand(n, plaintext.get());
+	SEcube_ciphertext encrypted;
+	struct { const char* name; size_t cacheSize; } caches[] = {
+		{"no-session-cache", 0},
+		{"session-cache", L1CryptoSession::Parameters::CACHE_SIZE}
+	};
+	for(auto& c : caches){
+		string name = "L1Encrypt/AES-CTR/" + to_string(n) + "/" + c.name;
+		if(!Selected(name)){
+			continue;
+		}
+		l1->L1SetCryptoSessionCacheSize(c.cacheSize);
+		Run(name, n, [&]{
+			encrypted.reset();
+			l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR, key);
+		});
+		vector<double> ns = results.back().ns;
+		sort(ns.begin(), ns.end());
+		cerr << name << ": " << (uint64_t)(1e9 / Percentile(ns, 0.5)) << " messages per second" << endl;
+	}
+	l1->L1SetCryptoSessionCacheSize(L1CryptoSession::Parameters::CACHE_SIZE);
+}
+
+/* AES-CTR with the keystream applied on the host (compare with L1Encrypt/AES-CTR and L1Decrypt/AES-CTR),
+ * and with a key whose policy forbids it (the SEcube refuses, the data is sent as usual) */
+void BenchKeystream(L1* l1, uint32_t key) {
+	vector<uint32_t> ids = FreeKeyIds(l1, 1);
+	if(ids.empty()){
+		return;
+	}
+	AddKey(l1, ids[0], L1Key::Policy::NO_KEYSTREAM);
+	struct { const char* name; uint32_t key; } keys[] = {{"AES-CTR-KEYSTREAM", key}, {"AES-CTR-NO-KEYSTREAM", ids[0]}};
+	for(auto& k : keys){
+		for(size_t n : sizes){
+			shared_ptr<uint8_t[]> plaintext(new uint8_t[n]);
+			L0Support::Se3Rand(n, plaintext.get());
+			SEcube_ciphertext encrypted;
+			shared_ptr<uint8_t[]> decrypted;
+			size_t decryptedSize = 0;
+			l1->L1SetCtrKeystream(true);
+			Run("L1Encrypt/" + string(k.name) + "/" + to_string(n), n, [&]{
+				encrypted.reset();
+				l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR, k.key);
+			});
+			if(encrypted.ciphertext == nullptr){ // filtered out
+				l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR, k.key);
+			}
+			Run("L1Decrypt/" + string(k.name) + "/" + to_string(n), n, [&]{
+				l1->L1Decrypt(encrypted, decryptedSize, decrypted);
+			});
+			l1->L1SetCtrKeystream(false); // the ciphertext must be the same as without the keystream
+			l1->L1Decrypt(encrypted, decryptedSize, decrypted);
+			if((decryptedSize != n) || memcmp(decrypted.get(), plaintext.get(), n)){
+				DeleteKey(l1, ids[0]);
+				throw runtime_error(string(k.name) + ": the keystream output does not match");
+			}
+		}
+	}
+	DeleteKey(l1, ids[0]);
+}
+
+/* JSON log lines, about as compressible as real logs */
+void FillJsonLog(uint8_t* data, size_t size) {
+	const char* levels[] = {"info", "debug", "warning", "error"};
+	const char* messages[] = {"request served", "cache miss", "session opened", "session closed", "retrying"};
+	string text;
+	uint32_t seed = 1;
+	for(uint32_t line = 0; text.size() < size; line++){
+		seed = seed * 1103515245 + 12345;
+		text += "{\"ts\":" + to_string(1700000000 + line) + ",\"level\":\"" + levels[(seed >> 16) % 4] +
+				"\",\"user\":" + to_string((seed >> 8) % 5000) + ",\"msg\":\"" + messages[(seed >> 20) % 5] +
+				"\",\"ms\":" + to_string((seed >> 4) % 300) + "}\n";
+	}
+	memcpy(data, text.data(), size);
+}
+
+/* AES-CTR with and without LZ4 compression, on compressible and incompressible data */
+void BenchCompression(L1* l1, uint32_t key) {
+	const char* corpora[] = {"json", "random"};
+	for(const char* corpus : corpora){
+		for(size_t n : sizes){
+			shared_ptr<uint8_t[]> plaintext(new uint8_t[n]);
+			if(strcmp(corpus, "json") == 0){
+				FillJsonLog(plaintext.get(), n);
+			} else {
+				L0Support::Se3Rand(n, plaintext.get());
+			}
+			for(bool lz4 : {false, true}){
+				string name = string("AES-CTR") + (lz4 ? "-LZ4/" : "/") + corpus + "/" + to_string(n);
+				SEcube_ciphertext encrypted;
+				shared_ptr<uint8_t[]> decrypted;
+				size_t decryptedSize = 0;
+				l1->L1SetCompression(lz4);
+				Run("L1Encrypt/" + name, n, [&]{
+					encrypted.reset();
+					l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR, key);
+				});
+				if(encrypted.ciphertext == nullptr){ // filtered out
+					l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR, key);
+				}
+				Run("L1Decrypt/" + name, n, [&]{
+					l1->L1Decrypt(encrypted, decryptedSize, decrypted);
+				});
+				l1->L1Decrypt(encrypted, decryptedSize, decrypted);
+				if((decryptedSize != n) || memcmp(decrypted.get(), plaintext.get(), n)){
+					l1->L1SetCompression(false);
+					throw runtime_error(name + ": the decrypted data does not match");
+				}
+				if(lz4){
+					cerr << name << ": ciphertext " << encrypted.ciphertext_size << " bytes (" << (encrypted.compressed ? "compressed" : "not compressed") << ")" << endl;
+				}
+			}
+		}
+	}
+	l1->L1SetCompression(false);
+}
+
+void BenchDigest(L1* l1, uint32_t key) {
+	struct { const char* name; uint16_t algorithm; bool keyed; size_t block; } algos[] = {
+		{"SHA256", L1Algorithms::Algorithms::SHA256, false, B5_SHA256_BLOCK_SIZE},
+		{"BLAKE2S", L1Algorithms::Algorithms::BLAKE2S, false, 64},
+		{"HMACSHA256", L1Algorithms::Algorithms::HMACSHA256, true, B5_SHA256_BLOCK_SIZE},
+		{"BLAKE2S-KEYED", L1Algorithms::Algorithms::BLAKE2S_KEYED, true, 64},
+		{"AES-CMAC", L1Algorithms::Algorithms::AES_CMAC, true, B5_AES_BLK_SIZE}
+	};
+	se3PerfCounters counters;
+	l1->L1PerfCounters(counters, true);
+	for(auto& a : algos){
+		for(size_t n : sizes){
+			shared_ptr<uint8_t[]> data(new uint8_t[n]);
+			L0Support::Se3Rand(n, data.get());
+			SEcube_digest digest;
+			Run("L1Digest/" + string(a.name) + "/" + to_string(n), n, [&]{
+				digest.algorithm = a.algorithm;
+				digest.key_id = key;
+				digest.usenonce = false;
+				l1->L1Digest(n, data, digest);
+			});
+		}
+		PrintAlgoCycles(l1, "L1Digest/" + string(a.name), a.algorithm, a.block);
+	}
+}
+
+void BenchKeys(L1* l1) {
+	const size_t counts[] = {1, 16, 64, 256};
+	vector<uint32_t> ids = FreeKeyIds(l1, counts[3]);
+	size_t added = 0;
+	for(size_t n : counts){
+		if(n > ids.size()){
+			break;
+		}
+		while(added < n){
+			AddKey(l1, ids[added++]);
+		}
+		vector<pair<uint32_t, uint16_t>> keys;
+		bool found = false;
+		Run("L1KeyList/" + to_string(n), 0, [&]{ keys.clear(); l1->L1KeyList(keys); });
+		Run("L1FindKey/" + to_string(n), 0, [&]{ l1->L1FindKey(ids[n - 1], found); }); // most recently added
+	}
+	for(size_t i = 0; i < added; i++){
+		DeleteKey(l1, ids[i]);
+	}
+}
+
+}
+
+// RENAME THIS TO main()
+int secube_bench(int argc, char* argv[]) {
+	if(!ParseArgs(argc, argv)){
+		cerr << "Usage: secube_bench [--device N] [--pin PIN] [--iterations N] [--min-time MS] [--filter TEXT] [--out FILE] [--factory-init]" << endl;
+		return -1;
+	}
+	unique_ptr<L0> l0 = make_unique<L0>();
+	unique_ptr<L1> l1 = make_unique<L1>();
+	vector<pair<string, string>> devices;
+	if(l0->GetDeviceList(devices) || config.device < 0 || config.device >= (int)devices.size()){
+		cerr << "SEcube device " << config.device << " not found. Quit." << endl;
+		return -1;
+	}
+	string path = devices.at(config.device).first;
+	uint32_t key = 0;
+	try{
+		l1->L1SelectSEcube((uint8_t)config.device);
+		if(config.factory_init){
+			array<uint8_t, L0Communication::Size::SERIAL> sn;
+			sn.fill('0');
+			memcpy(sn.data(), "SEcubeBench", 11);
+			try{
+				l1->L1FactoryInit(sn);
+			} catch (DeviceAlreadyInitializedException& e) {
+			}
+		}
+		l1->L1Login(config.pin, SE3_ACCESS_ADMIN, true);
+		vector<uint32_t> ids = FreeKeyIds(l1.get(), 1);
+		if(ids.empty()){
+			cerr << "No free key ID in the manual range. Quit." << endl;
+			return -1;
+		}
+		key = ids[0];
+		AddKey(l1.get(), key);
+	} catch (...) {
+		cerr << "Cannot login to " << path << ". Quit." << endl;
+		return -1;
+	}
+
+	try{
+		l0 = make_unique<L0>(); // discover again, the serial number may have been set above
+		l0->L0Open((uint8_t)config.device);
+		BenchEcho(l0.get());
+		BenchLongPoll(l0.get(), l1.get(), key);
+		l0->L0Close();
+		BenchTransport((uint8_t)config.device, l1.get());
+		BenchStorage(path);
+		BenchLogin(l1.get());
+		BenchCryptoSession(l1.get(), key);
+		BenchPipeline(l1.get(), key);
+		BenchSessionChurn(l1.get(), key);
+		BenchKeyCache(l1.get(), key);
+		BenchFragmented(l1.get(), key);
+		BenchEncryptDecrypt(l1.get(), key);
+		BenchSessionCache(l1.get(), key);
+		BenchKeystream(l1.get(), key);
+		BenchCompression(l1.get(), key);
+		BenchDigest(l1.get(), key);
+		BenchKeys(l1.get());
+		DeleteKey(l1.get(), key);
+		l1->L1Logout();
+	} catch (exception& e) {
+		cerr << "Benchmark failed: " << e.what() << endl;
+		return -1;
+	}
+
+	if(config.out.empty()){
+		WriteJson(cout, path);
+	} else {
+		ofstream f(config.out);
+		WriteJson(f, path);
+	}
+	return 0;
+}
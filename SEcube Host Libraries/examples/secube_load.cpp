@@ -0,0 +1,442 @@
+/**
+  ******************************************************************************
+  * File Name          : secube_load.cpp
+  * Description        : load generator for the L1 APIs.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  secube_load.cpp
+ *  \brief Sustained load on the L1 API with a weighted mix of operations.
+ *  \version SEcube SDK 1.5.1
+ *
+ *  N client threads issue operations for a given duration. With --rate the arrivals are
+ *  open loop: each thread draws its arrival times from a Poisson process and the latency of
+ *  an operation is measured from its scheduled arrival, so the time spent waiting behind a
+ *  slow operation is counted (no coordinated omission). Without --rate every thread issues
+ *  the next operation as soon as the previous one completes.
+ *
+ *  The SEcube executes one request at a time and a login is shared by the whole process,
+ *  so the threads share one L1 object; calls are serialized by a mutex, whose waiting time is
+ *  part of the latency.
+ *
+ *  Usage: secube_load [--device N] [--pin PIN] [--threads N] [--duration S] [--rate OPS]
+ *                     [--mix small=W,bulk=W,digest=W,find=W,login=W] [--interval S]
+ *                     [--out FILE] [--factory-init]
+ *  Operations: small = L1Encrypt of 64 bytes with AES-GCM, bulk = L1Encrypt of 64KB with
+ *  AES-CTR, digest = L1Digest of 4KB with SHA-256, find = L1FindKey, login = L1Logout
+ *  followed by L1Login. Every --interval seconds the completed operations, the errors and
+ *  the crypto sessions open on the device are sampled. The report is written as JSON.
+ *  To use the in-process emulator, see secube_bench.cpp.
+ */
+
+#include "../sources/L1/L1.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+struct LoadConfig {
+	int device = 0;
+	array<uint8_t, L1Parameters::Size::PIN> pin = {0};
+	size_t threads = 4;
+	double duration = 10; // seconds
+	double rate = 0; // operations per second over all threads, 0 = closed loop
+	double interval = 1; // seconds between samples
+	string mix = "small=40,bulk=10,digest=20,find=25,login=5";
+	string out;
+	bool factory_init = false;
+};
+
+/* Log-linear latency histogram in the style of HdrHistogram: 128 sub-buckets for each power
+ * of two, values are kept with a relative error below 1%. */
+class Histogram {
+	static const int SUB_BITS = 7;
+	static const int SUB = 1 << SUB_BITS;
+	vector<uint64_t> counts;
+	uint64_t total = 0;
+	uint64_t max = 0;
+	double sum = 0;
+	static size_t Index(uint64_t v) {
+		if(v < SUB){
+			return (size_t)v;
+		}
+		int msb = 63 - __builtin_clzll(v);
+		int shift = msb - SUB_BITS;
+		return (size_t)((shift + 1) * SUB + ((v >> shift) - SUB));
+	}
+	static uint64_t Value(size_t i) {
+		if(i < SUB){
+			return i;
+		}
+		int shift = (int)(i / SUB) - 1;
+		return ((uint64_t)(SUB + i % SUB) << shift) + ((uint64_t)1 << shift) / 2; // middle of the bucket
+	}
+public:
+	Histogram() : counts((64 - SUB_BITS + 1) * SUB, 0) {}
+	void Record(uint64_t v) {
+		counts[Index(v)]++;
+		total++;
+		sum += (double)v;
+		max = (v > max) ? v : max;
+	}
+	void Merge(const Histogram& h) {
+		for(size_t i = 0; i < counts.size(); i++){
+			counts[i] += h.counts[i];
+		}
+		total += h.total;
+		sum += h.sum;
+		max = (h.max > max) ? h.max : max;
+	}
+	uint64_t Count() const { return total; }
+	uint64_t Max() const { return max; }
+	double Mean() const { return (total == 0) ? 0 : sum / total; }
+	uint64_t Percentile(double p) const {
+		uint64_t rank = (uint64_t)(p * total + 0.5), seen = 0;
+		for(size_t i = 0; i < counts.size(); i++){
+			seen += counts[i];
+			if(seen >= rank && seen > 0){
+				return (Value(i) < max) ? Value(i) : max;
+			}
+		}
+		return max;
+	}
+};
+
+struct OpStats {
+	Histogram latency;
+	uint64_t errors = 0;
+};
+
+struct Sample {
+	double t;
+	uint64_t ops;
+	uint64_t errors;
+	int sessions; // -1 if the list could not be read
+};
+
+enum { OP_SMALL, OP_BULK, OP_DIGEST, OP_FIND, OP_LOGIN, OP_COUNT };
+const char* opNames[OP_COUNT] = {"small", "bulk", "digest", "find", "login"};
+
+LoadConfig config;
+mutex deviceLock; // serializes every call to the shared L1 object
+atomic<uint64_t> completed(0), failed(0);
+
+bool ParseMix(const string& mix, array<unsigned, OP_COUNT>& weights) {
+	stringstream ss(mix);
+	string item;
+	weights.fill(0);
+	while(getline(ss, item, ',')){
+		size_t eq = item.find('=');
+		int op = -1;
+		for(int i = 0; i < OP_COUNT && eq != string::npos; i++){
+			if(item.compare(0, eq, opNames[i]) == 0){
+				op = i;
+			}
+		}
+		if(op < 0){
+			return false;
+		}
+		weights[op] = (unsigned)atoi(item.c_str() + eq + 1);
+	}
+	return (weights[OP_SMALL] + weights[OP_BULK] + weights[OP_DIGEST] + weights[OP_FIND] + weights[OP_LOGIN]) > 0;
+}
+
+bool ParseArgs(int argc, char* argv[]) {
+	for(int i = 1; i < argc; i++){
+		string a = argv[i];
+		bool more = (i + 1 < argc);
+		if(a == "--device" && more){
+			config.device = atoi(argv[++i]);
+		} else if(a == "--pin" && more){
+			string pin = argv[++i];
+			if(pin.size() > config.pin.size()){
+				return false;
+			}
+			config.pin.fill(0);
+			memcpy(config.pin.data(), pin.data(), pin.size());
+		} else if(a == "--threads" && more){
+			config.threads = max(1, atoi(argv[++i]));
+		} else if(a == "--duration" && more){
+			config.duration = atof(argv[++i]);
+		} else if(a == "--rate" && more){
+			config.rate = atof(argv[++i]);
+		} else if(a == "--interval" && more){
+			config.interval = atof(argv[++i]);
+		} else if(a == "--mix" && more){
+			config.mix = argv[++i];
+		} else if(a == "--out" && more){
+			config.out = argv[++i];
+		} else if(a == "--factory-init"){
+			config.factory_init = true;
+		} else {
+			return false;
+		}
+	}
+	return (config.duration > 0 && config.interval > 0 && config.rate >= 0);
+}
+
+/* one operation of the mix; exceptions are counted as errors by the caller */
+void Execute(L1* l1, int op, uint32_t key, mt19937_64& rng) {
+	static const size_t SMALL = 64, BULK = 64 * 1024, DIGEST = 4096;
+	switch(op){
+	case OP_SMALL:
+	case OP_BULK: {
+		size_t n = (op == OP_SMALL) ? SMALL : BULK;
+		shared_ptr<uint8_t[]> plaintext(new uint8_t[n]);
+		for(size_t i = 0; i < n; i++){
+			plaintext[i] = (uint8_t)rng();
+		}
+		SEcube_ciphertext encrypted;
+		lock_guard<mutex> guard(deviceLock);
+		if(op == OP_SMALL){
+			l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES_GCM, CryptoInitialisation::Modes::GCM, key);
+		} else {
+			l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR, key);
+		}
+		break;
+	}
+	case OP_DIGEST: {
+		shared_ptr<uint8_t[]> data(new uint8_t[DIGEST]);
+		for(size_t i = 0; i < DIGEST; i++){
+			data[i] = (uint8_t)rng();
+		}
+		SEcube_digest digest;
+		digest.algorithm = L1Algorithms::Algorithms::SHA256;
+		digest.key_id = 0;
+		digest.usenonce = false;
+		lock_guard<mutex> guard(deviceLock);
+		l1->L1Digest(DIGEST, data, digest);
+		break;
+	}
+	case OP_FIND: {
+		bool found = false;
+		lock_guard<mutex> guard(deviceLock);
+		l1->L1FindKey(key, found);
+		break;
+	}
+	case OP_LOGIN: {
+		lock_guard<mutex> guard(deviceLock);
+		l1->L1Logout();
+		l1->L1Login(config.pin, SE3_ACCESS_ADMIN, true);
+		break;
+	}
+	}
+}
+
+void Client(L1* l1, uint32_t key, unsigned seed, const array<unsigned, OP_COUNT>& weights, Clock::time_point end, vector<OpStats>& stats) {
+	mt19937_64 rng(seed);
+	discrete_distribution<int> pick(weights.begin(), weights.end());
+	exponential_distribution<double> arrival((config.rate > 0) ? config.rate / config.threads : 1);
+	Clock::time_point next = Clock::now();
+	while(true){
+		if(config.rate > 0){
+			next += chrono::duration_cast<Clock::duration>(chrono::duration<double>(arrival(rng)));
+			if(next >= end){
+				break;
+			}
+			this_thread::sleep_until(next); // returns at once when behind schedule
+		} else {
+			next = Clock::now();
+			if(next >= end){
+				break;
+			}
+		}
+		int op = pick(rng);
+		bool ok = true;
+		try{
+			Execute(l1, op, key, rng);
+		} catch (...) {
+			ok = false;
+		}
+		uint64_t ns = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(Clock::now() - next).count();
+		stats[op].latency.Record(ns);
+		if(!ok){
+			stats[op].errors++;
+			failed++;
+		}
+		completed++;
+	}
+}
+
+void Monitor(L1* l1, Clock::time_point start, Clock::time_point end, vector<Sample>& samples) {
+	Clock::time_point next = start;
+	while(true){
+		next += chrono::duration_cast<Clock::duration>(chrono::duration<double>(config.interval));
+		if(next > end){
+			break;
+		}
+		this_thread::sleep_until(next);
+		Sample s;
+		s.t = chrono::duration<double>(Clock::now() - start).count();
+		s.ops = completed;
+		s.errors = failed;
+		s.sessions = -1;
+		try{
+			se3CryptoSessionsStatus status;
+			lock_guard<mutex> guard(deviceLock);
+			l1->L1CryptoSessionsList(status);
+			s.sessions = (int)status.sessions.size();
+		} catch (...) {
+		}
+		samples.push_back(s);
+	}
+}
+
+void WriteJson(ostream& os, const string& device, double elapsed, const vector<OpStats>& ops, const vector<Sample>& samples) {
+	uint64_t total = 0, errors = 0;
+	for(const OpStats& s : ops){
+		total += s.latency.Count();
+		errors += s.errors;
+	}
+	os << "{\n  \"context\": {\"device\": \"" << device << "\", \"threads\": " << config.threads
+	   << ", \"duration_s\": " << config.duration << ", \"rate\": " << config.rate << ", \"mix\": \"" << config.mix << "\"},\n";
+	os << "  \"total\": {\"ops\": " << total << ", \"errors\": " << errors << ", \"ops_per_second\": " << total / elapsed << "},\n";
+	os << "  \"operations\": [";
+	bool first = true;
+	for(int i = 0; i < OP_COUNT; i++){
+		const Histogram& h = ops[i].latency;
+		if(h.Count() == 0){
+			continue;
+		}
+		os << (first ? "\n" : ",\n") << "    {\"name\": \"" << opNames[i] << "\", \"ops\": " << h.Count()
+		   << ", \"errors\": " << ops[i].errors << ", \"error_rate\": " << (double)ops[i].errors / h.Count()
+		   << ", \"ops_per_second\": " << h.Count() / elapsed << ", \"time_unit\": \"ns\", \"mean\": " << (uint64_t)h.Mean()
+		   << ", \"p50\": " << h.Percentile(0.50) << ", \"p90\": " << h.Percentile(0.90) << ", \"p99\": " << h.Percentile(0.99)
+		   << ", \"p999\": " << h.Percentile(0.999) << ", \"max\": " << h.Max() << "}";
+		first = false;
+	}
+	os << "\n  ],\n  \"timeline\": [";
+	for(size_t i = 0; i < samples.size(); i++){
+		os << ((i == 0) ? "\n" : ",\n") << "    {\"t\": " << samples[i].t << ", \"ops\": " << samples[i].ops
+		   << ", \"errors\": " << samples[i].errors << ", \"sessions\": " << samples[i].sessions << "}";
+	}
+	os << "\n  ]\n}\n";
+}
+
+}
+
+// RENAME THIS TO main()
+int secube_load(int argc, char* argv[]) {
+	array<unsigned, OP_COUNT> weights;
+	if(!ParseArgs(argc, argv) || !ParseMix(config.mix, weights)){
+		cerr << "Usage: secube_load [--device N] [--pin PIN] [--threads N] [--duration S] [--rate OPS] "
+				"[--mix small=W,bulk=W,digest=W,find=W,login=W] [--interval S] [--out FILE] [--factory-init]" << endl;
+		return -1;
+	}
+	unique_ptr<L0> l0 = make_unique<L0>();
+	unique_ptr<L1> l1 = make_unique<L1>();
+	vector<pair<string, string>> devices;
+	if(l0->GetDeviceList(devices) || config.device < 0 || config.device >= (int)devices.size()){
+		cerr << "SEcube device " << config.device << " not found. Quit." << endl;
+		return -1;
+	}
+	string path = devices.at(config.device).first;
+
+	// a key of the manual range, used by the encryptions and by L1FindKey
+	se3Key key;
+	array<uint8_t, 32> keyData;
+	key.id = 0;
+	try{
+		l1->L1SelectSEcube((uint8_t)config.device);
+		if(config.factory_init){
+			array<uint8_t, L0Communication::Size::SERIAL> sn;
+			sn.fill('0');
+			memcpy(sn.data(), "SEcubeLoad", 10);
+			try{
+				l1->L1FactoryInit(sn);
+			} catch (DeviceAlreadyInitializedException& e) {
+			}
+		}
+		l1->L1Login(config.pin, SE3_ACCESS_ADMIN, true);
+		vector<pair<uint32_t, uint16_t>> keys;
+		l1->L1KeyList(keys);
+		for(uint32_t id = L1Key::Id::MANUAL_ID_END; id >= L1Key::Id::MANUAL_ID_BEGIN && key.id == 0; id--){
+			bool used = false;
+			for(auto& k : keys){
+				used = used || (k.first == id);
+			}
+			key.id = used ? 0 : id;
+		}
+		if(key.id == 0){
+			cerr << "No free key ID in the manual range. Quit." << endl;
+			return -1;
+		}
+		L0Support::Se3Rand(keyData.size(), keyData.data());
+		key.dataSize = (uint16_t)keyData.size();
+		key.data = keyData.data();
+		l1->L1KeyEdit(key, L1Commands::KeyOpEdit::SE3_KEY_OP_ADD);
+	} catch (...) {
+		cerr << "Cannot login to " << path << ". Quit." << endl;
+		return -1;
+	}
+
+	vector<vector<OpStats>> stats(config.threads, vector<OpStats>(OP_COUNT));
+	vector<Sample> samples;
+	vector<thread> clients;
+	Clock::time_point start = Clock::now();
+	Clock::time_point end = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(config.duration));
+	random_device seed;
+	for(size_t i = 0; i < config.threads; i++){
+		clients.emplace_back(Client, l1.get(), key.id, seed(), cref(weights), end, ref(stats[i]));
+	}
+	thread monitor(Monitor, l1.get(), start, end, ref(samples));
+	for(thread& t : clients){
+		t.join();
+	}
+	monitor.join();
+	double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+	vector<OpStats> ops(OP_COUNT);
+	for(vector<OpStats>& s : stats){
+		for(int i = 0; i < OP_COUNT; i++){
+			ops[i].latency.Merge(s[i].latency);
+			ops[i].errors += s[i].errors;
+		}
+	}
+	try{
+		key.dataSize = 0;
+		key.data = nullptr;
+		l1->L1KeyEdit(key, L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE);
+		l1->L1Logout();
+	} catch (...) {
+		cerr << "Cannot delete key " << key.id << "." << endl;
+	}
+
+	if(config.out.empty()){
+		WriteJson(cout, path, elapsed, ops, samples);
+	} else {
+		ofstream f(config.out);
+		WriteJson(f, path, elapsed, ops, samples);
+	}
+	return 0;
+}
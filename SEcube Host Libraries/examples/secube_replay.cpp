@@ -0,0 +1,300 @@
+/**
+  ******************************************************************************
+  * File Name          : secube_replay.cpp
+  * Description        : replay of a recording of the L0 traffic.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  secube_replay.cpp
+ *  \brief Replay of a recording of the L0 traffic (see L0_recorder.h), with timing comparison in JSON.
+ *  \version SEcube SDK 1.5.1
+ *
+ *  The recorded requests are written verbatim on the magic file of the device, in the recorded
+ *  order, and each response is polled as L0RX() does. With --speed original every request is sent
+ *  at its recorded offset from the start of the recording, with --speed max as soon as possible.
+ *  The report compares, for each command, the recorded and replayed latency (from the start of the
+ *  write of the request to the end of the read of the response) and counts the responses whose
+ *  status differs from the recorded one.
+ *
+ *  Usage: secube_replay RECORDING [--device N] [--speed original|max] [--out FILE]
+ *  Redacted recordings are replayed with zero payloads, so most commands fail; L1 commands
+ *  encrypted with the session key of the recorded login do not reproduce their status either,
+ *  the timing is still meaningful. To replay against the in-process emulator, build with
+ *  -DSE3_CUBESIM and set SE3_CUBESIM_PATH (see se3_cubesim.h in the firmware).
+ */
+
+#include "../sources/L0/L0.h"
+#include "../sources/L0/L0_recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+struct ReplayConfig {
+	string recording;
+	int device = 0;
+	bool original_speed = true;
+	string out;
+};
+
+struct Record {
+	se3RecordHeader h;
+	vector<uint8_t> blocks;
+	int peer = -1; // index of the matching request or response, -1 if unmatched
+};
+
+struct CmdStats {
+	vector<double> recorded; // latency of each request, ns
+	vector<double> replayed;
+	uint64_t recorded_polls = 0;
+	uint64_t replayed_polls = 0;
+	size_t status_mismatch = 0;
+};
+
+ReplayConfig config;
+
+double Percentile(const vector<double>& sorted, double p) {
+	if(sorted.empty()){
+		return 0;
+	}
+	size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[min(i, sorted.size() - 1)];
+}
+
+bool ParseArgs(int argc, char* argv[]) {
+	for(int i = 1; i < argc; i++){
+		string a = argv[i];
+		bool more = (i + 1 < argc);
+		if(a == "--device" && more){
+			config.device = atoi(argv[++i]);
+		} else if(a == "--speed" && more){
+			string s = argv[++i];
+			if(s != "original" && s != "max"){
+				return false;
+			}
+			config.original_speed = (s == "original");
+		} else if(a == "--out" && more){
+			config.out = argv[++i];
+		} else if(a[0] != '-' && config.recording.empty()){
+			config.recording = a;
+		} else {
+			return false;
+		}
+	}
+	return !config.recording.empty();
+}
+
+/* read the recording and match every request with its response by cmdToken */
+bool Load(const string& path, vector<Record>& records) {
+	ifstream f(path, ios::binary);
+	se3RecordFileHeader fh;
+	if(!f.read((char*)&fh, sizeof(fh)) || memcmp(fh.magic, L0Record::MAGIC, sizeof(fh.magic)) || fh.version != L0Record::VERSION){
+		return false;
+	}
+	map<uint32_t, int> pending; // cmdToken -> index of the request
+	Record r;
+	while(f.read((char*)&r.h, sizeof(r.h))){
+		r.blocks.resize(r.h.size);
+		if(r.h.size > 0 && !f.read((char*)r.blocks.data(), r.h.size)){
+			return false;
+		}
+		r.peer = -1;
+		int i = (int)records.size();
+		if(!(r.h.flags & L0Record::Flags::FAILED)){
+			if(r.h.type == L0Record::Type::REQUEST){
+				pending[r.h.cmdToken] = i;
+			} else if(r.h.type == L0Record::Type::RESPONSE){
+				auto it = pending.find(r.h.cmdToken);
+				if(it != pending.end()){
+					r.peer = it->second;
+					records[it->second].peer = i;
+					pending.erase(it);
+				}
+			}
+		}
+		records.push_back(r);
+	}
+	return true;
+}
+
+/* blocks to write for a request; a redacted request is rebuilt from its header with a zero payload */
+void RequestBlocks(const Record& r, vector<uint8_t>& buf) {
+	buf.assign((size_t)r.h.nBlocks * L0Communication::Parameter::COMM_BLOCK, 0);
+	memcpy(buf.data(), r.blocks.data(), min(buf.size(), r.blocks.size()));
+	if(r.h.flags & L0Record::Flags::REDACTED){
+		for(uint16_t i = 1; i < r.h.nBlocks; i++){
+			uint32_t token = r.h.cmdToken + i;
+			SE3SET32(buf.data() + i * L0Communication::Parameter::COMM_BLOCK, L0Request::Offset::DATA_CMD_TOKEN, token);
+		}
+	}
+}
+
+/* poll the first block of the response until the one for cmdToken is ready, then read the others */
+bool ReadResponse(se3File hFile, uint32_t cmdToken, uint8_t* buf, uint32_t& polls, uint16_t& status) {
+	uint64_t deadline = L0Support::Se3Deadline(SE3_TIMEOUT);
+	uint16_t ready = 0, len = 0;
+	uint32_t token = 0;
+	polls = 0;
+	do{
+		if(L0Support::Se3Clock() > deadline){
+			return false;
+		}
+		Se3Sleep();
+		polls++;
+		if(!L0Support::Se3Read(buf, hFile, 0, 1, SE3_TIMEOUT)){
+			return false;
+		}
+		SE3GET16(buf, L0Response::Offset::SE3_RESP_OFFSET_READY, ready);
+		SE3GET32(buf, L0Response::Offset::CMD_TOKEN, token);
+	} while(ready != 1 || token != cmdToken);
+	SE3GET16(buf, L0Response::Offset::STATUS, status);
+	SE3GET16(buf, L0Response::Offset::LEN, len);
+	uint16_t nBlocks = L0Support::Se3NBlocks(len);
+	return nBlocks <= 1 || L0Support::Se3Read(buf + L0Communication::Parameter::COMM_BLOCK, hFile, 1, nBlocks - 1, SE3_TIMEOUT);
+}
+
+void WriteJson(ostream& os, const string& device, size_t replayed, map<uint16_t, CmdStats>& stats) {
+	os << "{\n  \"context\": {\"device\": \"" << device << "\", \"recording\": \"" << config.recording
+	   << "\", \"speed\": \"" << (config.original_speed ? "original" : "max") << "\", \"requests\": " << replayed
+	   << "},\n  \"commands\": [";
+	bool first = true;
+	for(auto& c : stats){
+		CmdStats& s = c.second;
+		sort(s.recorded.begin(), s.recorded.end());
+		sort(s.replayed.begin(), s.replayed.end());
+		double rec = 0, rep = 0;
+		for(size_t i = 0; i < s.recorded.size(); i++){
+			rec += s.recorded[i];
+			rep += s.replayed[i];
+		}
+		rec /= s.recorded.size();
+		rep /= s.replayed.size();
+		os << (first ? "\n" : ",\n") << "    {\"cmd\": " << c.first << ", \"count\": " << s.recorded.size()
+		   << ", \"time_unit\": \"ns\", \"recorded\": {\"mean\": " << (uint64_t)rec
+		   << ", \"p50\": " << (uint64_t)Percentile(s.recorded, 0.50) << ", \"p99\": " << (uint64_t)Percentile(s.recorded, 0.99)
+		   << ", \"polls\": " << s.recorded_polls << "}, \"replayed\": {\"mean\": " << (uint64_t)rep
+		   << ", \"p50\": " << (uint64_t)Percentile(s.replayed, 0.50) << ", \"p99\": " << (uint64_t)Percentile(s.replayed, 0.99)
+		   << ", \"polls\": " << s.replayed_polls << "}, \"delta_mean\": " << (int64_t)(rep - rec)
+		   << ", \"delta_p50\": " << (int64_t)(Percentile(s.replayed, 0.50) - Percentile(s.recorded, 0.50))
+		   << ", \"status_mismatch\": " << s.status_mismatch << "}";
+		first = false;
+	}
+	os << "\n  ]\n}\n";
+}
+
+}
+
+// RENAME THIS TO main()
+int secube_replay(int argc, char* argv[]) {
+	if(!ParseArgs(argc, argv)){
+		cerr << "Usage: secube_replay RECORDING [--device N] [--speed original|max] [--out FILE]" << endl;
+		return -1;
+	}
+	vector<Record> records;
+	if(!Load(config.recording, records)){
+		cerr << "Cannot read the recording " << config.recording << ". Quit." << endl;
+		return -1;
+	}
+	unique_ptr<L0> l0 = make_unique<L0>();
+	vector<pair<string, string>> devices;
+	if(l0->GetDeviceList(devices) || config.device < 0 || config.device >= (int)devices.size()){
+		cerr << "SEcube device " << config.device << " not found. Quit." << endl;
+		return -1;
+	}
+	string path = devices.at(config.device).first;
+#ifdef _WIN32
+	wstring drive(path.begin(), path.end());
+#else
+	string drive = path;
+#endif
+	se3File hFile;
+	uint8_t disco[L0Communication::Parameter::COMM_BLOCK];
+	uint16_t r = L0Support::Se3OpenExisting((se3Char*)drive.c_str(), true, L0Support::Se3Deadline(SE3_TIMEOUT), &hFile);
+	if(r == L0Communication::Error::ERR_NOT_FOUND){ // as L0Open(), create the magic file and try again
+		L0Support::Se3MagicInit((se3Char*)drive.c_str(), disco, nullptr);
+		r = L0Support::Se3OpenExisting((se3Char*)drive.c_str(), true, L0Support::Se3Deadline(SE3_TIMEOUT), &hFile);
+	}
+	if(r != L0Communication::Error::OK){
+		cerr << "Cannot open " << path << ". Quit." << endl;
+		return -1;
+	}
+
+	vector<uint8_t> request;
+	vector<uint8_t> response(L0Communication::Parameter::COMM_N * L0Communication::Parameter::COMM_BLOCK);
+	map<int, uint64_t> started; // index of the request -> replay time of its write
+	map<uint16_t, CmdStats> stats;
+	size_t replayed = 0;
+	bool ok = true;
+	auto origin = chrono::steady_clock::now();
+	auto since = [&origin]() {
+		return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count();
+	};
+	for(size_t i = 0; i < records.size() && ok; i++){
+		Record& r = records[i];
+		if(r.peer < 0){
+			continue; // failed or unanswered in the recording, nothing to compare
+		}
+		if(r.h.type == L0Record::Type::REQUEST){
+			if(config.original_speed && since() < r.h.start){
+				this_thread::sleep_for(chrono::nanoseconds(r.h.start - since()));
+			}
+			RequestBlocks(r, request);
+			started[(int)i] = since();
+			ok = L0Support::Se3Write(request.data(), hFile, 0, r.h.nBlocks, SE3_TIMEOUT);
+		} else {
+			Record& req = records[r.peer];
+			uint32_t polls = 0;
+			uint16_t status = 0, recordedStatus = 0, cmd = 0;
+			ok = ReadResponse(hFile, r.h.cmdToken, response.data(), polls, status);
+			if(ok){
+				SE3GET16(req.blocks.data(), L0Request::Offset::CMD, cmd);
+				SE3GET16(r.blocks.data(), L0Response::Offset::STATUS, recordedStatus);
+				CmdStats& s = stats[cmd];
+				s.recorded.push_back((double)(r.h.end - req.h.start));
+				s.replayed.push_back((double)(since() - started[r.peer]));
+				s.recorded_polls += r.h.polls;
+				s.replayed_polls += polls;
+				s.status_mismatch += (status != recordedStatus);
+				replayed++;
+			}
+		}
+	}
+	L0Support::Se3Close(hFile);
+	if(!ok){
+		cerr << "Communication error after " << replayed << " requests. Quit." << endl;
+		return -1;
+	}
+
+	if(config.out.empty()){
+		WriteJson(cout, path, replayed, stats);
+	} else {
+		ofstream f(config.out);
+		WriteJson(f, path, replayed, stats);
+	}
+	return 0;
+}
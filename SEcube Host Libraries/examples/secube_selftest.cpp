@@ -0,0 +1,1100 @@
+/**
+  ******************************************************************************
+  * File Name          : secube_selftest.cpp
+  * Description        : self-test of the SEcube firmware through the L1 API.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  secube_selftest.cpp
+ *  \brief Self-test of the SEcube firmware through the L1 API, exits with a non-zero status if any check fails.
+ *  \version SEcube SDK 1.5.1
+ *
+ *  Each test prints PASS or FAIL followed by its name, a failed test also prints what did not match.
+ *  The device is selected among the ones returned by GetDeviceList(); to run against the in-process
+ *  emulator, build with -DSE3_CUBESIM (see se3_cubesim.h in the firmware) and set SE3_CUBESIM_PATH,
+ *  the emulated device is listed first.
+ *
+ *  Comm checks, on the emulator, that a response left unread by a host is dropped once the response
+ *  to a newer request is read, and that L0Echo() succeeds at once after such a response. It also checks
+ *  that a read of a response requested with long-poll is held until the response is ready, or answered
+ *  "not ready" after SE3_COMM_HOLD_TIME (500 ms); the service time of ECHO is set to 0 afterwards.
+ *
+ *  Pipeline checks that the results of L1CryptoUpdateSend() match the ones of L1CryptoUpdate().
+ *
+ *  KeyCache checks that the contexts kept by the key cache of the SEcube, and the idle sessions kept by
+ *  L1Encrypt(), are not used any more once their key is deleted or replaced.
+ *
+ *  Sessions checks that the SEcube releases the sessions left idle for longer than the timeout set
+ *  with L1SetCryptoSessionTimeout(), and not earlier, that L1CryptoSessionsRenew() keeps them open, and
+ *  that the session memory exhausted by sessions never closed is recovered by L1CryptoSessionsRelease()
+ *  or by the timeout. These tests wait for the timeout, they take a few seconds.
+ *
+ *  AES runs the vectors of FIPS-197 appendix C and the ECB, CBC and CTR vectors of NIST SP 800-38A with
+ *  AES sessions, whole and split, checks a CTR counter that carries across its 32-bit words, and runs the
+ *  SP 800-38A vectors through L1Encrypt() and L1Decrypt().
+ *
+ *  GCM runs the test cases 1-4 and 13-16 of the GCM specification with AES_GCM sessions; every
+ *  vector is encrypted and decrypted, in one CRYPTO_UPDATE and split in two. ChaCha20-Poly1305 does
+ *  the same with the AEAD vector of RFC 8439.
+ *
+ *  CMAC checks AES_CMAC sessions against the examples of RFC 4493 and NIST SP 800-38B, whole and
+ *  split in two, and EAX checks AES_EAX sessions with vectors for the 96-bit nonce of L1Encrypt().
+ *
+ *  SHA256 runs the vectors of FIPS 180-2 through L1Digest() and through sessions in requests that split
+ *  the blocks. HMACSHA256 does the same with the test cases of RFC 4231, and checks that the HMAC of an
+ *  AES-HMACSHA256 session restarted with RESET for every message matches the one computed on the host.
+ *  BLAKE2S checks the vector of RFC 7693 and keyed vectors of the BLAKE2 reference KAT, in requests split at
+ *  the 64-byte block and around it.
+ *
+ *  Usage: secube_selftest [--device N] [--pin PIN] [--filter TEXT] [--factory-init]
+ *  --factory-init sets a serial number on a device without one (i.e. a new emulator).
+ *  The PIN is the admin PIN, all zeros if not given. Keys are added in the manual range
+ *  (see L1Key::Id) by the tests and deleted at the end.
+ */
+
+#include "../sources/L1/L1.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread> // sleep_for
+
+using namespace std;
+
+namespace {
+
+struct SelftestConfig {
+	int device = 0;
+	array<uint8_t, L1Parameters::Size::PIN> pin = {0};
+	string filter;
+	bool factory_init = false;
+};
+
+SelftestConfig config;
+size_t passed = 0;
+size_t failed = 0;
+vector<uint32_t> keyIds; // manual range IDs free at start, used by the tests
+
+/* run test if its name matches --filter; a test fails by throwing */
+void Test(const string& name, function<void()> test) {
+	if(!config.filter.empty() && name.find(config.filter) == string::npos){
+		return;
+	}
+	try{
+		test();
+		passed++;
+		cout << "PASS " << name << endl;
+	} catch (exception& e) {
+		failed++;
+		cout << "FAIL " << name << ": " << e.what() << endl;
+	}
+}
+
+vector<uint8_t> FromHex(const string& s) {
+	vector<uint8_t> v;
+	for(size_t i = 0; i + 1 < s.size(); i += 2){
+		v.push_back((uint8_t)stoul(s.substr(i, 2), nullptr, 16));
+	}
+	return v;
+}
+
+string ToHex(const vector<uint8_t>& v) {
+	static const char digits[] = "0123456789abcdef";
+	string s;
+	for(uint8_t b : v){
+		s += digits[b >> 4];
+		s += digits[b & 0x0F];
+	}
+	return s;
+}
+
+void Expect(bool ok, const string& what) {
+	if(!ok){
+		throw runtime_error(what);
+	}
+}
+
+void ExpectEqual(const vector<uint8_t>& got, const vector<uint8_t>& expected, const string& what) {
+	if(got != expected){
+		throw runtime_error(what + ": got " + ToHex(got) + ", expected " + ToHex(expected));
+	}
+}
+
+bool ParseArgs(int argc, char* argv[]) {
+	for(int i = 1; i < argc; i++){
+		string a = argv[i];
+		bool more = (i + 1 < argc);
+		if(a == "--device" && more){
+			config.device = atoi(argv[++i]);
+		} else if(a == "--pin" && more){
+			string pin = argv[++i];
+			if(pin.size() > config.pin.size()){
+				return false;
+			}
+			config.pin.fill(0);
+			memcpy(config.pin.data(), pin.data(), pin.size());
+		} else if(a == "--filter" && more){
+			config.filter = argv[++i];
+		} else if(a == "--factory-init"){
+			config.factory_init = true;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* IDs of the manual range not used on the device, highest first */
+vector<uint32_t> FreeKeyIds(L1* l1, size_t n) {
+	vector<pair<uint32_t, uint16_t>> keys;
+	vector<uint32_t> ids;
+	l1->L1KeyList(keys);
+	for(uint32_t id = L1Key::Id::MANUAL_ID_END; id >= L1Key::Id::MANUAL_ID_BEGIN && ids.size() < n; id--){
+		bool used = false;
+		for(auto& k : keys){
+			used = used || (k.first == id);
+		}
+		if(!used){
+			ids.push_back(id);
+		}
+	}
+	return ids;
+}
+
+void AddKey(L1* l1, uint32_t id, vector<uint8_t> data) {
+	se3Key k;
+	k.id = id;
+	k.dataSize = (uint16_t)data.size();
+	k.data = data.data();
+	k.policy = L1Key::Policy::NONE;
+	l1->L1KeyEdit(k, L1Commands::KeyOpEdit::SE3_KEY_OP_ADD);
+}
+
+void DeleteKey(L1* l1, uint32_t id) {
+	se3Key k;
+	k.id = id;
+	k.dataSize = 0;
+	k.data = nullptr;
+	l1->L1KeyEdit(k, L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE);
+}
+
+/* delete the keys added by the tests, including the ones left by a failed test */
+void DeleteTestKeys(L1* l1) {
+	vector<pair<uint32_t, uint16_t>> keys;
+	l1->L1KeyList(keys);
+	for(auto& k : keys){
+		if(find(keyIds.begin(), keyIds.end(), k.first) != keyIds.end()){
+			DeleteKey(l1, k.first);
+		}
+	}
+}
+
+/* FIPS-197 appendix C: the first 16, 24 or 32 bytes of the key, and the plaintext */
+const string fipsKey = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+const string fipsPlaintext = "00112233445566778899aabbccddeeff";
+
+/* AES-ECB of one block computed on the host */
+vector<uint8_t> HostEcbEncrypt(vector<uint8_t> key, vector<uint8_t> in) {
+	B5_tAesCtx ctx;
+	vector<uint8_t> out(B5_AES_BLK_SIZE);
+	Expect(B5_Aes256_Init(&ctx, key.data(), (int16_t)key.size(), B5_AES256_ECB_ENC) == B5_AES256_RES_OK, "B5_Aes256_Init");
+	Expect(B5_Aes256_Update(&ctx, out.data(), in.data(), 1) == B5_AES256_RES_OK, "B5_Aes256_Update");
+	return out;
+}
+
+/* true if op throws an L1 exception */
+bool Refused(function<void()> op) {
+	try{
+		op();
+	} catch (L1Exception& e) {
+		return true;
+	}
+	return false;
+}
+
+uint32_t OpenEcb(L1* l1, uint32_t key) {
+	uint32_t sid = 0;
+	l1->L1CryptoInit(L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::ECB | CryptoInitialisation::Direction::ENCRYPT, key, sid);
+	return sid;
+}
+
+vector<uint8_t> EcbFinit(L1* l1, uint32_t sid, vector<uint8_t> in) {
+	vector<uint8_t> out(in.size());
+	uint16_t outLen = 0;
+	l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, 0, nullptr, (uint16_t)in.size(), in.data(), &outLen, out.data());
+	Expect(outLen == in.size(), "AES-ECB output size");
+	return out;
+}
+
+/* one CRYPTO_INIT and one CRYPTO_UPDATE with FINIT */
+vector<uint8_t> EcbEncrypt(L1* l1, uint32_t key, vector<uint8_t> in) {
+	return EcbFinit(l1, OpenEcb(l1, key), in);
+}
+
+/* AES with a session of mode (including the direction), in requests of chunk bytes; iv is set with
+ * the first request if not empty */
+vector<uint8_t> Aes(L1* l1, uint32_t key, uint16_t mode, vector<uint8_t> iv, vector<uint8_t> in, size_t chunk) {
+	vector<uint8_t> out(in.size());
+	uint16_t outLen = 0;
+	uint16_t flags = iv.empty() ? 0 : (uint16_t)L1Crypto::UpdateFlags::SET_IV;
+	uint32_t sid = 0;
+	size_t done = 0;
+	l1->L1CryptoInit(L1Algorithms::Algorithms::AES, mode, key, sid);
+	while(done < in.size()){
+		size_t n = min(chunk, in.size() - done);
+		if(done + n == in.size()){
+			flags |= L1Crypto::UpdateFlags::FINIT;
+		}
+		bool setIv = (flags & L1Crypto::UpdateFlags::SET_IV) != 0;
+		l1->L1CryptoUpdate(sid, flags, setIv ? B5_AES_BLK_SIZE : 0, setIv ? iv.data() : nullptr, (uint16_t)n, in.data() + done, &outLen, out.data() + done);
+		Expect(outLen == n, "AES output size");
+		done += n;
+		flags = 0;
+	}
+	return out;
+}
+
+/* AES-CTR computed on the host, one block at a time with the counter incremented as a 128-bit big-endian number */
+vector<uint8_t> HostCtr(vector<uint8_t> key, vector<uint8_t> counter, vector<uint8_t> in) {
+	vector<uint8_t> out(in.size());
+	for(size_t i = 0; i < in.size(); i += B5_AES_BLK_SIZE){
+		vector<uint8_t> ks = HostEcbEncrypt(key, counter);
+		for(size_t j = 0; j < B5_AES_BLK_SIZE; j++){
+			out[i + j] = in[i + j] ^ ks[j];
+		}
+		for(size_t j = B5_AES_BLK_SIZE; j-- > 0 && ++counter[j] == 0; );
+	}
+	return out;
+}
+
+/* FIPS-197 appendix C and NIST SP 800-38A F.1, F.2 and F.5 with AES sessions, in one CRYPTO_UPDATE and in
+ * requests of 48 bytes; a counter that carries across all its words; the SP 800-38A vectors through
+ * L1Encrypt() and L1Decrypt(), with their PKCS#7 padding block */
+void TestAes(L1* l1) {
+	const string p = "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+	const string k128 = "2b7e151628aed2a6abf7158809cf4f3c", k256 = "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4";
+	const string iv = "000102030405060708090a0b0c0d0e0f", ctr = "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+	const uint16_t ENC = CryptoInitialisation::Direction::ENCRYPT, DEC = CryptoInitialisation::Direction::DECRYPT;
+	uint32_t id = keyIds.at(0);
+	struct { const char* name; string key; string ciphertext; } fips[] = {
+		{"AES-128", fipsKey.substr(0, 32), "69c4e0d86a7b0430d8cdb78070b4c55a"},
+		{"AES-192", fipsKey.substr(0, 48), "dda97ca4864cdfe06eaf70a0ec0d7191"},
+		{"AES-256", fipsKey, "8ea2b7ca516745bfeafc49904b496089"}
+	};
+	for(auto& v : fips){
+		AddKey(l1, id, FromHex(v.key));
+		Test("AES/FIPS-197/" + string(v.name), [&]{
+			ExpectEqual(Aes(l1, id, CryptoInitialisation::Modes::ECB | ENC, {}, FromHex(fipsPlaintext), SIZE_MAX), FromHex(v.ciphertext), "ciphertext");
+			ExpectEqual(Aes(l1, id, CryptoInitialisation::Modes::ECB | DEC, {}, FromHex(v.ciphertext), SIZE_MAX), FromHex(fipsPlaintext), "plaintext");
+		});
+		DeleteKey(l1, id);
+	}
+	struct { const char* name; string key; uint16_t mode; string iv; string ciphertext; } sp[] = {
+		{"ECB-AES128", k128, CryptoInitialisation::Modes::ECB, "", "3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf43b1cd7f598ece23881b00e3ed0306887b0c785e27e8ad3f8223207104725dd4"},
+		{"ECB-AES256", k256, CryptoInitialisation::Modes::ECB, "", "f3eed1bdb5d2a03c064b5a7e3db181f8591ccb10d410ed26dc5ba74a31362870b6ed21b99ca6f4f9f153e7b1beafed1d23304b7a39f9f3ff067d8d8f9e24ecc7"},
+		{"CBC-AES128", k128, CryptoInitialisation::Modes::CBC, iv, "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b273bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7"},
+		{"CBC-AES256", k256, CryptoInitialisation::Modes::CBC, iv, "f58c4c04d6e5f1ba779eabfb5f7bfbd69cfc4e967edb808d679f777bc6702c7d39f23369a9d9bacfa530e26304231461b2eb05e2c39be9fcda6c19078c6a9d1b"},
+		{"CTR-AES128", k128, CryptoInitialisation::Modes::CTR, ctr, "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee"},
+		{"CTR-AES256", k256, CryptoInitialisation::Modes::CTR, ctr, "601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cacaf5c52b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd08457941a6"}
+	};
+	for(auto& v : sp){
+		AddKey(l1, id, FromHex(v.key));
+		for(size_t chunk : {SIZE_MAX, (size_t)48}){
+			string name = "AES/SP800-38A/" + string(v.name) + ((chunk == SIZE_MAX) ? "" : "/split");
+			Test(name + "/encrypt", [&]{
+				ExpectEqual(Aes(l1, id, v.mode | ENC, FromHex(v.iv), FromHex(p), chunk), FromHex(v.ciphertext), "ciphertext");
+			});
+			Test(name + "/decrypt", [&]{
+				ExpectEqual(Aes(l1, id, v.mode | DEC, FromHex(v.iv), FromHex(v.ciphertext), chunk), FromHex(p), "plaintext");
+			});
+		}
+		DeleteKey(l1, id);
+	}
+	AddKey(l1, id, FromHex(k128));
+	const string wrap = "f0f1f2f3fffffffffffffffffffffffe"; // the third block carries into the first word
+	for(size_t chunk : {SIZE_MAX, (size_t)16, (size_t)48}){
+		Test("AES/CTR/counter-wrap/" + ((chunk == SIZE_MAX) ? string("whole") : to_string(chunk)), [&]{
+			ExpectEqual(Aes(l1, id, CryptoInitialisation::Modes::CTR | ENC, FromHex(wrap), FromHex(p), chunk), HostCtr(FromHex(k128), FromHex(wrap), FromHex(p)), "ciphertext");
+		});
+	}
+	vector<uint8_t> pad(B5_AES_BLK_SIZE, B5_AES_BLK_SIZE); // PKCS#7 padding of a message of whole blocks
+	Test("AES/L1Encrypt/ECB-AES128", [&]{
+		vector<uint8_t> in = FromHex(p), expected = FromHex(sp[0].ciphertext), padBlock = HostEcbEncrypt(FromHex(k128), pad);
+		shared_ptr<uint8_t[]> plaintext(new uint8_t[in.size()]), decrypted;
+		size_t decryptedSize = 0;
+		SEcube_ciphertext encrypted;
+		memcpy(plaintext.get(), in.data(), in.size());
+		expected.insert(expected.end(), padBlock.begin(), padBlock.end());
+		l1->L1Encrypt(in.size(), plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::ECB, id);
+		ExpectEqual(vector<uint8_t>(encrypted.ciphertext.get(), encrypted.ciphertext.get() + encrypted.ciphertext_size), expected, "ciphertext");
+		l1->L1Decrypt(encrypted, decryptedSize, decrypted);
+		ExpectEqual(vector<uint8_t>(decrypted.get(), decrypted.get() + decryptedSize), in, "plaintext");
+	});
+	Test("AES/L1Decrypt/CBC-AES128", [&]{
+		vector<uint8_t> in = FromHex(sp[2].ciphertext), last(in.end() - B5_AES_BLK_SIZE, in.end());
+		for(size_t i = 0; i < B5_AES_BLK_SIZE; i++){
+			last[i] ^= pad[i];
+		}
+		vector<uint8_t> padBlock = HostEcbEncrypt(FromHex(k128), last);
+		in.insert(in.end(), padBlock.begin(), padBlock.end());
+		SEcube_ciphertext encrypted;
+		shared_ptr<uint8_t[]> decrypted;
+		size_t decryptedSize = 0;
+		encrypted.algorithm = L1Algorithms::Algorithms::AES;
+		encrypted.mode = CryptoInitialisation::Modes::CBC;
+		encrypted.key_id = id;
+		vector<uint8_t> ivBytes = FromHex(iv);
+		copy(ivBytes.begin(), ivBytes.end(), encrypted.initialization_vector.begin());
+		encrypted.ciphertext = make_unique<uint8_t[]>(in.size());
+		memcpy(encrypted.ciphertext.get(), in.data(), in.size());
+		encrypted.ciphertext_size = in.size();
+		l1->L1Decrypt(encrypted, decryptedSize, decrypted);
+		ExpectEqual(vector<uint8_t>(decrypted.get(), decrypted.get() + decryptedSize), FromHex(p), "plaintext");
+	});
+	DeleteKey(l1, id);
+}
+
+struct AeadVector {
+	const char* name;
+	string key, iv, aad, plaintext, ciphertext, tag;
+};
+
+/* one AEAD operation: RESET with the IV followed by the AAD, then the input in two requests
+ * if split is shorter than it, the last one with AUTH and FINIT; returns the output followed
+ * by the tag computed by the SEcube */
+vector<uint8_t> Aead(L1* l1, uint16_t algorithm, uint16_t mode, uint32_t key, const AeadVector& v, vector<uint8_t> in, size_t split) {
+	vector<uint8_t> data1 = FromHex(v.iv), aad = FromHex(v.aad), out;
+	vector<uint8_t> buf(L1Crypto::UpdateSize::DATAOUT);
+	uint16_t outLen = 0;
+	uint16_t flags = L1Crypto::UpdateFlags::RESET;
+	uint32_t sid = 0;
+	size_t done = 0;
+	data1.insert(data1.end(), aad.begin(), aad.end());
+	l1->L1CryptoInit(algorithm, mode, key, sid);
+	if(split < in.size()){
+		l1->L1CryptoUpdate(sid, flags, (uint16_t)data1.size(), data1.data(), (uint16_t)split, in.data(), &outLen, buf.data());
+		Expect(outLen == split, "output size of the first request");
+		out.assign(buf.begin(), buf.begin() + outLen);
+		data1.clear();
+		flags = 0;
+		done = split;
+	}
+	flags |= L1Crypto::UpdateFlags::AUTH | L1Crypto::UpdateFlags::FINIT;
+	l1->L1CryptoUpdate(sid, flags, (uint16_t)data1.size(), data1.data(), (uint16_t)(in.size() - done), in.data() + done, &outLen, buf.data());
+	out.insert(out.end(), buf.begin(), buf.begin() + outLen);
+	return out;
+}
+
+/* each vector encrypted and decrypted in one request, and in two requests split after
+ * the given number of bytes if the text is longer */
+void TestAead(L1* l1, const string& group, uint16_t algorithm, uint16_t mode, const vector<AeadVector>& vectors, size_t split) {
+	for(const AeadVector& v : vectors){
+		string name = group + "/" + v.name;
+		vector<uint8_t> plaintext = FromHex(v.plaintext), ciphertext = FromHex(v.ciphertext), tag = FromHex(v.tag);
+		vector<uint8_t> sealed = ciphertext, opened = plaintext;
+		sealed.insert(sealed.end(), tag.begin(), tag.end());
+		opened.insert(opened.end(), tag.begin(), tag.end());
+		uint32_t id = keyIds.at(0);
+		AddKey(l1, id, FromHex(v.key));
+		Test(name + "/encrypt", [&]{
+			ExpectEqual(Aead(l1, algorithm, mode | CryptoInitialisation::Direction::ENCRYPT, id, v, plaintext, SIZE_MAX), sealed, "ciphertext and tag");
+		});
+		Test(name + "/decrypt", [&]{
+			ExpectEqual(Aead(l1, algorithm, mode | CryptoInitialisation::Direction::DECRYPT, id, v, ciphertext, SIZE_MAX), opened, "plaintext and tag");
+		});
+		if(plaintext.size() > split){
+			Test(name + "/split", [&]{
+				ExpectEqual(Aead(l1, algorithm, mode | CryptoInitialisation::Direction::ENCRYPT, id, v, plaintext, split), sealed, "ciphertext and tag");
+				ExpectEqual(Aead(l1, algorithm, mode | CryptoInitialisation::Direction::DECRYPT, id, v, ciphertext, split), opened, "plaintext and tag");
+			});
+		}
+		DeleteKey(l1, id);
+	}
+}
+
+/* test cases 1-4 and 13-16 of the GCM specification (McGrew and Viega), AES-128 and AES-256 */
+void TestGcm(L1* l1) {
+	const string p = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255";
+	const string k = "feffe9928665731c6d6a8f9467308308", iv = "cafebabefacedbaddecaf888", aad = "feedfacedeadbeeffeedfacedeadbeefabaddad2";
+	const string c3 = "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985";
+	const string c15 = "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662898015ad";
+	const string zero128(32, '0'), zero256(64, '0'), zero96(24, '0');
+	vector<AeadVector> vectors = {
+		{"TC1", zero128, zero96, "", "", "", "58e2fccefa7e3061367f1d57a4e7455a"},
+		{"TC2", zero128, zero96, "", zero128, "0388dace60b6a392f328c2b971b2fe78", "ab6e47d42cec13bdf53a67b21257bddf"},
+		{"TC3", k, iv, "", p, c3, "4d5c2af327cd64a62cf35abd2ba6fab4"},
+		{"TC4", k, iv, aad, p.substr(0, 120), c3.substr(0, 120), "5bc94fbc3221a5db94fae95ae7121a47"},
+		{"TC13", zero256, zero96, "", "", "", "530f8afbc74536b9a963b4f1c4cb738b"},
+		{"TC14", zero256, zero96, "", zero128, "cea7403d4d606b6e074ec5d3baf39d18", "d0d1c8a799996bf0265b98b5d48ab919"},
+		{"TC15", k + k, iv, "", p, c15, "b094dac5d93471bdec1a502270e3cc6c"},
+		{"TC16", k + k, iv, aad, p.substr(0, 120), c15.substr(0, 120), "76fc6ece0f4e1768cddf8853bb2d551b"}
+	};
+	TestAead(l1, "GCM", L1Algorithms::Algorithms::AES_GCM, CryptoInitialisation::Modes::GCM, vectors, 32);
+}
+
+/* RFC 8439 section 2.8.2 */
+void TestChaCha20Poly1305(L1* l1) {
+	vector<AeadVector> vectors = {
+		{"RFC8439", "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f", "070000004041424344454647", "50515253c0c1c2c3c4c5c6c7",
+		 "4c616469657320616e642047656e746c656d656e206f662074686520636c617373206f66202739393a204966204920636f756c64206f6666657220796f75206f6e6c79206f6e652074697020666f7220746865206675747572652c2073756e73637265656e20776f756c642062652069742e",
+		 "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc3ff4def08e4b7a9de576d26586cec64b6116",
+		 "1ae10b594f09e26a7e902ecbd0600691"}
+	};
+	TestAead(l1, "ChaCha20-Poly1305", L1Algorithms::Algorithms::CHACHA20_POLY1305, 0, vectors, 64);
+}
+
+/* CMAC of a message in one CRYPTO_UPDATE, or in two split after the given number of bytes if
+ * the message is longer; the message is data1, data2 is not used */
+vector<uint8_t> Cmac(L1* l1, uint32_t key, vector<uint8_t> message, size_t split) {
+	vector<uint8_t> out(L1Crypto::UpdateSize::DATAOUT);
+	uint8_t unused[B5_AES_BLK_SIZE] = {0}; // CRYPTO_UPDATE needs some data, for the empty message
+	uint16_t outLen = 0;
+	uint32_t sid = 0;
+	size_t done = 0;
+	l1->L1CryptoInit(L1Algorithms::Algorithms::AES_CMAC, 0, key, sid);
+	if(split < message.size()){
+		l1->L1CryptoUpdate(sid, 0, (uint16_t)split, message.data(), 0, nullptr, &outLen, out.data());
+		done = split;
+	}
+	l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, (uint16_t)(message.size() - done), message.data() + done,
+			sizeof(unused), unused, &outLen, out.data());
+	out.resize(outLen);
+	return out;
+}
+
+/* RFC 4493 (AES-128) and NIST SP 800-38B (AES-256) examples */
+void TestCmac(L1* l1) {
+	const string m = "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+	struct { const char* name; string key; size_t length; string tag; } vectors[] = {
+		{"AES-128/0", "2b7e151628aed2a6abf7158809cf4f3c", 0, "bb1d6929e95937287fa37d129b756746"},
+		{"AES-128/16", "2b7e151628aed2a6abf7158809cf4f3c", 16, "070a16b46b4d4144f79bdd9dd04a287c"},
+		{"AES-128/40", "2b7e151628aed2a6abf7158809cf4f3c", 40, "dfa66747de9ae63030ca32611497c827"},
+		{"AES-128/64", "2b7e151628aed2a6abf7158809cf4f3c", 64, "51f0bebf7e3b9d92fc49741779363cfe"},
+		{"AES-256/0", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", 0, "028962f61b7bf89efc6b551f4667d983"},
+		{"AES-256/16", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", 16, "28a7023f452e8f82bd4bf28d8c37c35c"},
+		{"AES-256/40", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", 40, "aaf3d8f1de5640c232f5b169b9c911e6"},
+		{"AES-256/64", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", 64, "e1992190549f6ed5696a2c056c315410"}
+	};
+	for(auto& v : vectors){
+		uint32_t id = keyIds.at(0);
+		vector<uint8_t> message = FromHex(m.substr(0, 2 * v.length));
+		AddKey(l1, id, FromHex(v.key));
+		Test("CMAC/" + string(v.name), [&]{
+			ExpectEqual(Cmac(l1, id, message, SIZE_MAX), FromHex(v.tag), "tag");
+		});
+		if(v.length > B5_AES_BLK_SIZE){ // the last block is kept for FINIT even if complete
+			Test("CMAC/" + string(v.name) + "/split", [&]{
+				ExpectEqual(Cmac(l1, id, message, B5_AES_BLK_SIZE), FromHex(v.tag), "tag");
+			});
+		}
+		DeleteKey(l1, id);
+	}
+}
+
+/* EAX with the 96-bit nonce used by L1Encrypt(), the plaintext, key and AAD of the GCM test cases 4 and 16 */
+void TestEax(L1* l1) {
+	const string p = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39";
+	const string k = "feffe9928665731c6d6a8f9467308308", iv = "cafebabefacedbaddecaf888", aad = "feedfacedeadbeeffeedfacedeadbeefabaddad2";
+	vector<AeadVector> eax = {
+		{"AES-128", k, iv, aad, p, "206760741b9e5b75eaa69c401709f41b67b9b92d559953f31a892d17619f14ee8ca8c56d81522be3831d4503b1903302079b7863c7e4d8869196996e", "86465458445f4cd43787dadcebb8ce97"},
+		{"AES-256", k + k, iv, aad, p, "296dcf4347999a5be4f185d9bc8f6e7fe778bd02ef3fae616d048d4a9ce938d6b3a4289d4317db6d40a78e77592bcaccdd204333b0c6a7ba4e0d6ced", "0ec90a2a81d55105a7eebc9890a4b9eb"},
+		{"AES-256/empty", k + k, iv, "", "", "", "cd7ed850f64758c55bc18574e2afab3c"}
+	};
+	TestAead(l1, "EAX", L1Algorithms::Algorithms::AES_EAX, CryptoInitialisation::Modes::CTR, eax, 32);
+}
+
+vector<uint8_t> Bytes(const string& s) {
+	return vector<uint8_t>(s.begin(), s.end());
+}
+
+/* digest of a message with a session of algorithm, in requests of chunk bytes (at most DATAIN) with
+ * the last one FINIT; the message is data1, data2 is not used, key is not used by the plain digests */
+vector<uint8_t> Digest(L1* l1, uint16_t algorithm, uint32_t key, const vector<uint8_t>& message, size_t chunk) {
+	vector<uint8_t> out(L1Crypto::UpdateSize::DATAOUT);
+	uint8_t unused[B5_AES_BLK_SIZE] = {0}; // CRYPTO_UPDATE needs some data, for the empty message
+	uint16_t outLen = 0;
+	uint32_t sid = 0;
+	size_t done = 0;
+	chunk = min(chunk, (size_t)L1Crypto::UpdateSize::DATAIN);
+	l1->L1CryptoInit(algorithm, 0, key, sid);
+	while(message.size() - done > chunk){
+		l1->L1CryptoUpdate(sid, 0, (uint16_t)chunk, (uint8_t*)message.data() + done, 0, nullptr, &outLen, out.data());
+		done += chunk;
+	}
+	l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::FINIT, (uint16_t)(message.size() - done), (uint8_t*)message.data() + done,
+			sizeof(unused), unused, &outLen, out.data());
+	out.resize(outLen);
+	return out;
+}
+
+/* the digest returned by L1Digest(); with HMAC-SHA256 and keyed BLAKE2s the nonce, if not empty, is
+ * digested before the data */
+vector<uint8_t> L1DigestOf(L1* l1, uint16_t algorithm, uint32_t key, const vector<uint8_t>& nonce, vector<uint8_t> data) {
+	shared_ptr<uint8_t[]> input(new uint8_t[data.size()]);
+	SEcube_digest digest;
+	memcpy(input.get(), data.data(), data.size());
+	digest.algorithm = algorithm;
+	digest.key_id = key;
+	digest.usenonce = !nonce.empty();
+	if(digest.usenonce){
+		copy(nonce.begin(), nonce.end(), digest.digest_nonce.begin());
+	}
+	l1->L1Digest(data.size(), input, digest);
+	return vector<uint8_t>(digest.digest.begin(), digest.digest.end());
+}
+
+/* FIPS 180-2 appendix B: "abc", the 448-bit message and one million 'a', with L1Digest() and with sessions
+ * in requests that are not a multiple of the block */
+void TestSha256(L1* l1) {
+	struct { const char* name; vector<uint8_t> message; string digest; size_t chunk; } vectors[] = {
+		{"abc", Bytes("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", 1},
+		{"448-bit", Bytes("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+		 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", 7},
+		{"million-a", vector<uint8_t>(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", 4000}
+	};
+	for(auto& v : vectors){
+		Test("SHA256/FIPS-180-2/" + string(v.name) + "/L1Digest", [&]{
+			ExpectEqual(L1DigestOf(l1, L1Algorithms::Algorithms::SHA256, L1Key::Id::NULL_ID, {}, v.message), FromHex(v.digest), "digest");
+		});
+		Test("SHA256/FIPS-180-2/" + string(v.name) + "/split", [&]{
+			ExpectEqual(Digest(l1, L1Algorithms::Algorithms::SHA256, L1Key::Id::NULL_ID, v.message, v.chunk), FromHex(v.digest), "digest");
+		});
+	}
+}
+
+/* a key the SEcube can store (16, 24 or 32 bytes) giving the same HMAC-SHA256 as key: a key longer than
+ * the block is replaced by its SHA-256, a shorter one is padded with zeros to the block */
+vector<uint8_t> HmacKey(vector<uint8_t> key) {
+	if(key.size() > B5_SHA256_BLOCK_SIZE){
+		B5_tSha256Ctx sha;
+		vector<uint8_t> digest(B5_SHA256_DIGEST_SIZE);
+		B5_Sha256_Init(&sha);
+		B5_Sha256_Update(&sha, key.data(), (int32_t)key.size());
+		B5_Sha256_Finit(&sha, digest.data());
+		return digest;
+	}
+	key.resize((key.size() <= B5_AES_128) ? B5_AES_128 : (key.size() <= B5_AES_192) ? B5_AES_192 : B5_AES_256, 0);
+	return key;
+}
+
+/* RFC 4231 test cases 1-7 with sessions, whole and in requests of 13 bytes; the cases longer than the
+ * nonce of L1Digest() also through it, with their first 32 bytes as the nonce. The keys are stored as
+ * given by HmacKey(). AES-HMACSHA256 sessions
+ * restart the HMAC with RESET for each message, checked against the HMAC of the IV and the ciphertext
+ * computed on the host */
+void TestHmacSha256(L1* l1) {
+	const string k131(131 * 2, 'a');
+	struct { const char* name; string key; vector<uint8_t> data; string mac; } vectors[] = {
+		{"TC1", "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b", Bytes("Hi There"), "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"},
+		{"TC2", "4a656665", Bytes("what do ya want for nothing?"), "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+		{"TC3", string(40, 'a'), vector<uint8_t>(50, 0xdd), "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe"},
+		{"TC4", "0102030405060708090a0b0c0d0e0f10111213141516171819", vector<uint8_t>(50, 0xcd), "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b"},
+		{"TC5", "0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c", Bytes("Test With Truncation"), "a3b6167473100ee06e0c796c2955552b"}, // truncated to 128 bits
+		{"TC6", k131, Bytes("Test Using Larger Than Block-Size Key - Hash Key First"), "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"},
+		{"TC7", k131, Bytes("This is a test using a larger than block-size key and a larger than block-size data. The key needs to be hashed before being used by the HMAC algorithm."),
+		 "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2"}
+	};
+	uint32_t id = keyIds.at(0);
+	for(auto& v : vectors){
+		vector<uint8_t> mac = FromHex(v.mac);
+		AddKey(l1, id, HmacKey(FromHex(v.key)));
+		for(size_t chunk : {SIZE_MAX, (size_t)13}){
+			Test("HMACSHA256/RFC4231/" + string(v.name) + (chunk == SIZE_MAX ? "" : "/split"), [&]{
+				vector<uint8_t> out = Digest(l1, L1Algorithms::Algorithms::HMACSHA256, id, v.data, chunk);
+				out.resize(min(out.size(), mac.size()));
+				ExpectEqual(out, mac, "HMAC");
+			});
+		}
+		if(v.data.size() > B5_SHA256_DIGEST_SIZE){
+			Test("HMACSHA256/RFC4231/" + string(v.name) + "/L1Digest", [&]{
+				vector<uint8_t> nonce(v.data.begin(), v.data.begin() + B5_SHA256_DIGEST_SIZE);
+				vector<uint8_t> rest(v.data.begin() + B5_SHA256_DIGEST_SIZE, v.data.end());
+				ExpectEqual(L1DigestOf(l1, L1Algorithms::Algorithms::HMACSHA256, id, nonce, rest), mac, "HMAC");
+			});
+		}
+		DeleteKey(l1, id);
+	}
+
+	Test("HMACSHA256/AES-HMACSHA256/RESET", [&]{
+		vector<uint8_t> key = FromHex(fipsKey), keys(2 * B5_AES_256);
+		copy(key.begin(), key.end(), keys.begin());
+		PBKDF2HmacSha256(keys.data(), B5_AES_256, nullptr, 0, 1, keys.data(), keys.size()); // in place, as the SEcube does
+		vector<uint8_t> aesKey(keys.begin(), keys.begin() + B5_AES_256);
+		struct { string iv; size_t length; } messages[] = {
+			{"000102030405060708090a0b0c0d0e0f", 64}, {"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", 48}, {"000102030405060708090a0b0c0d0e0f", 64}
+		};
+		uint32_t sid = 0;
+		AddKey(l1, id, key);
+		l1->L1CryptoInit(L1Algorithms::Algorithms::AES_HMACSHA256, CryptoInitialisation::Modes::CTR | CryptoInitialisation::Direction::ENCRYPT, id, sid);
+		for(size_t m = 0; m < 3; m++){
+			vector<uint8_t> iv = FromHex(messages[m].iv), plaintext(messages[m].length), out(plaintext.size() + B5_SHA256_DIGEST_SIZE);
+			for(size_t i = 0; i < plaintext.size(); i++){
+				plaintext[i] = (uint8_t)(m + i);
+			}
+			uint16_t outLen = 0, last = (m == 2) ? (uint16_t)L1Crypto::UpdateFlags::FINIT : 0;
+			size_t first = (m == 1) ? B5_AES_BLK_SIZE : plaintext.size(); // the second message in two requests
+			l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::RESET | ((first == plaintext.size()) ? L1Crypto::UpdateFlags::AUTH | last : 0),
+					B5_AES_BLK_SIZE, iv.data(), (uint16_t)first, plaintext.data(), &outLen, out.data());
+			if(first < plaintext.size()){
+				l1->L1CryptoUpdate(sid, L1Crypto::UpdateFlags::AUTH | last, 0, nullptr, (uint16_t)(plaintext.size() - first), plaintext.data() + first,
+						&outLen, out.data() + first);
+			}
+			vector<uint8_t> ciphertext = HostCtr(aesKey, iv, plaintext), tag(B5_SHA256_DIGEST_SIZE);
+			B5_tHmacSha256Ctx hmac;
+			B5_HmacSha256_Init(&hmac, keys.data() + B5_AES_256, B5_AES_256);
+			B5_HmacSha256_Update(&hmac, iv.data(), (int32_t)iv.size());
+			B5_HmacSha256_Update(&hmac, ciphertext.data(), (int32_t)ciphertext.size());
+			B5_HmacSha256_Finit(&hmac, tag.data());
+			ExpectEqual(vector<uint8_t>(out.begin(), out.begin() + plaintext.size()), ciphertext, "ciphertext of message " + to_string(m));
+			ExpectEqual(vector<uint8_t>(out.begin() + plaintext.size(), out.end()), tag, "tag of message " + to_string(m));
+		}
+		DeleteKey(l1, id);
+	});
+}
+
+/* RFC 7693 appendix B, and the keyed vectors of the BLAKE2 reference KAT (key 00 01 .. 1f, message
+ * 00 01 .. of 0 to 255 bytes) whole, split at the block boundary and around it; the keyed vectors longer
+ * than the nonce of L1Digest() also through it, with their first 32 bytes as the nonce */
+void TestBlake2s(L1* l1) {
+	const string abc = "508c5e8c327c14e2e1a72ba34eeb452f37458b209ed63a294d999b4c86675982";
+	Test("BLAKE2S/RFC7693/abc/L1Digest", [&]{
+		ExpectEqual(L1DigestOf(l1, L1Algorithms::Algorithms::BLAKE2S, L1Key::Id::NULL_ID, {}, Bytes("abc")), FromHex(abc), "digest");
+	});
+	Test("BLAKE2S/RFC7693/abc/split", [&]{
+		ExpectEqual(Digest(l1, L1Algorithms::Algorithms::BLAKE2S, L1Key::Id::NULL_ID, Bytes("abc"), 1), FromHex(abc), "digest");
+	});
+	struct { size_t length; string digest; } keyed[] = {
+		{0, "48a8997da407876b3d79c0d92325ad3b89cbb754d86ab71aee047ad345fd2c49"},
+		{1, "40d15fee7c328830166ac3f918650f807e7e01e177258cdc0a39b11f598066f1"},
+		{63, "c65382513f07460da39833cb666c5ed82e61b9e998f4b0c4287cee56c3cc9bcd"},
+		{64, "8975b0577fd35566d750b362b0897a26c399136df07bababbde6203ff2954ed4"},
+		{65, "21fe0ceb0052be7fb0f004187cacd7de67fa6eb0938d927677f2398c132317a8"},
+		{255, "3fb735061abc519dfe979e54c1ee5bfad0a9d858b3315bad34bde999efd724dd"}
+	};
+	uint32_t id = keyIds.at(0);
+	AddKey(l1, id, FromHex(fipsKey));
+	for(auto& v : keyed){
+		vector<uint8_t> message(v.length);
+		for(size_t i = 0; i < message.size(); i++){
+			message[i] = (uint8_t)i;
+		}
+		string name = "BLAKE2S-KEYED/KAT/" + to_string(v.length);
+		for(size_t chunk : {SIZE_MAX, (size_t)1, (size_t)63, (size_t)64, (size_t)65}){
+			if(chunk != SIZE_MAX && chunk >= v.length){
+				continue;
+			}
+			Test(name + (chunk == SIZE_MAX ? "" : "/split-" + to_string(chunk)), [&]{
+				ExpectEqual(Digest(l1, L1Algorithms::Algorithms::BLAKE2S_KEYED, id, message, chunk), FromHex(v.digest), "digest");
+			});
+		}
+		if(v.length > B5_SHA256_DIGEST_SIZE){
+			Test(name + "/L1Digest", [&]{
+				vector<uint8_t> nonce(message.begin(), message.begin() + B5_SHA256_DIGEST_SIZE);
+				vector<uint8_t> rest(message.begin() + B5_SHA256_DIGEST_SIZE, message.end());
+				ExpectEqual(L1DigestOf(l1, L1Algorithms::Algorithms::BLAKE2S_KEYED, id, nonce, rest), FromHex(v.digest), "digest");
+			});
+		}
+	}
+	DeleteKey(l1, id);
+}
+
+#if defined(SE3_CUBESIM) && !defined(_WIN32)
+const size_t commBlock = L0Communication::Parameter::COMM_BLOCK;
+
+/* an ECHO request of len bytes sent with the vendor command of the emulator, bypassing L0TX;
+ * the emulator executes it at once, the response is left to be read */
+void RawEcho(uint32_t token, uint16_t len, uint16_t flags = 0) {
+	vector<uint8_t> req(L0Communication::Parameter::COMM_N * commBlock, 0);
+	uint16_t cmd = L0Commands::Command::ECHO;
+	uint16_t total = L0Support::Se3ReqLenDataAndHeaders(len);
+	uint16_t blocks = L0Support::Se3NBlocks(total);
+	SE3SET16(req.data(), L0Request::Offset::CMD, cmd);
+	SE3SET16(req.data(), L0Request::Offset::CMD_FLAGS, flags);
+	SE3SET16(req.data(), L0Request::Offset::LEN, total);
+	SE3SET32(req.data(), L0Request::Offset::CMD_TOKEN, token);
+	for(uint16_t i = 1; i < blocks; i++){
+		uint32_t t = token + i;
+		SE3SET32(req.data() + i * commBlock, L0Request::Offset::DATA_CMD_TOKEN, t);
+	}
+	Expect(se3_cubesim_vendor_write(0, req.data(), blocks), "vendor write of the request");
+}
+
+/* cmdtoken of the response served at block 0, 0 if not ready; ms is set to the duration of the read */
+uint32_t RawResponseToken(int64_t* ms = nullptr) {
+	vector<uint8_t> resp(commBlock);
+	uint16_t ready = 0;
+	uint32_t token = 0;
+	auto start = chrono::steady_clock::now();
+	Expect(se3_cubesim_vendor_read(0, resp.data(), 1), "vendor read of the response");
+	if(ms != nullptr){
+		*ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	}
+	SE3GET16(resp.data(), 0, ready);
+	if(ready == 1){
+		SE3GET32(resp.data(), L0Response::Offset::CMD_TOKEN, token);
+	}
+	return token;
+}
+#endif
+
+/* responses left unread by a host that exited must not block the next one; emulator only,
+ * the requests are injected with its vendor command */
+void TestComm(const string& path) {
+#if defined(SE3_CUBESIM) && !defined(_WIN32)
+	const char* sim = getenv("SE3_CUBESIM_PATH");
+	if(sim == nullptr || path.compare(0, strlen(sim), sim) != 0){
+		cout << "SKIP Comm: not the emulator" << endl;
+		return;
+	}
+	const uint16_t multiBlock = 1200; // three blocks
+	Test("Comm/passed-over", [&]{
+		RawEcho(0x1000, multiBlock);
+		RawEcho(0x2000, 16);
+		// the older response is served first, then dropped since the host has passed it over
+		Expect(RawResponseToken() == 0x1000, "first read: not the oldest response");
+		Expect(RawResponseToken() == 0x2000, "second read: not the newer response");
+		Expect(RawResponseToken() == 0, "response served again after being read");
+	});
+	Test("Comm/passed-over/L0Echo", [&]{
+		L0 l0;
+		vector<uint8_t> in(multiBlock), out(multiBlock);
+		L0Support::Se3Rand(in.size(), in.data());
+		RawEcho(0x3000, multiBlock);
+		l0.L0Open((uint8_t)config.device);
+		auto start = chrono::steady_clock::now();
+		l0.L0Echo(in.data(), (uint16_t)in.size(), out.data());
+		auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+		l0.L0Close();
+		ExpectEqual(out, in, "echo");
+		Expect(ms < 1000, "L0Echo took " + to_string(ms) + " ms");
+		Expect(RawResponseToken() == 0, "response left after L0Echo");
+	});
+	// the emulator makes the response ready after the service time of the request
+	const uint16_t echo = L0Commands::Command::ECHO, longPoll = L0Request::Flags::LONGPOLL;
+	int64_t ms = 0;
+	Test("Comm/long-poll/ready", [&]{
+		se3_cubesim_service_time(echo, 100000, 0);
+		RawEcho(0x4000, 16, longPoll);
+		uint32_t token = RawResponseToken(&ms);
+		se3_cubesim_service_time(echo, 0, 0);
+		Expect(token == 0x4000, "held read: not the response");
+		Expect(ms >= 90 && ms < 500, "held read took " + to_string(ms) + " ms, the response is ready after 100 ms");
+	});
+	Test("Comm/long-poll/expired", [&]{
+		se3_cubesim_service_time(echo, 800000, 0);
+		RawEcho(0x5000, 16, longPoll);
+		uint32_t first = RawResponseToken(&ms);
+		int64_t firstMs = ms;
+		uint32_t second = RawResponseToken(&ms);
+		se3_cubesim_service_time(echo, 0, 0);
+		Expect(first == 0, "first read: not \"not ready\"");
+		Expect(firstMs >= 490 && firstMs < 790, "first read held for " + to_string(firstMs) + " ms, SE3_COMM_HOLD_TIME is 500 ms");
+		Expect(second == 0x5000, "second read: not the response");
+	});
+	Test("Comm/long-poll/off", [&]{
+		se3_cubesim_service_time(echo, 100000, 0);
+		RawEcho(0x6000, 16);
+		uint32_t first = RawResponseToken(&ms);
+		this_thread::sleep_for(chrono::milliseconds(150));
+		uint32_t second = RawResponseToken();
+		se3_cubesim_service_time(echo, 0, 0);
+		Expect(first == 0 && ms < 50, "read without long-poll: held or ready");
+		Expect(second == 0x6000, "second read: not the response");
+	});
+#endif
+}
+
+/* the results of requests sent with L1CryptoUpdateSend() are read in order, and match the ones of L1CryptoUpdate() */
+void TestPipeline(L1* l1) {
+	Test("Pipeline/L1CryptoUpdateSend", [&]{
+		const size_t n = 4, chunk = L1Crypto::UpdateSize::DATAIN;
+		uint32_t key = keyIds.at(0);
+		vector<uint8_t> in(n * chunk), serial(n * chunk), pipelined(n * chunk);
+		uint16_t outLen = 0;
+		L0Support::Se3Rand(in.size(), in.data());
+		AddKey(l1, key, FromHex(fipsKey));
+		uint32_t sid = OpenEcb(l1, key);
+		for(size_t i = 0; i < n; i++){
+			l1->L1CryptoUpdate(sid, (i + 1 == n) ? L1Crypto::UpdateFlags::FINIT : 0, 0, nullptr, (uint16_t)chunk, in.data() + i * chunk, &outLen, serial.data() + i * chunk);
+		}
+		sid = OpenEcb(l1, key);
+		size_t depth = l1->L1MaxOutstanding(), sent = 0, done = 0;
+		while(done < n){
+			while((sent < n) && (sent - done < depth)){
+				l1->L1CryptoUpdateSend(sid, (sent + 1 == n) ? L1Crypto::UpdateFlags::FINIT : 0, 0, nullptr, (uint16_t)chunk, in.data() + sent * chunk);
+				sent++;
+			}
+			l1->L1CryptoUpdateReceive(&outLen, pipelined.data() + done * chunk);
+			Expect(outLen == chunk, "output size of request " + to_string(done));
+			done++;
+		}
+		DeleteKey(l1, key);
+		ExpectEqual(pipelined, serial, "pipelined output");
+		vector<uint8_t> first(in.begin(), in.begin() + B5_AES_BLK_SIZE), out(serial.begin(), serial.begin() + B5_AES_BLK_SIZE);
+		ExpectEqual(out, HostEcbEncrypt(FromHex(fipsKey), first), "first block");
+	});
+}
+
+void TestKeyCache(L1* l1) {
+	Test("KeyCache/CRYPTO_INIT/edit", [&]{
+		uint32_t id = keyIds.at(0);
+		vector<uint8_t> in = FromHex(fipsPlaintext);
+		AddKey(l1, id, FromHex(fipsKey));
+		for(int i = 0; i < 2; i++){ // the second CRYPTO_INIT finds the context in the cache
+			ExpectEqual(EcbEncrypt(l1, id, in), FromHex("8ea2b7ca516745bfeafc49904b496089"), "AES-256 key");
+		}
+		DeleteKey(l1, id);
+		Expect(Refused([&]{ OpenEcb(l1, id); }), "CRYPTO_INIT accepted a deleted key");
+		AddKey(l1, id, FromHex(fipsKey.substr(0, 32))); // same ID, another value and size
+		ExpectEqual(EcbEncrypt(l1, id, in), FromHex("69c4e0d86a7b0430d8cdb78070b4c55a"), "AES-128 key added again");
+		DeleteKey(l1, id);
+		AddKey(l1, id, FromHex(fipsKey.substr(0, 48)));
+		ExpectEqual(EcbEncrypt(l1, id, in), FromHex("dda97ca4864cdfe06eaf70a0ec0d7191"), "AES-192 key added again");
+		DeleteKey(l1, id);
+	});
+
+	/* more keys than the cache holds, used in turn so that every CRYPTO_INIT evicts a context;
+	 * one key is replaced between rounds */
+	Test("KeyCache/CRYPTO_INIT/evict", [&]{
+		const size_t n = 8;
+		vector<uint8_t> in = FromHex(fipsPlaintext);
+		vector<vector<uint8_t>> values;
+		for(size_t i = 0; i < n; i++){
+			vector<uint8_t> v = FromHex(fipsKey);
+			v[0] = (uint8_t)i;
+			values.push_back(v);
+			AddKey(l1, keyIds.at(i), v);
+		}
+		for(int round = 0; round < 3; round++){
+			for(size_t i = 0; i < n; i++){
+				ExpectEqual(EcbEncrypt(l1, keyIds.at(i), in), HostEcbEncrypt(values[i], in), "key " + to_string(i) + ", round " + to_string(round));
+			}
+			DeleteKey(l1, keyIds.at(3));
+			values[3][1] ^= 0xFF;
+			AddKey(l1, keyIds.at(3), values[3]);
+		}
+		for(size_t i = 0; i < n; i++){
+			DeleteKey(l1, keyIds.at(i));
+		}
+	});
+
+	/* L1Encrypt() keeps its AES session open for the next call, the session must be dropped with the key */
+	Test("KeyCache/L1Encrypt/edit", [&]{
+		uint32_t id = keyIds.at(0);
+		const size_t n = B5_AES_BLK_SIZE;
+		shared_ptr<uint8_t[]> plaintext(new uint8_t[n]);
+		vector<uint8_t> in = FromHex(fipsPlaintext);
+		memcpy(plaintext.get(), in.data(), n);
+		const char* expected[] = {"8ea2b7ca516745bfeafc49904b496089", "69c4e0d86a7b0430d8cdb78070b4c55a"};
+		const size_t keySize[] = {32, 16};
+		for(int i = 0; i < 2; i++){
+			AddKey(l1, id, FromHex(fipsKey.substr(0, keySize[i] * 2)));
+			for(int j = 0; j < 2; j++){ // the second call reuses the session of the first one
+				SEcube_ciphertext encrypted;
+				l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::ECB, id);
+				Expect(encrypted.ciphertext_size >= n, "L1Encrypt output size");
+				vector<uint8_t> block(encrypted.ciphertext.get(), encrypted.ciphertext.get() + n); // the padding block follows
+				ExpectEqual(block, FromHex(expected[i]), "AES-" + to_string(keySize[i] * 8) + " key, call " + to_string(j));
+			}
+			DeleteKey(l1, id);
+		}
+	});
+}
+
+}
+
+void TestSessions(L1* l1) {
+	const uint32_t timeout = 300; // ms, the SEcube looks for idle sessions every second
+	const auto poll = chrono::milliseconds(50);
+	vector<uint8_t> in = FromHex(fipsPlaintext);
+	vector<uint8_t> expected = FromHex("8ea2b7ca516745bfeafc49904b496089");
+	uint32_t key = keyIds.at(0);
+	AddKey(l1, key, FromHex(fipsKey));
+
+	Test("Sessions/expiry", [&]{
+		se3CryptoSessionsStatus status;
+		l1->L1CryptoSessionsRelease();
+		l1->L1SetCryptoSessionTimeout(timeout);
+		l1->L1CryptoSessionsList(status);
+		uint16_t reclaimed = status.reclaimed;
+		vector<uint32_t> sids;
+		for(int i = 0; i < 4; i++){
+			sids.push_back(OpenEcb(l1, key));
+		}
+		auto opened = chrono::steady_clock::now();
+		l1->L1CryptoSessionsList(status);
+		Expect(status.timeout == timeout, "timeout " + to_string(status.timeout) + ", expected " + to_string(timeout));
+		Expect(status.sessions.size() == sids.size(), to_string(status.sessions.size()) + " sessions open, expected " + to_string(sids.size()));
+		while(!status.sessions.empty()){
+			this_thread::sleep_for(poll);
+			auto idle = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - opened).count();
+			Expect(idle < 10 * timeout, "sessions not released after " + to_string(idle) + " ms");
+			l1->L1CryptoSessionsList(status);
+			Expect(status.sessions.empty() || status.sessions.size() == sids.size(), "sessions released one by one");
+			Expect(!status.sessions.empty() || idle >= timeout, "sessions released after " + to_string(idle) + " ms");
+		}
+		Expect(status.reclaimed == reclaimed + sids.size(), to_string(status.reclaimed - reclaimed) + " sessions reclaimed, expected " + to_string(sids.size()));
+		Expect(Refused([&]{ EcbFinit(l1, sids[0], in); }), "CRYPTO_UPDATE accepted an expired session");
+	});
+
+	Test("Sessions/renew", [&]{
+		se3CryptoSessionsStatus status;
+		l1->L1CryptoSessionsRelease();
+		l1->L1SetCryptoSessionTimeout(timeout);
+		uint32_t sid = OpenEcb(l1, key);
+		for(int i = 0; i < 4; i++){ // twice the timeout in all
+			this_thread::sleep_for(chrono::milliseconds(timeout / 2));
+			l1->L1CryptoSessionsRenew();
+		}
+		l1->L1CryptoSessionsList(status);
+		Expect(status.sessions.size() == 1, to_string(status.sessions.size()) + " sessions open, expected 1");
+		Expect(status.sessions[0].idle < timeout, "session idle for " + to_string(status.sessions[0].idle) + " ms after renew");
+		ExpectEqual(EcbFinit(l1, sid, in), expected, "renewed session");
+	});
+
+	/* the session kept idle by L1Encrypt() expires, its ID is given to a session with another key */
+	Test("Sessions/L1Encrypt/expiry", [&]{
+		const size_t n = B5_AES_BLK_SIZE;
+		se3CryptoSessionsStatus status;
+		shared_ptr<uint8_t[]> plaintext(new uint8_t[n]);
+		memcpy(plaintext.get(), in.data(), n);
+		uint32_t other = keyIds.at(1);
+		AddKey(l1, other, FromHex(fipsKey.substr(0, 32)));
+		l1->L1SetCryptoSessionTimeout(timeout);
+		l1->L1CryptoSessionsRelease(); // keeps the timeout
+		for(int i = 0; i < 2; i++){
+			SEcube_ciphertext encrypted;
+			l1->L1Encrypt(n, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::ECB, key);
+			ExpectEqual(vector<uint8_t>(encrypted.ciphertext.get(), encrypted.ciphertext.get() + n), expected, "L1Encrypt, call " + to_string(i));
+			if(i == 0){
+				auto start = chrono::steady_clock::now();
+				do{
+					this_thread::sleep_for(poll);
+					auto idle = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+					Expect(idle < 10 * timeout, "session not released after " + to_string(idle) + " ms");
+					l1->L1CryptoSessionsList(status);
+				} while(!status.sessions.empty());
+				uint32_t sid = OpenEcb(l1, other);
+				ExpectEqual(EcbFinit(l1, sid, in), FromHex("69c4e0d86a7b0430d8cdb78070b4c55a"), "session of the other key");
+				sid = OpenEcb(l1, other); // left open for the second call
+			}
+		}
+		l1->L1CryptoSessionsRelease();
+		DeleteKey(l1, other);
+	});
+
+	/* sessions never closed fill the session memory, which must be usable again once they are released */
+	Test("Sessions/leak", [&]{
+		const size_t limit = 1000;
+		se3CryptoSessionsStatus status;
+		l1->L1CryptoSessionsRelease();
+		l1->L1SetCryptoSessionTimeout(0);
+		l1->L1CryptoSessionsList(status);
+		uint16_t failures = status.failures;
+		size_t n = 0;
+		while(n < limit && !Refused([&]{ OpenEcb(l1, key); })){
+			n++;
+		}
+		Expect(n > 0 && n < limit, to_string(n) + " sessions opened");
+		l1->L1CryptoSessionsList(status);
+		Expect(status.sessions.size() == n, to_string(status.sessions.size()) + " sessions open, expected " + to_string(n));
+		Expect(status.failures > failures, "allocation failure not counted");
+		l1->L1CryptoSessionsRelease();
+		l1->L1CryptoSessionsList(status);
+		Expect(status.sessions.empty() && status.bytesUsed == 0, "sessions left after L1CryptoSessionsRelease()");
+		for(size_t i = 0; i < n; i++){
+			Expect(!Refused([&]{ OpenEcb(l1, key); }), "only " + to_string(i) + " sessions opened after L1CryptoSessionsRelease(), expected " + to_string(n));
+		}
+		// now released by the timeout; setting it restarts every lease
+		l1->L1SetCryptoSessionTimeout(timeout);
+		auto start = chrono::steady_clock::now();
+		while(Refused([&]{ OpenEcb(l1, key); })){
+			this_thread::sleep_for(poll);
+			auto idle = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+			Expect(idle < 10 * timeout, "session memory still full after " + to_string(idle) + " ms");
+		}
+		l1->L1CryptoSessionsRelease();
+	});
+
+	l1->L1SetCryptoSessionTimeout(L1CryptoSession::Parameters::DEVICE_TIMEOUT);
+	DeleteKey(l1, key);
+}
+
+// RENAME THIS TO main()
+int secube_selftest(int argc, char* argv[]) {
+	if(!ParseArgs(argc, argv)){
+		cerr << "Usage: secube_selftest [--device N] [--pin PIN] [--filter TEXT] [--factory-init]" << endl;
+		return -1;
+	}
+	unique_ptr<L0> l0 = make_unique<L0>();
+	unique_ptr<L1> l1 = make_unique<L1>();
+	vector<pair<string, string>> devices;
+	if(l0->GetDeviceList(devices) || config.device < 0 || config.device >= (int)devices.size()){
+		cerr << "SEcube device " << config.device << " not found. Quit." << endl;
+		return -1;
+	}
+	string path = devices.at(config.device).first;
+	try{
+		l1->L1SelectSEcube((uint8_t)config.device);
+		if(config.factory_init){
+			array<uint8_t, L0Communication::Size::SERIAL> sn;
+			sn.fill('0');
+			memcpy(sn.data(), "SEcubeSelftest", 14);
+			try{
+				l1->L1FactoryInit(sn);
+			} catch (DeviceAlreadyInitializedException& e) {
+			}
+		}
+		l1->L1Login(config.pin, SE3_ACCESS_ADMIN, true);
+		keyIds = FreeKeyIds(l1.get(), 16);
+		if(keyIds.size() < 16){
+			cerr << "Not enough free key IDs in the manual range. Quit." << endl;
+			return -1;
+		}
+	} catch (...) {
+		cerr << "Cannot login to " << path << ". Quit." << endl;
+		return -1;
+	}
+
+	try{
+		TestComm(path);
+		TestPipeline(l1.get());
+		TestAes(l1.get());
+		TestKeyCache(l1.get());
+		TestSessions(l1.get());
+		TestGcm(l1.get());
+		TestChaCha20Poly1305(l1.get());
+		TestCmac(l1.get());
+		TestEax(l1.get());
+		TestSha256(l1.get());
+		TestHmacSha256(l1.get());
+		TestBlake2s(l1.get());
+		DeleteTestKeys(l1.get());
+		l1->L1Logout();
+	} catch (exception& e) {
+		cerr << "Self-test aborted: " << e.what() << endl;
+		return -1;
+	}
+
+	cout << passed << " passed, " << failed << " failed" << endl;
+	return (failed == 0) ? 0 : 1;
+}
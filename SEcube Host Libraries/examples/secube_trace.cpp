@@ -0,0 +1,331 @@
+/**
+  ******************************************************************************
+  * File Name          : secube_trace.cpp
+  * Description        : event trace of the SEcube in Chrome trace format.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  secube_trace.cpp
+ *  \brief Drain of the event trace ring of the SEcube, converted to the Chrome trace-event format.
+ *  \version SEcube SDK 1.5.1
+ *
+ *  The firmware records the start and the end of each command, crypto init and update, flash
+ *  compaction and SD card transfer in a ring in SRAM (see se3_evtrace.h in the firmware). This
+ *  tool empties the ring, runs a workload for --duration ms while draining the ring every
+ *  --interval ms, and writes the events as JSON that can be opened with chrome://tracing or
+ *  Perfetto: commands, crypto and flash on one track, SD card transfers on another. Events are
+ *  lost if the ring fills up between two drains; their number is reported.
+ *
+ *  Usage: secube_trace [--device N] [--pin PIN] [--workload none|encrypt|keys]
+ *                      [--duration MS] [--interval MS] [--out FILE] [--factory-init]
+ *  With --workload none the tool only drains the ring, e.g. while the SD card is used.
+ *  To trace the in-process emulator, build with -DSE3_CUBESIM and set SE3_CUBESIM_PATH (see
+ *  se3_cubesim.h in the firmware).
+ */
+
+#include "../sources/L1/L1.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+struct TraceConfig {
+	int device = 0;
+	array<uint8_t, L1Parameters::Size::PIN> pin = {0};
+	string workload = "encrypt";
+	uint64_t duration_ms = 1000;
+	uint64_t interval_ms = 50;
+	string out;
+	bool factory_init = false;
+};
+
+TraceConfig config;
+
+enum { TRACK_CORE = 1, TRACK_SDIO = 2 };
+
+/* how each event id is shown: name of the slice, track, names of the arguments */
+struct EventInfo {
+	const char* name;
+	int track;
+	const char* a;
+	const char* b;
+};
+
+const EventInfo events[] = {
+	{nullptr, 0, nullptr, nullptr},
+	{"L0", TRACK_CORE, "cmd", "len"},
+	{"L0", TRACK_CORE, "cmd", "resp_blocks"},
+	{"L1", TRACK_CORE, "cmd", "len"},
+	{"L1", TRACK_CORE, "cmd", "status"},
+	{"crypto_init", TRACK_CORE, "algo", "mode"},
+	{"crypto_init", TRACK_CORE, "algo", "status"},
+	{"crypto_update", TRACK_CORE, "algo", "bytes"},
+	{"crypto_update", TRACK_CORE, "algo", "status"},
+	{"flash_swap", TRACK_CORE, "sector", "used"},
+	{"flash_swap", TRACK_CORE, "success", "used"},
+	{"sdio_read", TRACK_SDIO, "blocks", "block"},
+	{"sdio_read", TRACK_SDIO, "success", "block"},
+	{"sdio_write", TRACK_SDIO, "blocks", "block"},
+	{"sdio_write", TRACK_SDIO, "success", "block"},
+	{"sdio_write_done", TRACK_SDIO, "success", nullptr}
+};
+
+const char* const cmd0Names[] = {nullptr, "FACTORY_INIT", "ECHO", "L1", "BOOT_MODE_RESET"};
+const char* const cmd1Names[] = {nullptr, "CHALLENGE", "LOGIN", "LOGOUT", "CONFIG", "KEY_EDIT", "KEY_FIND", "KEY_LIST",
+		"CRYPTO_INIT", "CRYPTO_UPDATE", "CRYPTO_LIST", "FORCED_LOGOUT", "SEKEY", "CRYPTO_SESSIONS", "PERF"};
+const char* const algoNames[] = {"AES", "SHA256", "HMACSHA256", "AES_HMACSHA256", "AES_GCM", "CHACHA20_POLY1305",
+		"BLAKE2S", "BLAKE2S_KEYED", "AES_CMAC", "AES_EAX"};
+
+string Name(const char* const names[], size_t n, uint16_t i) {
+	return (i < n && names[i] != nullptr) ? names[i] : ("#" + to_string(i));
+}
+
+/* slice name, with the command or algorithm the event refers to */
+string SliceName(const se3TraceEvent& ev) {
+	string name = events[ev.id].name;
+	switch(ev.id){
+	case L1Perf::Event::CMD0_BEGIN:
+	case L1Perf::Event::CMD0_END:
+		return name + " " + Name(cmd0Names, sizeof(cmd0Names) / sizeof(cmd0Names[0]), ev.a);
+	case L1Perf::Event::CMD1_BEGIN:
+	case L1Perf::Event::CMD1_END:
+		return name + " " + Name(cmd1Names, sizeof(cmd1Names) / sizeof(cmd1Names[0]), ev.a);
+	case L1Perf::Event::CRYPTO_INIT_BEGIN:
+	case L1Perf::Event::CRYPTO_INIT_END:
+	case L1Perf::Event::CRYPTO_UPDATE_BEGIN:
+	case L1Perf::Event::CRYPTO_UPDATE_END:
+		return name + " " + Name(algoNames, sizeof(algoNames) / sizeof(algoNames[0]), ev.a);
+	default:
+		return name;
+	}
+}
+
+/* B and E events must nest on each track: drop the ends whose begin was lost or drained
+ * before the trace started, and the begins still open when it stopped (i.e. the last drain) */
+void WriteJson(ostream& os, const se3Trace& trace, const string& device) {
+	const size_t nEvents = sizeof(events) / sizeof(events[0]);
+	vector<bool> keep(trace.events.size(), false);
+	vector<size_t> open[3];
+	for(size_t i = 0; i < trace.events.size(); i++){
+		const se3TraceEvent& ev = trace.events[i];
+		if(ev.id == 0 || ev.id >= nEvents){
+			continue;
+		}
+		vector<size_t>& stack = open[events[ev.id].track];
+		if(ev.id == L1Perf::Event::SDIO_WRITE_DONE){
+			keep[i] = true;
+		} else if(ev.id % 2 == 1){ // begin
+			keep[i] = true;
+			stack.push_back(i);
+		} else if(!stack.empty() && trace.events[stack.back()].id == ev.id - 1){
+			keep[i] = true;
+			stack.pop_back();
+		}
+	}
+	for(auto& stack : open){
+		for(size_t i : stack){
+			keep[i] = false;
+		}
+	}
+	uint64_t t0 = trace.events.empty() ? 0 : trace.events.front().ts;
+	double usPerCycle = 1e6 / trace.clockHz;
+	os << "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"device\": \"" << device << "\", \"clock_hz\": " << trace.clockHz
+	   << ", \"lost\": " << trace.lost << "},\n\"traceEvents\": [\n"
+	   << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << TRACK_CORE << ", \"args\": {\"name\": \"core\"}},\n"
+	   << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << TRACK_SDIO << ", \"args\": {\"name\": \"sdio\"}}";
+	os.precision(3);
+	os << fixed;
+	for(size_t i = 0; i < trace.events.size(); i++){
+		if(!keep[i]){
+			continue;
+		}
+		const se3TraceEvent& ev = trace.events[i];
+		const EventInfo& info = events[ev.id];
+		const char* ph = (ev.id == L1Perf::Event::SDIO_WRITE_DONE) ? "i" : ((ev.id % 2 == 1) ? "B" : "E");
+		os << ",\n{\"name\": \"" << SliceName(ev) << "\", \"ph\": \"" << ph << "\", \"ts\": " << (ev.ts - t0) * usPerCycle
+		   << ", \"pid\": 1, \"tid\": " << info.track;
+		if(ph[0] == 'i'){
+			os << ", \"s\": \"t\"";
+		}
+		os << ", \"args\": {\"" << info.a << "\": " << ev.a;
+		if(info.b != nullptr){
+			os << ", \"" << info.b << "\": " << ev.b;
+		}
+		os << "}}";
+	}
+	os << "\n]}\n";
+}
+
+bool ParseArgs(int argc, char* argv[]) {
+	for(int i = 1; i < argc; i++){
+		string a = argv[i];
+		bool more = (i + 1 < argc);
+		if(a == "--device" && more){
+			config.device = atoi(argv[++i]);
+		} else if(a == "--pin" && more){
+			string pin = argv[++i];
+			if(pin.size() > config.pin.size()){
+				return false;
+			}
+			config.pin.fill(0);
+			memcpy(config.pin.data(), pin.data(), pin.size());
+		} else if(a == "--workload" && more){
+			config.workload = argv[++i];
+			if(config.workload != "none" && config.workload != "encrypt" && config.workload != "keys"){
+				return false;
+			}
+		} else if(a == "--duration" && more){
+			config.duration_ms = strtoull(argv[++i], nullptr, 10);
+		} else if(a == "--interval" && more){
+			config.interval_ms = max<uint64_t>(1, strtoull(argv[++i], nullptr, 10));
+		} else if(a == "--out" && more){
+			config.out = argv[++i];
+		} else if(a == "--factory-init"){
+			config.factory_init = true;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* ID of the manual range not used on the device, 0 if none */
+uint32_t FreeKeyId(L1* l1) {
+	vector<pair<uint32_t, uint16_t>> keys;
+	l1->L1KeyList(keys);
+	for(uint32_t id = L1Key::Id::MANUAL_ID_END; id >= L1Key::Id::MANUAL_ID_BEGIN; id--){
+		bool used = false;
+		for(auto& k : keys){
+			used = used || (k.first == id);
+		}
+		if(!used){
+			return id;
+		}
+	}
+	return 0;
+}
+
+void EditKey(L1* l1, uint32_t id, uint16_t op) {
+	array<uint8_t, 32> data;
+	L0Support::Se3Rand(data.size(), data.data());
+	se3Key k;
+	k.id = id;
+	k.dataSize = (op == L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE) ? 0 : (uint16_t)data.size();
+	k.data = (op == L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE) ? nullptr : data.data();
+	l1->L1KeyEdit(k, op);
+}
+
+/* run the workload for the configured time, draining the ring every interval */
+void Run(L1* l1, uint32_t key, se3Trace& trace) {
+	const size_t size = 16 * 1024;
+	shared_ptr<uint8_t[]> plaintext(new uint8_t[size]);
+	L0Support::Se3Rand(size, plaintext.get());
+	auto start = chrono::steady_clock::now();
+	auto drained = start;
+	while(chrono::steady_clock::now() - start < chrono::milliseconds(config.duration_ms)){
+		if(config.workload == "encrypt"){
+			SEcube_ciphertext encrypted;
+			l1->L1Encrypt(size, plaintext, encrypted, L1Algorithms::Algorithms::AES, CryptoInitialisation::Modes::CTR, key);
+		} else if(config.workload == "keys"){ // every edit is programmed on the flash, which is compacted when full
+			EditKey(l1, key, L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE);
+			EditKey(l1, key, L1Commands::KeyOpEdit::SE3_KEY_OP_ADD);
+		} else {
+			this_thread::sleep_for(chrono::milliseconds(config.interval_ms));
+		}
+		if(chrono::steady_clock::now() - drained >= chrono::milliseconds(config.interval_ms)){
+			l1->L1TraceDrain(trace);
+			drained = chrono::steady_clock::now();
+		}
+	}
+	l1->L1TraceDrain(trace);
+}
+
+}
+
+// RENAME THIS TO main()
+int secube_trace(int argc, char* argv[]) {
+	if(!ParseArgs(argc, argv)){
+		cerr << "Usage: secube_trace [--device N] [--pin PIN] [--workload none|encrypt|keys] [--duration MS] [--interval MS]"
+			 << " [--out FILE] [--factory-init]" << endl;
+		return -1;
+	}
+	unique_ptr<L0> l0 = make_unique<L0>();
+	unique_ptr<L1> l1 = make_unique<L1>();
+	vector<pair<string, string>> devices;
+	if(l0->GetDeviceList(devices) || config.device < 0 || config.device >= (int)devices.size()){
+		cerr << "SEcube device " << config.device << " not found. Quit." << endl;
+		return -1;
+	}
+	string path = devices.at(config.device).first;
+	uint32_t key = 0;
+	try{
+		l1->L1SelectSEcube((uint8_t)config.device);
+		if(config.factory_init){
+			array<uint8_t, L0Communication::Size::SERIAL> sn;
+			sn.fill('0');
+			memcpy(sn.data(), "SEcubeTrace", 11);
+			try{
+				l1->L1FactoryInit(sn);
+			} catch (DeviceAlreadyInitializedException& e) {
+			}
+		}
+		l1->L1Login(config.pin, SE3_ACCESS_ADMIN, true);
+		if(config.workload != "none"){
+			key = FreeKeyId(l1.get());
+			if(key == 0){
+				cerr << "No free key ID in the manual range. Quit." << endl;
+				return -1;
+			}
+			EditKey(l1.get(), key, L1Commands::KeyOpEdit::SE3_KEY_OP_ADD);
+		}
+	} catch (...) {
+		cerr << "Cannot login to " << path << ". Quit." << endl;
+		return -1;
+	}
+
+	se3Trace trace = {};
+	try{
+		se3Trace old = {};
+		l1->L1TraceDrain(old); // discard the events recorded before the run
+		Run(l1.get(), key, trace);
+		if(key != 0){
+			EditKey(l1.get(), key, L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE);
+		}
+		l1->L1Logout();
+	} catch (exception& e) {
+		cerr << "Trace failed: " << e.what() << endl;
+		return -1;
+	}
+
+	cerr << trace.events.size() << " events, " << trace.lost << " lost" << endl;
+	if(config.out.empty()){
+		WriteJson(cout, trace, path);
+	} else {
+		ofstream f(config.out);
+		WriteJson(f, trace, path);
+	}
+	return 0;
+}
@@ -46,6 +46,16 @@ public:
 	virtual void L0Close(uint8_t devPtr) = 0;
 	/** @brief Send command to SEcube, wait for reply, read reply (low level, used also by L1TXRX()). */
 	virtual void L0TXRX(uint16_t reqCmd, uint16_t reqCmdFlags, uint16_t reqLen, const uint8_t* reqData, uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) = 0;
+	/** @brief Send command to SEcube without waiting for the reply (see L0MaxOutstanding()). The reply must be read with L0Receive(). */
+	virtual void L0Send(uint16_t reqCmd, uint16_t reqCmdFlags, uint16_t reqLen, const uint8_t* reqData) = 0;
+	/** @brief Wait for the reply to the oldest command sent with L0Send() and read it. */
+	virtual void L0Receive(uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) = 0;
+	/** @brief Number of commands that may be sent with L0Send() before reading the first reply. */
+	virtual uint8_t L0MaxOutstanding() = 0;
+	/** @brief Ask the SEcube to hold the read of each reply until it is ready, instead of polling it. Ignored if the SEcube does not support it. */
+	virtual void L0SetLongPoll(bool enable) = 0;
+	/** @brief True if replies are read with a single held read (see L0SetLongPoll()). */
+	virtual bool L0LongPoll() = 0;
 	/** @brief The SEcube echoes back any data it receives. */
 	virtual uint16_t L0Echo(const uint8_t* dataIn, uint16_t dataInLen, uint8_t* dataOut) = 0;
 };
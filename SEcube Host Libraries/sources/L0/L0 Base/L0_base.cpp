@@ -54,7 +54,8 @@ void L0Base::AddDevice() {
 	L0Support::Se3PathCopy(_dev.info.path, this->it.deviceInfo.path);
 	_dev.info.status = this->it.deviceInfo.status;
 	_dev.opened = false;
-	_dev.f = {0};
+	_dev.f = se3File(); // not opened
+	_dev.longPoll = false;
 
 	//add the device to the vector
 	this->dev.push_back(_dev);
@@ -106,6 +107,35 @@ uint8_t* L0Base::GetDeviceResponse() {
 	return this->dev[this->ptr].response.get();
 }
 
+uint16_t L0Base::GetDeviceInfoStatus() {
+	return this->dev[this->ptr].info.status;
+}
+
+size_t L0Base::GetDevicePendingCount() {
+	return this->dev[this->ptr].pending.size();
+}
+
+bool L0Base::GetDeviceLongPoll() {
+	return this->dev[this->ptr].longPoll;
+}
+
+void L0Base::PushDevicePending(uint32_t cmdToken) {
+	this->dev[this->ptr].pending.push_back(cmdToken);
+}
+
+bool L0Base::PopDevicePending(uint32_t& cmdToken) {
+	if (this->dev[this->ptr].pending.empty()) {
+		return false;
+	}
+	cmdToken = this->dev[this->ptr].pending.front();
+	this->dev[this->ptr].pending.pop_front();
+	return true;
+}
+
+void L0Base::ClearDevicePending() {
+	this->dev[this->ptr].pending.clear();
+}
+
 //******************************//
 //Iterator GET methods
 uint8_t*	L0Base::GetDiscoDeviceHelloMsg() {
@@ -170,6 +200,14 @@ void L0Base::SetDeviceOpened(bool opened) {
 	this->dev[this->ptr].opened = opened;
 }
 
+void L0Base::SetDeviceInfoStatus(uint16_t status) {
+	this->dev[this->ptr].info.status = status;
+}
+
+void L0Base::SetDeviceLongPoll(bool longPoll) {
+	this->dev[this->ptr].longPoll = longPoll;
+}
+
 //change the device ptr
 bool L0Base::SetDevicePtr(uint16_t newPtr) {
 	//check if there is no device in the vector or if pointing outside the vector
@@ -207,6 +245,16 @@ void L0Base::SetDiscoDriveFile(FILE* fp) {
 FILE* L0Base::GetDiscoDriveFile() {
 	return this->it.driveIt.fp;
 }
+
+#ifdef SE3_CUBESIM
+bool L0Base::GetDiscoDriveCubesim() {
+	return this->it.driveIt.cubesim;
+}
+
+void L0Base::SetDiscoDriveCubesim(bool cubesim) {
+	this->it.driveIt.cubesim = cubesim;
+}
+#endif
 #endif
 
 void L0Base::SetDiscoDeviceStatus(uint16_t status) {
@@ -334,6 +382,14 @@ bool L0Support::Se3Write(uint8_t* buf, se3File hfile, size_t block, size_t nBloc
 #else
 //UNIX
 bool L0Support::Se3Write(uint8_t* buf, se3File hfile, size_t block, size_t nBlocks, uint32_t timeout) {
+	if (hfile.sg != -1) {
+		return Se3ScsiTransfer(SE3_SCSI_CMD_OUT, buf, hfile, block, nBlocks, timeout);
+	}
+#ifdef SE3_CUBESIM
+	if (hfile.fd == SE3_CUBESIM_FD) {
+		return se3_cubesim_write((uint32_t)block, buf, (uint16_t)nBlocks);
+	}
+#endif
     memcpy(hfile.buf, buf, nBlocks * L0Communication::Parameter::COMM_BLOCK);
     if (nBlocks * L0Communication::Parameter::COMM_BLOCK != pwrite(	hfile.fd,
     																hfile.buf,
@@ -379,6 +435,14 @@ bool L0Support::Se3Read(uint8_t* buf, se3File hFile, size_t block, size_t nBlock
 #else
 //UNIX
 bool L0Support::Se3Read(uint8_t* buf, se3File hFile, size_t block, size_t nBlocks, uint32_t timeout) {
+	if (hFile.sg != -1) {
+		return Se3ScsiTransfer(SE3_SCSI_RESP_IN, buf, hFile, block, nBlocks, timeout);
+	}
+#ifdef SE3_CUBESIM
+	if (hFile.fd == SE3_CUBESIM_FD) {
+		return se3_cubesim_read((uint32_t)block, buf, (uint16_t)nBlocks);
+	}
+#endif
     if (nBlocks * L0Communication::Parameter::COMM_BLOCK != pread(	hFile.fd,
     																hFile.buf,
 																	nBlocks * L0Communication::Parameter::COMM_BLOCK,
@@ -403,6 +467,10 @@ void L0Support::Se3Close(se3File hFile) {
 #else
 //UNIX
 void L0Support::Se3Close(se3File hFile) {
+    if (hFile.sg >= 0) {
+        close(hFile.sg);
+        hFile.sg = -1;
+    }
     if (hFile.fd >= 0) {
     	se3UnixUnlock(hFile.fd);
     	hFile.locked = false;
@@ -471,9 +539,17 @@ uint16_t L0Support::Se3OpenExisting(se3Char* path, bool rw, uint64_t deadline, s
 	int fd = -1; 	//set the file descriptor to an invalid value
 	bool lock_success = false;
 	se3Char mfPath[L0Communication::Parameter::SE3_MAX_PATH];
+#ifdef SE3_CUBESIM
+	if (Se3CubesimOpen(path, phFile)) {
+		if (rw)
+			Se3ScsiAttach(path, phFile);
+		return L0Communication::Error::OK;
+	}
+#endif
 	Se3MakePath(mfPath, path);
 //	Se3Trace(("se3c_open_existing %ls\n", mfPath));
 	phFile->locked = false;
+	phFile->sg = -1;
 	if (rw)
 		fd = open (mfPath, O_RDWR | O_DIRECT | O_SYNC, S_IWUSR | S_IRUSR);
 	else
@@ -510,6 +586,9 @@ uint16_t L0Support::Se3OpenExisting(se3Char* path, bool rw, uint64_t deadline, s
 		phFile->fd = fd;
 		phFile->locked = true;
 		phFile->buf = memalign(L0Communication::Parameter::COMM_BLOCK,L0Communication::Parameter::COMM_BLOCK * 16);
+		// requests go through the vendor CDBs if possible, the magic file stays locked
+		if (rw)
+			Se3ScsiAttach(path, phFile);
 	} else {
 		phFile->fd = -1;
 	}
@@ -626,9 +705,22 @@ bool L0Support::Se3MagicInit(se3Char* path, uint8_t* discoBuf, se3DiscoverInfo*
     se3Char mfPath[L0Communication::Parameter::SE3_MAX_PATH];
     se3DiscoverInfo info_;
     Se3MakePath(mfPath, path);
+#ifdef SE3_CUBESIM
+    if (Se3CubesimOpen(path, &hFile)) {
+        // no file to create, the emulator sees the magic blocks at fixed addresses
+        if (!Se3WriteMagic(hFile) || !Se3Read(discoBuf, hFile, 15, 1, SE3C_MAGIC_TIMEOUT) || !Se3ReadInfo(discoBuf, &info_)) {
+            return false;
+        }
+        if (info != NULL) {
+            memcpy(info, &info_, sizeof(se3DiscoverInfo));
+        }
+        return true;
+    }
+#endif
     // eclusive open r/w, create if not exists
 
     hFile.locked = false;
+    hFile.sg = -1;
     hFile.fd = open((char*)mfPath, O_SYNC | O_RDWR | O_CREAT | O_DIRECT | O_TRUNC, S_IWUSR | S_IRUSR);
 
     Se3Trace(("se3c_magic_init %s\n", mfPath));
@@ -817,4 +909,128 @@ void L0Support::se3UnixUnlock(int fd) {
     fl.l_pid = getpid();
     fcntl(fd, F_SETLK, &fl);
 }
+
+/* vendor CDBs. The blocks of the protocol file are addressed by index, without the file system */
+bool L0Support::Se3ScsiAttach(se3Char* path, se3File* phFile) {
+	uint8_t buf[L0Communication::Parameter::COMM_BLOCK];
+	const char* transport = getenv(SE3_TRANSPORT_ENV);
+	phFile->sg = -1;
+	if (transport != NULL && strcmp(transport, "file") == 0)
+		return false;
+#ifdef SE3_CUBESIM
+	if (phFile->fd == SE3_CUBESIM_FD)
+		phFile->sg = SE3_CUBESIM_FD;
+#endif
+#ifdef __linux__
+	if (phFile->sg == -1) {
+		struct stat st;
+		char sys[PATH_MAX];
+		char dev[PATH_MAX];
+		char* name;
+		DIR* dir;
+		struct dirent* entry;
+		// the drive is a file system on the SEcube disk or on one of its partitions
+		if (stat(path, &st) != 0)
+			return false;
+		snprintf(dev, sizeof(dev), "/sys/dev/block/%u:%u", major(st.st_dev), minor(st.st_dev));
+		if (realpath(dev, sys) == NULL)
+			return false;
+		if (snprintf(dev, sizeof(dev), "%s/partition", sys) >= (int)sizeof(dev))
+			return false;
+		if (access(dev, F_OK) == 0)
+			*strrchr(sys, '/') = '\0';
+		name = strrchr(sys, '/') + 1;
+		// prefer the SCSI generic node, the block node accepts SG_IO as well
+		snprintf(dev, sizeof(dev), "/dev/%s", name);
+		snprintf(sys + strlen(sys), sizeof(sys) - strlen(sys), "/device/scsi_generic");
+		dir = opendir(sys);
+		if (dir != NULL) {
+			while ((entry = readdir(dir)) != NULL) {
+				if (entry->d_name[0] != '.') {
+					snprintf(dev, sizeof(dev), "/dev/%s", entry->d_name);
+					break;
+				}
+			}
+			closedir(dir);
+		}
+		phFile->sg = open(dev, O_RDWR | O_NONBLOCK);
+		if (phFile->sg < 0) {
+			phFile->sg = -1;
+			return false;
+		}
+	}
+#endif
+	if (phFile->sg == -1)
+		return false;
+	// firmware without the vendor CDBs fails the command; without CAP_SYS_RAWIO the kernel does
+	if (!Se3Read(buf, *phFile, 15, 1, SE3C_MAGIC_TIMEOUT) || !Se3ReadInfo(buf, NULL)) {
+		if (phFile->sg >= 0)
+			close(phFile->sg);
+		phFile->sg = -1;
+		return false;
+	}
+	return true;
+}
+
+bool L0Support::Se3ScsiTransfer(uint8_t opcode, uint8_t* buf, se3File hFile, size_t block, size_t nBlocks, uint32_t timeout) {
+#ifdef SE3_CUBESIM
+	if (hFile.sg == SE3_CUBESIM_FD) {
+		if (opcode == SE3_SCSI_CMD_OUT)
+			return se3_cubesim_vendor_write((uint32_t)block, buf, (uint16_t)nBlocks);
+		return se3_cubesim_vendor_read((uint32_t)block, buf, (uint16_t)nBlocks);
+	}
+#endif
+#ifdef __linux__
+	uint8_t cdb[10];
+	uint8_t sense[32];
+	sg_io_hdr_t io;
+	// same layout as READ(10) and WRITE(10)
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = opcode;
+	cdb[2] = (uint8_t)(block >> 24);
+	cdb[3] = (uint8_t)(block >> 16);
+	cdb[4] = (uint8_t)(block >> 8);
+	cdb[5] = (uint8_t)block;
+	cdb[7] = (uint8_t)(nBlocks >> 8);
+	cdb[8] = (uint8_t)nBlocks;
+	memset(&io, 0, sizeof(io));
+	io.interface_id = 'S';
+	io.dxfer_direction = (opcode == SE3_SCSI_CMD_OUT) ? (SG_DXFER_TO_DEV) : (SG_DXFER_FROM_DEV);
+	io.cmd_len = sizeof(cdb);
+	io.cmdp = cdb;
+	io.dxfer_len = (unsigned int)(nBlocks * L0Communication::Parameter::COMM_BLOCK);
+	io.dxferp = buf;
+	io.mx_sb_len = sizeof(sense);
+	io.sbp = sense;
+	io.timeout = timeout;
+	if (ioctl(hFile.sg, SG_IO, &io) < 0 || (io.info & SG_INFO_OK_MASK) != SG_INFO_OK || io.resid != 0)
+		return false;
+	return true;
+#else
+	return false;
+#endif
+}
+#endif
+
+#if defined(SE3_CUBESIM) && !defined(_WIN32)
+/* in-process emulator */
+const se3Char* L0Support::Se3CubesimPath() {
+	const char* path = getenv(SE3_CUBESIM_ENV);
+	if (path == NULL || path[0] == '\0' || strlen(path) >= L0Communication::Parameter::SE3_MAX_PATH - SE3_MAGIC_FILE_LEN - 1)
+		return NULL;
+	return path;
+}
+
+bool L0Support::Se3CubesimOpen(se3Char* path, se3File* phFile) {
+	const se3Char* cubesimPath = Se3CubesimPath();
+	size_t len = (cubesimPath == NULL) ? 0 : strlen(cubesimPath);
+	// GetDeviceList() returns the drive paths with a trailing separator
+	if (cubesimPath == NULL || strncmp(path, cubesimPath, len) != 0 || (path[len] != '\0' && strcmp(path + len, "/") != 0) || !se3_cubesim_init())
+		return false;
+	phFile->fd = SE3_CUBESIM_FD;
+	phFile->buf = NULL;
+	phFile->locked = false;
+	phFile->sg = -1;
+	return true;
+}
 #endif
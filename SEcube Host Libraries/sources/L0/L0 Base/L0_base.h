@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <memory>
 #include <vector>
+#include <deque>
 #include "../L0_enumerations.h"
 
 #ifdef _WIN32
@@ -48,7 +49,24 @@
 	#include <errno.h>
 #endif
 
+#ifdef __linux__
+	#include <limits.h>
+	#include <dirent.h>
+	#include <sys/ioctl.h>
+	#include <sys/sysmacros.h>
+	#include <scsi/sg.h>
+#endif
+
+#if defined(SE3_CUBESIM) && !defined(_WIN32)
+	#include "se3_cubesim.h"
+	#define SE3_CUBESIM_ENV "SE3_CUBESIM_PATH" /* drive path answered by the in-process emulator */
+	#define SE3_CUBESIM_FD (-2) /* se3File.fd of the emulated device */
+#endif
+
 #define SE3_DRIVE_BUF_MAX 1024
+#define SE3_SCSI_CMD_OUT 0xC0 /* vendor CDB writing blocks of the protocol file, by index */
+#define SE3_SCSI_RESP_IN 0xC1 /* vendor CDB reading blocks of the protocol file, by index */
+#define SE3_TRANSPORT_ENV "SE3_L0_TRANSPORT" /* "file" disables the vendor CDBs */
 #define SE3_MAGIC_FILE_LEN 9
 #define SE3C_MAGIC_TIMEOUT 1000
 
@@ -141,6 +159,9 @@ typedef struct se3DriveIt_ {
 	size_t pos;
 #else
 	FILE* fp;
+#ifdef SE3_CUBESIM
+	bool cubesim; /**< The emulated device has not been returned yet. */
+#endif
 #endif
 } se3DriveIt;
 
@@ -154,9 +175,10 @@ typedef struct {
 	OVERLAPPED ol;
 	HANDLE h;
 #else
-	int fd;
-	void* buf;
-	bool locked;
+	int fd = -1;
+	void* buf = nullptr;
+	bool locked = false;
+	int sg = -1; /**< SCSI node the vendor CDBs are sent to, -1 if the magic file is used. */
 #endif
 }se3File;
 
@@ -166,6 +188,8 @@ typedef struct se3Device_ {
 	std::shared_ptr<uint8_t> response;
 	se3File f;
 	bool opened;
+	std::deque<uint32_t> pending; /**< cmdTokens of the requests sent and not yet answered, oldest first. */
+	bool longPoll; /**< Requests are sent with L0Request::Flags::LONGPOLL. */
 } se3Device;
 
 class L0Base {
@@ -188,6 +212,13 @@ class L0Base {
 		uint8_t		GetDevicePtr();
 		uint8_t*	GetDeviceRequest();
 		uint8_t*	GetDeviceResponse();
+		uint16_t	GetDeviceInfoStatus();
+		size_t		GetDevicePendingCount();
+		bool		GetDeviceLongPoll();
+		//pending requests
+		void	PushDevicePending(uint32_t cmdToken);
+		bool	PopDevicePending(uint32_t& cmdToken);
+		void	ClearDevicePending();
 		//Iterator GET methods
 		uint8_t*	GetDiscoDeviceHelloMsg();
 		se3Char*	GetDiscoDevicePath();
@@ -204,6 +235,8 @@ class L0Base {
 		//device SET methods
 		void	SetDeviceFile(se3File file);
 		void	SetDeviceOpened(bool opened);
+		void	SetDeviceInfoStatus(uint16_t status);
+		void	SetDeviceLongPoll(bool longPoll);
 		bool	SetDevicePtr(uint16_t newPtr);
 		//iterator SET methods
 		void	SetDiscoDeviceStatus(uint16_t status);
@@ -211,6 +244,10 @@ class L0Base {
 		void	SetDiscoDriveBufTermination();
 		void	SetDiscoDrivePath(se3Char* path);
 		void 	SetDiscoDriveFile(FILE* fp);
+#if defined(SE3_CUBESIM) && !defined(_WIN32)
+		bool	GetDiscoDriveCubesim();
+		void	SetDiscoDriveCubesim(bool cubesim);
+#endif
 };
 
 class L0Support {
@@ -236,7 +273,13 @@ class L0Support {
 		static uint16_t Se3Crc16Update(size_t dataLen, const uint8_t* data, uint16_t crc);
 		static bool se3UnixLock(int fd);
 		static void se3UnixUnlock(int fd);
+		static bool Se3ScsiAttach(se3Char* path, se3File* phFile); /**< Use the vendor CDBs for the opened device, if it answers them. */
+		static bool Se3ScsiTransfer(uint8_t opcode, uint8_t* buf, se3File hFile, size_t block, size_t nBlocks, uint32_t timeout);
 		static void DebugFileCreation();
+#if defined(SE3_CUBESIM) && !defined(_WIN32)
+		static const se3Char* Se3CubesimPath(); /**< Drive path of the emulated device, NULL if not configured. */
+		static bool Se3CubesimOpen(se3Char* path, se3File* phFile); /**< Open the emulated device if path is its drive. */
+#endif
 };
 
 #endif
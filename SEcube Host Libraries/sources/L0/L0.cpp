@@ -31,6 +31,7 @@
  */
 
 #include "L0.h"
+#include "L0_recorder.h"
 #include <string>
 
 int L0::GetDeviceList(std::vector<std::pair<std::string, std::string>>& devicelist){
@@ -66,6 +67,8 @@ int L0::GetDeviceList(std::vector<std::pair<std::string, std::string>>& deviceli
 }
 
 L0::L0() {
+	//start recording the traffic if requested by the environment
+	L0Recorder::StartFromEnv();
 	//initialize the secube discover
 	L0DiscoverInit();
 	//scan all the seCubes connected
@@ -65,6 +65,11 @@ public:
 	void L0Open(uint8_t devPtr) override ;
 	void L0Close(uint8_t devPtr) override ;
 	void L0TXRX(uint16_t reqCmd, uint16_t reqCmdFlags, uint16_t reqLen, const uint8_t* reqData, uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) override ;
+	void L0Send(uint16_t reqCmd, uint16_t reqCmdFlags, uint16_t reqLen, const uint8_t* reqData) override ;
+	void L0Receive(uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) override ;
+	uint8_t L0MaxOutstanding() override ;
+	void L0SetLongPoll(bool enable) override ;
+	bool L0LongPoll() override ;
 	uint16_t L0Echo(const uint8_t* dataIn, uint16_t dataInLen, uint8_t* dataOut) override ;
 
 	//PROVISION
@@ -79,6 +84,12 @@ public:
 	uint8_t* GetDeviceHelloMsg();
 	se3Char* GetDevicePath(){return this->base.GetDeviceInfoPath();}
 	uint8_t* GetDeviceSn(){return this->base.GetDeviceInfoSerialNo();}
+#ifdef _WIN32
+	bool GetDeviceScsi(){return false;}
+#else
+	/** @brief True if the requests to the open device are sent with the vendor CDBs, false if they go through the magic file. */
+	bool GetDeviceScsi(){return this->base.GetDeviceOpened() && this->base.GetDeviceFile().sg != -1;}
+#endif
 	int GetDeviceList(std::vector<std::pair<std::string, std::string>>& devicelist);
 	//LOGFILE MANAGING
 	bool Se3CreateLogFile(char* path, uint32_t file_dim);
@@ -69,6 +69,15 @@ bool L0::Se3DriveNext() {
 bool L0::Se3DriveNext() {
     char buf[SE3_DRIVE_BUF_MAX];
     memset(buf, '\0', SE3_DRIVE_BUF_MAX);
+#ifdef SE3_CUBESIM
+    if (this->base.GetDiscoDriveCubesim()) {
+    	// the emulated device is returned before the mounted drives
+    	this->base.SetDiscoDriveCubesim(false);
+    	strcpy(this->base.GetDiscoDriveBuf(), L0Support::Se3CubesimPath());
+    	this->base.SetDiscoDrivePath(this->base.GetDiscoDriveBuf());
+    	return true;
+    }
+#endif
     if(this->base.GetDiscoDriveFile() == nullptr){
     	return false;
     }
@@ -134,6 +143,9 @@ void L0::L0DiscoverInit() {
 //UNIX
 void L0::L0DiscoverInit() {
 	this->base.SetDiscoDriveFile(fopen("/proc/mounts", "r"));
+#ifdef SE3_CUBESIM
+	this->base.SetDiscoDriveCubesim(L0Support::Se3CubesimPath() != NULL);
+#endif
 }
 #endif
 
@@ -32,6 +32,8 @@
 
 #include "L0.h"
 #include "L0_error_manager.h"
+#include "L0_recorder.h"
+#include "L0_probes.h"
 
 using namespace std;
 
@@ -84,8 +86,14 @@ uint16_t L0::L0TX(uint16_t cmd, uint16_t cmdFlags, uint16_t len, const uint8_t*
 	uint32_t offsetDst = 0;				//Offset for destination blocks buffer
 	uint32_t offsetSrc = 0;				//Offset for source data buffer
 	uint16_t nBlocks = 0;				//Number of logical data blocks
+	bool written;
 
+	SE3_PROBE3(l0_tx_start, cmd, cmdFlags, len);
 	L0Support::Se3Rand(sizeof(uint32_t), (uint8_t*)&cmdToken);
+	uint32_t cmdToken0 = cmdToken;		//Command Token of the first block, used to match the response
+
+	if (L0LongPoll())
+		cmdFlags |= L0Request::Flags::LONGPOLL;
 
 	/* Set header fields */
 	SE3SET16(this->base.GetDeviceRequest(), L0Request::Offset::CMD, cmd);
@@ -126,9 +134,18 @@ uint16_t L0::L0TX(uint16_t cmd, uint16_t cmdFlags, uint16_t len, const uint8_t*
 	}
 
 	//send the data by writing inside the file
-	if (!L0Support::Se3Write(this->base.GetDeviceRequest(), this->base.GetDeviceFile(), 0, nBlocks, SE3_TIMEOUT))
+	if (L0Recorder::Active()) {
+		uint64_t start = L0Recorder::Now();
+		written = L0Support::Se3Write(this->base.GetDeviceRequest(), this->base.GetDeviceFile(), 0, nBlocks, SE3_TIMEOUT);
+		L0Recorder::Request(this->base.GetDeviceRequest(), nBlocks, written, start, L0Recorder::Now());
+	}
+	else
+		written = L0Support::Se3Write(this->base.GetDeviceRequest(), this->base.GetDeviceFile(), 0, nBlocks, SE3_TIMEOUT);
+	SE3_PROBE4(l0_tx_end, cmd, cmdToken0, nBlocks, written);
+	if (!written)
 		return L0ErrorCodes::Error::COMMUNICATION;
 
+	this->base.PushDevicePending(cmdToken0);
 	return L0ErrorCodes::Error::OK;
 }
 
@@ -150,9 +167,18 @@ uint16_t L0::L0RX(uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) {
 	uint16_t n;
 	uint16_t offsetSrc;
 	uint16_t offsetDst;
+	uint32_t expected = 0;
+	bool match = this->base.PopDevicePending(expected);
+	// with long-poll the SEcube holds the read until the response is ready, no need to wait
+	bool longPoll = L0LongPoll();
+	bool record = L0Recorder::Active();
+	uint64_t start = record ? L0Recorder::Now() : 0;
+	uint32_t polls = 0;
 
 	while (!ready) {
-		Se3Sleep();
+		if (!longPoll)
+			Se3Sleep();
+		polls++;
 
 		if (!L0Support::Se3Read(this->base.GetDeviceResponse(), this->base.GetDeviceFile(), 0, 1, SE3_TIMEOUT)) {
 			success = false;
@@ -161,6 +187,23 @@ uint16_t L0::L0RX(uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) {
 
 		SE3GET16(this->base.GetDeviceResponse(), 0, u16tmp);
 		ready = u16tmp == 1;
+		if (ready && match) {
+			// with pipelining the SEcube may still be serving the response to a previous request
+			SE3GET32(this->base.GetDeviceResponse(), L0Response::Offset::CMD_TOKEN, u32tmp);
+			ready = u32tmp == expected;
+			if (!ready) {
+				/* a response nobody will read (its host exited, or an earlier L0RX timed out):
+				 * read its other blocks, so that the SEcube releases it */
+				SE3GET16(this->base.GetDeviceResponse(), L0Response::Offset::LEN, lenDataAndHeaders);
+				nBlocks = L0Support::Se3NBlocks(lenDataAndHeaders);
+				if (nBlocks > 1 && nBlocks < L0Communication::Parameter::COMM_N &&
+					!L0Support::Se3Read(this->base.GetDeviceResponse() + L0Communication::Parameter::COMM_BLOCK, this->base.GetDeviceFile(), 1, nBlocks - 1, SE3_TIMEOUT)) {
+					success = false;
+					break;
+				}
+			}
+		}
+		SE3_PROBE2(l0_rx_poll, polls, ready);
 
 		if (L0Support::Se3Clock() > deadline && !ready) {
 			success = false;
@@ -168,29 +211,47 @@ uint16_t L0::L0RX(uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) {
 		}
 	}
 
-	if (!success)
+	if (!success) {
+		if (record)
+			L0Recorder::Response(this->base.GetDeviceResponse(), 1, false, polls, start, L0Recorder::Now());
+		SE3_PROBE4(l0_rx_done, 0xFFFF, 0, polls, expected);
+		// the state of the other outstanding requests is unknown
+		this->base.ClearDevicePending();
 		return L0ErrorCodes::Error::COMMUNICATION;
+	}
 
 	SE3GET16(this->base.GetDeviceResponse(), L0Response::Offset::LEN, lenDataAndHeaders);
 	len = L0Support::Se3RespLenData(lenDataAndHeaders);
 
-	if (len > *respLen)
+	if (len > *respLen) {
+		if (record)
+			L0Recorder::Response(this->base.GetDeviceResponse(), 1, false, polls, start, L0Recorder::Now());
+		SE3_PROBE4(l0_rx_done, 0xFFFF, len, polls, expected);
 		return L0ErrorCodes::Error::COMMUNICATION;
+	}
 
 	nBlocks = L0Support::Se3NBlocks(lenDataAndHeaders);
 
 	if (nBlocks > 1)
-		if (!L0Support::Se3Read(this->base.GetDeviceResponse() + L0Communication::Parameter::COMM_BLOCK, this->base.GetDeviceFile(), 1, nBlocks - 1, SE3_TIMEOUT))
-			return L0ErrorCodes::Error::COMMUNICATION;
+		success = L0Support::Se3Read(this->base.GetDeviceResponse() + L0Communication::Parameter::COMM_BLOCK, this->base.GetDeviceFile(), 1, nBlocks - 1, SE3_TIMEOUT);
+	if (record)
+		L0Recorder::Response(this->base.GetDeviceResponse(), (uint16_t)nBlocks, success, polls, start, L0Recorder::Now());
+	if (!success) {
+		SE3_PROBE4(l0_rx_done, 0xFFFF, len, polls, expected);
+		return L0ErrorCodes::Error::COMMUNICATION;
+	}
 
 	//check cmdtokens
 	SE3GET32(this->base.GetDeviceResponse(), L0Response::Offset::CMD_TOKEN, cmdtok0);
+	expected = cmdtok0;
 
 	for (i = 1; i < nBlocks; i++) {
 		cmdtok0++;
 		SE3GET32(this->base.GetDeviceResponse() + i * L0Communication::Parameter::COMM_BLOCK, L0Response::Offset::DATA_CMD_TOKEN, u32tmp);
-		if (cmdtok0 != u32tmp)
+		if (cmdtok0 != u32tmp) {
+			SE3_PROBE4(l0_rx_done, 0xFFFF, len, polls, expected);
 			return L0ErrorCodes::Error::COMMUNICATION;
+		}
 	}
 
 #if SE3_CONF_CRC
@@ -232,6 +293,7 @@ uint16_t L0::L0RX(uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) {
 	//read headers
 	SE3GET16(this->base.GetDeviceResponse(), L0Response::Offset::STATUS, u16tmp);
 	*respStatus = u16tmp;
+	SE3_PROBE4(l0_rx_done, u16tmp, len, polls, expected);
 	SE3GET16(this->base.GetDeviceResponse(), L0Response::Offset::LEN, u16tmp);
 	*respLen = len;
 
@@ -282,6 +344,9 @@ void L0::L0Open(uint8_t devPtr) {
 
 	//set the file handler inside the currently selected device
 	this->base.SetDeviceFile(hFile);
+	//the discovery status tells whether the device supports pipelining
+	this->base.SetDeviceInfoStatus(discovNfo.status);
+	this->base.ClearDevicePending();
 	//allocate the memory for the request buffer (transmission)
 	this->base.AllocateDeviceRequest();
 	//allocate the memory for the response buffer (reception)
@@ -302,6 +367,7 @@ void L0::L0Close(uint8_t devPtr) {
 
 	if (this->base.GetDeviceOpened()) {
 		this->base.SetDeviceOpened(false);
+		this->base.ClearDevicePending();
 		if (this->base.GetDeviceRequest() != NULL){
 			this->base.FreeDeviceRequest();
 		}
@@ -326,6 +392,10 @@ void L0::L0TXRX(uint16_t reqCmd, uint16_t reqCmdFlags, uint16_t reqLen, const ui
 	if (reqLen > L0Request::Size::MAX_DATA)
 		throw paramEcx;
 
+	// replies to commands sent with L0Send() must be read first
+	if (this->base.GetDevicePendingCount() > 0)
+		throw paramEcx;
+
 	//if (this->base.GetDevice() == NULL || reqLen > SE3_REQ_MAX_DATA)
 		//return SE3_ERR_PARAMS;
 
@@ -340,6 +410,58 @@ void L0::L0TXRX(uint16_t reqCmd, uint16_t reqCmdFlags, uint16_t reqLen, const ui
 		throw rxExc;
 }
 
+void L0::L0Send(uint16_t reqCmd, uint16_t reqCmdFlags, uint16_t reqLen, const uint8_t* reqData) {
+	L0NoDeviceOpenedException noDevExc;
+	L0ParametersErrorException paramEcx;
+	L0TXException txExc;
+
+	if (!this->base.GetDeviceOpened())
+		throw noDevExc;
+
+	if (reqLen > L0Request::Size::MAX_DATA)
+		throw paramEcx;
+
+	if (this->base.GetDevicePendingCount() >= L0MaxOutstanding())
+		throw paramEcx;
+
+	if (L0TX(reqCmd, reqCmdFlags, reqLen, reqData) != L0ErrorCodes::Error::OK)
+		throw txExc;
+}
+
+void L0::L0Receive(uint16_t* respStatus, uint16_t* respLen, uint8_t* respData) {
+	L0NoDeviceOpenedException noDevExc;
+	L0ParametersErrorException paramEcx;
+	L0RXException rxExc;
+
+	if (!this->base.GetDeviceOpened())
+		throw noDevExc;
+
+	if (this->base.GetDevicePendingCount() == 0)
+		throw paramEcx;
+
+	if (L0RX(respStatus, respLen, respData) != L0ErrorCodes::Error::OK)
+		throw rxExc;
+}
+
+uint8_t L0::L0MaxOutstanding() {
+	if (this->base.GetDeviceInfoStatus() & L0DiscoverParameters::Status::PIPELINE)
+		return L0Communication::Parameter::MAX_OUTSTANDING;
+	return 1;
+}
+
+void L0::L0SetLongPoll(bool enable) {
+	L0NoDeviceOpenedException noDevExc;
+
+	if (!this->base.GetDeviceOpened())
+		throw noDevExc;
+
+	this->base.SetDeviceLongPoll(enable);
+}
+
+bool L0::L0LongPoll() {
+	return this->base.GetDeviceLongPoll() && (this->base.GetDeviceInfoStatus() & L0DiscoverParameters::Status::LONGPOLL);
+}
+
 uint16_t L0::L0Echo(const uint8_t* dataIn, uint16_t dataInLen, uint8_t* dataOut) {
 	uint16_t respStatus = 0;
 	uint16_t respLen = 0;
@@ -47,7 +47,8 @@ namespace L0Communication {
 		enum {
 			COMM_BLOCK = 512,
 			COMM_N = 16,
-			SE3_MAX_PATH = 256 // MAX_PATH is already defined in Windows.h
+			SE3_MAX_PATH = 256, // MAX_PATH is already defined in Windows.h
+			MAX_OUTSTANDING = 2 /**< Requests that may be sent before reading the first response, if the SEcube supports pipelining. */
 		};
 	};
 
@@ -70,9 +71,25 @@ namespace L0DiscoverParameters {
 			STATUS = 3 * 32
 		};
 	};
+
+	/** Flags of the status field of the discovery block. */
+	struct Status {
+		enum {
+			LOCKED = 1 << 0, /**< Magic initialization prevented. */
+			PIPELINE = 1 << 1, /**< The SEcube accepts a request while executing the previous one (see L0Communication::Parameter::MAX_OUTSTANDING). */
+			LONGPOLL = 1 << 2 /**< The SEcube supports L0Request::Flags::LONGPOLL. */
+		};
+	};
 }
 
 namespace L0Request {
+	/** Command flags handled by the L0 protocol. */
+	struct Flags {
+		enum {
+			LONGPOLL = 1 << 13 /**< The SEcube holds the read of the response until it is ready (see L0SetLongPoll()). */
+		};
+	};
+
 	struct Size {
 		enum {
 			HEADER = 16,
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * File Name          : L0_probes.h
+  * Description        : Static tracepoints (USDT) of the host libraries.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  L0_probes.h
+ *  \brief USDT probes of the host libraries, for bpftrace, perf and SystemTap.
+ *  \version SEcube Open Source SDK 1.5.1
+ *
+ *  The probes are compiled in on Linux when <sys/sdt.h> is available (package systemtap-sdt-dev
+ *  or systemtap-sdt-devel), unless SE3_NO_USDT is defined; elsewhere they expand to nothing.
+ *  A probe that is not attached is a single nop: its arguments are locals already computed by
+ *  the surrounding code, nothing is evaluated for it. Probes are listed with
+ *  "readelf -n <binary>" or "bpftrace -l 'usdt:<binary>:secube:*'"; the provider is secube.
+ *  Example bpftrace scripts are in examples/bpftrace.
+ *
+ *  Probe                    Arguments
+ *  l0_tx_start              cmd, cmd flags, request length
+ *  l0_tx_end                cmd, token of the first block, blocks written, 1 if written
+ *  l0_rx_poll               poll number (from 1), 1 if the response is ready
+ *  l0_rx_done               response status (0xFFFF on failure), response length, polls, token
+ *  l1_txrx_start            L1 command, request length
+ *  l1_txrx_end              L1 command, L1 status (0xFFFF if no response), response length
+ *  l1_encrypt_start/end     L1 command, 16-byte blocks
+ *  l1_decrypt_start/end     L1 command, 16-byte blocks
+ *  l1_crypto_update_start   session ID, flags, input bytes (datain1 + datain2)
+ *  l1_crypto_update_end     session ID, output bytes, 1 on success
+ *  l1_login_start           access type
+ *  l1_login_end             access type, 1 on success
+ *  l1_logout                1 if forced, 1 on success
+ */
+
+#ifndef _L0_PROBES_H
+#define _L0_PROBES_H
+
+#if !defined(SE3_NO_USDT) && defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SE3_USDT 1
+#endif
+#endif
+
+#ifdef SE3_USDT
+#define SE3_PROBE0(name) STAP_PROBE(secube, name)
+#define SE3_PROBE1(name, a) STAP_PROBE1(secube, name, a)
+#define SE3_PROBE2(name, a, b) STAP_PROBE2(secube, name, a, b)
+#define SE3_PROBE3(name, a, b, c) STAP_PROBE3(secube, name, a, b, c)
+#define SE3_PROBE4(name, a, b, c, d) STAP_PROBE4(secube, name, a, b, c, d)
+#else
+#define SE3_PROBE0(name) do{}while(0)
+#define SE3_PROBE1(name, a) do{}while(0)
+#define SE3_PROBE2(name, a, b) do{}while(0)
+#define SE3_PROBE3(name, a, b, c) do{}while(0)
+#define SE3_PROBE4(name, a, b, c, d) do{}while(0)
+#endif
+
+#endif
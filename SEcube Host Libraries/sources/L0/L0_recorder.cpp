@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * File Name          : L0_recorder.cpp
+  * Description        : Recorder of the traffic on the magic file.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/**
+ * @file	L0_recorder.cpp
+ * @brief	Implementation of the L0 traffic recorder
+ *
+ * The records are appended to an in-memory chunk under a mutex shared by every L0 object of
+ * the process; full chunks are written to the file by a background thread, so that recording
+ * does not slow down the communication with file I/O.
+ */
+
+#include "L0_recorder.h"
+#include "L0_enumerations.h"
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+	const size_t CHUNK_SIZE = 1 << 20; // bytes of records handed to the writer thread at once
+}
+
+std::atomic<bool> L0Recorder::active(false);
+std::mutex L0Recorder::lock;
+std::condition_variable L0Recorder::flush;
+std::thread L0Recorder::writer;
+std::vector<uint8_t> L0Recorder::chunk;
+std::deque<std::vector<uint8_t>> L0Recorder::full;
+bool L0Recorder::stopping = false;
+FILE* L0Recorder::fp = nullptr;
+bool L0Recorder::redact = false;
+uint64_t L0Recorder::origin = 0;
+
+uint64_t L0Recorder::Now() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool L0Recorder::Start(const char* path, bool redactPayload) {
+	se3RecordFileHeader h;
+	Stop();
+	std::lock_guard<std::mutex> guard(lock);
+	fp = fopen(path, "wb");
+	if (fp == nullptr)
+		return false;
+	memcpy(h.magic, L0Record::MAGIC, sizeof(h.magic));
+	h.version = L0Record::VERSION;
+	h.flags = redactPayload ? L0Record::Flags::REDACTED : 0;
+	if (fwrite(&h, sizeof(h), 1, fp) != 1) {
+		fclose(fp);
+		fp = nullptr;
+		return false;
+	}
+	redact = redactPayload;
+	chunk.reserve(CHUNK_SIZE);
+	stopping = false;
+	writer = std::thread(Writer);
+	origin = Now();
+	active = true;
+	static std::once_flag once;
+	std::call_once(once, []() { atexit(Stop); }); // flush the tail of the recording
+	return true;
+}
+
+void L0Recorder::Stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (fp == nullptr)
+			return;
+		active = false;
+		stopping = true;
+		if (!chunk.empty())
+			full.push_back(std::move(chunk));
+		chunk.clear();
+	}
+	flush.notify_one();
+	writer.join();
+	fclose(fp);
+	fp = nullptr;
+}
+
+void L0Recorder::Writer() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		flush.wait(guard, []() { return stopping || !full.empty(); });
+		if (full.empty())
+			return;
+		std::vector<uint8_t> c = std::move(full.front());
+		full.pop_front();
+		guard.unlock();
+		fwrite(c.data(), 1, c.size(), fp);
+		guard.lock();
+	}
+}
+
+void L0Recorder::StartFromEnv() {
+	static std::once_flag once;
+	std::call_once(once, []() {
+		const char* path = getenv(SE3_L0_RECORD_ENV);
+		const char* r = getenv(SE3_L0_RECORD_REDACT_ENV);
+		if (path != nullptr && path[0] != '\0')
+			Start(path, r != nullptr && strcmp(r, "0") != 0);
+	});
+}
+
+void L0Recorder::Write(uint8_t type, uint8_t flags, const uint8_t* blocks, uint16_t nBlocks, uint32_t polls, uint64_t start, uint64_t end) {
+	se3RecordHeader h;
+	bool notify = false;
+	std::unique_lock<std::mutex> guard(lock);
+	if (!active)
+		return;
+	h.type = type;
+	h.flags = flags | (redact ? L0Record::Flags::REDACTED : 0);
+	h.nBlocks = nBlocks;
+	h.cmdToken = 0;
+	if (nBlocks > 0)
+		memcpy(&h.cmdToken, blocks + L0Request::Offset::CMD_TOKEN, sizeof(h.cmdToken)); // same offset in responses
+	h.polls = polls;
+	h.size = (nBlocks == 0) ? 0 : (redact ? L0Record::Size::HEADER : nBlocks * L0Communication::Parameter::COMM_BLOCK);
+	h.start = start - origin;
+	h.end = end - origin;
+	chunk.insert(chunk.end(), (const uint8_t*)&h, (const uint8_t*)&h + sizeof(h));
+	chunk.insert(chunk.end(), blocks, blocks + h.size);
+	if (chunk.size() >= CHUNK_SIZE) {
+		full.push_back(std::move(chunk));
+		chunk = std::vector<uint8_t>();
+		chunk.reserve(CHUNK_SIZE);
+		notify = true;
+	}
+	guard.unlock();
+	if (notify)
+		flush.notify_one();
+}
+
+void L0Recorder::Request(const uint8_t* blocks, uint16_t nBlocks, bool success, uint64_t start, uint64_t end) {
+	Write(L0Record::Type::REQUEST, success ? 0 : L0Record::Flags::FAILED, blocks, nBlocks, 0, start, end);
+}
+
+void L0Recorder::Response(const uint8_t* blocks, uint16_t nBlocks, bool success, uint32_t polls, uint64_t start, uint64_t end) {
+	Write(L0Record::Type::RESPONSE, success ? 0 : L0Record::Flags::FAILED, blocks, nBlocks, polls, start, end);
+}
@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * File Name          : L0_recorder.h
+  * Description        : Recorder of the traffic on the magic file.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  L0_recorder.h
+ *  \brief Recorder of the blocks exchanged with the SEcube by L0TX() and L0RX().
+ *  \version SEcube Open Source SDK 1.5.1
+ *
+ *  The recorder is process-wide and off by default. It is started by L0Recorder::Start() or,
+ *  when the first L0 object is built, by the environment variable SE3_L0_RECORD=<file>
+ *  (SE3_L0_RECORD_REDACT=1 to redact the payloads). A recording is a se3RecordFileHeader
+ *  followed by one se3RecordHeader for each request written or response read, each followed
+ *  by se3RecordHeader::size bytes of blocks. Redacted records keep only the 16-byte header of
+ *  the first block. Integers are in host byte order.
+ *  L0TX() and L0RX() only copy the records to memory, a background thread writes them to the
+ *  file; the tail of the recording is written by L0Recorder::Stop() or at the exit of the process.
+ */
+
+#ifndef _L0_RECORDER_H
+#define _L0_RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define SE3_L0_RECORD_ENV "SE3_L0_RECORD"
+#define SE3_L0_RECORD_REDACT_ENV "SE3_L0_RECORD_REDACT"
+
+namespace L0Record {
+	struct Type {
+		enum {
+			REQUEST = 1, /**< Blocks written by L0TX(). */
+			RESPONSE = 2 /**< Blocks read by L0RX(). */
+		};
+	};
+	struct Flags {
+		enum {
+			REDACTED = 1 << 0, /**< Only the header of the first block is stored. */
+			FAILED = 1 << 1 /**< The write or read failed, the blocks are not meaningful. */
+		};
+	};
+	struct Size {
+		enum {
+			HEADER = 16 /**< Bytes kept from the first block of a redacted record. */
+		};
+	};
+	const char MAGIC[8] = {'S', 'E', '3', 'L', '0', 'R', 'E', 'C'};
+	const uint32_t VERSION = 1;
+}
+
+#pragma pack(push, 1)
+typedef struct se3RecordFileHeader_ {
+	char magic[8]; /**< L0Record::MAGIC */
+	uint32_t version; /**< L0Record::VERSION */
+	uint32_t flags; /**< L0Record::Flags::REDACTED if every record is redacted */
+} se3RecordFileHeader;
+
+typedef struct se3RecordHeader_ {
+	uint8_t type; /**< L0Record::Type */
+	uint8_t flags; /**< L0Record::Flags */
+	uint16_t nBlocks; /**< Blocks written or read on the device. */
+	uint32_t cmdToken; /**< cmdToken of the first block. */
+	uint32_t polls; /**< Reads of the first response block until it was ready, 0 for requests. */
+	uint32_t size; /**< Bytes of block data following this header. */
+	uint64_t start; /**< Start of the operation, ns since the recording started (monotonic clock). */
+	uint64_t end; /**< End of the operation, same clock. */
+} se3RecordHeader;
+#pragma pack(pop)
+
+class L0Recorder {
+private:
+	static std::atomic<bool> active;
+	static std::mutex lock;
+	static std::condition_variable flush;
+	static std::thread writer;
+	static std::vector<uint8_t> chunk; // records not yet handed to the writer thread
+	static std::deque<std::vector<uint8_t>> full; // chunks waiting to be written to the file
+	static bool stopping;
+	static FILE* fp;
+	static bool redact;
+	static uint64_t origin;
+	static void Writer();
+	static void Write(uint8_t type, uint8_t flags, const uint8_t* blocks, uint16_t nBlocks, uint32_t polls, uint64_t start, uint64_t end);
+	L0Recorder() {};
+public:
+	/** @brief Start recording to a new file, replacing the current recording if any.
+	 *  @return false if the file cannot be created. */
+	static bool Start(const char* path, bool redactPayload);
+	/** @brief Stop recording and close the file. */
+	static void Stop();
+	/** @brief Start recording if SE3_L0_RECORD is set. Only the first call has effect. */
+	static void StartFromEnv();
+	/** @brief Cheap check done by L0TX() and L0RX() before taking the timestamps. */
+	static bool Active() { return active.load(std::memory_order_relaxed); }
+	/** @brief Monotonic time in ns. */
+	static uint64_t Now();
+	/** @brief Record the blocks of a request, written by L0TX(). */
+	static void Request(const uint8_t* blocks, uint16_t nBlocks, bool success, uint64_t start, uint64_t end);
+	/** @brief Record the blocks of a response, read by L0RX() after polls reads of the first block. */
+	static void Response(const uint8_t* blocks, uint16_t nBlocks, bool success, uint32_t polls, uint64_t start, uint64_t end);
+};
+
+#endif
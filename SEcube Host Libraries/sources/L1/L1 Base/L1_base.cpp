@@ -31,6 +31,7 @@
  */
 
 #include "L1_base.h"
+#include <iomanip>
 
 L1Base::L1Base() {
 	this->ptr = 0;
@@ -55,6 +56,10 @@ void L1Base::SwitchToSession(uint8_t sPtr) {
 	this->ptr = sPtr;
 }
 
+uint8_t L1Base::GetSessionIndex() {
+	return this->ptr;
+}
+
 void L1Base::FillSessionBuffer(uint8_t* data, size_t offset, size_t len) {
 	memcpy(this->s[this->ptr].buf + offset, data, len);
 }
@@ -202,11 +207,52 @@ void se3Algo::print(){
 	case L1Crypto::CryptoTypes::SE3_CRYPTO_TYPE_BLOCKCIPHER_AUTH:
 		std::cout << "Algorithm type: block cipher with authentication and integrity" << std::endl;
 		break;
+	case L1Crypto::CryptoTypes::SE3_CRYPTO_TYPE_STREAMCIPHER_AUTH:
+		std::cout << "Algorithm type: stream cipher with authentication and integrity" << std::endl;
+		break;
 	default:
 		std::cout << "Algorithm type: unknown" << std::endl;
 	}
 }
 
+static void PrintPerfEntries(const char* title, const std::vector<se3PerfEntry>& entries, const char* const names[], size_t nNames, uint32_t clockHz){
+	std::cout << title << std::endl;
+	for(size_t i = 0; i < entries.size(); i++){
+		const se3PerfEntry& e = entries[i];
+		if(e.count == 0){
+			continue;
+		}
+		double us = (clockHz == 0) ? 0 : (double)e.cycles * 1e6 / clockHz;
+		std::string name = (i < nNames && names[i] != nullptr) ? names[i] : ("#" + std::to_string(i));
+		std::cout << "  " << std::left << std::setw(18) << name << std::right
+				  << " calls " << std::setw(8) << e.count
+				  << "  bytes " << std::setw(10) << e.bytes
+				  << "  total " << std::setw(12) << std::fixed << std::setprecision(1) << us << " us"
+				  << "  mean " << std::setw(10) << us / e.count << " us" << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+void se3PerfCounters::print(){
+	static const char* const cmd0Names[] = {nullptr, "FACTORY_INIT", "ECHO", "L1", "BOOT_MODE_RESET"};
+	static const char* const cmd1Names[] = {nullptr, "CHALLENGE", "LOGIN", "LOGOUT", "CONFIG", "KEY_EDIT", "KEY_FIND", "KEY_LIST",
+			"CRYPTO_INIT", "CRYPTO_UPDATE", "CRYPTO_LIST", "FORCED_LOGOUT", "SEKEY", "CRYPTO_SESSIONS", "PERF"};
+	static const char* const algoNames[] = {"AES", "SHA256", "HMACSHA256", "AES_HMACSHA256", "AES_GCM", "CHACHA20_POLY1305",
+			"BLAKE2S", "BLAKE2S_KEYED", "AES_CMAC", "AES_EAX"};
+	static const char* const protoNames[] = {"RECV", "SEND"};
+	std::cout << "\nSEcube performance counters (version " << this->version << ", " << this->elapsed << " ms since reset, clock "
+			  << this->clockHz << " Hz)" << std::endl;
+	std::cout << "Protocol: " << this->bytesIn << " bytes in, " << this->bytesOut << " bytes out, "
+			  << this->busyPolls << " reads not ready, " << this->heldReads << " reads held" << std::endl;
+	std::cout << "Flash: " << this->flashProgram << " programs (" << this->flashProgramBytes << " bytes), "
+			  << this->flashErase << " erasures, " << this->flashSwap << " swaps" << std::endl;
+	std::cout << "Session memory: " << this->memRefills << " page refills, " << this->memFailures << " failed allocations" << std::endl;
+	PrintPerfEntries("L0 commands:", this->cmd0, cmd0Names, sizeof(cmd0Names) / sizeof(cmd0Names[0]), this->clockHz);
+	PrintPerfEntries("L1 commands:", this->cmd1, cmd1Names, sizeof(cmd1Names) / sizeof(cmd1Names[0]), this->clockHz);
+	PrintPerfEntries("Algorithm updates:", this->algo, algoNames, sizeof(algoNames) / sizeof(algoNames[0]), this->clockHz);
+	PrintPerfEntries("Protocol blocks:", this->proto, protoNames, sizeof(protoNames) / sizeof(protoNames[0]), this->clockHz);
+}
+
 //se3Session* L1Base::GetCurrentSession() {
 //	return &(this->s[this->ptr]);
 //}
@@ -101,6 +101,69 @@ typedef struct se3Algo_ {
 	void print();
 } se3Algo;
 
+/** \brief Crypto session open on the SEcube */
+typedef struct se3CryptoSessionInfo_ {
+	uint32_t sessId;
+	uint16_t algorithm;
+	uint32_t idle; /**< Time (ms) since the session was last used. */
+} se3CryptoSessionInfo;
+
+/** \brief Crypto sessions open on the SEcube and usage of the session memory */
+typedef struct se3CryptoSessionsStatus_ {
+	uint32_t timeout; /**< Idle time (ms) after which the SEcube releases a session, 0 if sessions never expire. */
+	uint16_t reclaimed; /**< Sessions released by the SEcube because idle, since login. */
+	uint32_t bytesUsed; /**< Session memory held by open sessions. */
+	uint32_t bytesInternal; /**< Session memory wasted by rounding each session up to its size class. */
+	uint32_t bytesExternal; /**< Free session memory that can only hold sessions of a size class in use. */
+	uint16_t peak; /**< Maximum number of sessions open at the same time, since login. */
+	uint16_t failures; /**< Sessions that could not be allocated, since login. */
+	std::vector<se3CryptoSessionInfo> sessions;
+} se3CryptoSessionsStatus;
+
+/** \brief Calls and time spent by the SEcube on a command or on the update of an algorithm */
+typedef struct se3PerfEntry_ {
+	uint32_t count;
+	uint32_t bytes; /**< Request bytes for commands, input bytes for algorithms. */
+	uint64_t cycles; /**< Cycles spent, at se3PerfCounters::clockHz. */
+} se3PerfEntry;
+
+/** \brief Performance counters of the SEcube, since their last reset */
+typedef struct se3PerfCounters_ {
+	uint16_t version; /**< Version of the counter block (see L1Perf::Parameters::VERSION). */
+	uint32_t clockHz; /**< Frequency of the cycle counter (the core clock, 1 GHz under CUBESIM). */
+	uint32_t elapsed; /**< Time (ms) since the counters were reset. */
+	uint32_t busyPolls; /**< Reads of a response that was not ready yet. */
+	uint32_t heldReads; /**< Reads delayed by the SEcube until the response was ready (long-poll). */
+	uint64_t bytesIn; /**< Protocol bytes written by the host. */
+	uint64_t bytesOut; /**< Protocol bytes read by the host. */
+	uint32_t flashProgram; /**< Flash program operations. */
+	uint32_t flashProgramBytes;
+	uint32_t flashErase; /**< Flash sector erasures. */
+	uint32_t flashSwap; /**< Compactions of the flash into the other sector. */
+	uint32_t memRefills; /**< Free pages taken by a size class of the session allocator. */
+	uint32_t memFailures; /**< Session allocations that failed. */
+	std::vector<se3PerfEntry> cmd0; /**< Indexed by L0 command (L0Commands::Command), L1 commands are counted under L1_CMD0. */
+	std::vector<se3PerfEntry> cmd1; /**< Indexed by L1 command (L1Commands::Codes). */
+	std::vector<se3PerfEntry> algo; /**< Update of each algorithm (L1Algorithms::Algorithms). */
+	std::vector<se3PerfEntry> proto; /**< Blocks of the protocol file (L1Perf::Proto), located and copied by the SEcube; empty before version 2. */
+	void print();
+} se3PerfCounters;
+
+/** \brief Event recorded in the trace ring of the SEcube (see L1Perf::Event) */
+typedef struct se3TraceEvent_ {
+	uint64_t ts; /**< Cycle counter at the event, at se3Trace::clockHz, extended to 64 bit. */
+	uint16_t id;
+	uint16_t a;
+	uint32_t b;
+} se3TraceEvent;
+
+/** \brief Events drained from the trace ring of the SEcube */
+typedef struct se3Trace_ {
+	uint32_t clockHz; /**< Frequency of the cycle counter. */
+	uint32_t lost; /**< Events overwritten in the ring before being drained. */
+	std::vector<se3TraceEvent> events; /**< Oldest first. */
+} se3Trace;
+
 /** \brief SEcube Key structure */
 typedef struct se3Key_ {
 	uint32_t id;
@@ -109,6 +172,7 @@ typedef struct se3Key_ {
 //	uint16_t nameSize;
 	uint8_t* data;
 //	uint8_t name[L1Key::Size::MAX_NAME];
+	uint16_t policy = L1Key::Policy::NONE; // see L1Key::Policy, stored by L1KeyEdit() when not NONE
 } se3Key;
 
 class L1Base {
@@ -120,6 +184,7 @@ public:
 	~L1Base();
 
 	void SwitchToSession(uint8_t sPtr);
+	uint8_t GetSessionIndex();
 	//fills the list of sessions (one session for each device connected)
 	void InitializeSession(uint8_t nSessions);
 	//fill the session buffer with tha data passed as parameter
@@ -31,6 +31,7 @@
  */
 
 #include "L1.h"
+#include "../L0/L0_probes.h"
 
 using namespace std;
 
@@ -47,6 +48,7 @@ void SEcube_ciphertext::reset(){
 	this->initialization_vector.fill(0);
 	this->digest_nonce.fill(0);
 	this->CTR_nonce.fill(0);
+	this->compressed = false;
 	this->ciphertext.reset();
 }
 
@@ -82,6 +84,16 @@ void L1::L1SelectSEcube(uint8_t indx){
 	this->base.SwitchToSession(indx);
 }
 
+void L1::L1SetLongPoll(bool enable){
+	L1SelectDeviceException selectDevExc;
+	try {
+		L0SetLongPoll(enable);
+	}
+	catch(...) {
+		throw selectDevExc;
+	}
+}
+
 L1::~L1() {
 	if(this->index != 255){ // this is used by SEkey
 		if (this->base.GetSessionLoggedIn()){
@@ -116,7 +128,7 @@ void L1::PrepareSessionBufferForChallenge(uint8_t* cc1, uint8_t* cc2, uint16_t a
 
 //public
 
-void L1::TXRXData(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags, uint16_t* respLen) {
+uint16_t L1::PrepareRequest(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags) {
 	//SET THE HEADERS
 	if (this->base.GetSessionLoggedIn()){ // fill the buffer with the token
 		this->base.FillSessionBuffer(this->base.GetSessionToken(), L1Request::Offset::TOKEN, L1Parameters::Size::TOKEN);
@@ -156,13 +168,68 @@ void L1::TXRXData(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags, uint16_t* re
 
 	uint16_t req0Len = L1Request::Offset::DATA + reqLenPadded;
 	uint8_t* reqAuth = this->base.GetSessionBuffer() + L1Request::Offset::AUTH;
+	uint16_t nBlocks = (req0Len - L1Parameters::Size::AUTH - L1Parameters::Size::IV) / L1Parameters::Size::CRYPTO_BLOCK;
 
+	SE3_PROBE2(l1_encrypt_start, cmd, nBlocks);
 	Se3PayloadEncrypt(	cmdFlags,
 						this->base.GetSessionBuffer() + L1Request::Offset::IV,
 						this->base.GetSessionBuffer() + L1Parameters::Size::AUTH + L1Parameters::Size::IV,
-						(req0Len - L1Parameters::Size::AUTH - L1Parameters::Size::IV) / L1Parameters::Size::CRYPTO_BLOCK,
+						nBlocks,
 						reqAuth);
+	SE3_PROBE2(l1_encrypt_end, cmd, nBlocks);
+	return req0Len;
+}
+
+uint16_t L1::OpenResponse(uint16_t cmd, uint16_t cmdFlags, uint16_t respStatus, uint16_t resp0Len, uint16_t* respLen) {
+	if(respStatus != L1Error::Error::OK)
+	{
+		SE3_PROBE3(l1_txrx_end, cmd, respStatus, 0);
+	}
+	if(respStatus == L1Error::Error::SE3_ERR_OPENED)
+	{
+		L1AlreadyOpenException alreadyOpenExc;
+		throw alreadyOpenExc;
+	}
+	else if(respStatus != L1Error::Error::OK)
+	{
+		cout << "[L1.cpp - L1::TXRXData] Debug: Response status from L0::L0TXRX -> " << respStatus <<endl;
+		L0TXRXException l0TxRxExc;
+		throw l0TxRxExc;
+	}
 
+	//DECRYPT
+	uint8_t* respIv = this->base.GetSessionBuffer() + L1Response::Offset::IV;
+	uint8_t* resp_auth = this->base.GetSessionBuffer() + L1Response::Offset::AUTH;
+	L1CommunicationError payloadDecryptExc;
+
+	uint16_t nBlocks = (resp0Len - L1Parameters::Size::AUTH - L1Parameters::Size::IV) / L1Parameters::Size::CRYPTO_BLOCK;
+	SE3_PROBE2(l1_decrypt_start, cmd, nBlocks);
+	try {
+	Se3PayloadDecrypt(	cmdFlags,
+						respIv,
+						this->base.GetSessionBuffer() + L1Parameters::Size::AUTH + L1Parameters::Size::IV,
+						nBlocks,
+						resp_auth);
+	}
+	catch (L1Exception& e) {
+		SE3_PROBE2(l1_decrypt_end, cmd, nBlocks);
+		SE3_PROBE3(l1_txrx_end, cmd, 0xFFFF, 0);
+		throw payloadDecryptExc;
+	}
+	SE3_PROBE2(l1_decrypt_end, cmd, nBlocks);
+
+	uint16_t u16tmp;
+
+	memcpy((void*)&u16tmp, (const void*)(this->base.GetSessionBuffer() + L1Response::Offset::LEN), 2);
+	*respLen = u16tmp;
+	memcpy((void*)&u16tmp, (const void*)(this->base.GetSessionBuffer() + L1Response::Offset::STATUS), 2);
+	SE3_PROBE3(l1_txrx_end, cmd, u16tmp, *respLen);
+	return u16tmp;
+}
+
+void L1::TXRXData(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags, uint16_t* respLen) {
+	SE3_PROBE2(l1_txrx_start, cmd, reqLen);
+	uint16_t req0Len = PrepareRequest(cmd, reqLen, cmdFlags);
 	uint16_t resp0Len = L0Communication::Parameter::COMM_N * L0Communication::Parameter::COMM_BLOCK;
 
 	uint16_t respStatus;
@@ -180,51 +247,45 @@ void L1::TXRXData(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags, uint16_t* re
 		}
 		catch (const std::exception& e){
 			cout << e.what() << endl;
+			SE3_PROBE3(l1_txrx_end, cmd, 0xFFFF, 0);
 			throw commExc;
 		}
 		catch(...) {
 //			printf("Other exception\n");
+			SE3_PROBE3(l1_txrx_end, cmd, 0xFFFF, 0);
 			throw commExc;
 		}
-
-        if(respStatus == L1Error::Error::SE3_ERR_OPENED)
-        {
-            L1AlreadyOpenException alreadyOpenExc;
-            throw alreadyOpenExc;
-        }
-        else if(respStatus != L1Error::Error::OK)
-        {
-            cout << "[L1.cpp - L1::TXRXData] Debug: Response status from L0::L0TXRX -> " << respStatus <<endl;
-            L0TXRXException l0TxRxExc;
-            throw l0TxRxExc;
-
-        }
 	}
 
-	//DECRYPT
-	uint8_t* respIv = this->base.GetSessionBuffer() + L1Response::Offset::IV;
-	uint8_t* resp_auth = this->base.GetSessionBuffer() + L1Response::Offset::AUTH;
-	L1CommunicationError payloadDecryptExc;
+	if (OpenResponse(cmd, cmdFlags, respStatus, resp0Len, respLen) != L0ErrorCodes::Error::OK)
+		throw commExc;
+}
 
+void L1::TXData(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags) {
+	SE3_PROBE2(l1_txrx_start, cmd, reqLen);
+	uint16_t req0Len = PrepareRequest(cmd, reqLen, cmdFlags);
+	L1TXRXException commExc;
 	try {
-	Se3PayloadDecrypt(	cmdFlags,
-						respIv,
-						this->base.GetSessionBuffer() + L1Parameters::Size::AUTH + L1Parameters::Size::IV,
-						(resp0Len - L1Parameters::Size::AUTH - L1Parameters::Size::IV) / L1Parameters::Size::CRYPTO_BLOCK,
-						resp_auth);
+		L0::L0Send(L0Commands::Command::L1_CMD0, cmdFlags, req0Len, this->base.GetSessionBuffer());
 	}
-	catch (L1Exception& e) {
-		throw payloadDecryptExc;
+	catch(...) {
+		SE3_PROBE3(l1_txrx_end, cmd, 0xFFFF, 0);
+		throw commExc;
 	}
+}
 
-	uint16_t u16tmp;
-
-	memcpy((void*)&u16tmp, (const void*)(this->base.GetSessionBuffer() + L1Response::Offset::LEN), 2);
-	*respLen = u16tmp;
-	memcpy((void*)&u16tmp, (const void*)(this->base.GetSessionBuffer() + L1Response::Offset::STATUS), 2);
-
-	if (u16tmp != L0ErrorCodes::Error::OK)
+uint16_t L1::RXData(uint16_t cmd, uint16_t cmdFlags, uint16_t* respLen) {
+	uint16_t resp0Len = L0Communication::Parameter::COMM_N * L0Communication::Parameter::COMM_BLOCK;
+	uint16_t respStatus;
+	L1TXRXException commExc;
+	try {
+		L0::L0Receive(&respStatus, &resp0Len, this->base.GetSessionBuffer());
+	}
+	catch(...) {
+		SE3_PROBE3(l1_txrx_end, cmd, 0xFFFF, 0);
 		throw commExc;
+	}
+	return OpenResponse(cmd, cmdFlags, respStatus, resp0Len, respLen);
 }
 
 void L1::Se3PayloadCryptoInit() {
@@ -296,6 +357,124 @@ void L1::L1Config(uint16_t type, uint16_t op, std::array<uint8_t, L1Parameters::
 	}
 }
 
+static void ReadPerfEntries(L1Base& base, size_t& offset, uint16_t n, vector<se3PerfEntry>& entries) {
+	entries.resize(n);
+	for(uint16_t i = 0; i < n; i++){
+		base.ReadSessionBuffer((uint8_t*)&(entries[i].count), L1Response::Offset::DATA + offset + L1Perf::EntryOffset::COUNT, 4);
+		base.ReadSessionBuffer((uint8_t*)&(entries[i].bytes), L1Response::Offset::DATA + offset + L1Perf::EntryOffset::BYTES, 4);
+		base.ReadSessionBuffer((uint8_t*)&(entries[i].cycles), L1Response::Offset::DATA + offset + L1Perf::EntryOffset::CYCLES, 8);
+		offset += L1Perf::EntrySize::SIZE;
+	}
+}
+
+void L1::L1PerfCounters(se3PerfCounters& counters, bool reset) {
+	L1PerfException perfExc;
+	uint16_t op = L1Perf::Operation::GET | (reset ? L1Perf::Operation::RESET : 0);
+	uint16_t respLen = 0;
+	uint16_t n0 = 0, n1 = 0, nAlgo = 0;
+	size_t offset = L1Perf::ResponseOffset::ENTRIES;
+	this->base.FillSessionBuffer((uint8_t*)&op, L1Request::Offset::DATA + L1Perf::RequestOffset::OP, 2);
+	try {
+		TXRXData(L1Commands::Codes::PERF, L1Perf::RequestSize::SIZE, 0, &respLen);
+	}
+	catch(L1Exception& e) {
+		throw perfExc;
+	}
+	if(respLen < L1Perf::ResponseOffset::ENTRIES){
+		throw perfExc;
+	}
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.version), L1Response::Offset::DATA + L1Perf::ResponseOffset::VERSION, 2);
+	if(counters.version > L1Perf::Parameters::VERSION){
+		throw perfExc;
+	}
+	this->base.ReadSessionBuffer((uint8_t*)&n0, L1Response::Offset::DATA + L1Perf::ResponseOffset::N_CMD0, 2);
+	this->base.ReadSessionBuffer((uint8_t*)&n1, L1Response::Offset::DATA + L1Perf::ResponseOffset::N_CMD1, 2);
+	this->base.ReadSessionBuffer((uint8_t*)&nAlgo, L1Response::Offset::DATA + L1Perf::ResponseOffset::N_ALGO, 2);
+	if(respLen < offset + ((size_t)n0 + n1 + nAlgo) * L1Perf::EntrySize::SIZE){
+		throw perfExc;
+	}
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.clockHz), L1Response::Offset::DATA + L1Perf::ResponseOffset::CLOCK_HZ, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.elapsed), L1Response::Offset::DATA + L1Perf::ResponseOffset::ELAPSED, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.busyPolls), L1Response::Offset::DATA + L1Perf::ResponseOffset::BUSY_POLLS, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.heldReads), L1Response::Offset::DATA + L1Perf::ResponseOffset::HELD_READS, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.bytesIn), L1Response::Offset::DATA + L1Perf::ResponseOffset::BYTES_IN, 8);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.bytesOut), L1Response::Offset::DATA + L1Perf::ResponseOffset::BYTES_OUT, 8);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.flashProgram), L1Response::Offset::DATA + L1Perf::ResponseOffset::FLASH_PROGRAM, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.flashProgramBytes), L1Response::Offset::DATA + L1Perf::ResponseOffset::FLASH_PROGRAM_BYTES, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.flashErase), L1Response::Offset::DATA + L1Perf::ResponseOffset::FLASH_ERASE, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.flashSwap), L1Response::Offset::DATA + L1Perf::ResponseOffset::FLASH_SWAP, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.memRefills), L1Response::Offset::DATA + L1Perf::ResponseOffset::MEM_REFILLS, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(counters.memFailures), L1Response::Offset::DATA + L1Perf::ResponseOffset::MEM_FAILURES, 4);
+	ReadPerfEntries(this->base, offset, n0, counters.cmd0);
+	ReadPerfEntries(this->base, offset, n1, counters.cmd1);
+	ReadPerfEntries(this->base, offset, nAlgo, counters.algo);
+	counters.proto.clear();
+	if(counters.version >= 2 && respLen >= offset + L1Perf::Proto::MAX * L1Perf::EntrySize::SIZE){
+		ReadPerfEntries(this->base, offset, L1Perf::Proto::MAX, counters.proto);
+	}
+}
+
+void L1::L1PerfReset() {
+	L1PerfException perfExc;
+	uint16_t op = L1Perf::Operation::RESET;
+	uint16_t respLen = 0;
+	this->base.FillSessionBuffer((uint8_t*)&op, L1Request::Offset::DATA + L1Perf::RequestOffset::OP, 2);
+	try {
+		TXRXData(L1Commands::Codes::PERF, L1Perf::RequestSize::SIZE, 0, &respLen);
+	}
+	catch(L1Exception& e) {
+		throw perfExc;
+	}
+}
+
+void L1::L1TraceDrain(se3Trace& trace) {
+	L1PerfException perfExc;
+	uint16_t op = L1Perf::Operation::TRACE;
+	uint16_t respLen = 0;
+	uint16_t version = 0, entrySize = 0, count = 0, pending = 0;
+	uint32_t lost = 0, ts = 0;
+	size_t offset;
+	se3TraceEvent ev;
+	do {
+		this->base.FillSessionBuffer((uint8_t*)&op, L1Request::Offset::DATA + L1Perf::RequestOffset::OP, 2);
+		try {
+			TXRXData(L1Commands::Codes::PERF, L1Perf::RequestSize::SIZE, 0, &respLen);
+		}
+		catch(L1Exception& e) {
+			throw perfExc;
+		}
+		if(respLen < L1Perf::TraceOffset::ENTRIES){
+			throw perfExc;
+		}
+		this->base.ReadSessionBuffer((uint8_t*)&version, L1Response::Offset::DATA + L1Perf::TraceOffset::VERSION, 2);
+		this->base.ReadSessionBuffer((uint8_t*)&entrySize, L1Response::Offset::DATA + L1Perf::TraceOffset::ENTRY_SIZE, 2);
+		this->base.ReadSessionBuffer((uint8_t*)&count, L1Response::Offset::DATA + L1Perf::TraceOffset::COUNT, 2);
+		if(version > L1Perf::Parameters::TRACE_VERSION || entrySize < L1Perf::TraceEntrySize::SIZE ||
+				respLen < L1Perf::TraceOffset::ENTRIES + (size_t)count * entrySize){
+			throw perfExc;
+		}
+		this->base.ReadSessionBuffer((uint8_t*)&pending, L1Response::Offset::DATA + L1Perf::TraceOffset::PENDING, 2);
+		this->base.ReadSessionBuffer((uint8_t*)&(trace.clockHz), L1Response::Offset::DATA + L1Perf::TraceOffset::CLOCK_HZ, 4);
+		this->base.ReadSessionBuffer((uint8_t*)&lost, L1Response::Offset::DATA + L1Perf::TraceOffset::LOST, 4);
+		trace.lost += lost;
+		offset = L1Perf::TraceOffset::ENTRIES;
+		for(uint16_t i = 0; i < count; i++){
+			this->base.ReadSessionBuffer((uint8_t*)&ts, L1Response::Offset::DATA + offset + L1Perf::TraceEntryOffset::TS, 4);
+			this->base.ReadSessionBuffer((uint8_t*)&(ev.id), L1Response::Offset::DATA + offset + L1Perf::TraceEntryOffset::ID, 2);
+			this->base.ReadSessionBuffer((uint8_t*)&(ev.a), L1Response::Offset::DATA + offset + L1Perf::TraceEntryOffset::A, 2);
+			this->base.ReadSessionBuffer((uint8_t*)&(ev.b), L1Response::Offset::DATA + offset + L1Perf::TraceEntryOffset::B, 4);
+			// the counter wraps: extend it by the distance from the previous event
+			if(trace.events.empty()){
+				ev.ts = ts;
+			} else {
+				ev.ts = trace.events.back().ts + (uint32_t)(ts - (uint32_t)trace.events.back().ts);
+			}
+			trace.events.push_back(ev);
+			offset += entrySize;
+		}
+	} while(pending > 0 && count > 0);
+}
+
 void L1::L1FactoryInit(const std::array<uint8_t, L0Communication::Size::SERIAL>& serialno) {
 	DeviceAlreadyInitializedException exA;
 	L0FactoryInitException exB;
@@ -35,6 +35,8 @@
 #include "Login-Logout API/login_logout_api.h"
 #include "Security API/security_api.h"
 #include "Utility API/utility_api.h"
+#include "L1_crypto_session.h"
+#include "L1_compression.h"
 
 /** This class defines the attributes and the methods of a L1 object. L1 is built upon L0, therefore it uses a higher
  *  level of abstraction. L0 is focused on very basic actions (such as low level USB communication with the SEcube),
@@ -46,18 +48,43 @@
  *  level can be used (although it should be noted that a corresponding L2 object does not exist, since these libraries
  *  offer specific APIs to the developers).  */
 class L1 : private L0, public LoginLogoutApi, public SecurityApi, public UtilityApi {
+	friend class CryptoSession;
 private:
 	L1Base base;
 	uint8_t index; // this is used only by SEkey to support multiple SEcube connected to the same host computer (default value 255)
+	std::vector<L1CryptoSessionCache> sessionCache; // idle crypto sessions, one cache for each SEcube
+	size_t sessionCacheSize = L1CryptoSession::Parameters::CACHE_SIZE;
 	/* these are private methods that are used exclusively for internal and low level purposes. */
 	void SessionInit();
 	void PrepareSessionBufferForChallenge(uint8_t* cc1, uint8_t* cc2, uint16_t access);
 	void TXRXData(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags, uint16_t* respLen);
+	/* same as TXRXData() in two steps, so that more requests can be in flight (up to L0MaxOutstanding()).
+	 * RXData() returns the status of the command instead of throwing when it is not OK. */
+	void TXData(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags);
+	uint16_t RXData(uint16_t cmd, uint16_t cmdFlags, uint16_t* respLen);
+	uint16_t PrepareRequest(uint16_t cmd, uint16_t reqLen, uint16_t cmdFlags);
+	uint16_t OpenResponse(uint16_t cmd, uint16_t cmdFlags, uint16_t respStatus, uint16_t resp0Len, uint16_t* respLen);
+	/* fill the session buffer with a CRYPTO_UPDATE request, return its length */
+	uint16_t PrepareCryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint8_t* data1, uint16_t data2Len, uint8_t* data2);
 	void Se3PayloadCryptoInit();
 	void Se3PayloadEncrypt(uint16_t flags, uint8_t* iv, uint8_t* data, uint16_t nBlocks, uint8_t* auth);
 	void Se3PayloadDecrypt(uint16_t flags, const uint8_t* iv, uint8_t* data, uint16_t nBlocks, const uint8_t* auth);
 	void L1Config(uint16_t type, uint16_t op, std::array<uint8_t, L1Parameters::Size::PIN>& value);
 	void KeyList(uint16_t maxKeys, uint16_t skip, se3Key* keyArray, uint16_t* count);
+	/* crypto session cache (see L1_crypto_session.h) */
+	L1CryptoSessionCache& CurrentCryptoSessionCache();
+	CryptoSession CryptoSessionAcquire(uint16_t algorithm, uint16_t mode, uint32_t keyId);
+	void CryptoSessionRelease(const se3CryptoSessionEntry& entry);
+	void CryptoSessionClose(uint32_t sessId);
+	void CryptoSessionInvalidate(uint32_t keyId);
+	void CryptoSessionInvalidateAll();
+	void CryptoSessionForget();
+	bool ctrKeystream = false; // see L1SetCtrKeystream()
+	bool CtrKeystream(const CryptoSession& session, uint16_t finit, const uint8_t* nonce, size_t size, const uint8_t* in, uint8_t* out);
+	bool compression = false; // see L1SetCompression()
+	/* L1Encrypt() and L1Decrypt() without the compression stage */
+	void EncryptData(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext, SEcube_ciphertext& encrypted_data, uint16_t algorithm, uint16_t algorithm_mode, uint32_t key_id);
+	void DecryptData(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, std::shared_ptr<uint8_t[]>& plaintext);
 public:
 	L1(); /**< Default constructor. */
 	L1(uint8_t index); /**< Custom constructor used only in a very specific case by the APIs of the SEkey library (L2). Do not use elsewhere. */
@@ -102,6 +129,14 @@ public:
 	 * @param [in] dataOut The buffer filled with the result of the crypto operation.
 	 * @detail This is a low level function to exploit the crypto features of the SEcube. It can be ignored, we suggest using L1Encrypt(), L1Decrypt() and L1Digest() instead. */
 	void L1CryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint8_t* data1, uint16_t data2Len, uint8_t* data2, uint16_t* dataOutLen, uint8_t* dataOut) override ;
+	/** @brief Same as L1CryptoUpdate(), without waiting for the result; it must be read with L1CryptoUpdateReceive().
+	 * @detail Up to L1MaxOutstanding() requests can be in flight, so that the SEcube receives the next request while it executes the current one.
+	 * The results are read in the same order as the requests. No other request may be sent to the SEcube while results are pending. */
+	void L1CryptoUpdateSend(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint8_t* data1, uint16_t data2Len, uint8_t* data2);
+	/** @brief Read the result of the oldest request sent with L1CryptoUpdateSend(). The parameters are the same as in L1CryptoUpdate(). */
+	void L1CryptoUpdateReceive(uint16_t* dataOutLen, uint8_t* dataOut);
+	/** @brief The number of requests that can be in flight with L1CryptoUpdateSend() (see L0MaxOutstanding()): 2 on firmware with pipelining, 1 otherwise. */
+	uint8_t L1MaxOutstanding();
 	/** @brief Encrypt some data according to a specific algorithm and mode (i.e. AES-256-CBC), using a specific key.
 	 * @param [in] plaintext_size The length of the buffer to be encrypted.
 	 * @param [in] plaintext The buffer to be encrypted.
@@ -158,6 +193,59 @@ public:
 	/** @brief Retrieve the list of algorithms supported by the device.
 	 * @param [out] algorithmsArray */
 	void L1GetAlgorithms(std::vector<se3Algo>& algorithmsArray) override ;
+	/** @brief Set how many idle crypto sessions L1Encrypt() and L1Decrypt() may keep open on the SEcube for later reuse.
+	 * @param [in] size The maximum number of idle sessions for each SEcube (default L1CryptoSession::Parameters::CACHE_SIZE). 0 disables the reuse of sessions.
+	 * @detail Reusing a session saves the initialization of a new session on the SEcube when the same key, algorithm and mode are used again.
+	 * Currently only AES sessions are reused. If the new size is smaller than the number of idle sessions, the least recently used ones are closed. */
+	void L1SetCryptoSessionCacheSize(size_t size);
+	/** @brief Let L1Encrypt() and L1Decrypt() ask the SEcube only for the keystream of AES-CTR, and apply it on the host.
+	 * @param [in] enable True to use the keystream, false (default) to send the data to the SEcube.
+	 * @detail The data never crosses the USB link, which halves the traffic, and the request for the next chunk is in flight while
+	 * the keystream of the current one is applied. The output is the same in both cases. Only AES (not AES-HMAC-SHA256) is affected;
+	 * keys added with L1Key::Policy::NO_KEYSTREAM are refused by the SEcube, then the data is sent as usual. */
+	void L1SetCtrKeystream(bool enable);
+	/** @brief Let L1Encrypt() compress the plaintext into an LZ4 frame before encrypting it.
+	 * @param [in] enable True to compress, false (default) to encrypt the plaintext as it is.
+	 * @detail Less data crosses the USB link when the plaintext compresses well (text, logs, JSON). The frame is cut so that each request to
+	 * the SEcube carries a full chunk of compressed data. The plaintext is encrypted as it is when it does not compress, in any case
+	 * SEcube_ciphertext::compressed tells L1Decrypt() whether to decompress, regardless of this setting. The size of the ciphertext may
+	 * reveal how compressible the plaintext is: do not enable this if an attacker can mix chosen data with secrets in the same plaintext. */
+	void L1SetCompression(bool enable);
+	/** @brief Retrieve the crypto sessions open on the SEcube, with their idle time, and the usage of the session memory.
+	 * @param [out] status The idle timeout of the SEcube, the open sessions and the session memory statistics.
+	 * @detail Throws exception in case of errors. */
+	void L1CryptoSessionsList(se3CryptoSessionsStatus& status);
+	/** @brief Release every crypto session open on the SEcube, including the idle sessions kept by L1Encrypt() and L1Decrypt().
+	 * @detail Session identifiers returned by L1CryptoInit() must not be used afterwards. Throws exception in case of errors. */
+	void L1CryptoSessionsRelease();
+	/** @brief Renew the lease of every crypto session open on the SEcube.
+	 * @detail The SEcube releases on its own the sessions that are not used for longer than its idle timeout (see
+	 * L1SetCryptoSessionTimeout()). Applications keeping a session returned by L1CryptoInit() idle for a long time
+	 * must call this function periodically. Throws exception in case of errors. */
+	void L1CryptoSessionsRenew();
+	/** @brief Set the idle time after which the SEcube releases a crypto session on its own.
+	 * @param [in] timeout The idle timeout in ms (default L1CryptoSession::Parameters::DEVICE_TIMEOUT, restored at each login). 0 disables it.
+	 * @detail Throws exception in case of errors. */
+	void L1SetCryptoSessionTimeout(uint32_t timeout);
+
+	// Diagnostics API
+	/** @brief Read the performance counters of the SEcube: time spent by each command and by the update of each algorithm,
+	 * flash and session memory activity, protocol traffic.
+	 * @param [out] counters The counters, accumulated since the last reset (see se3PerfCounters::print() for a report).
+	 * @param [in] reset Reset the counters after reading them, in the same request.
+	 * @detail Requires login. Throws exception in case of errors, or if the SEcube returns a counter block of a newer version. */
+	void L1PerfCounters(se3PerfCounters& counters, bool reset = false);
+	/** @brief Reset the performance counters of the SEcube.
+	 * @detail Requires login. Throws exception in case of errors. */
+	void L1PerfReset();
+	/** @brief Drain the event trace ring of the SEcube.
+	 * @param [in,out] trace The events are appended to trace.events, oldest first, and removed from the ring; lost is increased
+	 * by the events overwritten before being drained.
+	 * @detail The SEcube timestamps events with a 32 bit cycle counter, which is extended to 64 bit starting from the last event
+	 * already in trace: pass the same trace to successive calls, and drain more often than the counter wraps (about 23 s at
+	 * 180 MHz, 4 s under CUBESIM). Requires login. Throws exception in case of errors, or if the SEcube returns a trace block
+	 * of a newer version. */
+	void L1TraceDrain(se3Trace& trace);
 
 	// Other API
 	/** @brief Select a specific SEcube out of multiple SEcube devices.
@@ -169,6 +257,10 @@ public:
 	 * @details The selected SEcube will be the one used by the host PC to perform required actions (i.e. data encryption). The parameter is used to identify the SEcube in the
 	 * list of SEcube devices that is returned by L0 GetDeviceList(). Throws exception in case of errors. */
 	void L1SelectSEcube(uint8_t indx);
+	/** @brief Ask the selected SEcube to hold the read of each reply until it is ready, instead of polling it (see L0SetLongPoll()).
+	 * @param [in] enable True to hold the reads, false (default) to poll. Ignored if the SEcube does not support it.
+	 * @detail Throws exception if no SEcube is selected. */
+	void L1SetLongPoll(bool enable);
 	/** @brief Initialize the SEcube with the specified serial number (this is a wrapper of a similar L0 factory init function).
 	 * @param [in] serialno The serial number to be set on the SEcube.
 	 * @details Throws exception if the SEcube is already initialized (or in case of any error). Since it simply is a wrapper around the corresponding L0 function, this does not require to be logged in to the SEcube. */
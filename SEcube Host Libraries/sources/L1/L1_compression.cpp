@@ -0,0 +1,324 @@
+/**
+  ******************************************************************************
+  * File Name          : L1_compression.cpp
+  * Description        : LZ4 compression of the data encrypted by L1Encrypt().
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/**
+ * @file	L1_compression.cpp
+ * @date	October, 2026
+ * @brief	LZ4 compression of the data encrypted by L1Encrypt().
+ * @version SEcube Open Source SDK 1.5.1
+ *
+ * The transfer over USB dominates the time of L1Encrypt() and L1Decrypt() on bulk data, so compressible data
+ * (logs, JSON) is worth compressing on the host first. LZ4 is used because it compresses much faster than the
+ * USB link, and its frames can be read by the lz4 tool. Blocks are independent and the compressor fills each
+ * window of the frame: the encrypted requests then carry as much data as possible, and a chunk never depends
+ * on the previous ones.
+ */
+
+#include "L1_compression.h"
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+enum {
+	MIN_MATCH = 4,
+	LAST_LITERALS = 5, // the last 5 bytes of a block are always literals
+	MF_LIMIT = 12, // the last match starts at least 12 bytes before the end of a block
+	MAX_OFFSET = 65535,
+	HASH_LOG = 12,
+	FINAL_RESERVE = 1 + 8, // room kept for the last literals when the output is full (at least 8, see CompressBlock())
+	FLG = 0x68, // version 01, independent blocks, content size
+	BD = 0x40 // 64 KB blocks
+};
+
+uint32_t Read32(const uint8_t* p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+void Write32(uint8_t* p, uint32_t v) {
+	memcpy(p, &v, 4);
+}
+
+uint32_t Rotl32(uint32_t x, int r) {
+	return (x << r) | (x >> (32 - r));
+}
+
+/* xxHash32, used by LZ4 frames for the header checksum */
+uint32_t Xxh32(const uint8_t* p, size_t len, uint32_t seed) {
+	const uint32_t P1 = 2654435761U, P2 = 2246822519U, P3 = 3266489917U, P4 = 668265263U, P5 = 374761393U;
+	size_t i = 0;
+	uint32_t h;
+	if(len >= 16){
+		uint32_t v[4] = {seed + P1 + P2, seed + P2, seed, seed - P1};
+		for(; i + 16 <= len; i += 16){
+			for(int j = 0; j < 4; j++){
+				v[j] = Rotl32(v[j] + Read32(p + i + 4 * j) * P2, 13) * P1;
+			}
+		}
+		h = Rotl32(v[0], 1) + Rotl32(v[1], 7) + Rotl32(v[2], 12) + Rotl32(v[3], 18);
+	} else {
+		h = seed + P5;
+	}
+	h += (uint32_t)len;
+	for(; i + 4 <= len; i += 4){
+		h = Rotl32(h + Read32(p + i) * P3, 17) * P4;
+	}
+	for(; i < len; i++){
+		h = Rotl32(h + p[i] * P5, 11) * P1;
+	}
+	h ^= h >> 15;
+	h *= P2;
+	h ^= h >> 13;
+	h *= P3;
+	h ^= h >> 16;
+	return h;
+}
+
+/* bytes following the token to encode a literal or match length n */
+size_t LengthBytes(size_t n) {
+	return (n < 15) ? 0 : ((n - 15) / 255 + 1);
+}
+
+size_t WriteLength(uint8_t* dst, size_t n) {
+	size_t op = 0;
+	for(n -= 15; n >= 255; n -= 255){
+		dst[op++] = 255;
+	}
+	dst[op++] = (uint8_t)n;
+	return op;
+}
+
+/* compress src into at most dstCap bytes (dstCap >= FINAL_RESERVE). consumed receives how much of src was
+ * encoded, which is less than srcSize if dstCap is reached. Returns the size of the block. */
+size_t CompressBlock(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCap, size_t& consumed) {
+	uint32_t table[1 << HASH_LOG] = {0}; // last position of each hashed 4 bytes sequence
+	size_t ip = 1, anchor = 0, op = 0;
+	if(srcSize > MF_LIMIT){
+		size_t mfLimit = srcSize - MF_LIMIT;
+		size_t matchLimit = srcSize - LAST_LITERALS;
+		while(ip <= mfLimit){
+			uint32_t seq = Read32(src + ip);
+			uint32_t h = (seq * 2654435761U) >> (32 - HASH_LOG);
+			size_t ref = table[h];
+			table[h] = (uint32_t)ip;
+			if((ip - ref > MAX_OFFSET) || (Read32(src + ref) != seq)){
+				ip += 1 + ((ip - anchor) >> 6); // skip faster over data that does not compress
+				continue;
+			}
+			while((ip > anchor) && (ref > 0) && (src[ip - 1] == src[ref - 1])){
+				ip--;
+				ref--;
+			}
+			size_t len = MIN_MATCH;
+			while((ip + len < matchLimit) && (src[ip + len] == src[ref + len])){
+				len++;
+			}
+			size_t lit = ip - anchor;
+			if(op + 1 + LengthBytes(lit) + lit + 2 + LengthBytes(len - MIN_MATCH) + FINAL_RESERVE > dstCap){
+				break; // the output is full
+			}
+			uint8_t* token = dst + op++;
+			*token = (uint8_t)(((lit < 15) ? lit : 15) << 4);
+			if(lit >= 15){
+				op += WriteLength(dst + op, lit);
+			}
+			memcpy(dst + op, src + anchor, lit);
+			op += lit;
+			dst[op++] = (uint8_t)(ip - ref);
+			dst[op++] = (uint8_t)((ip - ref) >> 8);
+			*token |= (uint8_t)(((len - MIN_MATCH) < 15) ? (len - MIN_MATCH) : 15);
+			if(len - MIN_MATCH >= 15){
+				op += WriteLength(dst + op, len - MIN_MATCH);
+			}
+			ip += len;
+			anchor = ip;
+		}
+	}
+	/* the block ends with literals. If they do not fit, the block is cut: FINAL_RESERVE leaves room for at least
+	 * 8 of them, so the last match still starts 12 bytes before the end and is followed by 5 literals. */
+	size_t lit = srcSize - anchor;
+	size_t room = dstCap - op;
+	if(1 + LengthBytes(lit) + lit > room){
+		lit = room - 1 - LengthBytes(room - 1);
+		while(1 + LengthBytes(lit + 1) + lit + 1 <= room){
+			lit++;
+		}
+	}
+	dst[op++] = (uint8_t)(((lit < 15) ? lit : 15) << 4);
+	if(lit >= 15){
+		op += WriteLength(dst + op, lit);
+	}
+	memcpy(dst + op, src + anchor, lit);
+	op += lit;
+	consumed = anchor + lit;
+	return op;
+}
+
+bool ReadLength(const uint8_t* src, size_t srcSize, size_t& ip, size_t& n) {
+	uint8_t b;
+	do {
+		if(ip >= srcSize){
+			return false;
+		}
+		b = src[ip++];
+		n += b;
+	} while(b == 255);
+	return true;
+}
+
+bool DecompressBlock(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCap, size_t& written) {
+	size_t ip = 0, op = 0;
+	while(ip < srcSize){
+		uint8_t token = src[ip++];
+		size_t lit = token >> 4;
+		if((lit == 15) && !ReadLength(src, srcSize, ip, lit)){
+			return false;
+		}
+		if((lit > srcSize - ip) || (lit > dstCap - op)){
+			return false;
+		}
+		memcpy(dst + op, src + ip, lit);
+		ip += lit;
+		op += lit;
+		if(ip == srcSize){ // the last sequence has no match
+			break;
+		}
+		if(srcSize - ip < 2){
+			return false;
+		}
+		size_t offset = src[ip] | ((size_t)src[ip + 1] << 8);
+		ip += 2;
+		size_t len = token & 15;
+		if((len == 15) && !ReadLength(src, srcSize, ip, len)){
+			return false;
+		}
+		len += MIN_MATCH;
+		if((offset == 0) || (offset > op) || (len > dstCap - op)){
+			return false;
+		}
+		if(offset >= len){
+			memcpy(dst + op, dst + op - offset, len);
+			op += len;
+		} else { // overlapping copy, repeats the last offset bytes
+			for(size_t i = 0; i < len; i++, op++){
+				dst[op] = dst[op - offset];
+			}
+		}
+	}
+	written = op;
+	return true;
+}
+
+}
+
+void L1Compression::Compress(const uint8_t* data, size_t size, size_t window, vector<uint8_t>& frame) {
+	frame.clear();
+	frame.reserve(Parameters::HEADER + size + size / 64 + Parameters::END_MARK + 2 * window);
+	frame.resize(Parameters::HEADER);
+	uint64_t contentSize = size;
+	Write32(frame.data(), Parameters::MAGIC);
+	frame[4] = FLG;
+	frame[5] = BD;
+	memcpy(frame.data() + 6, &contentSize, 8);
+	frame[14] = (uint8_t)(Xxh32(frame.data() + 4, 10, 0) >> 8);
+	size_t in = 0;
+	while(in < size){
+		size_t room = window - (frame.size() % window); // up to the end of the current window
+		if(room < Parameters::BLOCK_HEADER + Parameters::BLOCK_MIN){
+			room += window;
+		}
+		size_t cap = room - Parameters::BLOCK_HEADER;
+		size_t n = (size - in < Parameters::BLOCK_MAX) ? (size - in) : (size_t)Parameters::BLOCK_MAX;
+		size_t pos = frame.size();
+		size_t consumed = 0;
+		frame.resize(pos + Parameters::BLOCK_HEADER + cap);
+		size_t written = CompressBlock(data + in, n, frame.data() + pos + Parameters::BLOCK_HEADER, cap, consumed);
+		uint32_t blockSize = (uint32_t)written;
+		if(consumed <= written){ // no gain, store the block as it is
+			consumed = (n < cap) ? n : cap;
+			written = consumed;
+			memcpy(frame.data() + pos + Parameters::BLOCK_HEADER, data + in, consumed);
+			blockSize = (uint32_t)written | 0x80000000U;
+		}
+		Write32(frame.data() + pos, blockSize);
+		frame.resize(pos + Parameters::BLOCK_HEADER + written);
+		in += consumed;
+	}
+	frame.resize(frame.size() + Parameters::END_MARK);
+	Write32(frame.data() + frame.size() - Parameters::END_MARK, 0);
+}
+
+bool L1Compression::Decompress(const uint8_t* frame, size_t size, shared_ptr<uint8_t[]>& data, size_t& dataSize) {
+	uint64_t contentSize = 0;
+	if((size < Parameters::HEADER + Parameters::END_MARK) || (Read32(frame) != Parameters::MAGIC) ||
+	   (frame[4] != FLG) || (frame[5] != BD) || (frame[14] != (uint8_t)(Xxh32(frame + 4, 10, 0) >> 8))){
+		return false;
+	}
+	memcpy(&contentSize, frame + 6, 8);
+	if(contentSize > (uint64_t)size * 255){ // more than LZ4 can achieve
+		return false;
+	}
+	shared_ptr<uint8_t[]> out(new uint8_t[(contentSize > 0) ? contentSize : 1]);
+	size_t ip = Parameters::HEADER, op = 0;
+	for(;;){
+		if(size - ip < Parameters::BLOCK_HEADER){
+			return false;
+		}
+		uint32_t blockSize = Read32(frame + ip);
+		ip += Parameters::BLOCK_HEADER;
+		if(blockSize == 0){ // end mark
+			break;
+		}
+		bool stored = (blockSize & 0x80000000U) != 0;
+		blockSize &= 0x7FFFFFFFU;
+		if(blockSize > size - ip){
+			return false;
+		}
+		size_t written = 0;
+		size_t avail = contentSize - op;
+		if(avail > Parameters::BLOCK_MAX){
+			avail = Parameters::BLOCK_MAX;
+		}
+		if(stored){
+			if(blockSize > avail){
+				return false;
+			}
+			memcpy(out.get() + op, frame + ip, blockSize);
+			written = blockSize;
+		} else if(!DecompressBlock(frame + ip, blockSize, out.get() + op, avail, written)){
+			return false;
+		}
+		ip += blockSize;
+		op += written;
+	}
+	if(op != contentSize){
+		return false;
+	}
+	data.swap(out);
+	dataSize = op;
+	return true;
+}
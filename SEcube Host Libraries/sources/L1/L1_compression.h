@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * File Name          : L1_compression.h
+  * Description        : LZ4 compression of the data encrypted by L1Encrypt().
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  L1_compression.h
+ *  \brief This header file defines the LZ4 frame compressor and decompressor used by L1Encrypt() and L1Decrypt() (see L1SetCompression()).
+ *  \version SEcube Open Source SDK 1.5.1
+ */
+
+#ifndef L1_COMPRESSION_H_
+#define L1_COMPRESSION_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/** LZ4 frames (https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md) made of independent blocks of at most
+ *  64 KB, with the content size in the header and without checksums (the integrity is up to the cipher). */
+namespace L1Compression {
+	struct Parameters {
+		enum {
+			MAGIC = 0x184D2204, /**< LZ4 frame magic number. */
+			HEADER = 15, /**< Magic number, FLG, BD, content size and header checksum. */
+			BLOCK_HEADER = 4, /**< Size of each block, the highest bit is set if the block is stored uncompressed. */
+			BLOCK_MAX = 64 * 1024, /**< Maximum uncompressed size of a block. */
+			BLOCK_MIN = 64, /**< A block that would be smaller than this is moved to the next window. */
+			END_MARK = 4
+		};
+	};
+
+	/** @brief Compress data into an LZ4 frame.
+	 * @param [in] data The data to be compressed.
+	 * @param [in] size The size of data.
+	 * @param [in] window Each block is cut so that, if the data compresses, it ends exactly at a multiple of window bytes
+	 * from the start of the frame. With window equal to the chunk of L1Encrypt(), each request to the SEcube carries a full
+	 * chunk of compressed data.
+	 * @param [out] frame The LZ4 frame. */
+	void Compress(const uint8_t* data, size_t size, size_t window, std::vector<uint8_t>& frame);
+	/** @brief Decompress an LZ4 frame produced by Compress().
+	 * @param [in] frame The LZ4 frame.
+	 * @param [in] size The size of the frame.
+	 * @param [out] data The decompressed data.
+	 * @param [out] dataSize The size of the decompressed data.
+	 * @return False if the frame is not valid or not supported (dependent blocks, checksums, dictionary). */
+	bool Decompress(const uint8_t* frame, size_t size, std::shared_ptr<uint8_t[]>& data, size_t& dataSize);
+}
+
+#endif
@@ -0,0 +1,340 @@
+/**
+  ******************************************************************************
+  * File Name          : L1_crypto_session.cpp
+  * Description        : Host-side reuse of SEcube crypto sessions.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/**
+ * @file	L1_crypto_session.cpp
+ * @date	October, 2026
+ * @brief	Cache of device crypto sessions shared by L1Encrypt() and L1Decrypt().
+ * @version SEcube Open Source SDK 1.5.1
+ *
+ * Opening a crypto session on the SEcube costs a round trip and a device side allocation. Sessions of algorithms
+ * whose state can be fully reset by the host (AES) are therefore not finalized at the end of an operation but kept
+ * in a small per-device LRU list, keyed by key ID, algorithm and mode. The least recently used session is closed
+ * with FINIT when the list is full. Sessions using a key are closed when the key is edited, the whole list is
+ * dropped on login and logout because the SEcube releases every session on its own.
+ *
+ * The SEcube also releases sessions left idle for longer than its timeout (a lease), so that sessions abandoned by
+ * a crashed or careless host do not exhaust the session memory. Cached sessions are closed by the host when idle
+ * for half the timeout, L1CryptoSessionsRenew() extends the lease of every open session.
+ */
+
+#include "L1.h"
+
+using namespace std;
+
+bool L1CryptoSessionCache::Take(uint32_t keyId, uint16_t algorithm, uint16_t mode, uint32_t& sessId){
+	for(list<se3CryptoSessionEntry>::iterator it = this->idle.begin(); it != this->idle.end(); it++){
+		if((it->keyId == keyId) && (it->algorithm == algorithm) && (it->mode == mode)){
+			sessId = it->sessId;
+			this->idle.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
+void L1CryptoSessionCache::Put(const se3CryptoSessionEntry& entry){
+	this->idle.push_front(entry);
+}
+
+bool L1CryptoSessionCache::Evict(size_t maxSize, se3CryptoSessionEntry& evicted){
+	if(this->idle.size() <= maxSize){
+		return false;
+	}
+	evicted = this->idle.back();
+	this->idle.pop_back();
+	return true;
+}
+
+void L1CryptoSessionCache::Remove(uint32_t keyId, list<se3CryptoSessionEntry>& removed){
+	list<se3CryptoSessionEntry>::iterator it = this->idle.begin();
+	while(it != this->idle.end()){
+		if(it->keyId == keyId){
+			removed.push_back(*it);
+			it = this->idle.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+void L1CryptoSessionCache::RemoveAll(list<se3CryptoSessionEntry>& removed){
+	removed.splice(removed.end(), this->idle);
+}
+
+void L1CryptoSessionCache::Expire(uint64_t now, list<se3CryptoSessionEntry>& removed){
+	if(this->timeout == 0){
+		return;
+	}
+	list<se3CryptoSessionEntry>::iterator it = this->idle.begin();
+	while(it != this->idle.end()){
+		if(now - it->lastUse >= this->timeout / 2){
+			removed.push_back(*it);
+			it = this->idle.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+void L1CryptoSessionCache::Touch(uint64_t now){
+	for(se3CryptoSessionEntry& e : this->idle){
+		e.lastUse = now;
+	}
+}
+
+void L1CryptoSessionCache::SetTimeout(uint32_t timeout){
+	this->timeout = timeout;
+}
+
+void L1CryptoSessionCache::Clear(){
+	this->idle.clear();
+}
+
+void L1CryptoSessionCache::Reset(){
+	this->Clear();
+	this->timeout = L1CryptoSession::Parameters::DEVICE_TIMEOUT;
+}
+
+size_t L1CryptoSessionCache::Size() const {
+	return this->idle.size();
+}
+
+CryptoSession::CryptoSession(L1* owner, const se3CryptoSessionEntry& entry, bool reused, bool reusable){
+	this->owner = owner;
+	this->entry = entry;
+	this->reused = reused;
+	this->reusable = reusable;
+	this->done = false;
+	this->finalized = false;
+}
+
+CryptoSession::CryptoSession(CryptoSession&& other) noexcept {
+	this->owner = other.owner;
+	this->entry = other.entry;
+	this->reused = other.reused;
+	this->reusable = other.reusable;
+	this->done = other.done;
+	this->finalized = other.finalized;
+	other.owner = nullptr;
+}
+
+CryptoSession::~CryptoSession(){
+	if(this->owner == nullptr){
+		return;
+	}
+	if(!this->done){ // operation aborted, the state of the session is unknown
+		this->owner->CryptoSessionClose(this->entry.sessId);
+	} else if(!this->finalized){
+		if(this->reusable){
+			this->owner->CryptoSessionRelease(this->entry);
+		} else {
+			this->owner->CryptoSessionClose(this->entry.sessId);
+		}
+	}
+}
+
+void CryptoSession::Done(bool finalized){
+	this->done = true;
+	this->finalized = finalized;
+}
+
+L1CryptoSessionCache& L1::CurrentCryptoSessionCache(){
+	uint8_t i = this->base.GetSessionIndex();
+	if(i >= this->sessionCache.size()){
+		this->sessionCache.resize(i + 1);
+	}
+	return this->sessionCache[i];
+}
+
+CryptoSession L1::CryptoSessionAcquire(uint16_t algorithm, uint16_t mode, uint32_t keyId){
+	se3CryptoSessionEntry entry;
+	entry.keyId = keyId;
+	entry.algorithm = algorithm;
+	entry.mode = mode;
+	entry.sessId = 0;
+	entry.lastUse = 0;
+	// AES sessions can be brought back to their initial state by the host (see L1Encrypt), AES-GCM and ChaCha20-Poly1305 ones restart with every message
+	bool reusable = (this->sessionCacheSize > 0) &&
+			((algorithm == L1Algorithms::Algorithms::AES) || (algorithm == L1Algorithms::Algorithms::AES_GCM) ||
+			 (algorithm == L1Algorithms::Algorithms::CHACHA20_POLY1305));
+	if(reusable){
+		list<se3CryptoSessionEntry> expired;
+		this->CurrentCryptoSessionCache().Expire(L0Support::Se3Clock(), expired);
+		for(se3CryptoSessionEntry& e : expired){
+			this->CryptoSessionClose(e.sessId);
+		}
+	}
+	if(reusable && this->CurrentCryptoSessionCache().Take(keyId, algorithm, mode, entry.sessId)){
+		return CryptoSession(this, entry, true, true);
+	}
+	L1CryptoInit(algorithm, mode, keyId, entry.sessId);
+	return CryptoSession(this, entry, false, reusable);
+}
+
+void L1::CryptoSessionRelease(const se3CryptoSessionEntry& entry){
+	se3CryptoSessionEntry evicted;
+	se3CryptoSessionEntry released = entry;
+	L1CryptoSessionCache& cache = this->CurrentCryptoSessionCache();
+	released.lastUse = L0Support::Se3Clock();
+	cache.Put(released);
+	while(cache.Evict(this->sessionCacheSize, evicted)){
+		this->CryptoSessionClose(evicted.sessId);
+	}
+}
+
+void L1::CryptoSessionClose(uint32_t sessId){
+	/* FINIT releases the session on the SEcube. SET_IV is there only because L1CryptoUpdate() refuses empty requests,
+	 * every algorithm that can be cached accepts a 16 byte IV. Errors are ignored: this is called by destructors and
+	 * the session is released anyway at logout. */
+	uint8_t iv[B5_AES_BLK_SIZE];
+	memset(iv, 0, B5_AES_BLK_SIZE);
+	try {
+		L1CryptoUpdate(sessId, L1Crypto::UpdateFlags::FINIT | L1Crypto::UpdateFlags::SET_IV, B5_AES_BLK_SIZE, iv, 0, nullptr, nullptr, nullptr);
+	}
+	catch(...) {
+	}
+}
+
+void L1::CryptoSessionInvalidate(uint32_t keyId){
+	list<se3CryptoSessionEntry> removed;
+	this->CurrentCryptoSessionCache().Remove(keyId, removed);
+	for(se3CryptoSessionEntry& e : removed){
+		this->CryptoSessionClose(e.sessId);
+	}
+}
+
+void L1::CryptoSessionInvalidateAll(){
+	list<se3CryptoSessionEntry> removed;
+	this->CurrentCryptoSessionCache().RemoveAll(removed);
+	for(se3CryptoSessionEntry& e : removed){
+		this->CryptoSessionClose(e.sessId);
+	}
+}
+
+void L1::CryptoSessionForget(){
+	this->CurrentCryptoSessionCache().Reset();
+}
+
+void L1::L1SetCryptoSessionCacheSize(size_t size){
+	se3CryptoSessionEntry evicted;
+	this->sessionCacheSize = size;
+	if(!this->base.GetSessionLoggedIn()){
+		return;
+	}
+	L1CryptoSessionCache& cache = this->CurrentCryptoSessionCache();
+	while(cache.Evict(this->sessionCacheSize, evicted)){
+		this->CryptoSessionClose(evicted.sessId);
+	}
+}
+
+void L1::L1CryptoSessionsList(se3CryptoSessionsStatus& status){
+	L1CryptoSessionsException sessionsExc;
+	uint16_t op = L1Crypto::SessionsOperation::LIST;
+	uint16_t respLen = 0;
+	uint16_t count = 0;
+	size_t offset = L1Crypto::SessionsResponseOffset::LIST_INFO;
+	status.sessions.clear();
+	this->base.FillSessionBuffer((uint8_t*)&op, L1Request::Offset::DATA + L1Crypto::SessionsRequestOffset::OP, 2);
+	try {
+		TXRXData(L1Commands::Codes::CRYPTO_SESSIONS, L1Crypto::SessionsRequestSize::LIST, 0, &respLen);
+	}
+	catch(L1Exception& e) {
+		throw sessionsExc;
+	}
+	if(respLen < L1Crypto::SessionsResponseOffset::LIST_INFO){
+		throw sessionsExc;
+	}
+	this->base.ReadSessionBuffer((uint8_t*)&(status.timeout), L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_TIMEOUT, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&count, L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_COUNT, 2);
+	this->base.ReadSessionBuffer((uint8_t*)&(status.reclaimed), L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_RECLAIMED, 2);
+	this->base.ReadSessionBuffer((uint8_t*)&(status.bytesUsed), L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_BYTES_USED, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(status.bytesInternal), L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_BYTES_INTERNAL, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(status.bytesExternal), L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_BYTES_EXTERNAL, 4);
+	this->base.ReadSessionBuffer((uint8_t*)&(status.peak), L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_PEAK, 2);
+	this->base.ReadSessionBuffer((uint8_t*)&(status.failures), L1Response::Offset::DATA + L1Crypto::SessionsResponseOffset::LIST_FAILURES, 2);
+	if(respLen < offset + (size_t)count * L1Crypto::SessionInfoSize::SIZE){
+		throw sessionsExc;
+	}
+	for(uint16_t i = 0; i < count; i++){
+		se3CryptoSessionInfo info;
+		this->base.ReadSessionBuffer((uint8_t*)&(info.sessId), L1Response::Offset::DATA + offset + L1Crypto::SessionInfoOffset::SID, 4);
+		this->base.ReadSessionBuffer((uint8_t*)&(info.algorithm), L1Response::Offset::DATA + offset + L1Crypto::SessionInfoOffset::ALGO, 2);
+		this->base.ReadSessionBuffer((uint8_t*)&(info.idle), L1Response::Offset::DATA + offset + L1Crypto::SessionInfoOffset::IDLE, 4);
+		offset += L1Crypto::SessionInfoSize::SIZE;
+		status.sessions.push_back(info);
+	}
+}
+
+void L1::L1CryptoSessionsRelease(){
+	L1CryptoSessionsException sessionsExc;
+	uint16_t op = L1Crypto::SessionsOperation::RELEASE;
+	uint16_t count = 0; // all sessions
+	uint16_t respLen = 0;
+	// the cached sessions are released on the SEcube as well, the timeout does not change
+	this->CurrentCryptoSessionCache().Clear();
+	this->base.FillSessionBuffer((uint8_t*)&op, L1Request::Offset::DATA + L1Crypto::SessionsRequestOffset::OP, 2);
+	this->base.FillSessionBuffer((uint8_t*)&count, L1Request::Offset::DATA + L1Crypto::SessionsRequestOffset::COUNT, 2);
+	try {
+		TXRXData(L1Commands::Codes::CRYPTO_SESSIONS, L1Crypto::SessionsRequestOffset::SIDS, 0, &respLen);
+	}
+	catch(L1Exception& e) {
+		throw sessionsExc;
+	}
+}
+
+void L1::L1CryptoSessionsRenew(){
+	L1CryptoSessionsException sessionsExc;
+	uint16_t op = L1Crypto::SessionsOperation::RENEW;
+	uint16_t count = 0; // all sessions
+	uint16_t respLen = 0;
+	this->base.FillSessionBuffer((uint8_t*)&op, L1Request::Offset::DATA + L1Crypto::SessionsRequestOffset::OP, 2);
+	this->base.FillSessionBuffer((uint8_t*)&count, L1Request::Offset::DATA + L1Crypto::SessionsRequestOffset::COUNT, 2);
+	try {
+		TXRXData(L1Commands::Codes::CRYPTO_SESSIONS, L1Crypto::SessionsRequestOffset::SIDS, 0, &respLen);
+	}
+	catch(L1Exception& e) {
+		throw sessionsExc;
+	}
+	this->CurrentCryptoSessionCache().Touch(L0Support::Se3Clock());
+}
+
+void L1::L1SetCryptoSessionTimeout(uint32_t timeout){
+	L1CryptoSessionsException sessionsExc;
+	uint16_t op = L1Crypto::SessionsOperation::SET_TIMEOUT;
+	uint16_t respLen = 0;
+	this->base.FillSessionBuffer(L1Request::Offset::DATA, L1Crypto::SessionsRequestSize::SET_TIMEOUT);
+	this->base.FillSessionBuffer((uint8_t*)&op, L1Request::Offset::DATA + L1Crypto::SessionsRequestOffset::OP, 2);
+	this->base.FillSessionBuffer((uint8_t*)&timeout, L1Request::Offset::DATA + L1Crypto::SessionsRequestOffset::TIMEOUT, 4);
+	try {
+		TXRXData(L1Commands::Codes::CRYPTO_SESSIONS, L1Crypto::SessionsRequestSize::SET_TIMEOUT, 0, &respLen);
+	}
+	catch(L1Exception& e) {
+		throw sessionsExc;
+	}
+	// the SEcube restarts every lease with the new timeout
+	L1CryptoSessionCache& cache = this->CurrentCryptoSessionCache();
+	cache.SetTimeout(timeout);
+	cache.Touch(L0Support::Se3Clock());
+}
@@ -0,0 +1,122 @@
+/**
+  ******************************************************************************
+  * File Name          : L1_crypto_session.h
+  * Description        : Host-side reuse of SEcube crypto sessions.
+  ******************************************************************************
+  *
+  * Copyright � 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/*! \file  L1_crypto_session.h
+ *  \brief This header file defines the cache of device crypto sessions used by L1Encrypt() and L1Decrypt(), and the RAII handle to those sessions.
+ *  \version SEcube Open Source SDK 1.5.1
+ */
+
+#ifndef L1_CRYPTO_SESSION_H_
+#define L1_CRYPTO_SESSION_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+
+class L1;
+
+/** Parameters of the session cache. */
+namespace L1CryptoSession {
+	struct Parameters {
+		enum {
+			CACHE_SIZE = 8, /**< Default number of idle device sessions kept open for each SEcube. */
+			INIT_IV_FILL = 0x55, /**< Value of each byte of the IV set by the SEcube when an AES session is initialized. */
+			DEVICE_TIMEOUT = 10 * 60 * 1000 /**< Idle time (ms) after which the SEcube releases a session, as set by the SEcube at login. */
+		};
+	};
+}
+
+/** An idle device crypto session kept open by the host, ready to be reused for the same key, algorithm and mode. */
+typedef struct se3CryptoSessionEntry_ {
+	uint32_t keyId;
+	uint16_t algorithm;
+	uint16_t mode; /**< Algorithm mode, including the direction (i.e. CryptoInitialisation::Modes::CBC | CryptoInitialisation::Direction::ENCRYPT). */
+	uint32_t sessId; /**< Session identifier on the SEcube. */
+	uint64_t lastUse; /**< Host clock (ms, see L0Support::Se3Clock()) when the session was last used. */
+} se3CryptoSessionEntry;
+
+/** Bounded LRU list of the idle device sessions of a single SEcube. The most recently used session is at the front. */
+class L1CryptoSessionCache {
+private:
+	std::list<se3CryptoSessionEntry> idle;
+	uint32_t timeout = L1CryptoSession::Parameters::DEVICE_TIMEOUT; /**< Idle timeout of the SEcube (ms), 0 if sessions never expire. */
+public:
+	/** @brief Take an idle session matching key, algorithm and mode out of the cache.
+	 * @return True if a session was found (its identifier is stored in sessId), false otherwise. */
+	bool Take(uint32_t keyId, uint16_t algorithm, uint16_t mode, uint32_t& sessId);
+	/** @brief Put a session back into the cache as the most recently used one. */
+	void Put(const se3CryptoSessionEntry& entry);
+	/** @brief Remove the least recently used session if the cache holds more than maxSize sessions.
+	 * @return True if a session was removed (it is returned in evicted and must be closed by the caller), false otherwise. */
+	bool Evict(size_t maxSize, se3CryptoSessionEntry& evicted);
+	/** @brief Remove every session that uses the specified key. The removed sessions are appended to removed. */
+	void Remove(uint32_t keyId, std::list<se3CryptoSessionEntry>& removed);
+	/** @brief Remove every session. The removed sessions are appended to removed. */
+	void RemoveAll(std::list<se3CryptoSessionEntry>& removed);
+	/** @brief Remove every session idle for at least half of the device timeout. The removed sessions are appended to removed.
+	 * @detail The SEcube reclaims a session once its lease expires and may then hand out the same identifier to a new session,
+	 * so a cached session must be dropped while it is still certainly alive. */
+	void Expire(uint64_t now, std::list<se3CryptoSessionEntry>& removed);
+	/** @brief Mark every session as used at time now (their leases have been renewed on the SEcube). */
+	void Touch(uint64_t now);
+	void SetTimeout(uint32_t timeout);
+	/** @brief Forget every session without closing them (used when the SEcube has released them, i.e. after a bulk release).
+	 * The device timeout is kept, the SEcube does not change it. */
+	void Clear();
+	/** @brief Same as Clear(), and the device timeout goes back to its default value (used on login and logout, the SEcube
+	 * resets its timeout as well). */
+	void Reset();
+	size_t Size() const;
+};
+
+/** RAII handle to a device crypto session. The handle is returned by L1 when a crypto operation starts.
+ *  When the operation completes successfully, Done() must be called: the session then goes back to the session
+ *  cache of the L1 object on destruction. If the handle is destroyed without calling Done() (i.e. an exception
+ *  was thrown in the middle of the operation), the session is closed on the SEcube with a FINIT. */
+class CryptoSession {
+	friend class L1;
+private:
+	L1* owner;
+	se3CryptoSessionEntry entry;
+	bool reused; /**< True if the session was taken from the cache instead of being initialized. */
+	bool reusable; /**< True if the session may go back to the cache at the end of the operation (it must not be finalized). */
+	bool done;
+	bool finalized;
+	CryptoSession(L1* owner, const se3CryptoSessionEntry& entry, bool reused, bool reusable);
+public:
+	CryptoSession(const CryptoSession&) = delete;
+	CryptoSession& operator=(const CryptoSession&) = delete;
+	CryptoSession(CryptoSession&& other) noexcept;
+	~CryptoSession();
+	/** @brief The identifier of the session on the SEcube (to be used with L1CryptoUpdate()). */
+	uint32_t Id() const { return this->entry.sessId; }
+	/** @brief True if the session was already used by a previous operation, therefore its state is not the one produced by L1CryptoInit(). */
+	bool Reused() const { return this->reused; }
+	/** @brief True if the last L1CryptoUpdate() of the operation must not carry the FINIT flag, so that the session can be reused. */
+	bool Reusable() const { return this->reusable; }
+	/** @brief Mark the operation as successfully completed. If the session was finalized with FINIT, pass false. */
+	void Done(bool finalized);
+};
+
+#endif
@@ -170,6 +170,7 @@ namespace L1Crypto {
 			SE3_CRYPTO_TYPE_STREAMCIPHER = 1, /**< Stream cipher. */
 			SE3_CRYPTO_TYPE_DIGEST = 2, /**< Digest algorithm (i.e. SHA-256, HMAC-SHA-256). */
 			SE3_CRYPTO_TYPE_BLOCKCIPHER_AUTH = 3, /**< Block cipher algorithm, granting also integrity and authentication (i.e. AES-256-HMAC-SHA-256). */
+			SE3_CRYPTO_TYPE_STREAMCIPHER_AUTH = 4, /**< Stream cipher algorithm, granting also integrity and authentication (i.e. ChaCha20-Poly1305). */
 			SE3_CRYPTO_TYPE_OTHER = 0xFFFF /**< Anything else not listed above. */
 		};
 	};
@@ -291,13 +292,103 @@ namespace L1Crypto {
 		};
 	};
 
+	/** IV and tag sizes of L1Algorithms::Algorithms::AES_GCM. */
+	struct GcmSize {
+		enum {
+			//B5_GCM_AES_IV_SIZE = 12,
+			IV = 12,
+			//B5_GCM_AES_TAG_SIZE = 16
+			TAG = 16
+		};
+	};
+
+	/** Nonce and tag sizes of L1Algorithms::Algorithms::CHACHA20_POLY1305. */
+	struct ChaCha20Poly1305Size {
+		enum {
+			//B5_CHACHA20_NONCE_SIZE = 12,
+			NONCE = 12,
+			//B5_POLY1305_TAG_SIZE = 16
+			TAG = 16
+		};
+	};
+
+	/** Nonce and tag sizes of L1Algorithms::Algorithms::AES_EAX. */
+	struct EaxSize {
+		enum {
+			//B5_EAX_AES_NONCE_SIZE = 12,
+			NONCE = 12,
+			//B5_EAX_AES_TAG_SIZE = 16
+			TAG = 16
+		};
+	};
+
+	/** Sub-operations of L1Commands::Codes::CRYPTO_SESSIONS. */
+	struct SessionsOperation {
+		enum {
+			//SE3_CRYPTO_SESSIONS_OP_LIST = 1
+			LIST = 1, /**< List the open sessions with their idle time and the usage of the session memory. */
+			//SE3_CRYPTO_SESSIONS_OP_RELEASE = 2
+			RELEASE = 2, /**< Release the given sessions, or every session if no session is given. */
+			//SE3_CRYPTO_SESSIONS_OP_RENEW = 3
+			RENEW = 3, /**< Renew the lease of the given sessions, or of every session if no session is given. */
+			//SE3_CRYPTO_SESSIONS_OP_SET_TIMEOUT = 4
+			SET_TIMEOUT = 4 /**< Set the idle time (ms) after which the SEcube releases a session on its own. 0 disables it. */
+		};
+	};
+
+	struct SessionsRequestOffset {
+		enum {
+			OP = 0,
+			COUNT = 2,
+			SIDS = 4,
+			TIMEOUT = 4
+		};
+	};
+
+	struct SessionsRequestSize {
+		enum {
+			LIST = 2,
+			SET_TIMEOUT = 8
+		};
+	};
+
+	struct SessionsResponseOffset {
+		enum {
+			COUNT = 0, /**< RELEASE and RENEW: number of sessions affected. */
+			LIST_TIMEOUT = 0,
+			LIST_COUNT = 4,
+			LIST_RECLAIMED = 6,
+			LIST_BYTES_USED = 8,
+			LIST_BYTES_INTERNAL = 12,
+			LIST_BYTES_EXTERNAL = 16,
+			LIST_PEAK = 20,
+			LIST_FAILURES = 22,
+			LIST_INFO = 24
+		};
+	};
+
+	struct SessionInfoOffset {
+		enum {
+			SID = 0,
+			ALGO = 4,
+			IDLE = 8
+		};
+	};
+
+	struct SessionInfoSize {
+		enum {
+			SIZE = 12
+		};
+	};
+
 	struct UpdateFlags {
 		enum {
 			FINIT = 1 << 15, 	/**< This flag is used to finalize the crypto operation. It must be used, for example, when working on the last block of data. */
 			RESET = 1 << 14, 	/**< Same as SET_IV. */
 			SET_IV = RESET, 	/**< This flag is used to set the initialization vector for the given algorithm and mode. */
 			SETNONCE = 1 << 13, /**< This flag is used to setup the nonce that must be used for a given crypto operation. */
-			AUTH = 1 << 12 		/**< This flag enables the digest computation for AES-HMAC-SHA256. */
+			AUTH = 1 << 12, 	/**< This flag enables the digest computation for AES-HMAC-SHA256. */
+			KEYSTREAM = 1 << 11 /**< AES-CTR only: data2Len bytes of raw keystream are returned, data2 is not sent. */
 		};
 	};
 }
@@ -341,6 +432,13 @@ namespace L1Key {
 		};
 	};
 
+	struct Policy {
+		enum : uint16_t {
+			NONE = 0, /**< No restrictions on the use of the key. */
+			NO_KEYSTREAM = 1 << 0 /**< The SEcube never returns the raw AES-CTR keystream of this key (see L1Crypto::UpdateFlags::KEYSTREAM). */
+		};
+	};
+
 	struct Size {
 		enum {
 			//SE3_KEY_DATA_MAX = 2048,
@@ -420,7 +518,9 @@ namespace L1Commands {
 			CRYPTO_UPDATE = 9,
 			CRYPTO_LIST = 10,
 			FORCED_LOGOUT=11,
-			SEKEY = 12
+			SEKEY = 12,
+			CRYPTO_SESSIONS = 13,
+			PERF = 14
 		};
 	};
 
@@ -488,7 +588,13 @@ namespace L1Algorithms {
 			SHA256 = 1,  		/**< SHA-256 digest  */
 			HMACSHA256 = 2,  	/**< HMAC-SHA-256 digest */
 			AES_HMACSHA256 = 3, /**< AES + HMAC + SHA-256 */
-			ALGORITHM_MAX = 4	/**< Value required by SEfile */
+			AES_GCM = 4,		/**< AES-GCM authenticated encryption */
+			CHACHA20_POLY1305 = 5,	/**< ChaCha20-Poly1305 authenticated encryption (256-bit keys only) */
+			BLAKE2S = 6,		/**< BLAKE2s-256 digest */
+			BLAKE2S_KEYED = 7,	/**< BLAKE2s-256 digest keyed with a key stored on the SEcube */
+			AES_CMAC = 8,		/**< AES-CMAC digest, 16 bytes */
+			AES_EAX = 9,		/**< AES-CTR encryption and AES-CMAC authentication with one key (EAX) */
+			ALGORITHM_MAX = 10	/**< Value required by SEfile */
 		};
 	};
 }
@@ -559,9 +665,10 @@ namespace CryptoInitialisation {
 			ECB = 1, /**< Not very strong. Don't use it, if possible. */
 			CBC = 2, /**< If you were thinking about using ECB, CBC is a far better choice. */
 			OFB = 3, /**< Turns AES into a stream cipher. Similar to CFB. */
-			CTR = 4, /**< Turns AES into a stream cipher. By far the most used. */
+			CTR = 4, /**< Turns AES into a stream cipher. By far the most used. The only mode of L1Algorithms::Algorithms::AES_EAX. */
 			CFB = 5,	 /**< Turns AES into a stream cipher. Similar to OFB. */
-			INVALID_AES_MODE = 6 /**< Just a value to identify an invalid mode. */
+			GCM = 6, /**< Only for L1Algorithms::Algorithms::AES_GCM. CTR encryption and GHASH authentication in a single pass. */
+			INVALID_AES_MODE = 7 /**< Just a value to identify an invalid mode. */
 		};
 	};
 }
@@ -576,4 +683,136 @@ namespace L1SEkey {
 	};
 }
 
+/** @brief Constants of the performance counters of the SEcube (L1Commands::Codes::PERF). */
+namespace L1Perf {
+	/** Operations, GET and RESET can be combined to read and reset the counters at once. TRACE must be alone. */
+	struct Operation {
+		enum {
+			//SE3_PERF_OP_GET = 1 << 0
+			GET = 1 << 0,
+			//SE3_PERF_OP_RESET = 1 << 1
+			RESET = 1 << 1,
+			//SE3_PERF_OP_TRACE = 1 << 2
+			TRACE = 1 << 2
+		};
+	};
+
+	struct Parameters {
+		enum {
+			VERSION = 2, /**< Version of the counter block understood by the host. */
+			TRACE_VERSION = 1 /**< Version of the trace block understood by the host. */
+		};
+	};
+
+	struct RequestOffset {
+		enum {
+			OP = 0
+		};
+	};
+
+	struct RequestSize {
+		enum {
+			SIZE = 2
+		};
+	};
+
+	struct ResponseOffset {
+		enum {
+			VERSION = 0,
+			N_CMD0 = 2,
+			N_CMD1 = 4,
+			N_ALGO = 6,
+			CLOCK_HZ = 8,
+			ELAPSED = 12,
+			BUSY_POLLS = 16,
+			HELD_READS = 20,
+			BYTES_IN = 24,
+			BYTES_OUT = 32,
+			FLASH_PROGRAM = 40,
+			FLASH_PROGRAM_BYTES = 44,
+			FLASH_ERASE = 48,
+			FLASH_SWAP = 52,
+			MEM_REFILLS = 56,
+			MEM_FAILURES = 60,
+			ENTRIES = 64
+		};
+	};
+
+	struct EntryOffset {
+		enum {
+			COUNT = 0,
+			BYTES = 4,
+			CYCLES = 8
+		};
+	};
+
+	struct EntrySize {
+		enum {
+			SIZE = 16
+		};
+	};
+
+	/** Entries of the protocol blocks, after the ones of the algorithms since version 2. */
+	struct Proto {
+		enum {
+			//SE3_PERF_PROTO_RECV = 0
+			RECV = 0, /**< Blocks of requests written by the host. */
+			//SE3_PERF_PROTO_SEND = 1
+			SEND = 1, /**< Blocks of responses read by the host. */
+			//SE3_PERF_PROTO_MAX = 2
+			MAX = 2
+		};
+	};
+
+	/** Trace block returned by Operation::TRACE. */
+	struct TraceOffset {
+		enum {
+			VERSION = 0,
+			ENTRY_SIZE = 2,
+			COUNT = 4,
+			PENDING = 6,
+			CLOCK_HZ = 8,
+			LOST = 12,
+			NOW = 16,
+			ENTRIES = 20
+		};
+	};
+
+	struct TraceEntryOffset {
+		enum {
+			TS = 0,
+			ID = 4,
+			A = 6,
+			B = 8
+		};
+	};
+
+	struct TraceEntrySize {
+		enum {
+			SIZE = 12
+		};
+	};
+
+	/** Trace event ids, each _END follows its _BEGIN. */
+	struct Event {
+		enum {
+			CMD0_BEGIN = 1, /**< a: L0 command, b: request length */
+			CMD0_END = 2, /**< a: L0 command, b: response blocks */
+			CMD1_BEGIN = 3, /**< a: L1 command, b: request length */
+			CMD1_END = 4, /**< a: L1 command, b: status */
+			CRYPTO_INIT_BEGIN = 5, /**< a: algorithm, b: mode */
+			CRYPTO_INIT_END = 6, /**< a: algorithm, b: status */
+			CRYPTO_UPDATE_BEGIN = 7, /**< a: algorithm, b: input bytes */
+			CRYPTO_UPDATE_END = 8, /**< a: algorithm, b: status */
+			FLASH_SWAP_BEGIN = 9, /**< a: sector, b: bytes used */
+			FLASH_SWAP_END = 10, /**< a: success, b: bytes used */
+			SDIO_READ_BEGIN = 11, /**< a: blocks, b: first block */
+			SDIO_READ_END = 12, /**< a: success, b: first block */
+			SDIO_WRITE_BEGIN = 13, /**< a: blocks, b: first block */
+			SDIO_WRITE_END = 14, /**< a: success, b: first block */
+			SDIO_WRITE_DONE = 15 /**< Completion of a queued write, a: success */
+		};
+	};
+}
+
 #endif
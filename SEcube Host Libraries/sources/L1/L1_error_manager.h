@@ -186,4 +186,18 @@ public:
 	}
 };
 
+class L1CryptoSessionsException : public L1Exception {
+public:
+	virtual const char* what() const throw() override {
+		return "Error while managing the crypto sessions!";
+	}
+};
+
+class L1PerfException : public L1Exception {
+public:
+	virtual const char* what() const throw() override {
+		return "Error while reading the performance counters!";
+	}
+};
+
 #endif
@@ -32,6 +32,7 @@
 
 #include "L1.h"
 #include "L1_error_manager.h"
+#include "../L0/L0_probes.h"
 
 void L1::L1Login(const std::array<uint8_t, L1Parameters::Size::PIN>& pin, se3_access_type access, bool force) {
 	uint8_t cc1[L1Parameters::Size::CHALLENGE];
@@ -39,6 +40,7 @@ void L1::L1Login(const std::array<uint8_t, L1Parameters::Size::PIN>& pin, se3_ac
 	uint16_t reqLen = 0;
 	uint16_t respLen = 0;
 
+	SE3_PROBE1(l1_login_start, access);
 	// copy pin to low-level array
 	uint8_t pin_[L1Parameters::Size::PIN];
 	memset(pin_, 0, L1Parameters::Size::PIN);
@@ -68,14 +70,17 @@ void L1::L1Login(const std::array<uint8_t, L1Parameters::Size::PIN>& pin, se3_ac
 			L1LogoutForced();
 			L1Login(pin, access, false);
 //			printf("Debug: Login after forced logout succeed\n");
+			SE3_PROBE2(l1_login_end, access, 1);
 			return;
 		}
 		else
 		{
+			SE3_PROBE2(l1_login_end, access, 0);
 			throw loginExc;
 		}
 	}
 	catch (L1Exception& e) {
+		SE3_PROBE2(l1_login_end, access, 0);
 		throw loginExc;
 	}
 
@@ -98,11 +103,14 @@ void L1::L1Login(const std::array<uint8_t, L1Parameters::Size::PIN>& pin, se3_ac
 												L1Parameters::Size::CHALLENGE);
 	}
 	catch (L1Exception& e) {
+		SE3_PROBE2(l1_login_end, access, 0);
 		throw loginExc;
 	}
 
-	if (cmpRes == false)
+	if (cmpRes == false) {
+		SE3_PROBE2(l1_login_end, access, 0);
 		throw loginExc;
+	}
 
 	//prepare key session
 	//the resulting key is saved in this->base.s.key
@@ -131,11 +139,14 @@ void L1::L1Login(const std::array<uint8_t, L1Parameters::Size::PIN>& pin, se3_ac
 	catch (L1Exception& e) {
 		this->base.SetSessionLoggedIn(false);
 		this->base.SetSessionAccessType(SE3_ACCESS_NONE);
+		SE3_PROBE2(l1_login_end, access, 0);
 		throw loginExc;
 	}
 
 	//read token
 	this->base.SetSessionToken(L1Response::Offset::DATA + L1Login::ResponseOffset::TOKEN, L1Parameters::Size::TOKEN);
+	CryptoSessionForget(); // sessions of a previous login do not exist anymore on the SEcube
+	SE3_PROBE2(l1_login_end, access, 1);
 }
 
 void L1::L1Logout() {
@@ -152,9 +163,12 @@ void L1::L1Logout() {
 		TXRXData(L1Commands::Codes::LOGOUT, dataLen, 0, &respLen);
 	}
 	catch (L1Exception& e) {
+		SE3_PROBE2(l1_logout, 0, 0);
 		throw logOutExc;
 	}
+	SE3_PROBE2(l1_logout, 0, 1);
 
+	CryptoSessionForget(); // the SEcube releases every crypto session at logout
 	this->base.SetSessionLoggedIn(false);
 	this->base.SetSessionAccessType(SE3_ACCESS_NONE);
 }
@@ -169,9 +183,12 @@ void L1::L1LogoutForced() {
 		TXRXData(L1Commands::Codes::FORCED_LOGOUT, dataLen, 0, &respLen);
 	}
 	catch (L1Exception& e) {
+		SE3_PROBE2(l1_logout, 1, 0);
 		throw logOutExc;
 	}
+	SE3_PROBE2(l1_logout, 1, 1);
 
+	CryptoSessionForget(); // the SEcube releases every crypto session at logout
 	this->base.SetSessionLoggedIn(false);
 	this->base.SetSessionAccessType(SE3_ACCESS_NONE);
 }
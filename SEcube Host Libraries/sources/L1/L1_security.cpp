@@ -32,6 +32,10 @@
 
 #include "L1.h"
 #include "L1_error_manager.h"
+#include "../L0/L0_probes.h"
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -61,7 +65,7 @@ void L1::L1CryptoInit(uint16_t algorithm, uint16_t mode, uint32_t keyId, uint32_
 	sessId = u32Tmp;
 }
 
-void L1::L1CryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint8_t* data1, uint16_t data2Len, uint8_t* data2, uint16_t* dataOutLen, uint8_t* dataOut) {
+uint16_t L1::PrepareCryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint8_t* data1, uint16_t data2Len, uint8_t* data2) {
 	if(data1Len == 0 && data2Len == 0){
 		throw std::invalid_argument("Cannot pass empty input buffers!");
 	}
@@ -99,6 +103,13 @@ void L1::L1CryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint
 	if ((data2Len > 0) && (data2 != nullptr)){
 		this->base.FillSessionBuffer(data2,	L1Response::Offset::DATA + L1Crypto::UpdateRequestOffset::DATA + data1LenPadded, data2Len);
 	}
+	SE3_PROBE3(l1_crypto_update_start, sessId, flags, (uint32_t)data1Len + data2Len);
+	return dataLen;
+}
+
+void L1::L1CryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint8_t* data1, uint16_t data2Len, uint8_t* data2, uint16_t* dataOutLen, uint8_t* dataOut) {
+	L1CryptoUpdateException cryptoUpdateExc;
+	uint16_t dataLen = PrepareCryptoUpdate(sessId, flags, data1Len, data1, data2Len, data2);
 
 	//send the data
 	uint16_t respLen;
@@ -106,11 +117,13 @@ void L1::L1CryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint
 		TXRXData(L1Commands::Codes::CRYPTO_UPDATE, dataLen, 0, &respLen);
 	}
 	catch(L1Exception& e) {
+		SE3_PROBE3(l1_crypto_update_end, sessId, 0, 0);
 		throw cryptoUpdateExc;
 	}
 
 	uint16_t u16tmp;
 	this->base.ReadSessionBuffer((uint8_t*)&u16tmp,	L1Response::Offset::DATA + L1Crypto::UpdateResponseOffset::DATAOUT_LEN,	2);	//extract the data length
+	SE3_PROBE3(l1_crypto_update_end, sessId, u16tmp, 1);
 	if(dataOutLen != nullptr){
 		*dataOutLen = u16tmp;
 	}
@@ -120,18 +133,232 @@ void L1::L1CryptoUpdate(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint
 	}
 }
 
+void L1::L1CryptoUpdateSend(uint32_t sessId, uint16_t flags, uint16_t data1Len, uint8_t* data1, uint16_t data2Len, uint8_t* data2) {
+	L1CryptoUpdateException cryptoUpdateExc;
+	uint16_t dataLen = PrepareCryptoUpdate(sessId, flags, data1Len, data1, data2Len, data2);
+	try {
+		TXData(L1Commands::Codes::CRYPTO_UPDATE, dataLen, 0);
+	}
+	catch(L1Exception& e) {
+		SE3_PROBE3(l1_crypto_update_end, sessId, 0, 0);
+		throw cryptoUpdateExc;
+	}
+}
+
+void L1::L1CryptoUpdateReceive(uint16_t* dataOutLen, uint8_t* dataOut) {
+	L1CryptoUpdateException cryptoUpdateExc;
+	uint16_t respLen;
+	uint16_t u16tmp = 0;
+	uint16_t status = RXData(L1Commands::Codes::CRYPTO_UPDATE, 0, &respLen);
+	if(status == L1Error::Error::OK){
+		this->base.ReadSessionBuffer((uint8_t*)&u16tmp, L1Response::Offset::DATA + L1Crypto::UpdateResponseOffset::DATAOUT_LEN, 2);
+	}
+	SE3_PROBE3(l1_crypto_update_end, 0, u16tmp, status == L1Error::Error::OK); // the session is not known here
+	if(status != L1Error::Error::OK){
+		throw cryptoUpdateExc;
+	}
+	if(dataOutLen != nullptr){
+		*dataOutLen = u16tmp;
+	}
+	if(dataOut != nullptr){
+		memcpy(dataOut, this->base.GetSessionBuffer() + L1Response::Offset::DATA + L1Crypto::UpdateResponseOffset::DATA, u16tmp);
+	}
+}
+
+uint8_t L1::L1MaxOutstanding() {
+	return L0MaxOutstanding();
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define L1_KEYSTREAM_AVX2
+__attribute__((target("avx2")))
+static void KeystreamXorAvx2(uint8_t* out, const uint8_t* in, const uint8_t* keystream, size_t len) {
+	size_t i = 0;
+	for(; i + 32 <= len; i += 32){
+		__m256i a = _mm256_loadu_si256((const __m256i*)(in + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(keystream + i));
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(a, b));
+	}
+	for(; i < len; i++){
+		out[i] = in[i] ^ keystream[i];
+	}
+}
+#endif
+
+/* out = in XOR keystream, with AVX2 when the CPU supports it */
+static void KeystreamXor(uint8_t* out, const uint8_t* in, const uint8_t* keystream, size_t len) {
+#ifdef L1_KEYSTREAM_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	if(avx2){
+		KeystreamXorAvx2(out, in, keystream, len);
+		return;
+	}
+#endif
+	size_t i = 0;
+	for(; i + 8 <= len; i += 8){
+		uint64_t a, b;
+		memcpy(&a, in + i, 8);
+		memcpy(&b, keystream + i, 8);
+		a ^= b;
+		memcpy(out + i, &a, 8);
+	}
+	for(; i < len; i++){
+		out[i] = in[i] ^ keystream[i];
+	}
+}
+
+void L1::L1SetCtrKeystream(bool enable) {
+	this->ctrKeystream = enable;
+}
+
+bool L1::CtrKeystream(const CryptoSession& session, uint16_t finit, const uint8_t* nonce, size_t size, const uint8_t* in, uint8_t* out) {
+	enum{
+		/* same chunks as the plain path, so that the counter of each chunk (and the ciphertext) does not change */
+		CHUNK = L1Crypto::UpdateSize::DATAIN - B5_AES_BLK_SIZE
+	};
+	L1CryptoUpdateException cryptoUpdateExc;
+	uint32_t sessId = session.Id();
+	size_t nChunks = (size + CHUNK - 1) / CHUNK;
+	size_t depth = L0MaxOutstanding();
+	size_t sent = 0, done = 0;
+	uint16_t status = L1Error::Error::OK;
+	uint16_t respLen = 0;
+	if(size == 0){
+		return false;
+	}
+	auto send = [&](size_t k){
+		uint8_t iv[B5_AES_BLK_SIZE];
+		uint64_t ctr_counter = k;
+		uint16_t flags = L1Crypto::UpdateFlags::RESET;
+		uint16_t data1Len = B5_AES_BLK_SIZE;
+		uint16_t data2Len = (uint16_t)((size - k * CHUNK) < CHUNK ? (size - k * CHUNK) : CHUNK);
+		memcpy(iv, nonce, 8);
+		memcpy(iv+8, &ctr_counter, 8);
+		if(k + 1 == nChunks){ // last chunk of data, same flags as L1Encrypt() and L1Decrypt()
+			if(session.Reused() && (nChunks == 1)){ // single chunk on a reused session, restore the IV set by the SEcube at init
+				memset(iv, L1CryptoSession::Parameters::INIT_IV_FILL, B5_AES_BLK_SIZE);
+				flags = finit | L1Crypto::UpdateFlags::RESET;
+			} else {
+				flags = finit;
+				data1Len = 0;
+			}
+		}
+		flags |= L1Crypto::UpdateFlags::KEYSTREAM;
+		this->base.FillSessionBuffer((uint8_t*)&sessId, L1Response::Offset::DATA + L1Crypto::UpdateRequestOffset::SID, 4);
+		this->base.FillSessionBuffer((uint8_t*)&flags, L1Response::Offset::DATA + L1Crypto::UpdateRequestOffset::FLAGS, 2);
+		this->base.FillSessionBuffer((uint8_t*)&data1Len, L1Response::Offset::DATA + L1Crypto::UpdateRequestOffset::DATAIN1_LEN, 2);
+		this->base.FillSessionBuffer((uint8_t*)&data2Len, L1Response::Offset::DATA + L1Crypto::UpdateRequestOffset::DATAIN2_LEN, 2);
+		if(data1Len > 0){
+			this->base.FillSessionBuffer(iv, L1Response::Offset::DATA + L1Crypto::UpdateRequestOffset::DATA, data1Len);
+		}
+		SE3_PROBE3(l1_crypto_update_start, sessId, flags, (uint32_t)data1Len);
+		TXData(L1Commands::Codes::CRYPTO_UPDATE, L1Crypto::UpdateRequestOffset::DATA + data1Len, 0);
+	};
+	auto drain = [&](){ // collect the responses still in flight, their content is not needed
+		while(done < sent){
+			done++;
+			try {
+				RXData(L1Commands::Codes::CRYPTO_UPDATE, 0, &respLen);
+			}
+			catch(...) {
+			}
+		}
+	};
+	try {
+		while(done < nChunks){
+			while((sent < nChunks) && (sent - done < depth)){ // keep the next requests in flight while the keystream is applied
+				send(sent);
+				sent++;
+			}
+			status = RXData(L1Commands::Codes::CRYPTO_UPDATE, 0, &respLen);
+			size_t off = done * CHUNK;
+			size_t len = (size - off) < CHUNK ? (size - off) : CHUNK;
+			uint16_t u16tmp = 0;
+			done++;
+			if(status == L1Error::Error::OK){
+				this->base.ReadSessionBuffer((uint8_t*)&u16tmp, L1Response::Offset::DATA + L1Crypto::UpdateResponseOffset::DATAOUT_LEN, 2);
+			}
+			SE3_PROBE3(l1_crypto_update_end, sessId, u16tmp, status == L1Error::Error::OK);
+			if((status == L1Error::Error::SE3_ERR_ACCESS) && (done == 1)){ // keystream not allowed by the policy of the key, nothing was processed
+				drain();
+				return false;
+			}
+			if((status != L1Error::Error::OK) || (u16tmp != len)){
+				throw cryptoUpdateExc;
+			}
+			KeystreamXor(out + off, in + off, this->base.GetSessionBuffer() + L1Response::Offset::DATA + L1Crypto::UpdateResponseOffset::DATA, len);
+		}
+	}
+	catch(...) {
+		drain();
+		throw cryptoUpdateExc;
+	}
+	return true;
+}
+
+/* size of the data carried by each request of EncryptData(), the LZ4 frame is cut at multiples of this size */
+static size_t CompressionWindow(uint16_t algorithm, uint16_t algorithm_mode) {
+	if((algorithm == L1Algorithms::Algorithms::AES_GCM) || (algorithm == L1Algorithms::Algorithms::CHACHA20_POLY1305) ||
+	   (algorithm == L1Algorithms::Algorithms::AES_EAX)){
+		return L1Crypto::UpdateSize::DATAIN - B5_AES_BLK_SIZE - L1Crypto::GcmSize::TAG;
+	}
+	size_t window = L1Crypto::UpdateSize::DATAIN;
+	if(algorithm_mode == CryptoInitialisation::Modes::CTR){ // the nonce is sent with each chunk
+		window -= B5_AES_BLK_SIZE;
+	}
+	if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){
+		window -= B5_SHA256_DIGEST_SIZE;
+	}
+	return window;
+}
+
+void L1::L1SetCompression(bool enable) {
+	this->compression = enable;
+}
+
 void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext, SEcube_ciphertext& encrypted_data, uint16_t algorithm, uint16_t algorithm_mode, uint32_t key_id) {
+	if(!this->compression || (plaintext == nullptr) || (plaintext_size == 0)){
+		EncryptData(plaintext_size, plaintext, encrypted_data, algorithm, algorithm_mode, key_id);
+		return;
+	}
+	vector<uint8_t> frame;
+	L1Compression::Compress(plaintext.get(), plaintext_size, CompressionWindow(algorithm, algorithm_mode), frame);
+	if(frame.size() >= plaintext_size){ // does not compress, encrypt the plaintext as it is
+		EncryptData(plaintext_size, plaintext, encrypted_data, algorithm, algorithm_mode, key_id);
+		return;
+	}
+	shared_ptr<uint8_t[]> compressed(new uint8_t[frame.size()]);
+	memcpy(compressed.get(), frame.data(), frame.size());
+	EncryptData(frame.size(), compressed, encrypted_data, algorithm, algorithm_mode, key_id);
+	encrypted_data.compressed = true;
+}
+
+void L1::EncryptData(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext, SEcube_ciphertext& encrypted_data, uint16_t algorithm, uint16_t algorithm_mode, uint32_t key_id) {
 	L1EncryptException encryptExc;
 	if(plaintext == nullptr){
 		throw encryptExc;
 	}
-	if((algorithm == L1Algorithms::Algorithms::HMACSHA256) || (algorithm == L1Algorithms::Algorithms::SHA256)){
+	if((algorithm == L1Algorithms::Algorithms::HMACSHA256) || (algorithm == L1Algorithms::Algorithms::SHA256) ||
+	   (algorithm == L1Algorithms::Algorithms::BLAKE2S) || (algorithm == L1Algorithms::Algorithms::BLAKE2S_KEYED) ||
+	   (algorithm == L1Algorithms::Algorithms::AES_CMAC)){
 		throw std::invalid_argument("Cannot call L1Encrypt with digest algorithms. Call L1Digest instead.");
 	}
-	if((algorithm != L1Algorithms::Algorithms::AES) && (algorithm != L1Algorithms::Algorithms::AES_HMACSHA256)){
+	if((algorithm != L1Algorithms::Algorithms::AES) && (algorithm != L1Algorithms::Algorithms::AES_HMACSHA256) &&
+	   (algorithm != L1Algorithms::Algorithms::AES_GCM) && (algorithm != L1Algorithms::Algorithms::CHACHA20_POLY1305) &&
+	   (algorithm != L1Algorithms::Algorithms::AES_EAX)){
 		throw std::invalid_argument("Invalid algorithm.");
 	}
-	if((algorithm_mode != CryptoInitialisation::Modes::ECB) &&
+	if(algorithm == L1Algorithms::Algorithms::AES_GCM){
+		if(algorithm_mode != CryptoInitialisation::Modes::GCM){
+			throw std::invalid_argument("Invalid algorithm mode.");
+		}
+	} else if(algorithm == L1Algorithms::Algorithms::CHACHA20_POLY1305){
+		// ChaCha20-Poly1305 has no modes, algorithm_mode is only stored in the ciphertext
+	} else if(algorithm == L1Algorithms::Algorithms::AES_EAX){
+		if(algorithm_mode != CryptoInitialisation::Modes::CTR){ // EAX is CTR encryption plus CMAC authentication
+			throw std::invalid_argument("Invalid algorithm mode.");
+		}
+	} else if((algorithm_mode != CryptoInitialisation::Modes::ECB) &&
 	   (algorithm_mode != CryptoInitialisation::Modes::CBC) &&
 	   (algorithm_mode != CryptoInitialisation::Modes::CTR) &&
 	   (algorithm_mode != CryptoInitialisation::Modes::OFB) &&
@@ -149,7 +376,43 @@ void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext,
 	encrypted_data.mode = algorithm_mode;
 	encrypted_data.key_id = key_id;
 	try {
-		L1CryptoInit(algorithm, algorithm_mode | CryptoInitialisation::Direction::ENCRYPT, key_id, encSessId);
+		CryptoSession session = CryptoSessionAcquire(algorithm, algorithm_mode | CryptoInitialisation::Direction::ENCRYPT, key_id);
+		encSessId = session.Id();
+		uint16_t finit = session.Reusable() ? 0 : (uint16_t)L1Crypto::UpdateFlags::FINIT; // reusable sessions are left open for the next call
+		if((algorithm == L1Algorithms::Algorithms::AES_GCM) || (algorithm == L1Algorithms::Algorithms::CHACHA20_POLY1305) ||
+		   (algorithm == L1Algorithms::Algorithms::AES_EAX)){ // AEAD: no padding, the data is encrypted and authenticated in a single pass
+			enum{
+				/* the first request carries the IV too, and the response to the last one carries the tag */
+				GCM_CHUNK = L1Crypto::UpdateSize::DATAIN - B5_AES_BLK_SIZE - L1Crypto::GcmSize::TAG
+			};
+			static_assert(((int)L1Crypto::GcmSize::IV == (int)L1Crypto::ChaCha20Poly1305Size::NONCE) && ((int)L1Crypto::GcmSize::TAG == (int)L1Crypto::ChaCha20Poly1305Size::TAG) &&
+					((int)L1Crypto::GcmSize::IV == (int)L1Crypto::EaxSize::NONCE) && ((int)L1Crypto::GcmSize::TAG == (int)L1Crypto::EaxSize::TAG),
+					"AES-GCM, ChaCha20-Poly1305 and AES-EAX share the same message layout");
+			uint8_t gcm_iv[L1Crypto::GcmSize::IV];
+			L0Support::Se3Rand(L1Crypto::GcmSize::IV, gcm_iv); // fill IV (or nonce) with random bytes
+			memcpy(encrypted_data.initialization_vector.data(), gcm_iv, L1Crypto::GcmSize::IV);
+			ciphertext = make_unique<uint8_t[]>(plaintext_size + L1Crypto::GcmSize::TAG);
+			uint16_t flags = L1Crypto::UpdateFlags::RESET; // the first chunk starts the message
+			do {
+				curr_chunk = (plaintext_size - enc_size) < GCM_CHUNK ? (plaintext_size - enc_size) : GCM_CHUNK;
+				if(enc_size + curr_chunk == plaintext_size){ // last chunk of data
+					flags |= L1Crypto::UpdateFlags::AUTH | finit;
+				}
+				bool first = (flags & L1Crypto::UpdateFlags::RESET) != 0;
+				L1CryptoUpdate(encSessId, flags, first ? L1Crypto::GcmSize::IV : 0, first ? gcm_iv : nullptr, curr_chunk, plaintext.get() + enc_size, &curr_len, ciphertext.get() + enc_size);
+				if(curr_len != curr_chunk + ((flags & L1Crypto::UpdateFlags::AUTH) ? L1Crypto::GcmSize::TAG : 0)){
+					throw encryptExc;
+				}
+				enc_size += curr_chunk;
+				flags = 0;
+			} while(enc_size < plaintext_size);
+			session.Done(!session.Reusable());
+			encrypted_data.ciphertext = make_unique<uint8_t[]>(plaintext_size);
+			memcpy(encrypted_data.ciphertext.get(), ciphertext.get(), plaintext_size);
+			encrypted_data.ciphertext_size = plaintext_size;
+			memcpy(encrypted_data.digest.data(), ciphertext.get() + plaintext_size, L1Crypto::GcmSize::TAG); // copy the AES-GCM, Poly1305 or EAX tag
+			return;
+		}
 		uint8_t padding = (B5_AES_BLK_SIZE - (plaintext_size % B5_AES_BLK_SIZE)); // PKCS#7 padding
 		size_t total_size = plaintext_size + padding;
 		total_size_copy = total_size;
@@ -189,7 +452,12 @@ void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext,
 			}
 			uint8_t *decrypted = plaintext_padded.get(); // alias for plaintext
 			uint8_t *encrypted = ciphertext.get(); // alias for ciphertext
-			do {
+			if(this->ctrKeystream && (algorithm == L1Algorithms::Algorithms::AES) &&
+			   CtrKeystream(session, finit, ctr_nonce, total_size, decrypted, encrypted)){ // see L1SetCtrKeystream()
+				enc_size = total_size;
+				total_size = 0;
+			}
+			while(total_size > 0) {
 				if(total_size - curr_chunk){ // still in the middle of data
 					if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){ // AES with HMAC-SHA256
 						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::RESET, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, decrypted, &curr_len, encrypted);
@@ -200,8 +468,12 @@ void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext,
 				else{ // last chunk of data
 					if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){ // AES with HMAC-SHA256
 						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::RESET | L1Crypto::UpdateFlags::AUTH | L1Crypto::UpdateFlags::FINIT, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, decrypted, &curr_len, encrypted);
+					} else if(session.Reused() && (total_size == total_size_copy)){ // single chunk on a reused session, restore the IV set by the SEcube at init
+						uint8_t init_iv[B5_AES_BLK_SIZE];
+						memset(init_iv, L1CryptoSession::Parameters::INIT_IV_FILL, B5_AES_BLK_SIZE);
+						L1CryptoUpdate(encSessId, finit | L1Crypto::UpdateFlags::RESET, B5_AES_BLK_SIZE, init_iv, curr_chunk, decrypted, &curr_len, encrypted);
 					} else { // standard AES without HMAC-SHA256
-						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::FINIT, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, decrypted, &curr_len, encrypted);
+						L1CryptoUpdate(encSessId, finit, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, decrypted, &curr_len, encrypted);
 					}
 				}
 				ctr_counter++; // increment counter and concatenate it with the nonce
@@ -214,7 +486,7 @@ void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext,
 					curr_chunk = total_size < (DATAIN_NEW - B5_SHA256_DIGEST_SIZE) ? total_size : (DATAIN_NEW - B5_SHA256_DIGEST_SIZE);
 				}
 				enc_size += curr_len; // increment counter of encrypted data
-			} while(total_size > 0);
+			}
 			if((total_size_copy != enc_size) && (total_size_copy != (enc_size - 32))){
 				throw encryptExc; // throw exception if total encoded size is different from the original size (include also signature case with AES-HMAC-SHA256)
 			}
@@ -257,7 +529,7 @@ void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext,
 					if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){ // AES with HMAC-SHA256
 						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::RESET | L1Crypto::UpdateFlags::AUTH | L1Crypto::UpdateFlags::FINIT, 0, nullptr, curr_chunk, decrypted, &curr_len, encrypted);
 					} else { // standard AES without HMAC-SHA256
-						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::FINIT, 0, nullptr, curr_chunk, decrypted, &curr_len, encrypted);
+						L1CryptoUpdate(encSessId, finit, 0, nullptr, curr_chunk, decrypted, &curr_len, encrypted);
 					}
 				}
 				total_size -= curr_chunk; // decrement total number of bytes
@@ -273,6 +545,7 @@ void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext,
 				throw encryptExc; // throw exception if total encoded size is different from the original size (include also signature case with AES-HMAC-SHA256)
 			}
 		}
+		session.Done(!session.Reusable());
 
 		// encryption is done, copy data into L1Ciphertext object
 		encrypted_data.ciphertext = make_unique<uint8_t[]>(total_size_copy);
@@ -290,17 +563,44 @@ void L1::L1Encrypt(size_t plaintext_size, std::shared_ptr<uint8_t[]> plaintext,
 }
 
 void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, std::shared_ptr<uint8_t[]>& plaintext) {
+	DecryptData(encrypted_data, plaintext_size, plaintext);
+	if(encrypted_data.compressed){
+		shared_ptr<uint8_t[]> data;
+		size_t data_size = 0;
+		if(!L1Compression::Decompress(plaintext.get(), plaintext_size, data, data_size)){
+			throw L1DecryptException();
+		}
+		plaintext.swap(data);
+		plaintext_size = data_size;
+	}
+}
+
+void L1::DecryptData(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, std::shared_ptr<uint8_t[]>& plaintext) {
 	L1DecryptException decryptExc;
 	uint16_t algorithm = encrypted_data.algorithm;
 	uint16_t algorithm_mode = encrypted_data.mode;
 	uint32_t key_id = encrypted_data.key_id;
-	if((algorithm == L1Algorithms::Algorithms::HMACSHA256) || (algorithm == L1Algorithms::Algorithms::SHA256)){
+	if((algorithm == L1Algorithms::Algorithms::HMACSHA256) || (algorithm == L1Algorithms::Algorithms::SHA256) ||
+	   (algorithm == L1Algorithms::Algorithms::BLAKE2S) || (algorithm == L1Algorithms::Algorithms::BLAKE2S_KEYED) ||
+	   (algorithm == L1Algorithms::Algorithms::AES_CMAC)){
 		throw std::invalid_argument("Cannot call L1Decrypt with digest algorithms. Call L1Digest instead.");
 	}
-	if((algorithm != L1Algorithms::Algorithms::AES) && (algorithm != L1Algorithms::Algorithms::AES_HMACSHA256)){
+	if((algorithm != L1Algorithms::Algorithms::AES) && (algorithm != L1Algorithms::Algorithms::AES_HMACSHA256) &&
+	   (algorithm != L1Algorithms::Algorithms::AES_GCM) && (algorithm != L1Algorithms::Algorithms::CHACHA20_POLY1305) &&
+	   (algorithm != L1Algorithms::Algorithms::AES_EAX)){
 		throw std::invalid_argument("Invalid algorithm.");
 	}
-	if((algorithm_mode != CryptoInitialisation::Modes::ECB) &&
+	if(algorithm == L1Algorithms::Algorithms::AES_GCM){
+		if(algorithm_mode != CryptoInitialisation::Modes::GCM){
+			throw std::invalid_argument("Invalid algorithm mode.");
+		}
+	} else if(algorithm == L1Algorithms::Algorithms::CHACHA20_POLY1305){
+		// ChaCha20-Poly1305 has no modes, algorithm_mode is only stored in the ciphertext
+	} else if(algorithm == L1Algorithms::Algorithms::AES_EAX){
+		if(algorithm_mode != CryptoInitialisation::Modes::CTR){ // EAX is CTR encryption plus CMAC authentication
+			throw std::invalid_argument("Invalid algorithm mode.");
+		}
+	} else if((algorithm_mode != CryptoInitialisation::Modes::ECB) &&
 	   (algorithm_mode != CryptoInitialisation::Modes::CBC) &&
 	   (algorithm_mode != CryptoInitialisation::Modes::CTR) &&
 	   (algorithm_mode != CryptoInitialisation::Modes::OFB) &&
@@ -314,7 +614,41 @@ void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, st
 	size_t enc_size = encrypted_data.ciphertext_size; // here we will store a copy of the size of the ciphertext
 	unique_ptr<uint8_t[]> decrypted_data; // here we will store the decrypted data
 	try {
-		L1CryptoInit(algorithm, algorithm_mode | CryptoInitialisation::Direction::DECRYPT, key_id, encSessId);
+		CryptoSession session = CryptoSessionAcquire(algorithm, algorithm_mode | CryptoInitialisation::Direction::DECRYPT, key_id);
+		encSessId = session.Id();
+		uint16_t finit = session.Reusable() ? 0 : (uint16_t)L1Crypto::UpdateFlags::FINIT; // reusable sessions are left open for the next call
+		if((algorithm == L1Algorithms::Algorithms::AES_GCM) || (algorithm == L1Algorithms::Algorithms::CHACHA20_POLY1305) ||
+		   (algorithm == L1Algorithms::Algorithms::AES_EAX)){ // AEAD: the SEcube returns the tag of the ciphertext with the last chunk
+			enum{
+				GCM_CHUNK = L1Crypto::UpdateSize::DATAIN - B5_AES_BLK_SIZE - L1Crypto::GcmSize::TAG
+			};
+			decrypted_data = make_unique<uint8_t[]>(enc_size + L1Crypto::GcmSize::TAG);
+			uint16_t flags = L1Crypto::UpdateFlags::RESET; // the first chunk starts the message
+			do {
+				curr_chunk = (enc_size - dec_size) < GCM_CHUNK ? (enc_size - dec_size) : GCM_CHUNK;
+				if(dec_size + curr_chunk == enc_size){ // last chunk of data
+					flags |= L1Crypto::UpdateFlags::AUTH | finit;
+				}
+				bool first = (flags & L1Crypto::UpdateFlags::RESET) != 0;
+				L1CryptoUpdate(encSessId, flags, first ? L1Crypto::GcmSize::IV : 0, first ? encrypted_data.initialization_vector.data() : nullptr,
+						curr_chunk, encrypted_data.ciphertext.get() + dec_size, &curr_len, decrypted_data.get() + dec_size);
+				if(curr_len != curr_chunk + ((flags & L1Crypto::UpdateFlags::AUTH) ? L1Crypto::GcmSize::TAG : 0)){
+					throw decryptExc;
+				}
+				dec_size += curr_chunk;
+				flags = 0;
+			} while(dec_size < enc_size);
+			session.Done(!session.Reusable());
+			if(memcmp(encrypted_data.digest.data(), decrypted_data.get() + dec_size, L1Crypto::GcmSize::TAG)){ // tag does not match
+				L1DataIntegrityException exc;
+				throw exc;
+			}
+			shared_ptr<uint8_t[]> tmp(new uint8_t[dec_size]);
+			memcpy(tmp.get(), decrypted_data.get(), dec_size);
+			plaintext_size = dec_size;
+			plaintext.swap(tmp);
+			return;
+		}
 		decrypted_data  = make_unique<uint8_t[]>(encrypted_data.ciphertext_size); // by default allocated for simple AES
 		if(algorithm_mode == CryptoInitialisation::Modes::CTR){
 			enum{
@@ -337,7 +671,12 @@ void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, st
 			}
 			uint8_t *decrypted = decrypted_data.get(); // alias for plaintext
 			uint8_t *encrypted = encrypted_data.ciphertext.get(); // alias for ciphertext
-			do {
+			if(this->ctrKeystream && (algorithm == L1Algorithms::Algorithms::AES) &&
+			   CtrKeystream(session, finit, ctr_nonce, enc_size, encrypted, decrypted)){ // see L1SetCtrKeystream()
+				dec_size = enc_size;
+				enc_size = 0;
+			}
+			while(enc_size > 0) {
 				if(enc_size - curr_chunk){ // still in the middle of data
 					if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){ // AES with HMAC-SHA256
 						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::RESET, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, encrypted, &curr_len, decrypted);
@@ -348,8 +687,12 @@ void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, st
 				else{ // last chunk of data
 					if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){ // AES with HMAC-SHA256
 						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::RESET | L1Crypto::UpdateFlags::AUTH | L1Crypto::UpdateFlags::FINIT, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, encrypted, &curr_len, decrypted);
+					} else if(session.Reused() && (enc_size == encrypted_data.ciphertext_size)){ // single chunk on a reused session, restore the IV set by the SEcube at init
+						uint8_t init_iv[B5_AES_BLK_SIZE];
+						memset(init_iv, L1CryptoSession::Parameters::INIT_IV_FILL, B5_AES_BLK_SIZE);
+						L1CryptoUpdate(encSessId, finit | L1Crypto::UpdateFlags::RESET, B5_AES_BLK_SIZE, init_iv, curr_chunk, encrypted, &curr_len, decrypted);
 					} else { // standard AES without HMAC-SHA256
-						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::FINIT, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, encrypted, &curr_len, decrypted);
+						L1CryptoUpdate(encSessId, finit, B5_AES_BLK_SIZE, ctr_nonce, curr_chunk, encrypted, &curr_len, decrypted);
 					}
 				}
 				ctr_counter++; // increment counter and concatenate it with the nonce
@@ -362,7 +705,7 @@ void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, st
 					curr_chunk = enc_size < (DATAIN_NEW - B5_SHA256_DIGEST_SIZE) ? enc_size : (DATAIN_NEW - B5_SHA256_DIGEST_SIZE);
 				}
 				dec_size += curr_len; // increment counter of encrypted data
-			} while(enc_size > 0);
+			}
 		} else {
 			curr_chunk = encrypted_data.ciphertext_size < L1Crypto::UpdateSize::DATAIN ? encrypted_data.ciphertext_size : L1Crypto::UpdateSize::DATAIN; // by default computed for simple AES
 			if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){
@@ -390,7 +733,7 @@ void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, st
 					if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){ // AES with HMAC-SHA256
 						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::RESET | L1Crypto::UpdateFlags::AUTH | L1Crypto::UpdateFlags::FINIT, 0, nullptr, curr_chunk, encrypted, &curr_len, decrypted);
 					} else { // standard AES without HMAC-SHA256
-						L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::FINIT, 0, nullptr, curr_chunk, encrypted, &curr_len, decrypted);
+						L1CryptoUpdate(encSessId, finit, 0, nullptr, curr_chunk, encrypted, &curr_len, decrypted);
 					}
 				}
 				enc_size -= curr_chunk; // decrement total number of bytes
@@ -406,6 +749,7 @@ void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, st
 		if((encrypted_data.ciphertext_size != dec_size) && (encrypted_data.ciphertext_size != (dec_size - 32))){
 			throw decryptExc; // throw exception if total decrypted size is different from the original size (include also signature case with AES-HMAC-SHA256)
 		}
+		session.Done(!session.Reusable());
 		uint8_t padding_size = 0;
 		uint64_t decrypted_size = dec_size;
 		if(algorithm == L1Algorithms::Algorithms::AES_HMACSHA256){ // check signature
@@ -447,7 +791,9 @@ void L1::L1Decrypt(SEcube_ciphertext& encrypted_data, size_t& plaintext_size, st
 
 void L1::L1Digest(size_t input_size, std::shared_ptr<uint8_t[]> input_data, SEcube_digest& digest) {
 	L1DigestException digestExc;
-	if(((digest.algorithm != L1Algorithms::Algorithms::HMACSHA256) && (digest.algorithm != L1Algorithms::Algorithms::SHA256))){
+	if((digest.algorithm != L1Algorithms::Algorithms::HMACSHA256) && (digest.algorithm != L1Algorithms::Algorithms::SHA256) &&
+	   (digest.algorithm != L1Algorithms::Algorithms::BLAKE2S) && (digest.algorithm != L1Algorithms::Algorithms::BLAKE2S_KEYED) &&
+	   (digest.algorithm != L1Algorithms::Algorithms::AES_CMAC)){
 		throw digestExc;
 	}
 	uint32_t encSessId = 0;
@@ -457,6 +803,8 @@ void L1::L1Digest(size_t input_size, std::shared_ptr<uint8_t[]> input_data, SEcu
 	try {
 		switch(digest.algorithm){
 			case L1Algorithms::Algorithms::HMACSHA256:
+			case L1Algorithms::Algorithms::BLAKE2S_KEYED: // keyed BLAKE2s and AES-CMAC take the nonce exactly like HMAC-SHA256
+			case L1Algorithms::Algorithms::AES_CMAC:
 				L1CryptoInit(digest.algorithm, 0, digest.key_id, encSessId);
 				if(digest.usenonce){
 					L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::SETNONCE, 32, digest.digest_nonce.data(), 0, nullptr, nullptr, nullptr);
@@ -471,6 +819,7 @@ void L1::L1Digest(size_t input_size, std::shared_ptr<uint8_t[]> input_data, SEcu
 				}
 				break;
 			case L1Algorithms::Algorithms::SHA256:
+			case L1Algorithms::Algorithms::BLAKE2S:
 				L1CryptoInit(digest.algorithm, 0, L1Key::Id::NULL_ID, encSessId);
 				break;
 			default:
@@ -486,11 +835,11 @@ void L1::L1Digest(size_t input_size, std::shared_ptr<uint8_t[]> input_data, SEcu
 				L1CryptoUpdate(encSessId, L1Crypto::UpdateFlags::FINIT, curr_chunk, input, 0, nullptr, &curr_len, output);
 			}
 			input_size -= curr_chunk;
-			output += curr_chunk;
-			input += curr_chunk;
+			input += curr_chunk; // the digest is written only by the last chunk, output does not move
 			curr_chunk = input_size < (L1Crypto::UpdateSize::DATAIN - B5_SHA256_DIGEST_SIZE) ? input_size : (L1Crypto::UpdateSize::DATAIN - B5_SHA256_DIGEST_SIZE);
 		} while(input_size > 0);
-		for(int i=0; i<32; i++){ // copy the digest
+		digest.digest.fill(0); // AES-CMAC fills only the first B5_CMAC_AES_BLK_SIZE bytes
+		for(int i=0; (i<32) && (i<curr_len); i++){ // copy the digest
 			digest.digest[i] = output_data[i];
 		}
 	}
@@ -553,6 +902,7 @@ void L1::L1KeyEdit(se3Key& k, uint16_t op) {
 	   (k.id >= L1Key::Id::RESERVED_ID_SEKEY_BEGIN && k.id <= L1Key::Id::RESERVED_ID_SEKEY_END)){
     	throw keyEditExc;
     }
+	CryptoSessionInvalidate(k.id); // cached sessions must not outlive the key they were initialized with (done before filling the buffer, it sends requests)
 	this->base.FillSessionBuffer((uint8_t*)&op, L1Response::Offset::DATA + L1Request::KeyOffset::OP, 2);
 	dataLen += 2;
 	this->base.FillSessionBuffer((uint8_t*)&(k.id), L1Response::Offset::DATA + L1Request::KeyOffset::ID, 4);
@@ -566,6 +916,10 @@ void L1::L1KeyEdit(se3Key& k, uint16_t op) {
 		this->base.FillSessionBuffer(k.data, L1Response::Offset::DATA + L1Request::KeyOffset::DATA, k.dataSize);
 		dataLen += k.dataSize;
 	}
+	if((op != L1Commands::KeyOpEdit::SE3_KEY_OP_DELETE) && (k.policy != L1Key::Policy::NONE)){ // optional, after the key data
+		this->base.FillSessionBuffer((uint8_t*)&(k.policy), L1Response::Offset::DATA + dataLen, 2);
+		dataLen += 2;
+	}
 	try {
 		TXRXData(L1Commands::Codes::KEY_EDIT, dataLen, 0, &respLen);
 	}
@@ -72,6 +72,7 @@ bool L1::L1SEkey_DeleteAllKeys(std::vector<uint32_t>& keep){
 	uint16_t resp_len = 0;
 	uint16_t op = L1Commands::Options::SE3_SEKEY_DELETEALL;
 	uint16_t offset = L1Request::Offset::DATA;
+	CryptoSessionInvalidateAll();
 	this->base.FillSessionBuffer((unsigned char*)&op, offset, 2);
 	offset += 2;
 	for(uint32_t key : keep){ // in case some keys have to be preserved, send their IDs to the SEcube
@@ -96,6 +97,7 @@ bool L1::L1SEkey_DeleteKey(uint32_t key_id){
 	uint16_t resp_len = 0;
 	uint16_t op = L1Commands::Options::SE3_SEKEY_DELETEKEY;
 	uint16_t offset = L1Request::Offset::DATA;
+	CryptoSessionInvalidate(key_id);
 	this->base.FillSessionBuffer((unsigned char*)&op, offset, 2);
 	offset += 2;
 	this->base.FillSessionBuffer((unsigned char*)&key_id, offset, 4);
@@ -138,6 +140,7 @@ bool L1::L1SEkey_InsertKey(uint32_t key_id, uint16_t key_len, uint32_t dec_id, s
 	uint16_t resp_len = 0;
 	uint16_t op = L1Commands::Options::SE3_SEKEY_INSERTKEY;
 	uint16_t offset = L1Request::Offset::DATA;
+	CryptoSessionInvalidate(key_id);
 	this->base.FillSessionBuffer((unsigned char*)&op, offset, 2);
 	offset += 2;
 	this->base.FillSessionBuffer((unsigned char*)&key_id, offset, 4);
@@ -38,10 +38,10 @@
  *  the key are not used at all, therefore the only attribute you care about is the digest. */
 class SEcube_digest{
 public:
-	uint32_t key_id; /**< The ID of the key that is used to generate the digest with HMAC-SHA256. */
+	uint32_t key_id; /**< The ID of the key that is used to generate the digest with HMAC-SHA256, keyed BLAKE2s or AES-CMAC. */
 	uint16_t algorithm; /**< The algorithm used to generate the digest. */
 	std::array<uint8_t, B5_SHA256_DIGEST_SIZE> digest; /**< The digest of the data. The size is B5_SHA256_DIGEST_SIZE because current digest algorithms always produce a result on 32 bytes. */
-	std::array<uint8_t, B5_SHA256_DIGEST_SIZE> digest_nonce; /**< This is the nonce that is used to compute the authenticated digest with HMAC-SHA256. */
+	std::array<uint8_t, B5_SHA256_DIGEST_SIZE> digest_nonce; /**< This is the nonce that is used to compute the authenticated digest with HMAC-SHA256, keyed BLAKE2s or AES-CMAC. */
 	bool usenonce; /**< Use the nonce parameter as input to generate the digest. This can be useful if you already have a digest that was computed on the data
 	you are working on, and you want to recompute it to check if the data have been modified. So you also need to set the same nonce that was used in the previous
 	computation. */
@@ -59,10 +59,11 @@ public:
 	uint16_t mode; /**< The mode of the algorithm (i.e. CTR). */
 	std::unique_ptr<uint8_t[]> ciphertext; /**< The buffer holding the encrypted data. */
 	size_t ciphertext_size; /**< The dimension of the ciphertext (bytes). */
-	std::array<uint8_t, B5_SHA256_DIGEST_SIZE> digest; /**< The digest that is associated to the data if using AES with HMAC-SHA-256. */
+	std::array<uint8_t, B5_SHA256_DIGEST_SIZE> digest; /**< The digest that is associated to the data if using AES with HMAC-SHA-256. The first 16 bytes hold the tag with AES-GCM, ChaCha20-Poly1305 and AES-EAX. */
 	std::array<uint8_t, B5_SHA256_DIGEST_SIZE> digest_nonce; /**< This is the nonce that is used to compute the authenticated digest. */
 	std::array<uint8_t, B5_AES_BLK_SIZE> CTR_nonce; /**< This is the nonce that is used to run the AES cipher in CTR mode. */
-	std::array<uint8_t, B5_AES_BLK_SIZE> initialization_vector; /**< This is the initialization vector that is used to run AES in CBC, CFB, OFB modes. */
+	std::array<uint8_t, B5_AES_BLK_SIZE> initialization_vector; /**< This is the initialization vector that is used to run AES in CBC, CFB, OFB modes. The first 12 bytes hold the IV with AES-GCM and the nonce with ChaCha20-Poly1305 and AES-EAX. */
+	bool compressed = false; /**< True if the plaintext was compressed into an LZ4 frame before the encryption (see L1SetCompression()). */
 	void reset(); /**< Reset the content of the L1Ciphertext object. */
 };
 
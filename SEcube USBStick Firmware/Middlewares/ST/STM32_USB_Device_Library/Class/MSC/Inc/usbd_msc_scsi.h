@@ -80,8 +80,13 @@
 #define SCSI_VERIFY16                               0x8F
 
 #define SCSI_SEND_DIAGNOSTIC                        0x1D
+#define SCSI_SYNCHRONIZE_CACHE10                    0x35
 #define SCSI_READ_FORMAT_CAPACITIES                 0x23
 
+/* Vendor specific commands: blocks of the SEcube protocol, addressed by index */
+#define SCSI_SE3_CMD_OUT                            0xC0
+#define SCSI_SE3_RESP_IN                            0xC1
+
 #define NO_SENSE                                    0
 #define RECOVERED_ERROR                             1
 #define NOT_READY                                   2
@@ -125,6 +130,11 @@ extern  uint8_t Mode_Sense10_data[];
 extern  uint8_t Scsi_Sense_Data[];
 extern  uint8_t ReadCapacity10_Data[];
 extern  uint8_t ReadFormatCapacity_Data [];
+
+int8_t USBD_MSC_SynchronizeCache(uint8_t lun);
+int8_t USBD_MSC_VendorWrite(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+int8_t USBD_MSC_VendorRead(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+void USBD_MSC_ResumeRead(void);
 /**
   * @}
   */ 
@@ -91,6 +91,9 @@ static int8_t SCSI_ModeSense10 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t
 static int8_t SCSI_Write10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *params);
 static int8_t SCSI_Read10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *params);
 static int8_t SCSI_Verify10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_SynchronizeCache10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_VendorIn(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_VendorOut(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
 static int8_t SCSI_CheckAddressRange (USBD_HandleTypeDef  *pdev, 
                                       uint8_t lun , 
                                       uint32_t blk_offset , 
@@ -100,6 +103,10 @@ static int8_t SCSI_ProcessRead (USBD_HandleTypeDef  *pdev,
 
 static int8_t SCSI_ProcessWrite (USBD_HandleTypeDef  *pdev,
                                  uint8_t lun);
+
+/* Read deferred because the storage returned USBD_BUSY */
+static USBD_HandleTypeDef  *SCSI_DeferredDev = NULL;
+static uint8_t SCSI_DeferredLun = 0;
 /**
   * @}
   */ 
@@ -160,6 +167,15 @@ int8_t SCSI_ProcessCmd(USBD_HandleTypeDef  *pdev,
   case SCSI_VERIFY10:
     return SCSI_Verify10(pdev, lun, params);
     
+  case SCSI_SYNCHRONIZE_CACHE10:
+    return SCSI_SynchronizeCache10(pdev, lun, params);
+    
+  case SCSI_SE3_CMD_OUT:
+    return SCSI_VendorOut(pdev, lun, params);
+    
+  case SCSI_SE3_RESP_IN:
+    return SCSI_VendorIn(pdev, lun, params);
+    
   default:
     SCSI_SenseCode(pdev, 
                    lun,
@@ -458,6 +474,8 @@ static int8_t SCSI_Read10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *para
   
   if(hmsc->bot_state == USBD_BOT_IDLE)  /* Idle */
   {
+    /* a read deferred before a reset is not resumed */
+    SCSI_DeferredDev = NULL;
     
     /* case 10 : Ho <> Di */
     
@@ -636,6 +654,203 @@ static int8_t SCSI_Verify10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *pa
   return 0;
 }
 
+/**
+* @brief  USBD_MSC_SynchronizeCache
+*         Write cached data to the medium. To be implemented by the storage
+*         interface when it caches writes.
+* @param  lun: Logical unit number
+* @retval status
+*/
+__weak int8_t USBD_MSC_SynchronizeCache(uint8_t lun)
+{
+  return 0;
+}
+
+/**
+* @brief  SCSI_SynchronizeCache10
+*         Process Synchronize Cache10 command
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_SynchronizeCache10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  
+  if (USBD_MSC_SynchronizeCache(lun) != 0)
+  {
+    SCSI_SenseCode(pdev,
+                   lun,
+                   HARDWARE_ERROR, 
+                   WRITE_FAULT);
+    return -1;
+  }
+  hmsc->bot_data_length = 0;
+  return 0;
+}
+
+/**
+* @brief  USBD_MSC_VendorWrite
+*         Receive blocks of a SCSI_SE3_CMD_OUT command. To be implemented by
+*         the storage interface when it supports the vendor commands.
+* @param  lun: Logical unit number
+* @param  buf: data
+* @param  blk_addr: first block index
+* @param  blk_len: number of blocks
+* @retval status
+*/
+__weak int8_t USBD_MSC_VendorWrite(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  return -1;
+}
+
+/**
+* @brief  USBD_MSC_VendorRead
+*         Send blocks of a SCSI_SE3_RESP_IN command. To be implemented by the
+*         storage interface when it supports the vendor commands. May return
+*         USBD_BUSY like the Read operation of the storage.
+* @param  lun: Logical unit number
+* @param  buf: data
+* @param  blk_addr: first block index
+* @param  blk_len: number of blocks
+* @retval status
+*/
+__weak int8_t USBD_MSC_VendorRead(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  return -1;
+}
+
+/**
+* @brief  SCSI_VendorCheck
+*         Check a vendor command and load its block range. The CDB has the
+*         layout of Read10/Write10, the medium is not involved.
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @param  dir_in: the command transfers data to the host
+* @retval status
+*/
+static int8_t SCSI_VendorCheck(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params, uint8_t dir_in)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  
+  /* cases 8,10 : direction mismatch */
+  if (((hmsc->cbw.bmFlags & 0x80) == 0x80) != (dir_in != 0))
+  {
+    SCSI_SenseCode(pdev,
+                   hmsc->cbw.bLUN, 
+                   ILLEGAL_REQUEST, 
+                   INVALID_CDB);
+    return -1;
+  }
+  
+  hmsc->scsi_blk_addr = (params[2] << 24) | \
+    (params[3] << 16) | \
+      (params[4] <<  8) | \
+        params[5];
+  hmsc->scsi_blk_len = (params[7] <<  8) | \
+    params[8];
+  
+  hmsc->scsi_blk_addr *= hmsc->scsi_blk_size;
+  hmsc->scsi_blk_len  *= hmsc->scsi_blk_size;
+  
+  /* cases 3,4,5,11,13 : Hn,Hi,Ho <> Dn,Di,Do */
+  if ((hmsc->scsi_blk_len == 0) || (hmsc->cbw.dDataLength != hmsc->scsi_blk_len))
+  {
+    SCSI_SenseCode(pdev,
+                   hmsc->cbw.bLUN, 
+                   ILLEGAL_REQUEST, 
+                   INVALID_CDB);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+* @brief  SCSI_VendorOut
+*         Process the SCSI_SE3_CMD_OUT vendor command
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_VendorOut(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  
+  if (hmsc->bot_state == USBD_BOT_IDLE) /* Idle */
+  {
+    if (SCSI_VendorCheck(pdev, lun, params, 0) < 0)
+    {
+      return -1; /* error */
+    }
+    
+    /* Prepare EP to receive first data packet */
+    hmsc->bot_state = USBD_BOT_DATA_OUT;  
+    USBD_LL_PrepareReceive (pdev,
+                      MSC_EPOUT_ADDR,
+                      hmsc->bot_data, 
+                      MIN (hmsc->scsi_blk_len, MSC_MEDIA_PACKET));  
+  }
+  else /* Write Process ongoing */
+  {
+    return SCSI_ProcessWrite(pdev, lun);
+  }
+  return 0;
+}
+
+/**
+* @brief  SCSI_VendorIn
+*         Process the SCSI_SE3_RESP_IN vendor command
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_VendorIn(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  
+  if (hmsc->bot_state == USBD_BOT_IDLE) /* Idle */
+  {
+    /* a read deferred before a reset is not resumed */
+    SCSI_DeferredDev = NULL;
+    
+    if (SCSI_VendorCheck(pdev, lun, params, 1) < 0)
+    {
+      return -1; /* error */
+    }
+    hmsc->bot_state = USBD_BOT_DATA_IN;
+  }
+  hmsc->bot_data_length = MSC_MEDIA_PACKET;  
+  
+  return SCSI_ProcessRead(pdev, lun);
+}
+
+/**
+* @brief  USBD_MSC_ResumeRead
+*         Retry a read deferred by the storage. Must not be preempted by the
+*         USB interrupt.
+* @retval None
+*/
+void USBD_MSC_ResumeRead(void)
+{
+  USBD_HandleTypeDef  *pdev = SCSI_DeferredDev;
+  USBD_MSC_BOT_HandleTypeDef  *hmsc;
+  
+  if (pdev == NULL)
+  {
+    return;
+  }
+  SCSI_DeferredDev = NULL;
+  hmsc = (USBD_MSC_BOT_HandleTypeDef*)pdev->pClassData;
+  if ((hmsc == NULL) || (hmsc->bot_state != USBD_BOT_DATA_IN))
+  {
+    return;
+  }
+  if (SCSI_ProcessRead(pdev, SCSI_DeferredLun) < 0)
+  {
+    MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_FAILED);
+  }
+}
+
 /**
 * @brief  SCSI_CheckAddressRange
 *         Check address range
@@ -669,13 +884,32 @@ static int8_t SCSI_ProcessRead (USBD_HandleTypeDef  *pdev, uint8_t lun)
 {
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*)pdev->pClassData;   
   uint32_t len;
+  int8_t ret;
   
   len = MIN(hmsc->scsi_blk_len , MSC_MEDIA_PACKET); 
   
-  if( ((USBD_StorageTypeDef *)pdev->pUserData)->Read(lun ,
+  if (hmsc->cbw.CB[0] == SCSI_SE3_RESP_IN)
+  {
+    ret = USBD_MSC_VendorRead(lun ,
                               hmsc->bot_data, 
                               hmsc->scsi_blk_addr / hmsc->scsi_blk_size, 
-                              len / hmsc->scsi_blk_size) < 0)
+                              len / hmsc->scsi_blk_size);
+  }
+  else
+  {
+    ret = ((USBD_StorageTypeDef *)pdev->pUserData)->Read(lun ,
+                              hmsc->bot_data, 
+                              hmsc->scsi_blk_addr / hmsc->scsi_blk_size, 
+                              len / hmsc->scsi_blk_size);
+  }
+  if (ret == USBD_BUSY)
+  {
+    /* data not available yet, the IN transfer is started by USBD_MSC_ResumeRead */
+    SCSI_DeferredDev = pdev;
+    SCSI_DeferredLun = lun;
+    return 0;
+  }
+  if (ret < 0)
   {
     
     SCSI_SenseCode(pdev,
@@ -715,14 +949,26 @@ static int8_t SCSI_ProcessRead (USBD_HandleTypeDef  *pdev, uint8_t lun)
 static int8_t SCSI_ProcessWrite (USBD_HandleTypeDef  *pdev, uint8_t lun)
 {
   uint32_t len;
+  int8_t ret;
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
   
   len = MIN(hmsc->scsi_blk_len , MSC_MEDIA_PACKET); 
   
-  if(((USBD_StorageTypeDef *)pdev->pUserData)->Write(lun ,
+  if (hmsc->cbw.CB[0] == SCSI_SE3_CMD_OUT)
+  {
+    ret = USBD_MSC_VendorWrite(lun ,
                               hmsc->bot_data, 
                               hmsc->scsi_blk_addr / hmsc->scsi_blk_size, 
-                              len / hmsc->scsi_blk_size) < 0)
+                              len / hmsc->scsi_blk_size);
+  }
+  else
+  {
+    ret = ((USBD_StorageTypeDef *)pdev->pUserData)->Write(lun ,
+                              hmsc->bot_data, 
+                              hmsc->scsi_blk_addr / hmsc->scsi_blk_size, 
+                              len / hmsc->scsi_blk_size);
+  }
+  if (ret < 0)
   {
     SCSI_SenseCode(pdev,
                    lun, 
@@ -0,0 +1,480 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_cubesim.c
+  * Description        : In-process SEcube emulator built from the firmware sources
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+#include "se3_cubesim.h"
+#include "se3_core.h"
+#include "se3_communication_core.h"
+#include "se3_security_core.h"
+#include "se3_sdio.h"
+#include "se3_rand.h"
+#include "se3_evtrace.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0
+#endif
+
+#define SE3_CUBESIM_CMDS (16)
+
+/** Interval between two attempts of a held read, as the main loop calls STORAGE_Poll_HS (us) */
+#define SE3_CUBESIM_HOLD_POLL_US (100)
+
+/** \brief Service time of a command */
+typedef struct se3_cubesim_service_ {
+	uint32_t base_us;
+	uint32_t block_us;
+} se3_cubesim_service;
+
+static struct {
+	bool ready;
+	pthread_mutex_t lock;
+	uint8_t* sd;
+	uint32_t sd_blocks;
+	uint32_t sd_access_us;  ///< latency of each SD card command
+	uint32_t sd_block_us;  ///< latency of each block read or written
+	uint64_t sd_busy_until;  ///< the SD card is busy until this time (us)
+	se3_cubesim_service service[SE3_CUBESIM_CMDS];
+	bool executing;  ///< a request has been executed, its response is not ready yet
+	uint64_t done_at;  ///< its response is ready at this time (us)
+} cubesim = {
+	.ready = false,
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/* time */
+
+static uint64_t clock_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void sleep_us(uint64_t us)
+{
+	struct timespec t;
+	if (us == 0) {
+		return;
+	}
+	t.tv_sec = (time_t)(us / 1000000);
+	t.tv_nsec = (long)(us % 1000000) * 1000;
+	while (nanosleep(&t, &t) != 0);
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)(clock_us() / 1000);
+}
+
+/* flash */
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+	if (TypeProgram != FLASH_TYPEPROGRAM_BYTE ||
+		Address < SE3_CUBESIM_FLASH_BASE || Address >= SE3_CUBESIM_FLASH_BASE + SE3_CUBESIM_FLASH_SIZE) {
+		return HAL_ERROR;
+	}
+	*(uint8_t*)(uintptr_t)Address &= (uint8_t)Data;
+	return HAL_OK;
+}
+
+static bool flash_map()
+{
+	void* base = (void*)(uintptr_t)SE3_CUBESIM_FLASH_BASE;
+	void* p = mmap(base, SE3_CUBESIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+	if (p != base) {
+		// address already in use, the firmware cannot run
+		munmap(p, SE3_CUBESIM_FLASH_SIZE);
+		return false;
+	}
+	memset(p, 0xFF, SE3_CUBESIM_FLASH_SIZE);
+	return true;
+}
+
+/* SD card, driven by se3_sdio.c */
+
+SD_HandleTypeDef hsd;
+HAL_SD_CardInfoTypedef SDCardInfo;
+
+static bool sd_map(const char* path)
+{
+	size_t size = (size_t)SE3_CUBESIM_SD_BLOCKS * STORAGE_BLK_SIZ;
+	struct stat st;
+	void* p;
+	int fd;
+	if (path == NULL) {
+		cubesim.sd = (uint8_t*)calloc(SE3_CUBESIM_SD_BLOCKS, STORAGE_BLK_SIZ);
+		cubesim.sd_blocks = SE3_CUBESIM_SD_BLOCKS;
+		return (cubesim.sd != NULL);
+	}
+	fd = open(path, O_RDWR | O_CREAT, 0600);
+	if (fd < 0) {
+		return false;
+	}
+	if (fstat(fd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) != 0)) {
+		close(fd);
+		return false;
+	}
+	if ((size_t)st.st_size > size) {
+		// use the whole image
+		size = (size_t)st.st_size / STORAGE_BLK_SIZ * STORAGE_BLK_SIZ;
+	}
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+	cubesim.sd = (uint8_t*)p;
+	cubesim.sd_blocks = (uint32_t)(size / STORAGE_BLK_SIZ);
+	return true;
+}
+
+static void sd_latency_parse(const char* s)
+{
+	unsigned access_us = 0, block_us = 0;
+	if (s == NULL || sscanf(s, "%u:%u", &access_us, &block_us) < 1) {
+		return;
+	}
+	cubesim.sd_access_us = access_us;
+	cubesim.sd_block_us = block_us;
+}
+
+static void sd_wait(void)
+{
+	uint64_t now = clock_us();
+	if (cubesim.sd_busy_until > now) {
+		sleep_us(cubesim.sd_busy_until - now);
+	}
+}
+
+/** \brief Start a command on the SD card, once the previous one is complete
+ *  \return the card data at addr, NULL if the blocks are out of the card
+ */
+static uint8_t* sd_command(uint64_t addr, uint32_t block_size, uint32_t blocks)
+{
+	if (block_size != STORAGE_BLK_SIZ || addr % STORAGE_BLK_SIZ != 0 ||
+		addr / STORAGE_BLK_SIZ >= cubesim.sd_blocks || blocks > cubesim.sd_blocks - addr / STORAGE_BLK_SIZ) {
+		return NULL;
+	}
+	sd_wait();
+	cubesim.sd_busy_until = clock_us() + cubesim.sd_access_us + (uint64_t)cubesim.sd_block_us * blocks;
+	return cubesim.sd + addr;
+}
+
+HAL_SD_ErrorTypedef HAL_SD_ReadBlocks_DMA(SD_HandleTypeDef *hsd, uint32_t *pReadBuffer, uint64_t ReadAddr, uint32_t BlockSize, uint32_t NumberOfBlocks)
+{
+	uint8_t* p = sd_command(ReadAddr, BlockSize, NumberOfBlocks);
+	if (p == NULL) {
+		return SD_ERROR;
+	}
+	memcpy(pReadBuffer, p, (size_t)NumberOfBlocks * STORAGE_BLK_SIZ);
+	return SD_OK;
+}
+
+HAL_SD_ErrorTypedef HAL_SD_WriteBlocks_DMA(SD_HandleTypeDef *hsd, uint32_t *pWriteBuffer, uint64_t WriteAddr, uint32_t BlockSize, uint32_t NumberOfBlocks)
+{
+	uint8_t* p = sd_command(WriteAddr, BlockSize, NumberOfBlocks);
+	if (p == NULL) {
+		return SD_ERROR;
+	}
+	memcpy(p, pWriteBuffer, (size_t)NumberOfBlocks * STORAGE_BLK_SIZ);
+	return SD_OK;
+}
+
+HAL_SD_ErrorTypedef HAL_SD_CheckReadOperation(SD_HandleTypeDef *hsd, uint32_t Timeout)
+{
+	sd_wait();
+	return SD_OK;
+}
+
+HAL_SD_ErrorTypedef HAL_SD_CheckWriteOperation(SD_HandleTypeDef *hsd, uint32_t Timeout)
+{
+	sd_wait();
+	return SD_OK;
+}
+
+HAL_SD_ErrorTypedef HAL_SD_Get_CardInfo(SD_HandleTypeDef *hsd, HAL_SD_CardInfoTypedef *pCardInfo)
+{
+	pCardInfo->CardCapacity = (uint64_t)cubesim.sd_blocks * STORAGE_BLK_SIZ;
+	pCardInfo->CardBlockSize = STORAGE_BLK_SIZ;
+	return SD_OK;
+}
+
+HAL_SD_TransferStateTypedef HAL_SD_GetStatus(SD_HandleTypeDef *hsd)
+{
+	return (clock_us() < cubesim.sd_busy_until) ? (SD_TRANSFER_BUSY) : (SD_TRANSFER_OK);
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+}
+
+void STORAGE_Poll_HS(void)
+{
+}
+
+/* random numbers */
+
+bool se3_rand32(uint32_t *val)
+{
+	return (getrandom(val, sizeof(uint32_t), 0) == sizeof(uint32_t));
+}
+
+uint16_t se3_rand(uint16_t size, uint8_t* data)
+{
+	size_t n = 0;
+	ssize_t r;
+	while (n < size) {
+		r = getrandom(data + n, size - n, 0);
+		if (r <= 0) {
+			return 0;
+		}
+		n += (size_t)r;
+	}
+	return size;
+}
+
+/* service time */
+
+static void service_parse(const char* s)
+{
+	unsigned base_us = 0, block_us = 0;
+	size_t i;
+	if (s == NULL || sscanf(s, "%u:%u", &base_us, &block_us) < 1) {
+		return;
+	}
+	for (i = 0; i < SE3_CUBESIM_CMDS; i++) {
+		cubesim.service[i].base_us = base_us;
+		cubesim.service[i].block_us = block_us;
+	}
+}
+
+void se3_cubesim_service_time(uint16_t cmd, uint32_t base_us, uint32_t block_us)
+{
+	if (cmd >= SE3_CUBESIM_CMDS) {
+		return;
+	}
+	pthread_mutex_lock(&cubesim.lock);
+	cubesim.service[cmd].base_us = base_us;
+	cubesim.service[cmd].block_us = block_us;
+	pthread_mutex_unlock(&cubesim.lock);
+}
+
+/** \brief Service time of the request just executed (us) */
+static uint64_t service_time(uint16_t cmd, uint16_t req_len, uint16_t resp_len)
+{
+	uint64_t us;
+	if (cmd >= SE3_CUBESIM_CMDS) {
+		return 0;
+	}
+	us = cubesim.service[cmd].base_us;
+	us += (uint64_t)cubesim.service[cmd].block_us *
+		((req_len + SE3_COMM_BLOCK - 1) / SE3_COMM_BLOCK + (resp_len + SE3_COMM_BLOCK - 1) / SE3_COMM_BLOCK);
+	return us;
+}
+
+/* device */
+
+bool se3_cubesim_init(void)
+{
+	bool success = true;
+	pthread_mutex_lock(&cubesim.lock);
+	if (!cubesim.ready) {
+		if (!flash_map()) {
+			success = false;
+		}
+		else if (!sd_map(getenv("SE3_CUBESIM_SD_FILE"))) {
+			munmap((void*)(uintptr_t)SE3_CUBESIM_FLASH_BASE, SE3_CUBESIM_FLASH_SIZE);
+			success = false;
+		}
+		else {
+			service_parse(getenv("SE3_CUBESIM_SERVICE"));
+			sd_latency_parse(getenv("SE3_CUBESIM_SD_LATENCY"));
+			device_init();
+			cubesim.ready = true;
+		}
+	}
+	pthread_mutex_unlock(&cubesim.lock);
+	return success;
+}
+
+/* same as device_loop, until no request is left or the response of the last one executed is not
+ * ready yet: a response is ready once the service time of its request has elapsed, the host can
+ * send the next request meanwhile. Called with the lock held */
+static void requests_execute(void)
+{
+	uint16_t cmd;
+	for (;;) {
+		if (cubesim.executing) {
+			if (clock_us() < cubesim.done_at) {
+				return;
+			}
+			se3_proto_response_done();
+			cubesim.executing = false;
+		}
+		if (!se3_proto_request_next()) {
+			return;
+		}
+		cmd = req_hdr.cmd;
+		se3_cmd_execute();
+		cubesim.done_at = clock_us() + service_time(cmd, req_hdr.len, resp_hdr.len);
+		cubesim.executing = true;
+	}
+}
+
+/* what device_loop does between two USB transfers: complete the requests whose service time has
+ * elapsed, then session expiry and the SD card. Called with the lock held */
+static void device_idle(void)
+{
+	requests_execute();
+	se3_sessions_expire();
+	secube_sdio_idle();
+}
+
+/* a read of the response held by the communication core (SE3_PROTO_BUSY) is retried until it is
+ * answered, as STORAGE_Poll_HS does on the device; the lock is released meanwhile. Called with the
+ * lock held */
+static int32_t read_held(int32_t (*send)(uint32_t, uint8_t*, uint16_t), uint32_t block, uint8_t* buf, uint16_t blk_len)
+{
+	int32_t r = send(block, buf, blk_len);
+	while (r == SE3_PROTO_BUSY) {
+		pthread_mutex_unlock(&cubesim.lock);
+		sleep_us(SE3_CUBESIM_HOLD_POLL_US);
+		pthread_mutex_lock(&cubesim.lock);
+		device_idle();
+		r = send(block, buf, blk_len);
+	}
+	return r;
+}
+
+static int32_t storage_send(uint32_t block, uint8_t* buf, uint16_t blk_len)
+{
+	return se3_proto_send(0, buf, block, blk_len);
+}
+
+static int32_t vendor_send(uint32_t index, uint8_t* buf, uint16_t blk_len)
+{
+	return se3_proto_vendor_send(buf, index, blk_len);
+}
+
+bool se3_cubesim_storage_write(uint32_t block, const uint8_t* buf, uint16_t blk_len)
+{
+	int32_t r;
+	if (!se3_cubesim_init()) {
+		return false;
+	}
+	pthread_mutex_lock(&cubesim.lock);
+	device_idle();
+	r = se3_proto_recv(0, buf, block, blk_len);
+	device_idle();  // executes the request if complete
+	pthread_mutex_unlock(&cubesim.lock);
+	return (r == SE3_PROTO_OK);
+}
+
+bool se3_cubesim_storage_read(uint32_t block, uint8_t* buf, uint16_t blk_len)
+{
+	int32_t r;
+	if (!se3_cubesim_init()) {
+		return false;
+	}
+	pthread_mutex_lock(&cubesim.lock);
+	device_idle();
+	r = read_held(storage_send, block, buf, blk_len);
+	pthread_mutex_unlock(&cubesim.lock);
+	return (r == SE3_PROTO_OK);
+}
+
+bool se3_cubesim_storage_sync(void)
+{
+	bool ret;
+	if (!se3_cubesim_init()) {
+		return false;
+	}
+	pthread_mutex_lock(&cubesim.lock);
+	ret = secube_sdio_flush();
+	pthread_mutex_unlock(&cubesim.lock);
+	return ret;
+}
+
+bool se3_cubesim_write(uint32_t block, const uint8_t* buf, uint16_t blk_len)
+{
+	return se3_cubesim_storage_write(SE3_CUBESIM_MAGIC_BLOCK + block, buf, blk_len);
+}
+
+bool se3_cubesim_read(uint32_t block, uint8_t* buf, uint16_t blk_len)
+{
+	return se3_cubesim_storage_read(SE3_CUBESIM_MAGIC_BLOCK + block, buf, blk_len);
+}
+
+bool se3_cubesim_vendor_write(uint32_t index, const uint8_t* buf, uint16_t blk_len)
+{
+	int32_t r;
+	if (!se3_cubesim_init()) {
+		return false;
+	}
+	pthread_mutex_lock(&cubesim.lock);
+	device_idle();
+	r = se3_proto_vendor_recv(buf, index, blk_len);
+	device_idle();  // executes the request if complete
+	pthread_mutex_unlock(&cubesim.lock);
+	return (r == SE3_PROTO_OK);
+}
+
+bool se3_cubesim_vendor_read(uint32_t index, uint8_t* buf, uint16_t blk_len)
+{
+	int32_t r;
+	if (!se3_cubesim_init()) {
+		return false;
+	}
+	pthread_mutex_lock(&cubesim.lock);
+	device_idle();
+	r = read_held(vendor_send, index, buf, blk_len);
+	pthread_mutex_unlock(&cubesim.lock);
+	return (r == SE3_PROTO_OK);
+}
@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_cubesim.h
+  * Description        : In-process SEcube emulator built from the firmware sources
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+	CUBESIM runs the firmware core (communication, dispatcher, security core, flash and
+	algorithms) inside the host process. The block I/O the host would send to the magic file
+	of a SEcube is passed to se3_cubesim_write and se3_cubesim_read instead; requests are
+	executed as soon as their last block is written, their responses are ready once the service
+	time of the request has elapsed (0 by default). A read of a response held by the
+	communication core (long-poll) returns when the response is ready or the hold expires.
+	The flash is a RAM model, its content is lost when the process exits. The SD card is
+	driven by se3_sdio.c, the same write-behind and read-ahead as on the device, through a
+	model of the HAL SD functions: the card is in RAM, or in a file, and each command keeps
+	it busy for the configured latency. Between two transfers the emulator runs what the
+	main loop does when idle: session expiry and the flush of delayed SD writes.
+
+	To build it, compile with -DCUBESIM -ICUBESIM -IInc/Common -IInc/Device (paths relative
+	to the Project directory) this file, every source of Src/Common, the se3_algo_ sources
+	and se3_communication_core.c, se3_core.c, se3_dispatcher_core.c, se3_evtrace.c,
+	se3_flash.c, se3_keys.c, se3_memory.c, se3_perf.c, se3_sdio.c, se3_security_core.c,
+	se3_sekey.c of
+	Src/Device, adding -fPIC -fvisibility=hidden, and link them with -shared -lpthread. The
+	host libraries define the same B5_ crypto functions: hidden visibility keeps the firmware
+	ones private to the shared library, only the functions below are exported. The host
+	libraries are then compiled with -DSE3_CUBESIM -I<Project>/CUBESIM and linked with the
+	library.
+
+	Environment:
+		SE3_CUBESIM_SERVICE  "base_us[:block_us]", service time of every request, i.e. how long
+		                     after its last block its response is ready; block_us is charged
+		                     for each request and response block.
+		SE3_CUBESIM_SD_FILE  image of the SD card, created or grown to SE3_CUBESIM_SD_BLOCKS
+		                     blocks if needed; the content is kept after the process exits.
+		SE3_CUBESIM_SD_LATENCY  "access_us[:block_us]", time the SD card is busy for each
+		                     command; block_us is charged for each block read or written.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SE3_CUBESIM_API __attribute__((visibility("default")))
+
+/** Size of the emulated SD card, in blocks; an SE3_CUBESIM_SD_FILE image may be larger */
+#define SE3_CUBESIM_SD_BLOCKS (8192)
+
+/** First SD block of the magic file; block 0 is always forwarded to the SD card by the firmware */
+#define SE3_CUBESIM_MAGIC_BLOCK (64)
+
+/** \brief Boot the emulated device
+ *  \return false if the emulated flash could not be mapped
+ *
+ *  Maps the flash, runs device_init and reads SE3_CUBESIM_SERVICE. Calls after the first
+ *    one do nothing.
+ */
+SE3_CUBESIM_API bool se3_cubesim_init(void);
+
+/** \brief Write blocks of the magic file
+ *  \param block first block, relative to the magic file
+ *  \param buf data, blk_len * 512 bytes
+ *  \param blk_len number of blocks
+ *  \return false on I/O failure
+ *
+ *  Any request completed by the write is executed before returning, the service time
+ *    configured for its command included.
+ */
+SE3_CUBESIM_API bool se3_cubesim_write(uint32_t block, const uint8_t* buf, uint16_t blk_len);
+
+/** \brief Read blocks of the magic file
+ *  \param block first block, relative to the magic file
+ *  \param buf output, blk_len * 512 bytes
+ *  \param blk_len number of blocks
+ *  \return false on I/O failure
+ */
+SE3_CUBESIM_API bool se3_cubesim_read(uint32_t block, uint8_t* buf, uint16_t blk_len);
+
+/** \brief Write blocks of the mass storage, as the SCSI WRITE(10) command
+ *  \param block first block, absolute
+ *  \param buf data, blk_len * 512 bytes
+ *  \param blk_len number of blocks
+ *  \return false on I/O failure
+ *
+ *  Blocks outside of the magic file go to the SD card; the write may be delayed by
+ *    se3_sdio.c until the next idle period or se3_cubesim_storage_sync.
+ */
+SE3_CUBESIM_API bool se3_cubesim_storage_write(uint32_t block, const uint8_t* buf, uint16_t blk_len);
+
+/** \brief Read blocks of the mass storage, as the SCSI READ(10) command
+ *  \param block first block, absolute
+ *  \param buf output, blk_len * 512 bytes
+ *  \param blk_len number of blocks
+ *  \return false on I/O failure
+ */
+SE3_CUBESIM_API bool se3_cubesim_storage_read(uint32_t block, uint8_t* buf, uint16_t blk_len);
+
+/** \brief Write the delayed SD blocks, as the SCSI SYNCHRONIZE CACHE command
+ *  \return false on I/O failure
+ */
+SE3_CUBESIM_API bool se3_cubesim_storage_sync(void);
+
+/** \brief Send blocks with the SCSI_SE3_CMD_OUT vendor command
+ *  \param index index of the first block in the protocol file
+ *  \param buf data, blk_len * 512 bytes
+ *  \param blk_len number of blocks
+ *  \return false if the command fails
+ *
+ *  Same as se3_cubesim_write, without the magic file: the blocks reach the
+ *    communication core as they do from the SCSI layer of the device.
+ */
+SE3_CUBESIM_API bool se3_cubesim_vendor_write(uint32_t index, const uint8_t* buf, uint16_t blk_len);
+
+/** \brief Receive blocks with the SCSI_SE3_RESP_IN vendor command
+ *  \param index index of the first block in the protocol file
+ *  \param buf output, blk_len * 512 bytes
+ *  \param blk_len number of blocks
+ *  \return false if the command fails
+ */
+SE3_CUBESIM_API bool se3_cubesim_vendor_read(uint32_t index, uint8_t* buf, uint16_t blk_len);
+
+/** \brief Set the service time of a command
+ *  \param cmd command code (SE3_CMD0_*)
+ *  \param base_us time spent on each request, in microseconds
+ *  \param block_us time spent on each request and response block, in microseconds
+ */
+SE3_CUBESIM_API void se3_cubesim_service_time(uint16_t cmd, uint32_t base_us, uint32_t block_us);
+
+#ifdef __cplusplus
+}
+#endif
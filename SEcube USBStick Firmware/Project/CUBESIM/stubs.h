@@ -0,0 +1,122 @@
+/**
+  ******************************************************************************
+  * File Name          : stubs.h
+  * Description        : Hardware stubs for the CUBESIM host build of the firmware
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+	Included by se3c0def.h when CUBESIM is defined. It replaces the pieces of the STM32 HAL
+	used by the firmware core, so that the core can be compiled for a Linux host and driven
+	through se3_cubesim.h.
+
+	The internal flash is emulated by a RAM area mapped at the same address it has on the
+	device, because se3_flash.c handles flash addresses as uint32_t. The SD card functions
+	used by se3_sdio.c are implemented by the SD card model of se3_cubesim.c.
+*/
+
+#define SE3_CUBESIM_FLASH_BASE  ((uint32_t)0x08000000)  ///< first address of the emulated flash
+#define SE3_CUBESIM_FLASH_SIZE  ((uint32_t)0x00100000)  ///< 1MB, as on the STM32F429
+
+#define FLASH_SECTOR_10  ((uint32_t)10)
+#define FLASH_SECTOR_11  ((uint32_t)11)
+#define FLASH_TYPEPROGRAM_BYTE  ((uint32_t)0x00)
+
+#define SE3_FLASH_S0  (FLASH_SECTOR_10)
+#define SE3_FLASH_S1  (FLASH_SECTOR_11)
+#define SE3_FLASH_S0_ADDR  ((uint32_t)0x080C0000)
+#define SE3_FLASH_S1_ADDR  ((uint32_t)0x080E0000)
+#define SE3_FLASH_SECTOR_SIZE (128*1024)
+
+typedef enum {
+	HAL_OK = 0x00,
+	HAL_ERROR = 0x01,
+	HAL_BUSY = 0x02,
+	HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+/** \brief Milliseconds since boot
+ *
+ *  Taken from the monotonic clock of the host, so time goes on while the emulator is idle.
+ */
+uint32_t HAL_GetTick(void);
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+
+/** \brief Program the emulated flash
+ *
+ *  Programming can only clear bits, as on the device; erased bytes read as 0xFF.
+ */
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+
+typedef enum {
+	OTG_HS_IRQn = 77
+} IRQn_Type;
+
+/** \brief Nothing to mask, USB transfers are passed to the firmware by the calling thread */
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+typedef enum {
+	SD_ERROR = 41,
+	SD_OK = 0
+} HAL_SD_ErrorTypedef;
+
+typedef enum {
+	SD_TRANSFER_OK = 0,
+	SD_TRANSFER_BUSY = 1,
+	SD_TRANSFER_ERROR = 2
+} HAL_SD_TransferStateTypedef;
+
+typedef struct {
+	uint64_t CardCapacity;
+	uint32_t CardBlockSize;
+} HAL_SD_CardInfoTypedef;
+
+typedef struct {
+	uint32_t unused;
+} SD_HandleTypeDef;
+
+extern SD_HandleTypeDef hsd;
+extern HAL_SD_CardInfoTypedef SDCardInfo;
+
+/** \brief Start a transfer from or to the emulated SD card
+ *
+ *  The data is copied at once, the card then stays busy for the latency of the command.
+ *    A command waits until the previous one is complete, as the card runs one at a time.
+ */
+HAL_SD_ErrorTypedef HAL_SD_ReadBlocks_DMA(SD_HandleTypeDef *hsd, uint32_t *pReadBuffer, uint64_t ReadAddr, uint32_t BlockSize, uint32_t NumberOfBlocks);
+HAL_SD_ErrorTypedef HAL_SD_WriteBlocks_DMA(SD_HandleTypeDef *hsd, uint32_t *pWriteBuffer, uint64_t WriteAddr, uint32_t BlockSize, uint32_t NumberOfBlocks);
+
+/** \brief Wait until the transfer started last is complete */
+HAL_SD_ErrorTypedef HAL_SD_CheckReadOperation(SD_HandleTypeDef *hsd, uint32_t Timeout);
+HAL_SD_ErrorTypedef HAL_SD_CheckWriteOperation(SD_HandleTypeDef *hsd, uint32_t Timeout);
+
+HAL_SD_ErrorTypedef HAL_SD_Get_CardInfo(SD_HandleTypeDef *hsd, HAL_SD_CardInfoTypedef *pCardInfo);
+HAL_SD_TransferStateTypedef HAL_SD_GetStatus(SD_HandleTypeDef *hsd);
+
+/** \brief Nothing to poll, reads are answered synchronously by the emulator */
+void STORAGE_Poll_HS(void);
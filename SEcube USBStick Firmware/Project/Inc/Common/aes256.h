@@ -85,16 +85,6 @@ typedef struct {
     uint8_t  Nr;                   /**< Number of rounds */
     uint8_t  InitVector[16];       /**< IV for OFB, CBC, CTR */
     uint8_t  mode;                 /**< Active mode */
-    uint32_t const *Te0;
-    uint32_t const *Te1;
-    uint32_t const *Te2;
-    uint32_t const *Te3;
-    uint32_t const *Te4;
-    uint32_t const *Td0;
-    uint32_t const *Td1;
-    uint32_t const *Td2;
-    uint32_t const *Td3;
-    uint32_t const *Td4;
 } B5_tAesCtx;
 ///@}
 /** @} */
@@ -136,6 +126,16 @@ int32_t    B5_Aes256_SetIV  (B5_tAesCtx *ctx, const uint8_t *IV);
  */
 int32_t    B5_Aes256_Update (B5_tAesCtx *ctx, uint8_t *encData, uint8_t *clrData, int16_t nBlk);
 
+/**
+ *
+ * @brief Write the CTR keystream of the current AES context, i.e. the encryption of an all-zero input.
+ * @param ctx Pointer to the current AES context (must be in B5_AES256_CTR mode).
+ * @param keystream Output buffer of nBlk AES blocks.
+ * @param nBlk Number of AES blocks to generate.
+ * @return See \ref aesReturn .
+ */
+int32_t    B5_Aes256_Keystream (B5_tAesCtx *ctx, uint8_t *keystream, int16_t nBlk);
+
 /**
  *
  * @brief De-initialize the current AES context.
@@ -245,6 +245,230 @@ int32_t    B5_CmacAes256_Reset (B5_tCmacAesCtx *ctx);
  */
 int32_t    B5_CmacAes256_Sign (const uint8_t *data, int32_t dataLen, const uint8_t *Key, int16_t keySize, uint8_t *rSignature);
 
+///@}
+/** @} */
+
+/** \defgroup gcmaesSizes AES-GCM IV and Tag Sizes
+ * @{
+ */
+/** \name AES-GCM IV and Tag Sizes */
+///@{
+#define B5_GCM_AES_IV_SIZE          12  /**< Recommended IV Size in Bytes. */
+#define B5_GCM_AES_TAG_SIZE         16  /**< Tag Size in Bytes. */
+///@}
+/** @} */
+
+/** \defgroup gcmaesReturn AES-GCM return values
+ * @{
+ */
+/** \name AES-GCM return values */
+///@{
+#define B5_GCM_AES256_RES_OK                                    ( 0)
+#define B5_GCM_AES256_RES_INVALID_CONTEXT                       (-1)
+#define B5_GCM_AES256_RES_CANNOT_ALLOCATE_CONTEXT               (-2)
+#define B5_GCM_AES256_RES_INVALID_KEY_SIZE                      (-3)
+#define B5_GCM_AES256_RES_INVALID_ARGUMENT                      (-4)
+#define B5_GCM_AES256_RES_INVALID_STATE                         (-5)
+///@}
+/** @} */
+
+/** \defgroup gcmaesModes AES-GCM modes
+ * @{
+ */
+/** \name AES-GCM modes */
+///@{
+#define B5_GCM_AES256_ENC       1       /**< GCM authenticated encryption */
+#define B5_GCM_AES256_DEC       2       /**< GCM authenticated decryption */
+///@}
+/** @} */
+
+/** \defgroup gcmaesStr AES-GCM data structures
+ * @{
+ */
+/** \name AES-GCM data structures */
+///@{
+typedef struct {
+    B5_tAesCtx  aesCtx;                 /**< AES context in CTR mode, the IV holds the counter block */
+    uint64_t    HL[16];                 /**< GHASH table, low halves of the 4-bit multiples of H */
+    uint64_t    HH[16];                 /**< GHASH table, high halves of the 4-bit multiples of H */
+    uint8_t     J0[B5_AES_BLK_SIZE];    /**< Pre-counter block of the current message */
+    uint8_t     X[B5_AES_BLK_SIZE];     /**< GHASH accumulator */
+    uint8_t     ks[B5_AES_BLK_SIZE];    /**< Keystream of the last partial block */
+    uint64_t    aadLen;                 /**< AAD bytes of the current message */
+    uint64_t    dataLen;                /**< Data bytes of the current message */
+    uint8_t     mode;                   /**< Active mode */
+    uint8_t     state;                  /**< Message state */
+} B5_tGcmAes256Ctx;
+///@}
+/** @} */
+
+/** \defgroup gcmaesFunc AES-GCM functions
+ * @{
+ */
+/** \name AES-GCM functions */
+///@{
+/**
+ *
+ * @brief Initialize the AES-GCM context and precompute the GHASH table for the key.
+ * @param ctx Pointer to the AES-GCM data structure to be initialized.
+ * @param Key Pointer to the Key that must be used.
+ * @param keySize Key size. See \ref aesKeys for supported sizes.
+ * @param gcmMode AES-GCM mode. See \ref gcmaesModes for supported modes.
+ * @return See \ref gcmaesReturn .
+ */
+int32_t    B5_GcmAes256_Init (B5_tGcmAes256Ctx *ctx, const uint8_t *Key, int16_t keySize, uint8_t gcmMode);
+
+/**
+ *
+ * @brief Start a new message.
+ * @param ctx Pointer to the current AES-GCM context.
+ * @param IV Pointer to the IV.
+ * @param ivLen IV length (in Bytes). \ref B5_GCM_AES_IV_SIZE is the recommended one.
+ * @return See \ref gcmaesReturn .
+ */
+int32_t    B5_GcmAes256_Start (B5_tGcmAes256Ctx *ctx, const uint8_t *IV, int32_t ivLen);
+
+/**
+ *
+ * @brief Authenticate additional data. Allowed only between B5_GcmAes256_Start and the first B5_GcmAes256_Update.
+ * @param ctx Pointer to the current AES-GCM context.
+ * @param aad Pointer to the additional data.
+ * @param aadLen Bytes to be processed.
+ * @return See \ref gcmaesReturn .
+ */
+int32_t    B5_GcmAes256_Aad (B5_tGcmAes256Ctx *ctx, const uint8_t *aad, int32_t aadLen);
+
+/**
+ *
+ * @brief Encrypt/Decrypt and authenticate data. Any length is accepted.
+ * @param ctx Pointer to the current AES-GCM context.
+ * @param outData Output data, may be the same as inData.
+ * @param inData Input data.
+ * @param dataLen Bytes to be processed.
+ * @return See \ref gcmaesReturn .
+ */
+int32_t    B5_GcmAes256_Update (B5_tGcmAes256Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t dataLen);
+
+/**
+ *
+ * @brief Finish the current message.
+ * @param ctx Pointer to the current AES-GCM context.
+ * @param rTag Pointer to a blank memory area that can store the \ref B5_GCM_AES_TAG_SIZE bytes tag.
+ * @return See \ref gcmaesReturn .
+ */
+int32_t    B5_GcmAes256_Finit (B5_tGcmAes256Ctx *ctx, uint8_t *rTag);
+
+///@}
+/** @} */
+
+/** \defgroup eaxaesSizes AES-EAX Nonce and Tag Sizes
+ * @{
+ */
+/** \name AES-EAX Nonce and Tag Sizes */
+///@{
+#define B5_EAX_AES_NONCE_SIZE       12  /**< Nonce Size in Bytes used by the SEcube. EAX itself accepts any length. */
+#define B5_EAX_AES_TAG_SIZE         16  /**< Tag Size in Bytes. */
+///@}
+/** @} */
+
+/** \defgroup eaxaesReturn AES-EAX return values
+ * @{
+ */
+/** \name AES-EAX return values */
+///@{
+#define B5_EAX_AES256_RES_OK                                    ( 0)
+#define B5_EAX_AES256_RES_INVALID_CONTEXT                       (-1)
+#define B5_EAX_AES256_RES_CANNOT_ALLOCATE_CONTEXT               (-2)
+#define B5_EAX_AES256_RES_INVALID_KEY_SIZE                      (-3)
+#define B5_EAX_AES256_RES_INVALID_ARGUMENT                      (-4)
+#define B5_EAX_AES256_RES_INVALID_STATE                         (-5)
+///@}
+/** @} */
+
+/** \defgroup eaxaesModes AES-EAX modes
+ * @{
+ */
+/** \name AES-EAX modes */
+///@{
+#define B5_EAX_AES256_ENC       1       /**< EAX authenticated encryption */
+#define B5_EAX_AES256_DEC       2       /**< EAX authenticated decryption */
+///@}
+/** @} */
+
+/** \defgroup eaxaesStr AES-EAX data structures
+ * @{
+ */
+/** \name AES-EAX data structures */
+///@{
+typedef struct {
+    B5_tCmacAesCtx  cmacCtx;                /**< CMAC context, its key schedule also drives the counter */
+    uint8_t     N[B5_AES_BLK_SIZE];         /**< CMAC of the nonce, also the initial counter */
+    uint8_t     H[B5_AES_BLK_SIZE];         /**< CMAC of the additional data */
+    uint8_t     ctr[B5_AES_BLK_SIZE];       /**< Counter block */
+    uint8_t     ks[B5_AES_BLK_SIZE];        /**< Keystream of the last partial block */
+    uint8_t     ksPos;                      /**< Keystream bytes already used, 0 when no block is open */
+    uint8_t     mode;                       /**< Active mode */
+    uint8_t     state;                      /**< Message state */
+} B5_tEaxAes256Ctx;
+///@}
+/** @} */
+
+/** \defgroup eaxaesFunc AES-EAX functions
+ * @{
+ */
+/** \name AES-EAX functions */
+///@{
+/**
+ *
+ * @brief Initialize the AES-EAX context. CTR encryption and CMAC authentication share the same key schedule.
+ * @param ctx Pointer to the AES-EAX data structure to be initialized.
+ * @param Key Pointer to the Key that must be used.
+ * @param keySize Key size. See \ref aesKeys for supported sizes.
+ * @param eaxMode AES-EAX mode. See \ref eaxaesModes for supported modes.
+ * @return See \ref eaxaesReturn .
+ */
+int32_t    B5_EaxAes256_Init (B5_tEaxAes256Ctx *ctx, const uint8_t *Key, int16_t keySize, uint8_t eaxMode);
+
+/**
+ *
+ * @brief Start a new message.
+ * @param ctx Pointer to the current AES-EAX context.
+ * @param nonce Pointer to the nonce.
+ * @param nonceLen Nonce length (in Bytes).
+ * @return See \ref eaxaesReturn .
+ */
+int32_t    B5_EaxAes256_Start (B5_tEaxAes256Ctx *ctx, const uint8_t *nonce, int32_t nonceLen);
+
+/**
+ *
+ * @brief Authenticate additional data. Allowed only between B5_EaxAes256_Start and the first B5_EaxAes256_Update.
+ * @param ctx Pointer to the current AES-EAX context.
+ * @param aad Pointer to the additional data.
+ * @param aadLen Bytes to be processed.
+ * @return See \ref eaxaesReturn .
+ */
+int32_t    B5_EaxAes256_Aad (B5_tEaxAes256Ctx *ctx, const uint8_t *aad, int32_t aadLen);
+
+/**
+ *
+ * @brief Encrypt/Decrypt and authenticate data. Any length is accepted.
+ * @param ctx Pointer to the current AES-EAX context.
+ * @param outData Output data, may be the same as inData.
+ * @param inData Input data.
+ * @param dataLen Bytes to be processed.
+ * @return See \ref eaxaesReturn .
+ */
+int32_t    B5_EaxAes256_Update (B5_tEaxAes256Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t dataLen);
+
+/**
+ *
+ * @brief Finish the current message.
+ * @param ctx Pointer to the current AES-EAX context.
+ * @param rTag Pointer to a blank memory area that can store the \ref B5_EAX_AES_TAG_SIZE bytes tag.
+ * @return See \ref eaxaesReturn .
+ */
+int32_t    B5_EaxAes256_Finit (B5_tEaxAes256Ctx *ctx, uint8_t *rTag);
+
 ///@}
 /** @} */
     
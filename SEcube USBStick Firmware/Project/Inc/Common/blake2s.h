@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * File Name          : blake2s.h
+  * Description        : BLAKE2s-256 implementation (RFC 7693)
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \defgroup blake2sReturn BLAKE2s return values
+ * @{
+ */
+/** \name BLAKE2s return values */
+///@{
+#define B5_BLAKE2S_RES_OK                                       ( 0)
+#define B5_BLAKE2S_RES_INVALID_CONTEXT                          (-1)
+#define B5_BLAKE2S_RES_CANNOT_ALLOCATE_CONTEXT                  (-2)
+#define B5_BLAKE2S_RES_INVALID_ARGUMENT                         (-3)
+#define B5_BLAKE2S_RES_INVALID_KEY_SIZE                         (-4)
+///@}
+/** @} */
+
+/** \defgroup blake2sSize BLAKE2s digest, key and block sizes
+ * @{
+ */
+/** \name BLAKE2s digest, key and block sizes */
+///@{
+#define B5_BLAKE2S_DIGEST_SIZE      32
+#define B5_BLAKE2S_MAX_KEY_SIZE     32
+#define B5_BLAKE2S_BLOCK_SIZE       64
+///@}
+/** @} */
+
+/** \defgroup blake2sStr BLAKE2s data structures
+ * @{
+ */
+/** \name BLAKE2s data structures */
+///@{
+typedef struct
+{
+    uint32_t   h[8];          /**< Chained state */
+    uint32_t   t[2];          /**< Byte counter */
+    uint8_t    buffer[64];    /**< Pending block, compressed only when more data follows or at Finit */
+    uint8_t    bufLen;        /**< Bytes in buffer */
+} B5_tBlake2sCtx;
+///@}
+/** @} */
+
+/** \defgroup blake2sFunc BLAKE2s functions
+ * @{
+ */
+/** \name BLAKE2s functions */
+///@{
+
+/**
+ * @brief Initialize the BLAKE2s-256 context.
+ * @param ctx Pointer to the BLAKE2s data structure to be initialized.
+ * @param Key Pointer to the key for keyed hashing, NULL for plain hashing.
+ * @param keySize Key size, 0 for plain hashing or 1 to \ref B5_BLAKE2S_MAX_KEY_SIZE .
+ * @return See \ref blake2sReturn .
+ */
+int32_t B5_Blake2s_Init (B5_tBlake2sCtx *ctx, const uint8_t *Key, int16_t keySize);
+
+/**
+ * @brief Compute the BLAKE2s algorithm on input data depending on the current status of the BLAKE2s context.
+ * @param ctx Pointer to the current BLAKE2s context.
+ * @param data Pointer to the input data.
+ * @param dataLen Bytes to be processed.
+ * @return See \ref blake2sReturn .
+ */
+int32_t B5_Blake2s_Update (B5_tBlake2sCtx *ctx, const uint8_t *data, int32_t dataLen);
+
+/**
+ * @brief De-initialize the current BLAKE2s context.
+ * @param ctx Pointer to the BLAKE2s context to de-initialize.
+ * @param rDigest Pointer to a blank memory area that can store the \ref B5_BLAKE2S_DIGEST_SIZE bytes digest.
+ * @return See \ref blake2sReturn .
+ */
+int32_t B5_Blake2s_Finit (B5_tBlake2sCtx *ctx, uint8_t *rDigest);
+///@}
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
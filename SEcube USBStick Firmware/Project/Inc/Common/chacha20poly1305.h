@@ -0,0 +1,148 @@
+/**
+  ******************************************************************************
+  * File Name          : chacha20poly1305.h
+  * Description        : ChaCha20-Poly1305 AEAD implementation (RFC 8439)
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \defgroup chachaReturn ChaCha20-Poly1305 return values
+ * @{
+ */
+/** \name ChaCha20-Poly1305 return values */
+///@{
+#define B5_CHACHA20_POLY1305_RES_OK                             ( 0)
+#define B5_CHACHA20_POLY1305_RES_INVALID_CONTEXT                (-1)
+#define B5_CHACHA20_POLY1305_RES_CANNOT_ALLOCATE_CONTEXT        (-2)
+#define B5_CHACHA20_POLY1305_RES_INVALID_KEY_SIZE               (-3)
+#define B5_CHACHA20_POLY1305_RES_INVALID_ARGUMENT               (-4)
+#define B5_CHACHA20_POLY1305_RES_INVALID_STATE                  (-5)
+///@}
+/** @} */
+
+/** \defgroup chachaSize ChaCha20-Poly1305 key, nonce, block and tag sizes
+ * @{
+ */
+/** \name ChaCha20-Poly1305 key, nonce, block and tag sizes */
+///@{
+#define B5_CHACHA20_KEY_SIZE            32
+#define B5_CHACHA20_NONCE_SIZE          12
+#define B5_CHACHA20_BLOCK_SIZE          64
+#define B5_POLY1305_TAG_SIZE            16
+///@}
+/** @} */
+
+/** \defgroup chachaModes ChaCha20-Poly1305 modes
+ * @{
+ */
+/** \name ChaCha20-Poly1305 modes */
+///@{
+#define B5_CHACHA20_POLY1305_ENC        1       /**< Authenticated encryption */
+#define B5_CHACHA20_POLY1305_DEC        2       /**< Authenticated decryption */
+///@}
+/** @} */
+
+/** \defgroup chachaStr ChaCha20-Poly1305 data structures
+ * @{
+ */
+/** \name ChaCha20-Poly1305 data structures */
+///@{
+typedef struct
+{
+    uint32_t   input[16];   /**< ChaCha20 state: constants, key, block counter and nonce */
+    uint8_t    ks[64];      /**< Keystream of the last partial block */
+    uint32_t   r[5];        /**< Poly1305 key, 26-bit limbs */
+    uint32_t   h[5];        /**< Poly1305 accumulator, 26-bit limbs */
+    uint32_t   pad[4];      /**< Poly1305 final addend */
+    uint8_t    buffer[16];  /**< Poly1305 partial block */
+    uint8_t    leftover;    /**< Bytes in buffer */
+    uint64_t   aadLen;      /**< AAD bytes of the current message */
+    uint64_t   dataLen;     /**< Data bytes of the current message */
+    uint8_t    mode;        /**< Active mode */
+    uint8_t    state;       /**< Message state */
+} B5_tChaCha20Poly1305Ctx;
+///@}
+/** @} */
+
+/** \defgroup chachaFunc ChaCha20-Poly1305 functions
+ * @{
+ */
+/** \name ChaCha20-Poly1305 functions */
+///@{
+
+/**
+ * @brief Initialize the ChaCha20-Poly1305 context.
+ * @param ctx Pointer to the ChaCha20-Poly1305 data structure to be initialized.
+ * @param Key Pointer to the Key that must be used.
+ * @param keySize Key size, must be \ref B5_CHACHA20_KEY_SIZE.
+ * @param mode See \ref chachaModes .
+ * @return See \ref chachaReturn .
+ */
+int32_t B5_ChaCha20Poly1305_Init (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *Key, int16_t keySize, uint8_t mode);
+
+/**
+ * @brief Start a new message.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param nonce Pointer to the \ref B5_CHACHA20_NONCE_SIZE bytes nonce.
+ * @return See \ref chachaReturn .
+ */
+int32_t B5_ChaCha20Poly1305_Start (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *nonce);
+
+/**
+ * @brief Authenticate additional data. Allowed only between B5_ChaCha20Poly1305_Start and the first B5_ChaCha20Poly1305_Update.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param aad Pointer to the additional data.
+ * @param aadLen Bytes to be processed.
+ * @return See \ref chachaReturn .
+ */
+int32_t B5_ChaCha20Poly1305_Aad (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *aad, int32_t aadLen);
+
+/**
+ * @brief Encrypt/Decrypt and authenticate data. Any length is accepted.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param outData Output data, may be the same as inData.
+ * @param inData Input data.
+ * @param dataLen Bytes to be processed.
+ * @return See \ref chachaReturn .
+ */
+int32_t B5_ChaCha20Poly1305_Update (B5_tChaCha20Poly1305Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t dataLen);
+
+/**
+ * @brief Finish the current message.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param rTag Pointer to a blank memory area that can store the \ref B5_POLY1305_TAG_SIZE bytes tag.
+ * @return See \ref chachaReturn .
+ */
+int32_t B5_ChaCha20Poly1305_Finit (B5_tChaCha20Poly1305Ctx *ctx, uint8_t *rTag);
+///@}
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -87,7 +87,8 @@ enum {
 /** command flags */
 enum {
     SE3_CMDFLAG_ENCRYPT = (1 << 15),  ///< encrypt packet
-    SE3_CMDFLAG_SIGN = (1 << 14) ///< sign payload
+    SE3_CMDFLAG_SIGN = (1 << 14), ///< sign payload
+    SE3_CMDFLAG_LONGPOLL = (1 << 13) ///< hold reads of the response until it is ready
 };
 
 /** Request fields */
@@ -138,6 +139,13 @@ enum {
     SE3_DISCO_OFFSET_STATUS = 3*32
 };
 
+/** Discover status flags */
+enum {
+    SE3_DISCO_STATUS_LOCKED = (1 << 0),  ///< magic initialization prevented
+    SE3_DISCO_STATUS_PIPELINE = (1 << 1),  ///< a second request may be sent before reading the response to the first one
+    SE3_DISCO_STATUS_LONGPOLL = (1 << 2)  ///< SE3_CMDFLAG_LONGPOLL is supported
+};
+
 // required for in-place encryption with AES
 #if (SE3_REQ_MAX_DATA % 16 != 0)
 #error "SE3_REQ_MAX_DATA is not a multiple of 16"
@@ -111,7 +111,9 @@ enum {
 	SE3_CMD1_CRYPTO_UPDATE = 9,
     SE3_CMD1_CRYPTO_LIST = 10,
 	SE3_CMD1_LOGOUT_FORCED = 11,
-	SE3_CMD1_SEKEY = 12 // added for SEKey
+	SE3_CMD1_SEKEY = 12, // added for SEKey
+	SE3_CMD1_CRYPTO_SESSIONS = 13,
+	SE3_CMD1_PERF = 14
 };
 
 /** config operations */
@@ -169,6 +171,20 @@ enum {
  *  @}
  */
 
+/**
+ *  @defgroup KeyPolicy
+ *  @{
+ *  @brief Optional restrictions on the use of a key. The policy is an ui16 that follows the key data
+ *  in a \ref key_edit request (SE3_KEY_OP_ADD) or takes its place (SE3_KEY_OP_ADD_TRNG); when it is
+ *  missing the key has no restrictions.
+ */
+enum {
+    SE3_KEY_POLICY_NO_KEYSTREAM = (1 << 0)	/**< The key cannot be used with SE3_CRYPTO_FLAG_KEYSTREAM. */
+};
+/**
+ *  @}
+ */
+
 /** key_edit fields */
 enum {
     SE3_CMD1_KEY_EDIT_REQ_OFF_OP = 0,
@@ -208,7 +224,13 @@ enum {
 	SE3_ALGO_SHA256 = 1,  ///< SHA256
 	SE3_ALGO_HMACSHA256 = 2,  ///< HMAC-SHA256
 	SE3_ALGO_AES_HMACSHA256 = 3,  ///< AES + HMAC-SHA256
-    SE3_ALGO_MAX = 4
+	SE3_ALGO_AES_GCM = 4,  ///< AES-GCM
+	SE3_ALGO_CHACHA20_POLY1305 = 5,  ///< ChaCha20-Poly1305
+	SE3_ALGO_BLAKE2S = 6,  ///< BLAKE2s-256
+	SE3_ALGO_BLAKE2S_KEYED = 7,  ///< BLAKE2s-256 keyed with a device key
+	SE3_ALGO_AES_CMAC = 8,  ///< AES-CMAC
+	SE3_ALGO_AES_EAX = 9,  ///< AES-CTR + AES-CMAC with one key (EAX)
+    SE3_ALGO_MAX = 10
 };
 /**
  *  @}
@@ -241,7 +263,8 @@ enum {
 	SE3_CRYPTO_FLAG_RESET = (1 << 14),
 	SE3_CRYPTO_FLAG_SETIV = SE3_CRYPTO_FLAG_RESET,
 	SE3_CRYPTO_FLAG_SETNONCE = (1 << 13),
-	SE3_CRYPTO_FLAG_AUTH = (1 << 12)
+	SE3_CRYPTO_FLAG_AUTH = (1 << 12),
+	SE3_CRYPTO_FLAG_KEYSTREAM = (1 << 11)
 };
 
 /** crypto_update maximum buffer sizes */
@@ -272,12 +295,141 @@ enum {
 	SE3_CMD1_CRYPTO_ALGOINFO_KEY_SIZE = 20 // 10 * uint16_t = 20 byte
 };
 
+/** crypto_sessions operations */
+enum {
+	SE3_CRYPTO_SESSIONS_OP_LIST = 1,  ///< list open sessions with their idle time
+	SE3_CRYPTO_SESSIONS_OP_RELEASE = 2,  ///< release the given sessions (all of them if count is 0)
+	SE3_CRYPTO_SESSIONS_OP_RENEW = 3,  ///< renew the lease of the given sessions (all of them if count is 0)
+	SE3_CRYPTO_SESSIONS_OP_SET_TIMEOUT = 4  ///< set the idle timeout in ms (0 disables reclamation)
+};
+
+/** crypto_sessions fields */
+enum {
+	SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_OP = 0,
+	SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_COUNT = 2,
+	SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_SIDS = 4,
+	SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_TIMEOUT = 4,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_REQ_SIZE = 2,
+	SE3_CMD1_CRYPTO_SESSIONS_SET_TIMEOUT_REQ_SIZE = 8,
+	SE3_CMD1_CRYPTO_SESSIONS_RESP_OFF_COUNT = 0,  ///< RELEASE, RENEW: number of sessions affected
+	SE3_CMD1_CRYPTO_SESSIONS_RESP_SIZE = 2,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_TIMEOUT = 0,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_COUNT = 4,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_RECLAIMED = 6,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_BYTES_USED = 8,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_BYTES_INTERNAL = 12,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_BYTES_EXTERNAL = 16,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_PEAK = 20,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_FAILURES = 22,
+	SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_INFO = 24,
+	SE3_CMD1_CRYPTO_SESSIONS_INFO_SIZE = 12,
+	SE3_CMD1_CRYPTO_SESSIONS_INFO_OFF_SID = 0,
+	SE3_CMD1_CRYPTO_SESSIONS_INFO_OFF_ALGO = 4,
+	SE3_CMD1_CRYPTO_SESSIONS_INFO_OFF_IDLE = 8
+};
+
+/** perf operations, GET and RESET can be combined to read and reset the counters at once */
+enum {
+	SE3_PERF_OP_GET = 1 << 0,  ///< return the counter block
+	SE3_PERF_OP_RESET = 1 << 1,  ///< reset the counters, after reading them if GET is set
+	SE3_PERF_OP_TRACE = 1 << 2  ///< drain the event trace ring, cannot be combined with the others
+};
+
+/** perf counter block
+ *
+ *  The block starts with a fixed header followed by n_cmd0 entries for the L0 commands,
+ *  n_cmd1 entries for the L1 commands and n_algo entries for the update of the algorithms,
+ *  each indexed by command code or algorithm id. Since version 2, SE3_PERF_PROTO_MAX entries
+ *  for the protocol blocks follow (see SE3_PERF_PROTO_RECV). Cycles are counted at clock_hz.
+ */
+enum {
+	SE3_PERF_VERSION = 2,
+	SE3_PERF_CMD0_MAX = 8,
+	SE3_PERF_CMD1_MAX = 16,
+	SE3_PERF_PROTO_MAX = 2,
+	SE3_CMD1_PERF_REQ_OFF_OP = 0,
+	SE3_CMD1_PERF_REQ_SIZE = 2,
+	SE3_CMD1_PERF_RESP_OFF_VERSION = 0,
+	SE3_CMD1_PERF_RESP_OFF_N_CMD0 = 2,
+	SE3_CMD1_PERF_RESP_OFF_N_CMD1 = 4,
+	SE3_CMD1_PERF_RESP_OFF_N_ALGO = 6,
+	SE3_CMD1_PERF_RESP_OFF_CLOCK_HZ = 8,
+	SE3_CMD1_PERF_RESP_OFF_ELAPSED = 12,  ///< ms since the last reset
+	SE3_CMD1_PERF_RESP_OFF_BUSY_POLLS = 16,  ///< reads of a response not ready yet
+	SE3_CMD1_PERF_RESP_OFF_HELD_READS = 20,  ///< reads delayed by long-poll
+	SE3_CMD1_PERF_RESP_OFF_BYTES_IN = 24,  ///< protocol bytes written by the host (64 bit)
+	SE3_CMD1_PERF_RESP_OFF_BYTES_OUT = 32,  ///< protocol bytes read by the host (64 bit)
+	SE3_CMD1_PERF_RESP_OFF_FLASH_PROGRAM = 40,
+	SE3_CMD1_PERF_RESP_OFF_FLASH_PROGRAM_BYTES = 44,
+	SE3_CMD1_PERF_RESP_OFF_FLASH_ERASE = 48,
+	SE3_CMD1_PERF_RESP_OFF_FLASH_SWAP = 52,
+	SE3_CMD1_PERF_RESP_OFF_MEM_REFILLS = 56,  ///< free pages taken by a size class of the session allocator
+	SE3_CMD1_PERF_RESP_OFF_MEM_FAILURES = 60,
+	SE3_CMD1_PERF_RESP_OFF_ENTRIES = 64,
+	SE3_CMD1_PERF_ENTRY_OFF_COUNT = 0,
+	SE3_CMD1_PERF_ENTRY_OFF_BYTES = 4,  ///< request bytes for commands, input bytes for algorithms
+	SE3_CMD1_PERF_ENTRY_OFF_CYCLES = 8,  ///< 64 bit
+	SE3_CMD1_PERF_ENTRY_SIZE = 16
+};
+
+/** protocol block entries of the perf counter block: one call per block of the protocol
+ *  file, the cycles spent locating the block and copying it to or from its slot */
+enum {
+	SE3_PERF_PROTO_RECV = 0,  ///< blocks of requests written by the host
+	SE3_PERF_PROTO_SEND = 1  ///< blocks of responses read by the host, the discovery block excluded
+};
+
+/** perf trace block
+ *
+ *  Returned by SE3_PERF_OP_TRACE: a header followed by count entries, oldest first, which
+ *  are removed from the ring. pending entries are left for the next call; lost entries were
+ *  overwritten before being drained. Timestamps are taken by the 32 bit cycle counter at
+ *  clock_hz, now is its value when the block was built.
+ */
+enum {
+	SE3_EVTRACE_VERSION = 1,
+	SE3_EVTRACE_RESP_OFF_VERSION = 0,
+	SE3_EVTRACE_RESP_OFF_ENTRY_SIZE = 2,
+	SE3_EVTRACE_RESP_OFF_COUNT = 4,
+	SE3_EVTRACE_RESP_OFF_PENDING = 6,
+	SE3_EVTRACE_RESP_OFF_CLOCK_HZ = 8,
+	SE3_EVTRACE_RESP_OFF_LOST = 12,
+	SE3_EVTRACE_RESP_OFF_NOW = 16,
+	SE3_EVTRACE_RESP_OFF_ENTRIES = 20,
+	SE3_EVTRACE_ENTRY_OFF_TS = 0,
+	SE3_EVTRACE_ENTRY_OFF_ID = 4,
+	SE3_EVTRACE_ENTRY_OFF_A = 6,
+	SE3_EVTRACE_ENTRY_OFF_B = 8,
+	SE3_EVTRACE_ENTRY_SIZE = 12,
+	SE3_EVTRACE_MAX_ENTRIES = (SE3_RESP1_MAX_DATA - SE3_EVTRACE_RESP_OFF_ENTRIES) / SE3_EVTRACE_ENTRY_SIZE
+};
+
+/** trace event ids, each _END follows its _BEGIN */
+enum {
+	SE3_EVT_CMD0_BEGIN = 1,  ///< a: L0 command, b: request length
+	SE3_EVT_CMD0_END = 2,  ///< a: L0 command, b: response blocks
+	SE3_EVT_CMD1_BEGIN = 3,  ///< a: L1 command, b: request length
+	SE3_EVT_CMD1_END = 4,  ///< a: L1 command, b: status
+	SE3_EVT_CRYPTO_INIT_BEGIN = 5,  ///< a: algorithm, b: mode
+	SE3_EVT_CRYPTO_INIT_END = 6,  ///< a: algorithm, b: status
+	SE3_EVT_CRYPTO_UPDATE_BEGIN = 7,  ///< a: algorithm, b: input bytes
+	SE3_EVT_CRYPTO_UPDATE_END = 8,  ///< a: algorithm, b: status
+	SE3_EVT_FLASH_SWAP_BEGIN = 9,  ///< a: sector, b: bytes used
+	SE3_EVT_FLASH_SWAP_END = 10,  ///< a: success, b: bytes used
+	SE3_EVT_SDIO_READ_BEGIN = 11,  ///< a: blocks, b: first block
+	SE3_EVT_SDIO_READ_END = 12,  ///< a: success, b: first block
+	SE3_EVT_SDIO_WRITE_BEGIN = 13,  ///< a: blocks, b: first block
+	SE3_EVT_SDIO_WRITE_END = 14,  ///< a: success, b: first block
+	SE3_EVT_SDIO_WRITE_DONE = 15  ///< completion of a queued write, a: success
+};
+
 /** crypto_list default cipher types */
 enum {
 	SE3_CRYPTO_TYPE_BLOCKCIPHER = 0,
 	SE3_CRYPTO_TYPE_STREAMCIPHER = 1,
 	SE3_CRYPTO_TYPE_DIGEST = 2,
 	SE3_CRYPTO_TYPE_BLOCKCIPHER_AUTH = 3,
+	SE3_CRYPTO_TYPE_STREAMCIPHER_AUTH = 4,
 	SE3_CRYPTO_TYPE_OTHER = 0xFFFF
 };
 
@@ -295,6 +447,7 @@ enum {
 	SE3_FEEDBACK_OFB = 3,
 	SE3_FEEDBACK_CTR = 4,
 	SE3_FEEDBACK_CFB = 5,
+	SE3_FEEDBACK_GCM = 6,  ///< only for SE3_ALGO_AES_GCM
 	SE3_DIR_ENCRYPT = (1 << SE3_DIR_SHIFT),
 	SE3_DIR_DECRYPT = (2 << SE3_DIR_SHIFT)
 };
@@ -63,7 +63,6 @@ typedef struct
     uint32_t   total[2];
     uint32_t   state[8];
     uint8_t    buffer[64];    
-    uint32_t   W[64];    
 } B5_tSha256Ctx;
 ///@}
 /** @} */
@@ -120,8 +119,8 @@ int32_t B5_Sha256_Finit (B5_tSha256Ctx *ctx, uint8_t *rDigest);
 typedef struct
 {
    B5_tSha256Ctx        shaCtx;
-   uint8_t     		iPad[64];
-   uint8_t     		oPad[64];
+   uint32_t             iState[8];  /**< Hash state after absorbing the inner pad. */
+   uint32_t             oState[8];  /**< Hash state after absorbing the outer pad. */
 } B5_tHmacSha256Ctx;
 ///@}
 /** @} */
@@ -150,6 +149,13 @@ int32_t B5_HmacSha256_Init (B5_tHmacSha256Ctx *ctx, const uint8_t *Key, int16_t
  */
 int32_t B5_HmacSha256_Update (B5_tHmacSha256Ctx *ctx, const uint8_t *data, int32_t dataLen);
 
+/**
+ * @brief Restart the HMAC-SHA256 computation with the key given to B5_HmacSha256_Init.
+ * @param ctx Pointer to an HMAC-SHA256 context initialized with B5_HmacSha256_Init.
+ * @return See \ref hmacshaReturn .
+ */
+int32_t B5_HmacSha256_Reset (B5_tHmacSha256Ctx *ctx);
+
 /**
  * @brief De-initialize the current HMAC-SHA256 context.
  * @param ctx Pointer to the HMAC-SHA256 context to de-initialize.
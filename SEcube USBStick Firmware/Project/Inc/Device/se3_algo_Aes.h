@@ -25,6 +25,12 @@
 #pragma once
 #include "se3_security_core.h"
 
+/** \brief SE3_ALGO_AES session context */
+typedef struct se3_algo_Aes_ctx_ {
+    B5_tAesCtx aes;
+    uint8_t keystream; ///< SE3_CRYPTO_FLAG_KEYSTREAM allowed (CTR mode, key without SE3_KEY_POLICY_NO_KEYSTREAM)
+} se3_algo_Aes_ctx;
+
 /** \brief SE3_ALGO_AES init handler
  *  
  *  Supported modes
@@ -44,15 +50,18 @@ uint16_t se3_algo_Aes_init(
  *  (default): encrypt/decrypt datain2 and update HmacSha256 context with datain2. Not executed
  *    if datain2 is empty (zero-length)
  *  SE3_CRYPTO_FLAG_SETIV: set new IV from datain1
+ *  SE3_CRYPTO_FLAG_KEYSTREAM: CTR mode only, return datain2_len bytes of raw keystream instead of
+ *    encrypting datain2 (which is not sent). Fails with SE3_ERR_ACCESS if the key policy forbids it
  *  SE3_CRYPTO_FLAG_FINIT: release session
  *
  *  Combined operations are executed in the following order:
  *    SE3_CRYPTO_FLAG_SETIV
- *    (default)
+ *    (default) or SE3_CRYPTO_FLAG_KEYSTREAM
  *    SE3_CRYPTO_FLAG_FINIT
  *
  *  Contribution of each operation to the output size:
  *    (default): + datain2_len
+ *    SE3_CRYPTO_FLAG_KEYSTREAM: + datain2_len
  *    Others: + 0
  */
 uint16_t se3_algo_Aes_update(
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_algo_Blake2s.h
+  * Description        : BLAKE2s-256 primitives/crypto handlers
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#pragma once
+#include "se3_security_core.h"
+#include "blake2s.h"
+
+/** \brief SE3_ALGO_BLAKE2S init handler
+ *  
+ *  Key is not used and can be set to SE3_KEY_INVALID
+ *  Mode is not used
+ */
+uint16_t se3_algo_Blake2s_init(se3_flash_key* key, uint16_t mode, uint8_t* ctx);
+
+/** \brief SE3_ALGO_BLAKE2S_KEYED init handler
+ *  
+ *  The key (1 to B5_BLAKE2S_MAX_KEY_SIZE bytes) is absorbed by BLAKE2s itself, no HMAC construction is needed
+ *  Mode is not used
+ */
+uint16_t se3_algo_Blake2sKeyed_init(se3_flash_key* key, uint16_t mode, uint8_t* ctx);
+
+/** \brief SE3_ALGO_BLAKE2S and SE3_ALGO_BLAKE2S_KEYED update handler
+ *  
+ *  Supported operations
+ *  (default): update Blake2s context with datain1
+ *  SE3_CRYPTO_FLAG_FINIT: produce digest (or authentication tag) in dataout and release session
+ *
+ *  Contribution of each operation to the output size:
+ *    (default): + 0
+ *    SE3_CRYPTO_FLAG_FINIT: + B5_BLAKE2S_DIGEST_SIZE
+ */
+uint16_t se3_algo_Blake2s_update(
+	uint8_t* ctx, uint16_t flags,
+	uint16_t datain1_len, const uint8_t* datain1,
+	uint16_t datain2_len, const uint8_t* datain2,
+	uint16_t* dataout_len, uint8_t* dataout);
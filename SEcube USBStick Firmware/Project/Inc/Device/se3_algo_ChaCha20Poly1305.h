@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_algo_ChaCha20Poly1305.h
+  * Description        : ChaCha20-Poly1305 crypto handlers
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/**
+ *  \file se3_algo_ChaCha20Poly1305.h
+ *  \brief SE3_ALGO_CHACHA20_POLY1305 crypto handlers
+ */
+
+#pragma once
+#include "se3_security_core.h"
+#include "chacha20poly1305.h"
+
+/** \brief SE3_ALGO_CHACHA20_POLY1305 init handler
+ *  
+ *  Supported modes
+ *  One of {SE3_DIR_ENCRYPT, SE3_DIR_DECRYPT}, the feedback bits are ignored
+ *  
+ *  Supported key sizes
+ *  256-bit
+ */
+uint16_t se3_algo_ChaCha20Poly1305_init(
+    se3_flash_key* key, uint16_t mode, uint8_t* ctx);
+
+/** \brief SE3_ALGO_CHACHA20_POLY1305 update handler
+ *
+ *  Supported operations
+ *  SE3_CRYPTO_FLAG_RESET: start a new message. The first B5_CHACHA20_NONCE_SIZE bytes of datain1
+ *    are the nonce, the rest is additional authenticated data.
+ *  (default): authenticate datain1 as additional data, then encrypt/decrypt and authenticate
+ *    datain2. Data of any length is accepted and a message can span any number of calls, but
+ *    additional data is refused once datain2 has been processed.
+ *  SE3_CRYPTO_FLAG_AUTH: end the message and append the tag to dataout. On decryption the
+ *    tag must be compared by the caller with the one received.
+ *  SE3_CRYPTO_FLAG_FINIT: release session
+ *
+ *  Combined operations are executed in the following order:
+ *    SE3_CRYPTO_FLAG_RESET
+ *    (default)
+ *    SE3_CRYPTO_FLAG_AUTH
+ *    SE3_CRYPTO_FLAG_FINIT
+ *  
+ *  Contribution of each operation to the output size:
+ *    (default): + datain2_len
+ *    SE3_CRYPTO_FLAG_AUTH: + B5_POLY1305_TAG_SIZE
+ *    Others: + 0
+ */
+uint16_t se3_algo_ChaCha20Poly1305_update(
+    uint8_t* ctx, uint16_t flags,
+    uint16_t datain1_len, const uint8_t* datain1,
+    uint16_t datain2_len, const uint8_t* datain2,
+    uint16_t* dataout_len, uint8_t* dataout);
@@ -30,9 +30,57 @@
 #define SE3_BMAP_MAKE(n) ((uint32_t)(0xFFFFFFFF >> (32 - (n))))
 
 
+/** \brief response header to be encoded */
+typedef struct se3_comm_resp_header_ {
+    uint16_t ready;
+    uint16_t status;
+    uint16_t len;
+#if SE3_CONF_CRC
+    uint16_t crc;
+#endif
+    uint32_t cmdtok[SE3_COMM_N - 1];
+} se3_comm_resp_header;
+
+enum {
+    SE3_COMM_SLOTS = 2,  ///< number of request/response slots
+    SE3_COMM_TABLE = 64,  ///< size of the block lookup table (power of 2, larger than SE3_COMM_N)
+    SE3_COMM_HOLD_TIME = 500  ///< maximum time a long-poll read of a response is held (ms)
+};
+
+/** request/response slot states */
+enum {
+    SE3_COMM_SLOT_FREE = 0,  ///< unused, or response already read
+    SE3_COMM_SLOT_RECEIVING = 1,  ///< request blocks being received
+    SE3_COMM_SLOT_READY = 2,  ///< request complete, waiting to be executed
+    SE3_COMM_SLOT_EXEC = 3,  ///< request being executed
+    SE3_COMM_SLOT_DONE = 4  ///< response ready to be read
+};
+
+/** \brief request/response slot
+ *
+ *  The host may send a request while the previous one is executing. Each request is
+ *  received into a slot, tagged with the cmdtoken of its first block, and the slot holds
+ *  the response until the host has read it. Responses are served in order of arrival.
+ *  The state is written both from the USB handlers and from the device loop, so it must
+ *  be volatile.
+ */
+typedef struct se3_comm_slot_ {
+    volatile uint8_t state;  ///< SE3_COMM_SLOT_* state
+    uint32_t seq;  ///< arrival order of the request
+    uint32_t req_bmap;  ///< map of request blocks still to be received
+    uint32_t resp_bmap;  ///< map of valid response blocks
+    uint16_t resp_blocks;  ///< number of response blocks
+    bool served;  ///< the first response block has been read
+    bool longpoll;  ///< reads of the response are held until it is ready
+    se3_comm_req_header req;  ///< decoded request header
+    se3_comm_resp_header resp;  ///< response header to be encoded
+    uint8_t* req_buf;  ///< request buffer (header followed by data)
+    uint8_t* resp_buf;  ///< response buffer (header followed by data)
+} se3_comm_slot;
+
 /** \brief structure holding host-device communication status and buffers
  *
- *  req_ready and resp_ready must be volatile, otherwise -O3 optimization will not work.
+ *  The request and response pointers refer to the slot being executed.
  */
 typedef struct SE3_COMM_STATUS_ {
     // magic
@@ -41,34 +89,29 @@ typedef struct SE3_COMM_STATUS_ {
 
     // block map
     uint32_t blocks[SE3_COMM_N];  ///< map of blocks
-    uint32_t block_guess;  ///< guess for next block that will be accessed
+    int8_t block_table[SE3_COMM_TABLE];  ///< index in blocks by block number (open addressing), -1 if empty
+    uint32_t block_min;  ///< lowest block of the special protocol file
+    uint32_t block_max;  ///< highest block of the special protocol file
     bool locked;  ///< prevent magic initialization
 
+    // slots
+    se3_comm_slot slots[SE3_COMM_SLOTS];  ///< request/response slots
+    se3_comm_slot* recv;  ///< slot which received the last request header
+    se3_comm_slot* exec;  ///< slot being executed
+    uint32_t seq;  ///< arrival counter of requests
+    bool holding;  ///< a read of the response is being held
+    uint32_t hold_start;  ///< time at which the held read started
+
     // request
-    volatile bool req_ready;  ///< request ready flag
-    uint32_t req_bmap;  ///< map of received request blocks
     uint8_t* req_data;  ///< received data buffer
     uint8_t* req_hdr;   ///< received header buffer
 
     // response
-    volatile bool resp_ready;  ///< response ready flag
-    uint32_t resp_bmap;  ///< map of sent response blocks
+    uint32_t resp_bmap;  ///< map of response blocks produced by the current command
     uint8_t* resp_data;  ///< buffer for data to be sent
     uint8_t* resp_hdr;  ///< buffer for header to be sent
 } SE3_COMM_STATUS;
 
-
-/** \brief response header to be encoded */
-typedef struct se3_comm_resp_header_ {
-    uint16_t ready;
-    uint16_t status;
-    uint16_t len;
-#if SE3_CONF_CRC
-    uint16_t crc;
-#endif
-    uint32_t cmdtok[SE3_COMM_N - 1];
-} se3_comm_resp_header;
-
 /** USB data handlers return values */
 enum {
 	SE3_PROTO_OK = 0,  ///< Report OK to the USB HAL
@@ -86,6 +129,20 @@ extern const uint8_t se3_hello[SE3_HELLO_SIZE];
 /**\brief Initializes the communication core structures */
 void se3_communication_core_init();
 
+/** \brief Select the next request to be executed
+ *
+ *  Take the oldest fully received request, make it the current one (comm, req_hdr
+ *  and resp_hdr refer to it) and mark it as executing.
+ *  \return true if a request is ready, false otherwise
+ */
+bool se3_proto_request_next();
+
+/** \brief Publish the response of the current request
+ *
+ *  The response built in comm and resp_hdr becomes readable by the host.
+ */
+void se3_proto_response_done();
+
 
 /** \brief USB data receive handler
  *  
@@ -99,8 +156,35 @@ int32_t se3_proto_recv(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint1
  *   
  *  SEcube API requests are filtered and data is sent from the response buffer
  *  Other requests are passed to the SDIO interface.
+ *  If the request was sent with SE3_CMDFLAG_LONGPOLL, a read of the first response block
+ *  returns SE3_PROTO_BUSY until the response is ready or SE3_COMM_HOLD_TIME expires; the
+ *  USB handler then retries the read from the main loop.
  */
 int32_t se3_proto_send(uint8_t lun, uint8_t* buf, uint32_t blk_addr, uint16_t blk_len);
 
+/** \brief Vendor command receive handler
+ *
+ *  Store blocks of a request sent with the SCSI_SE3_CMD_OUT vendor command. The blocks
+ *  are addressed by their index in the special protocol file, so that the magic file
+ *  and the SD card are not involved.
+ *  \param buf request blocks
+ *  \param index index of the first block, the discover block cannot be written
+ *  \param blk_len number of blocks
+ *  \return SE3_PROTO_FAIL if the blocks are out of the protocol file, SE3_PROTO_OK otherwise
+ */
+int32_t se3_proto_vendor_recv(const uint8_t* buf, uint32_t index, uint16_t blk_len);
+
+/** \brief Vendor command send handler
+ *
+ *  Output blocks of the response for the SCSI_SE3_RESP_IN vendor command, addressed as
+ *  in se3_proto_vendor_recv(). A read starting at the first response block is held like
+ *  in se3_proto_send().
+ *  \param buf response blocks
+ *  \param index index of the first block, SE3_COMM_N - 1 is the discover block
+ *  \param blk_len number of blocks
+ *  \return SE3_PROTO_OK, SE3_PROTO_BUSY or SE3_PROTO_FAIL
+ */
+int32_t se3_proto_vendor_send(uint8_t* buf, uint32_t index, uint16_t blk_len);
+
 
 
@@ -31,6 +31,8 @@
 #include "se3_common.h"
 #include "se3_rand.h"
 #include "se3_sekey.h"
+#include "se3_perf.h"
+#include "se3_evtrace.h"
 
 #define SE3_CMD1_MAX 	16
 #define SE3_N_HARDWARE 	3
@@ -123,8 +125,8 @@ static se3_cmd_func handlers[SE3_N_HARDWARE][SE3_CMD1_MAX] = {{
     /* 10 */ crypto_list,
     /* 11 */ NULL, // forced logout
     /* 12 */ sekey_utilities,
-    /* 13 */ NULL,
-    /* 14 */ NULL,
+    /* 13 */ crypto_sessions,
+    /* 14 */ perf,
     /* 15 */ error
 	/* Each number identifies a command sent by the host-side. This must be consistent with
 	 * L1_enumeration.h on the host-side. Check out L1Commands::Codes in L1_enumeration.h. */
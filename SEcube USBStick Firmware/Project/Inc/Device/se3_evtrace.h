@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_evtrace.h
+  * Description        : Event trace ring
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#pragma once
+
+#include "se3c0def.h"
+#include "se3c1def.h"
+#include "se3_perf.h"
+
+/** \brief Enable the event trace ring
+ *
+ *  When 0, se3_evt does nothing and the ring is always empty.
+ */
+#ifndef SE3_CONF_EVTRACE
+#define SE3_CONF_EVTRACE 1
+#endif
+
+/** Entries of the ring, a power of 2 */
+#define SE3_EVTRACE_SIZE (512)
+
+/** \brief event trace entry, see the trace block in se3c1def.h */
+typedef struct se3_evtrace_entry_ {
+	uint32_t ts;  ///< se3_perf_cycles at the event
+	uint16_t id;  ///< SE3_EVT_ event id
+	uint16_t a;
+	uint32_t b;
+} se3_evtrace_entry;
+
+/** \brief event trace ring
+ *
+ *  head counts the events written since boot, tail the events drained; when the writer
+ *  laps the reader the oldest entries are overwritten and counted as lost by the next drain.
+ */
+typedef struct se3_evtrace_ring_ {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t lost;
+	se3_evtrace_entry entries[SE3_EVTRACE_SIZE];
+} se3_evtrace_ring;
+
+extern se3_evtrace_ring se3_evtrace;
+
+/** \brief Record an event
+ *
+ *  Called from the command path, the crypto core, the flash and the SD card driver, some of
+ *  which run in interrupt context: interrupts are masked while the entry is written. Under
+ *  CUBESIM the firmware runs on a single thread.
+ */
+static inline void se3_evt(uint16_t id, uint16_t a, uint32_t b)
+{
+#if SE3_CONF_EVTRACE
+	se3_evtrace_entry* e;
+#ifndef CUBESIM
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+#endif
+	e = &(se3_evtrace.entries[se3_evtrace.head & (SE3_EVTRACE_SIZE - 1)]);
+	e->ts = se3_perf_cycles();
+	e->id = id;
+	e->a = a;
+	e->b = b;
+	(se3_evtrace.head)++;
+#ifndef CUBESIM
+	__set_PRIMASK(primask);
+#endif
+#endif
+}
+
+/** \brief Copy the oldest events to buf and remove them from the ring
+ *  \param buf destination, in the trace entry format of se3c1def.h
+ *  \param max maximum number of entries to copy
+ *  \param pending entries left in the ring
+ *  \param lost entries overwritten before being drained, since the previous call
+ *  \return number of entries copied
+ */
+uint16_t se3_evtrace_drain(uint8_t* buf, uint16_t max, uint16_t* pending, uint32_t* lost);
@@ -33,6 +33,8 @@
 #define SE3_FLASH_S0_ADDR  ((uint32_t)0x080C0000)
 #define SE3_FLASH_S1_ADDR  ((uint32_t)0x080E0000)
 #define SE3_FLASH_SECTOR_SIZE (128*1024)
+#else
+#include "se3c0def.h"
 #endif
 
 /*
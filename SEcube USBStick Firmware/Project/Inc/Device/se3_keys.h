@@ -37,11 +37,13 @@
  *  0:3     id
  *  4:5     data_size
  *  6:(6+data_size-1) data
+ *  (6+data_size):(6+data_size+1) policy, only stored if not zero
  */
 typedef struct se3_flash_key_ {
 	uint32_t id;
 	uint16_t data_size;
 	uint8_t* data;
+	uint16_t policy; ///< see \ref KeyPolicy
 } se3_flash_key;
 
 /** Flash key fields */
@@ -23,7 +23,33 @@
   */
 
 #pragma once
-#include "se3c0def.h"
+#include "se3c1def.h"
+
+enum {
+	SE3_MEM_PAGE = 2048,  ///< slab page size, each page serves a single size class
+	SE3_MEM_PAGES_MAX = 32,  ///< maximum number of slab pages
+	SE3_MEM_CLASS_MAX = SE3_ALGO_MAX,  ///< maximum number of size classes, one for each algorithm at most
+	SE3_MEM_INDEX_MAX = 128,  ///< maximum number of entries in index
+	SE3_MEM_ALIGN = 16,  ///< entry alignment, the session buffer is declared SE3_ALIGN_16
+	SE3_MEM_NONE = 0xFF  ///< invalid page/class
+};
+
+/** \brief slab page descriptor */
+typedef struct se3_mem_page_ {
+	uint8_t cls;  ///< size class served by this page, SE3_MEM_NONE if the page is free
+	uint8_t next;  ///< next page in the class (or free page) list
+	uint8_t prev;  ///< previous page in the class list
+	uint8_t used;  ///< number of slots in use
+	uint8_t bump;  ///< number of slots ever handed out since the page was assigned
+	uint8_t free;  ///< head of the freed slot list, SE3_MEM_NONE if empty
+} se3_mem_page;
+
+/** \brief size class descriptor */
+typedef struct se3_mem_class_ {
+	uint16_t size;  ///< slot size (bytes)
+	uint8_t slots;  ///< number of slots per page
+	uint8_t partial;  ///< first page of this class with at least one free slot
+} se3_mem_class;
 
 /** \brief memory allocator structure */
 typedef struct se3_mem_ {
@@ -32,12 +58,32 @@ typedef struct se3_mem_ {
 	uint8_t* dat;
 	size_t dat_size;
 	size_t used;
+	se3_mem_page pages[SE3_MEM_PAGES_MAX];
+	uint8_t npages;
+	uint8_t free_pages;
+	se3_mem_class classes[SE3_MEM_CLASS_MAX];
+	uint8_t nclasses;
+	uint16_t ids[SE3_MEM_INDEX_MAX];  ///< stack of unused entry ids
+	uint16_t nids;
+	uint16_t requested[SE3_MEM_INDEX_MAX];  ///< size requested by each live entry
+	uint32_t allocs;
+	uint32_t failures;
+	uint16_t peak;
 } se3_mem;
 
-enum {
-	SE3_MEM_HEADER = 4,  ///< entry header size
-	SE3_MEM_BLOCK = 32  ///< memory alignment
-};
+/** \brief memory allocator statistics */
+typedef struct se3_mem_stats_ {
+	uint32_t allocs;  ///< successful allocations since last reset
+	uint32_t failures;  ///< failed allocations since last reset
+	uint16_t entries;  ///< live entries
+	uint16_t entries_peak;  ///< maximum number of live entries since last reset
+	uint16_t pages;  ///< total number of pages
+	uint16_t pages_free;  ///< pages not assigned to any size class
+	uint32_t bytes_requested;  ///< bytes requested by live entries
+	uint32_t bytes_used;  ///< bytes of slots held by live entries
+	uint32_t bytes_internal;  ///< slot bytes wasted by rounding up to the size class
+	uint32_t bytes_external;  ///< free slot bytes stranded in pages assigned to a size class
+} se3_mem_stats;
 
 /** \brief initialize memory allocator
  *  \param mem memory buffer object
@@ -45,13 +91,26 @@ enum {
  *  \param index pointer to the index buffer (array[index_size] of pointers)
  *  \param buf_size number of bytes in data buffer
  *  \param buf pointer to data buffer
+ *
+ *  No size class is defined after initialization, see se3_mem_add_class.
  */
 void se3_mem_init(se3_mem* mem, size_t index_size, uint8_t** index, size_t buf_size, uint8_t* buf);
 
+/** \brief register a size class
+ *
+ *  Classes are kept sorted, registering an existing size has no effect.
+ *  \param mem memory buffer object
+ *  \param size size of the objects served by the class
+ *  \return true on success; false if the class table is full or size exceeds SE3_MEM_PAGE
+ */
+bool se3_mem_add_class(se3_mem* mem, size_t size);
+
 /** \brief allocate one entry
  *
+ *  The entry is taken from the smallest size class that fits, in constant time.
  *  \param mem memory buffer object
  *  \param size allocation size
+ *  \return entry id, or -1 on failure
  */
 int32_t se3_mem_alloc(se3_mem* mem, size_t size);
 
@@ -74,3 +133,10 @@ void se3_mem_free(se3_mem* mem, int32_t id);
 *  \param mem memory buffer object
 */
 void se3_mem_reset(se3_mem* mem);
+
+/** \brief get usage and fragmentation statistics
+ *
+ *  \param mem memory buffer object
+ *  \param stats output statistics
+ */
+void se3_mem_stats_get(se3_mem* mem, se3_mem_stats* stats);
@@ -0,0 +1,103 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_perf.h
+  * Description        : Performance counters
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#pragma once
+
+#include "se3c0def.h"
+#include "se3c1def.h"
+#ifndef CUBESIM
+#include "stm32f4xx_hal.h"
+#else
+#include <time.h>
+#endif
+
+/** \brief time and count spent on a command or on an algorithm */
+typedef struct se3_perf_entry_ {
+	uint32_t count;  ///< number of calls
+	uint32_t bytes;  ///< request bytes for commands, input bytes for algorithms
+	uint64_t cycles;  ///< cycles spent, at SE3_PERF_CLOCK_HZ
+} se3_perf_entry;
+
+/** \brief performance counters, see the perf counter block in se3c1def.h */
+typedef struct se3_perf_counters_ {
+	uint32_t reset_tick;  ///< ms clock at the last reset
+	uint32_t busy_polls;
+	uint32_t held_reads;
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	uint32_t flash_program;
+	uint32_t flash_program_bytes;
+	uint32_t flash_erase;
+	uint32_t flash_swap;
+	uint32_t mem_refills;
+	uint32_t mem_failures;
+	se3_perf_entry cmd0[SE3_PERF_CMD0_MAX];
+	se3_perf_entry cmd1[SE3_PERF_CMD1_MAX];
+	se3_perf_entry algo[SE3_ALGO_MAX];
+	se3_perf_entry proto[SE3_PERF_PROTO_MAX];
+} se3_perf_counters;
+
+extern se3_perf_counters se3_perf;
+
+/** \brief Cycle counter
+ *
+ *  The DWT cycle counter of the core, which wraps every 2^32 cycles (about 24 s at 180 MHz),
+ *  so only intervals shorter than that are measured correctly. Under CUBESIM the monotonic
+ *  clock in ns is used instead.
+ */
+#ifdef CUBESIM
+#define SE3_PERF_CLOCK_HZ (1000000000U)
+static inline uint32_t se3_perf_cycles()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec);
+}
+#else
+#define SE3_PERF_CLOCK_HZ (SystemCoreClock)
+static inline uint32_t se3_perf_cycles()
+{
+	return DWT->CYCCNT;
+}
+#endif
+
+/** \brief Account a call started at cycle start to entry e */
+static inline void se3_perf_add(se3_perf_entry* e, uint32_t start, uint32_t bytes)
+{
+	(e->count)++;
+	e->bytes += bytes;
+	e->cycles += (uint32_t)(se3_perf_cycles() - start);
+}
+
+/** \brief Start the cycle counter and reset the counters */
+void se3_perf_init();
+
+/** \brief Reset the counters */
+void se3_perf_reset();
+
+/** \brief PERF command handler
+ *
+ *  Return the counter block and/or reset the counters, or drain the event trace ring
+ */
+uint16_t perf(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, uint8_t* resp);
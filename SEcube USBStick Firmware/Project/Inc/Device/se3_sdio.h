@@ -32,9 +32,23 @@
 #define MEM_OP_OK (0)
 #define STORAGE_LUN_NBR (1)
 #define STORAGE_BLK_SIZ (512)
+#define SE3_SDIO_WB_BLOCKS (16)  ///< blocks in each of the two write-behind buffers
+#define SE3_SDIO_RA_BLOCKS (16)  ///< blocks in the read-ahead window
+#define SE3_SDIO_IDLE_FLUSH (10)  ///< ms without writes after which the queue is flushed when idle
 
 bool secube_sdio_read(uint8_t lun, uint8_t* buf, uint32_t blk_addr, uint16_t blk_len);
 bool secube_sdio_write(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint16_t blk_len);
 bool secube_sdio_capacity(uint32_t *block_num, uint16_t *block_size);
 bool secube_sdio_isready(void);
 
+/** \brief Wait for the queued writes to reach the SD card
+ *  \return false if any queued write failed since the last flush
+ */
+bool secube_sdio_flush(void);
+
+/** \brief Flush the queued writes if no write was received for a while
+ *
+ *  To be called from the main loop. USB interrupts are masked while the queue is flushed.
+ */
+void secube_sdio_idle(void);
+
@@ -41,6 +41,16 @@ enum {
 	SE3_SESSIONS_MAX = 100  ///< maximum number of sessions
 };
 
+enum {
+	SE3_SESSIONS_TIMEOUT_DEFAULT = (10*60*1000),  ///< idle time (ms) after which a session is reclaimed
+	SE3_SESSIONS_EXPIRE_PERIOD = 1000  ///< interval (ms) between two scans for idle sessions
+};
+
+enum {
+	SE3_KEY_CACHE_ENTRIES = 4,  ///< number of initialized crypto contexts kept by the key cache
+	SE3_KEY_CACHE_DATA = 1024  ///< maximum size of a crypto context kept by the key cache
+};
+
 extern enum {
 	SE3_AES256,
 	SE3_CRC16,
@@ -71,6 +81,10 @@ typedef struct SE3_SECURITY_INFO_ {
     SE3_RECORD_INFO records[SE3_RECORD_MAX];
     se3_mem sessions;
     uint16_t sessions_algo[SE3_SESSIONS_MAX];
+    uint32_t sessions_tick[SE3_SESSIONS_MAX];  ///< last use of each session (ms)
+    uint32_t sessions_timeout;  ///< idle timeout (ms), 0 if sessions never expire
+    uint32_t sessions_expire_tick;  ///< last scan for idle sessions (ms)
+    uint16_t sessions_reclaimed;  ///< sessions reclaimed because idle since last login
 } SE3_SECURITY_INFO;
 
 /** \brief crypto_init function type */
@@ -89,7 +103,7 @@ typedef struct se3_algo_descriptor_ {
 	se3_crypto_init_handler init;  ///< crypto_init function
 	se3_crypto_update_handler update;  ///< crypto_update function
 	uint16_t size;  ///< context size size
-	char display_name[16];  ///< name for the algorithm list API
+	char display_name[16];  ///< name for the algorithm list API, NUL-terminated (15 characters at most)
 	uint16_t display_type;  ///< type for the algorithm list API
 	uint16_t display_block_size;  ///< block size for the algorithm list API
 	uint16_t display_key_size[SE3_CMD1_CRYPTO_ALGOINFO_KEY_NUM];  /**< Supported key size. Up to 10 different sizes preallocated. */
@@ -99,7 +113,6 @@ typedef struct se3_payload_cryptoctx_ {
 	B5_tAesCtx aesenc;
     B5_tAesCtx aesdec;
 	B5_tHmacSha256Ctx hmac;
-	uint8_t hmac_key[B5_AES_256];
     uint8_t auth[B5_SHA256_DIGEST_SIZE];
 } se3_payload_cryptoctx;
 
@@ -139,6 +152,33 @@ uint16_t crypto_update(uint16_t req_size, const uint8_t* req, uint16_t* resp_siz
 /** @brief Get list of available algorithms, with additional details. */
 uint16_t crypto_list(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, uint8_t* resp);
 
+/** \brief CRYPTO_SESSIONS handler
+ *
+ *  List, release and renew crypto sessions, or set their idle timeout
+ */
+uint16_t crypto_sessions(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, uint8_t* resp);
+
+/** \brief Reclaim idle sessions
+ *
+ *  Free every session which has not been used for longer than the idle timeout.
+ *  Called from the device loop between commands; scans at most once every
+ *  SE3_SESSIONS_EXPIRE_PERIOD ms.
+ */
+void se3_sessions_expire();
+
+/** \brief Invalidate the key cache for a key
+ *
+ *  Drop every cached crypto context derived from the key with the given ID.
+ *  Must be called whenever that key is added, replaced or deleted.
+ */
+void se3_key_cache_invalidate(uint32_t key_id);
+
+/** \brief Invalidate the whole key cache
+ *
+ *  Drop and wipe every cached crypto context.
+ */
+void se3_key_cache_reset();
+
 /** \brief Security Core initialization
  *
  *  Inizialitazion of Security Core data structures
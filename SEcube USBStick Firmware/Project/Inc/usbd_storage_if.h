@@ -99,6 +99,7 @@
   */ 
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+void STORAGE_Poll_HS(void);
 /* USER CODE END  EXPORTED_FUNCTIONS */
 /**
   * @}
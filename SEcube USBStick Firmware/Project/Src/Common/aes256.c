@@ -25,6 +25,8 @@
 
 #include "aes256.h"
 
+#define B5_AES_PIPELINE 4 /**< Blocks whose keystream is generated per batch in CTR mode. */
+
 const uint32_t B5Te0_S[256] = {
     0xc66363a5, 0xf87c7c84, 0xee777799, 0xf67b7b8d,
     0xfff2f20d, 0xd66b6bbd, 0xde6f6fb1, 0x91c5c554,
@@ -762,10 +764,10 @@ static uint8_t B5_rijndaelKeySetupEnc (B5_tAesCtx *ctx, uint32_t *rk, const uint
         for (;;) 
         {
             temp  = rk[3];
-            memcpy(&ut0, &ctx->Te4[(temp >> 16) & 0xff], sizeof(uint32_t));
-            memcpy(&ut1, &ctx->Te4[(temp >>  8) & 0xff], sizeof(uint32_t));
-            memcpy(&ut2, &ctx->Te4[(temp      ) & 0xff], sizeof(uint32_t));
-            memcpy(&ut3, &ctx->Te4[(temp >> 24)       ], sizeof(uint32_t));
+            memcpy(&ut0, &B5Te4_S[(temp >> 16) & 0xff], sizeof(uint32_t));
+            memcpy(&ut1, &B5Te4_S[(temp >>  8) & 0xff], sizeof(uint32_t));
+            memcpy(&ut2, &B5Te4_S[(temp      ) & 0xff], sizeof(uint32_t));
+            memcpy(&ut3, &B5Te4_S[(temp >> 24)       ], sizeof(uint32_t));
             memcpy(&ut4, &B5_rcon[i], sizeof(uint32_t));
             
             rk[4] = rk[0] ^
@@ -792,10 +794,10 @@ static uint8_t B5_rijndaelKeySetupEnc (B5_tAesCtx *ctx, uint32_t *rk, const uint
         for (;;) 
         {
             temp = rk[5];
-            memcpy(&ut0, &ctx->Te4[(temp >> 16) & 0xff], sizeof(uint32_t));
-            memcpy(&ut1, &ctx->Te4[(temp >>  8) & 0xff], sizeof(uint32_t));
-            memcpy(&ut2, &ctx->Te4[(temp      ) & 0xff], sizeof(uint32_t));
-            memcpy(&ut3, &ctx->Te4[(temp >> 24)       ], sizeof(uint32_t));
+            memcpy(&ut0, &B5Te4_S[(temp >> 16) & 0xff], sizeof(uint32_t));
+            memcpy(&ut1, &B5Te4_S[(temp >>  8) & 0xff], sizeof(uint32_t));
+            memcpy(&ut2, &B5Te4_S[(temp      ) & 0xff], sizeof(uint32_t));
+            memcpy(&ut3, &B5Te4_S[(temp >> 24)       ], sizeof(uint32_t));
             memcpy(&ut4, &B5_rcon[i], sizeof(uint32_t));
             
             rk[ 6] = rk[ 0] ^
@@ -824,10 +826,10 @@ static uint8_t B5_rijndaelKeySetupEnc (B5_tAesCtx *ctx, uint32_t *rk, const uint
         for (;;) 
         {
             temp = rk[ 7];
-            memcpy(&ut0, &ctx->Te4[(temp >> 16) & 0xff], sizeof(uint32_t));
-            memcpy(&ut1, &ctx->Te4[(temp >>  8) & 0xff], sizeof(uint32_t));
-            memcpy(&ut2, &ctx->Te4[(temp      ) & 0xff], sizeof(uint32_t));
-            memcpy(&ut3, &ctx->Te4[(temp >> 24)       ], sizeof(uint32_t));
+            memcpy(&ut0, &B5Te4_S[(temp >> 16) & 0xff], sizeof(uint32_t));
+            memcpy(&ut1, &B5Te4_S[(temp >>  8) & 0xff], sizeof(uint32_t));
+            memcpy(&ut2, &B5Te4_S[(temp      ) & 0xff], sizeof(uint32_t));
+            memcpy(&ut3, &B5Te4_S[(temp >> 24)       ], sizeof(uint32_t));
             memcpy(&ut4, &B5_rcon[i], sizeof(uint32_t));
             
             rk[ 8] = rk[ 0] ^
@@ -843,10 +845,10 @@ static uint8_t B5_rijndaelKeySetupEnc (B5_tAesCtx *ctx, uint32_t *rk, const uint
             
             if (++i == 7) return 14;
             temp = rk[11];
-            memcpy(&ut0, &ctx->Te4[(temp >> 24)       ], sizeof(uint32_t));
-            memcpy(&ut1, &ctx->Te4[(temp >> 16) & 0xff], sizeof(uint32_t));
-            memcpy(&ut2, &ctx->Te4[(temp >>  8) & 0xff], sizeof(uint32_t));
-            memcpy(&ut3, &ctx->Te4[(temp      ) & 0xff], sizeof(uint32_t));
+            memcpy(&ut0, &B5Te4_S[(temp >> 24)       ], sizeof(uint32_t));
+            memcpy(&ut1, &B5Te4_S[(temp >> 16) & 0xff], sizeof(uint32_t));
+            memcpy(&ut2, &B5Te4_S[(temp >>  8) & 0xff], sizeof(uint32_t));
+            memcpy(&ut3, &B5Te4_S[(temp      ) & 0xff], sizeof(uint32_t));
             
             rk[ 12] = rk[ 4] ^
                     (ut0 & 0xff000000) ^
@@ -890,25 +892,25 @@ static uint8_t B5_rijndaelKeySetupDec (B5_tAesCtx *ctx, uint32_t *rk, const uint
     for (i = 1; i < Nr; i++) {
         rk += 4;
         rk[0] =
-                ctx->Td0[ctx->Te4[(rk[0] >> 24)       ] & 0xff] ^
-                ctx->Td1[ctx->Te4[(rk[0] >> 16) & 0xff] & 0xff] ^
-                ctx->Td2[ctx->Te4[(rk[0] >>  8) & 0xff] & 0xff] ^
-                ctx->Td3[ctx->Te4[(rk[0]      ) & 0xff] & 0xff];
+                B5Td0_S[B5Te4_S[(rk[0] >> 24)       ] & 0xff] ^
+                B5Td1_S[B5Te4_S[(rk[0] >> 16) & 0xff] & 0xff] ^
+                B5Td2_S[B5Te4_S[(rk[0] >>  8) & 0xff] & 0xff] ^
+                B5Td3_S[B5Te4_S[(rk[0]      ) & 0xff] & 0xff];
         rk[1] =
-                ctx->Td0[ctx->Te4[(rk[1] >> 24)       ] & 0xff] ^
-                ctx->Td1[ctx->Te4[(rk[1] >> 16) & 0xff] & 0xff] ^
-                ctx->Td2[ctx->Te4[(rk[1] >>  8) & 0xff] & 0xff] ^
-                ctx->Td3[ctx->Te4[(rk[1]      ) & 0xff] & 0xff];
+                B5Td0_S[B5Te4_S[(rk[1] >> 24)       ] & 0xff] ^
+                B5Td1_S[B5Te4_S[(rk[1] >> 16) & 0xff] & 0xff] ^
+                B5Td2_S[B5Te4_S[(rk[1] >>  8) & 0xff] & 0xff] ^
+                B5Td3_S[B5Te4_S[(rk[1]      ) & 0xff] & 0xff];
         rk[2] =
-                ctx->Td0[ctx->Te4[(rk[2] >> 24)       ] & 0xff] ^
-                ctx->Td1[ctx->Te4[(rk[2] >> 16) & 0xff] & 0xff] ^
-                ctx->Td2[ctx->Te4[(rk[2] >>  8) & 0xff] & 0xff] ^
-                ctx->Td3[ctx->Te4[(rk[2]      ) & 0xff] & 0xff];
+                B5Td0_S[B5Te4_S[(rk[2] >> 24)       ] & 0xff] ^
+                B5Td1_S[B5Te4_S[(rk[2] >> 16) & 0xff] & 0xff] ^
+                B5Td2_S[B5Te4_S[(rk[2] >>  8) & 0xff] & 0xff] ^
+                B5Td3_S[B5Te4_S[(rk[2]      ) & 0xff] & 0xff];
         rk[3] =
-                ctx->Td0[ctx->Te4[(rk[3] >> 24)       ] & 0xff] ^
-                ctx->Td1[ctx->Te4[(rk[3] >> 16) & 0xff] & 0xff] ^
-                ctx->Td2[ctx->Te4[(rk[3] >>  8) & 0xff] & 0xff] ^
-                ctx->Td3[ctx->Te4[(rk[3]      ) & 0xff] & 0xff];
+                B5Td0_S[B5Te4_S[(rk[3] >> 24)       ] & 0xff] ^
+                B5Td1_S[B5Te4_S[(rk[3] >> 16) & 0xff] & 0xff] ^
+                B5Td2_S[B5Te4_S[(rk[3] >>  8) & 0xff] & 0xff] ^
+                B5Td3_S[B5Te4_S[(rk[3]      ) & 0xff] & 0xff];
     }
     return (uint8_t) Nr;
 }
@@ -935,72 +937,72 @@ static void B5_rijndaelEncrypt (B5_tAesCtx *ctx, uint32_t *rk, int16_t Nr, const
     
     
     /* round 1: */
-    t0 = ctx->Te0[s0 >> 24] ^ ctx->Te1[(s1 >> 16) & 0xff] ^ ctx->Te2[(s2 >>  8) & 0xff] ^ ctx->Te3[s3 & 0xff] ^ rk[ 4];
-    t1 = ctx->Te0[s1 >> 24] ^ ctx->Te1[(s2 >> 16) & 0xff] ^ ctx->Te2[(s3 >>  8) & 0xff] ^ ctx->Te3[s0 & 0xff] ^ rk[ 5];
-    t2 = ctx->Te0[s2 >> 24] ^ ctx->Te1[(s3 >> 16) & 0xff] ^ ctx->Te2[(s0 >>  8) & 0xff] ^ ctx->Te3[s1 & 0xff] ^ rk[ 6];
-    t3 = ctx->Te0[s3 >> 24] ^ ctx->Te1[(s0 >> 16) & 0xff] ^ ctx->Te2[(s1 >>  8) & 0xff] ^ ctx->Te3[s2 & 0xff] ^ rk[ 7];
+    t0 = B5Te0_S[s0 >> 24] ^ B5Te1_S[(s1 >> 16) & 0xff] ^ B5Te2_S[(s2 >>  8) & 0xff] ^ B5Te3_S[s3 & 0xff] ^ rk[ 4];
+    t1 = B5Te0_S[s1 >> 24] ^ B5Te1_S[(s2 >> 16) & 0xff] ^ B5Te2_S[(s3 >>  8) & 0xff] ^ B5Te3_S[s0 & 0xff] ^ rk[ 5];
+    t2 = B5Te0_S[s2 >> 24] ^ B5Te1_S[(s3 >> 16) & 0xff] ^ B5Te2_S[(s0 >>  8) & 0xff] ^ B5Te3_S[s1 & 0xff] ^ rk[ 6];
+    t3 = B5Te0_S[s3 >> 24] ^ B5Te1_S[(s0 >> 16) & 0xff] ^ B5Te2_S[(s1 >>  8) & 0xff] ^ B5Te3_S[s2 & 0xff] ^ rk[ 7];
     /* round 2: */
-    s0 = ctx->Te0[t0 >> 24] ^ ctx->Te1[(t1 >> 16) & 0xff] ^ ctx->Te2[(t2 >>  8) & 0xff] ^ ctx->Te3[t3 & 0xff] ^ rk[ 8];
-    s1 = ctx->Te0[t1 >> 24] ^ ctx->Te1[(t2 >> 16) & 0xff] ^ ctx->Te2[(t3 >>  8) & 0xff] ^ ctx->Te3[t0 & 0xff] ^ rk[ 9];
-    s2 = ctx->Te0[t2 >> 24] ^ ctx->Te1[(t3 >> 16) & 0xff] ^ ctx->Te2[(t0 >>  8) & 0xff] ^ ctx->Te3[t1 & 0xff] ^ rk[10];
-    s3 = ctx->Te0[t3 >> 24] ^ ctx->Te1[(t0 >> 16) & 0xff] ^ ctx->Te2[(t1 >>  8) & 0xff] ^ ctx->Te3[t2 & 0xff] ^ rk[11];
+    s0 = B5Te0_S[t0 >> 24] ^ B5Te1_S[(t1 >> 16) & 0xff] ^ B5Te2_S[(t2 >>  8) & 0xff] ^ B5Te3_S[t3 & 0xff] ^ rk[ 8];
+    s1 = B5Te0_S[t1 >> 24] ^ B5Te1_S[(t2 >> 16) & 0xff] ^ B5Te2_S[(t3 >>  8) & 0xff] ^ B5Te3_S[t0 & 0xff] ^ rk[ 9];
+    s2 = B5Te0_S[t2 >> 24] ^ B5Te1_S[(t3 >> 16) & 0xff] ^ B5Te2_S[(t0 >>  8) & 0xff] ^ B5Te3_S[t1 & 0xff] ^ rk[10];
+    s3 = B5Te0_S[t3 >> 24] ^ B5Te1_S[(t0 >> 16) & 0xff] ^ B5Te2_S[(t1 >>  8) & 0xff] ^ B5Te3_S[t2 & 0xff] ^ rk[11];
     /* round 3: */
-    t0 = ctx->Te0[s0 >> 24] ^ ctx->Te1[(s1 >> 16) & 0xff] ^ ctx->Te2[(s2 >>  8) & 0xff] ^ ctx->Te3[s3 & 0xff] ^ rk[12];
-    t1 = ctx->Te0[s1 >> 24] ^ ctx->Te1[(s2 >> 16) & 0xff] ^ ctx->Te2[(s3 >>  8) & 0xff] ^ ctx->Te3[s0 & 0xff] ^ rk[13];
-    t2 = ctx->Te0[s2 >> 24] ^ ctx->Te1[(s3 >> 16) & 0xff] ^ ctx->Te2[(s0 >>  8) & 0xff] ^ ctx->Te3[s1 & 0xff] ^ rk[14];
-    t3 = ctx->Te0[s3 >> 24] ^ ctx->Te1[(s0 >> 16) & 0xff] ^ ctx->Te2[(s1 >>  8) & 0xff] ^ ctx->Te3[s2 & 0xff] ^ rk[15];
+    t0 = B5Te0_S[s0 >> 24] ^ B5Te1_S[(s1 >> 16) & 0xff] ^ B5Te2_S[(s2 >>  8) & 0xff] ^ B5Te3_S[s3 & 0xff] ^ rk[12];
+    t1 = B5Te0_S[s1 >> 24] ^ B5Te1_S[(s2 >> 16) & 0xff] ^ B5Te2_S[(s3 >>  8) & 0xff] ^ B5Te3_S[s0 & 0xff] ^ rk[13];
+    t2 = B5Te0_S[s2 >> 24] ^ B5Te1_S[(s3 >> 16) & 0xff] ^ B5Te2_S[(s0 >>  8) & 0xff] ^ B5Te3_S[s1 & 0xff] ^ rk[14];
+    t3 = B5Te0_S[s3 >> 24] ^ B5Te1_S[(s0 >> 16) & 0xff] ^ B5Te2_S[(s1 >>  8) & 0xff] ^ B5Te3_S[s2 & 0xff] ^ rk[15];
     /* round 4: */
-    s0 = ctx->Te0[t0 >> 24] ^ ctx->Te1[(t1 >> 16) & 0xff] ^ ctx->Te2[(t2 >>  8) & 0xff] ^ ctx->Te3[t3 & 0xff] ^ rk[16];
-    s1 = ctx->Te0[t1 >> 24] ^ ctx->Te1[(t2 >> 16) & 0xff] ^ ctx->Te2[(t3 >>  8) & 0xff] ^ ctx->Te3[t0 & 0xff] ^ rk[17];
-    s2 = ctx->Te0[t2 >> 24] ^ ctx->Te1[(t3 >> 16) & 0xff] ^ ctx->Te2[(t0 >>  8) & 0xff] ^ ctx->Te3[t1 & 0xff] ^ rk[18];
-    s3 = ctx->Te0[t3 >> 24] ^ ctx->Te1[(t0 >> 16) & 0xff] ^ ctx->Te2[(t1 >>  8) & 0xff] ^ ctx->Te3[t2 & 0xff] ^ rk[19];
+    s0 = B5Te0_S[t0 >> 24] ^ B5Te1_S[(t1 >> 16) & 0xff] ^ B5Te2_S[(t2 >>  8) & 0xff] ^ B5Te3_S[t3 & 0xff] ^ rk[16];
+    s1 = B5Te0_S[t1 >> 24] ^ B5Te1_S[(t2 >> 16) & 0xff] ^ B5Te2_S[(t3 >>  8) & 0xff] ^ B5Te3_S[t0 & 0xff] ^ rk[17];
+    s2 = B5Te0_S[t2 >> 24] ^ B5Te1_S[(t3 >> 16) & 0xff] ^ B5Te2_S[(t0 >>  8) & 0xff] ^ B5Te3_S[t1 & 0xff] ^ rk[18];
+    s3 = B5Te0_S[t3 >> 24] ^ B5Te1_S[(t0 >> 16) & 0xff] ^ B5Te2_S[(t1 >>  8) & 0xff] ^ B5Te3_S[t2 & 0xff] ^ rk[19];
     /* round 5: */
-    t0 = ctx->Te0[s0 >> 24] ^ ctx->Te1[(s1 >> 16) & 0xff] ^ ctx->Te2[(s2 >>  8) & 0xff] ^ ctx->Te3[s3 & 0xff] ^ rk[20];
-    t1 = ctx->Te0[s1 >> 24] ^ ctx->Te1[(s2 >> 16) & 0xff] ^ ctx->Te2[(s3 >>  8) & 0xff] ^ ctx->Te3[s0 & 0xff] ^ rk[21];
-    t2 = ctx->Te0[s2 >> 24] ^ ctx->Te1[(s3 >> 16) & 0xff] ^ ctx->Te2[(s0 >>  8) & 0xff] ^ ctx->Te3[s1 & 0xff] ^ rk[22];
-    t3 = ctx->Te0[s3 >> 24] ^ ctx->Te1[(s0 >> 16) & 0xff] ^ ctx->Te2[(s1 >>  8) & 0xff] ^ ctx->Te3[s2 & 0xff] ^ rk[23];
+    t0 = B5Te0_S[s0 >> 24] ^ B5Te1_S[(s1 >> 16) & 0xff] ^ B5Te2_S[(s2 >>  8) & 0xff] ^ B5Te3_S[s3 & 0xff] ^ rk[20];
+    t1 = B5Te0_S[s1 >> 24] ^ B5Te1_S[(s2 >> 16) & 0xff] ^ B5Te2_S[(s3 >>  8) & 0xff] ^ B5Te3_S[s0 & 0xff] ^ rk[21];
+    t2 = B5Te0_S[s2 >> 24] ^ B5Te1_S[(s3 >> 16) & 0xff] ^ B5Te2_S[(s0 >>  8) & 0xff] ^ B5Te3_S[s1 & 0xff] ^ rk[22];
+    t3 = B5Te0_S[s3 >> 24] ^ B5Te1_S[(s0 >> 16) & 0xff] ^ B5Te2_S[(s1 >>  8) & 0xff] ^ B5Te3_S[s2 & 0xff] ^ rk[23];
     /* round 6: */
-    s0 = ctx->Te0[t0 >> 24] ^ ctx->Te1[(t1 >> 16) & 0xff] ^ ctx->Te2[(t2 >>  8) & 0xff] ^ ctx->Te3[t3 & 0xff] ^ rk[24];
-    s1 = ctx->Te0[t1 >> 24] ^ ctx->Te1[(t2 >> 16) & 0xff] ^ ctx->Te2[(t3 >>  8) & 0xff] ^ ctx->Te3[t0 & 0xff] ^ rk[25];
-    s2 = ctx->Te0[t2 >> 24] ^ ctx->Te1[(t3 >> 16) & 0xff] ^ ctx->Te2[(t0 >>  8) & 0xff] ^ ctx->Te3[t1 & 0xff] ^ rk[26];
-    s3 = ctx->Te0[t3 >> 24] ^ ctx->Te1[(t0 >> 16) & 0xff] ^ ctx->Te2[(t1 >>  8) & 0xff] ^ ctx->Te3[t2 & 0xff] ^ rk[27];
+    s0 = B5Te0_S[t0 >> 24] ^ B5Te1_S[(t1 >> 16) & 0xff] ^ B5Te2_S[(t2 >>  8) & 0xff] ^ B5Te3_S[t3 & 0xff] ^ rk[24];
+    s1 = B5Te0_S[t1 >> 24] ^ B5Te1_S[(t2 >> 16) & 0xff] ^ B5Te2_S[(t3 >>  8) & 0xff] ^ B5Te3_S[t0 & 0xff] ^ rk[25];
+    s2 = B5Te0_S[t2 >> 24] ^ B5Te1_S[(t3 >> 16) & 0xff] ^ B5Te2_S[(t0 >>  8) & 0xff] ^ B5Te3_S[t1 & 0xff] ^ rk[26];
+    s3 = B5Te0_S[t3 >> 24] ^ B5Te1_S[(t0 >> 16) & 0xff] ^ B5Te2_S[(t1 >>  8) & 0xff] ^ B5Te3_S[t2 & 0xff] ^ rk[27];
     /* round 7: */
-    t0 = ctx->Te0[s0 >> 24] ^ ctx->Te1[(s1 >> 16) & 0xff] ^ ctx->Te2[(s2 >>  8) & 0xff] ^ ctx->Te3[s3 & 0xff] ^ rk[28];
-    t1 = ctx->Te0[s1 >> 24] ^ ctx->Te1[(s2 >> 16) & 0xff] ^ ctx->Te2[(s3 >>  8) & 0xff] ^ ctx->Te3[s0 & 0xff] ^ rk[29];
-    t2 = ctx->Te0[s2 >> 24] ^ ctx->Te1[(s3 >> 16) & 0xff] ^ ctx->Te2[(s0 >>  8) & 0xff] ^ ctx->Te3[s1 & 0xff] ^ rk[30];
-    t3 = ctx->Te0[s3 >> 24] ^ ctx->Te1[(s0 >> 16) & 0xff] ^ ctx->Te2[(s1 >>  8) & 0xff] ^ ctx->Te3[s2 & 0xff] ^ rk[31];
+    t0 = B5Te0_S[s0 >> 24] ^ B5Te1_S[(s1 >> 16) & 0xff] ^ B5Te2_S[(s2 >>  8) & 0xff] ^ B5Te3_S[s3 & 0xff] ^ rk[28];
+    t1 = B5Te0_S[s1 >> 24] ^ B5Te1_S[(s2 >> 16) & 0xff] ^ B5Te2_S[(s3 >>  8) & 0xff] ^ B5Te3_S[s0 & 0xff] ^ rk[29];
+    t2 = B5Te0_S[s2 >> 24] ^ B5Te1_S[(s3 >> 16) & 0xff] ^ B5Te2_S[(s0 >>  8) & 0xff] ^ B5Te3_S[s1 & 0xff] ^ rk[30];
+    t3 = B5Te0_S[s3 >> 24] ^ B5Te1_S[(s0 >> 16) & 0xff] ^ B5Te2_S[(s1 >>  8) & 0xff] ^ B5Te3_S[s2 & 0xff] ^ rk[31];
     /* round 8: */
-    s0 = ctx->Te0[t0 >> 24] ^ ctx->Te1[(t1 >> 16) & 0xff] ^ ctx->Te2[(t2 >>  8) & 0xff] ^ ctx->Te3[t3 & 0xff] ^ rk[32];
-    s1 = ctx->Te0[t1 >> 24] ^ ctx->Te1[(t2 >> 16) & 0xff] ^ ctx->Te2[(t3 >>  8) & 0xff] ^ ctx->Te3[t0 & 0xff] ^ rk[33];
-    s2 = ctx->Te0[t2 >> 24] ^ ctx->Te1[(t3 >> 16) & 0xff] ^ ctx->Te2[(t0 >>  8) & 0xff] ^ ctx->Te3[t1 & 0xff] ^ rk[34];
-    s3 = ctx->Te0[t3 >> 24] ^ ctx->Te1[(t0 >> 16) & 0xff] ^ ctx->Te2[(t1 >>  8) & 0xff] ^ ctx->Te3[t2 & 0xff] ^ rk[35];
+    s0 = B5Te0_S[t0 >> 24] ^ B5Te1_S[(t1 >> 16) & 0xff] ^ B5Te2_S[(t2 >>  8) & 0xff] ^ B5Te3_S[t3 & 0xff] ^ rk[32];
+    s1 = B5Te0_S[t1 >> 24] ^ B5Te1_S[(t2 >> 16) & 0xff] ^ B5Te2_S[(t3 >>  8) & 0xff] ^ B5Te3_S[t0 & 0xff] ^ rk[33];
+    s2 = B5Te0_S[t2 >> 24] ^ B5Te1_S[(t3 >> 16) & 0xff] ^ B5Te2_S[(t0 >>  8) & 0xff] ^ B5Te3_S[t1 & 0xff] ^ rk[34];
+    s3 = B5Te0_S[t3 >> 24] ^ B5Te1_S[(t0 >> 16) & 0xff] ^ B5Te2_S[(t1 >>  8) & 0xff] ^ B5Te3_S[t2 & 0xff] ^ rk[35];
     /* round 9: */
-    t0 = ctx->Te0[s0 >> 24] ^ ctx->Te1[(s1 >> 16) & 0xff] ^ ctx->Te2[(s2 >>  8) & 0xff] ^ ctx->Te3[s3 & 0xff] ^ rk[36];
-    t1 = ctx->Te0[s1 >> 24] ^ ctx->Te1[(s2 >> 16) & 0xff] ^ ctx->Te2[(s3 >>  8) & 0xff] ^ ctx->Te3[s0 & 0xff] ^ rk[37];
-    t2 = ctx->Te0[s2 >> 24] ^ ctx->Te1[(s3 >> 16) & 0xff] ^ ctx->Te2[(s0 >>  8) & 0xff] ^ ctx->Te3[s1 & 0xff] ^ rk[38];
-    t3 = ctx->Te0[s3 >> 24] ^ ctx->Te1[(s0 >> 16) & 0xff] ^ ctx->Te2[(s1 >>  8) & 0xff] ^ ctx->Te3[s2 & 0xff] ^ rk[39];
+    t0 = B5Te0_S[s0 >> 24] ^ B5Te1_S[(s1 >> 16) & 0xff] ^ B5Te2_S[(s2 >>  8) & 0xff] ^ B5Te3_S[s3 & 0xff] ^ rk[36];
+    t1 = B5Te0_S[s1 >> 24] ^ B5Te1_S[(s2 >> 16) & 0xff] ^ B5Te2_S[(s3 >>  8) & 0xff] ^ B5Te3_S[s0 & 0xff] ^ rk[37];
+    t2 = B5Te0_S[s2 >> 24] ^ B5Te1_S[(s3 >> 16) & 0xff] ^ B5Te2_S[(s0 >>  8) & 0xff] ^ B5Te3_S[s1 & 0xff] ^ rk[38];
+    t3 = B5Te0_S[s3 >> 24] ^ B5Te1_S[(s0 >> 16) & 0xff] ^ B5Te2_S[(s1 >>  8) & 0xff] ^ B5Te3_S[s2 & 0xff] ^ rk[39];
     if (Nr > 10) {
         /* round 10: */
-        s0 = ctx->Te0[t0 >> 24] ^ ctx->Te1[(t1 >> 16) & 0xff] ^ ctx->Te2[(t2 >>  8) & 0xff] ^ ctx->Te3[t3 & 0xff] ^ rk[40];
-        s1 = ctx->Te0[t1 >> 24] ^ ctx->Te1[(t2 >> 16) & 0xff] ^ ctx->Te2[(t3 >>  8) & 0xff] ^ ctx->Te3[t0 & 0xff] ^ rk[41];
-        s2 = ctx->Te0[t2 >> 24] ^ ctx->Te1[(t3 >> 16) & 0xff] ^ ctx->Te2[(t0 >>  8) & 0xff] ^ ctx->Te3[t1 & 0xff] ^ rk[42];
-        s3 = ctx->Te0[t3 >> 24] ^ ctx->Te1[(t0 >> 16) & 0xff] ^ ctx->Te2[(t1 >>  8) & 0xff] ^ ctx->Te3[t2 & 0xff] ^ rk[43];
+        s0 = B5Te0_S[t0 >> 24] ^ B5Te1_S[(t1 >> 16) & 0xff] ^ B5Te2_S[(t2 >>  8) & 0xff] ^ B5Te3_S[t3 & 0xff] ^ rk[40];
+        s1 = B5Te0_S[t1 >> 24] ^ B5Te1_S[(t2 >> 16) & 0xff] ^ B5Te2_S[(t3 >>  8) & 0xff] ^ B5Te3_S[t0 & 0xff] ^ rk[41];
+        s2 = B5Te0_S[t2 >> 24] ^ B5Te1_S[(t3 >> 16) & 0xff] ^ B5Te2_S[(t0 >>  8) & 0xff] ^ B5Te3_S[t1 & 0xff] ^ rk[42];
+        s3 = B5Te0_S[t3 >> 24] ^ B5Te1_S[(t0 >> 16) & 0xff] ^ B5Te2_S[(t1 >>  8) & 0xff] ^ B5Te3_S[t2 & 0xff] ^ rk[43];
         /* round 11: */
-        t0 = ctx->Te0[s0 >> 24] ^ ctx->Te1[(s1 >> 16) & 0xff] ^ ctx->Te2[(s2 >>  8) & 0xff] ^ ctx->Te3[s3 & 0xff] ^ rk[44];
-        t1 = ctx->Te0[s1 >> 24] ^ ctx->Te1[(s2 >> 16) & 0xff] ^ ctx->Te2[(s3 >>  8) & 0xff] ^ ctx->Te3[s0 & 0xff] ^ rk[45];
-        t2 = ctx->Te0[s2 >> 24] ^ ctx->Te1[(s3 >> 16) & 0xff] ^ ctx->Te2[(s0 >>  8) & 0xff] ^ ctx->Te3[s1 & 0xff] ^ rk[46];
-        t3 = ctx->Te0[s3 >> 24] ^ ctx->Te1[(s0 >> 16) & 0xff] ^ ctx->Te2[(s1 >>  8) & 0xff] ^ ctx->Te3[s2 & 0xff] ^ rk[47];
+        t0 = B5Te0_S[s0 >> 24] ^ B5Te1_S[(s1 >> 16) & 0xff] ^ B5Te2_S[(s2 >>  8) & 0xff] ^ B5Te3_S[s3 & 0xff] ^ rk[44];
+        t1 = B5Te0_S[s1 >> 24] ^ B5Te1_S[(s2 >> 16) & 0xff] ^ B5Te2_S[(s3 >>  8) & 0xff] ^ B5Te3_S[s0 & 0xff] ^ rk[45];
+        t2 = B5Te0_S[s2 >> 24] ^ B5Te1_S[(s3 >> 16) & 0xff] ^ B5Te2_S[(s0 >>  8) & 0xff] ^ B5Te3_S[s1 & 0xff] ^ rk[46];
+        t3 = B5Te0_S[s3 >> 24] ^ B5Te1_S[(s0 >> 16) & 0xff] ^ B5Te2_S[(s1 >>  8) & 0xff] ^ B5Te3_S[s2 & 0xff] ^ rk[47];
         if (Nr > 12) {
             /* round 12: */
-            s0 = ctx->Te0[t0 >> 24] ^ ctx->Te1[(t1 >> 16) & 0xff] ^ ctx->Te2[(t2 >>  8) & 0xff] ^ ctx->Te3[t3 & 0xff] ^ rk[48];
-            s1 = ctx->Te0[t1 >> 24] ^ ctx->Te1[(t2 >> 16) & 0xff] ^ ctx->Te2[(t3 >>  8) & 0xff] ^ ctx->Te3[t0 & 0xff] ^ rk[49];
-            s2 = ctx->Te0[t2 >> 24] ^ ctx->Te1[(t3 >> 16) & 0xff] ^ ctx->Te2[(t0 >>  8) & 0xff] ^ ctx->Te3[t1 & 0xff] ^ rk[50];
-            s3 = ctx->Te0[t3 >> 24] ^ ctx->Te1[(t0 >> 16) & 0xff] ^ ctx->Te2[(t1 >>  8) & 0xff] ^ ctx->Te3[t2 & 0xff] ^ rk[51];
+            s0 = B5Te0_S[t0 >> 24] ^ B5Te1_S[(t1 >> 16) & 0xff] ^ B5Te2_S[(t2 >>  8) & 0xff] ^ B5Te3_S[t3 & 0xff] ^ rk[48];
+            s1 = B5Te0_S[t1 >> 24] ^ B5Te1_S[(t2 >> 16) & 0xff] ^ B5Te2_S[(t3 >>  8) & 0xff] ^ B5Te3_S[t0 & 0xff] ^ rk[49];
+            s2 = B5Te0_S[t2 >> 24] ^ B5Te1_S[(t3 >> 16) & 0xff] ^ B5Te2_S[(t0 >>  8) & 0xff] ^ B5Te3_S[t1 & 0xff] ^ rk[50];
+            s3 = B5Te0_S[t3 >> 24] ^ B5Te1_S[(t0 >> 16) & 0xff] ^ B5Te2_S[(t1 >>  8) & 0xff] ^ B5Te3_S[t2 & 0xff] ^ rk[51];
             /* round 13: */
-            t0 = ctx->Te0[s0 >> 24] ^ ctx->Te1[(s1 >> 16) & 0xff] ^ ctx->Te2[(s2 >>  8) & 0xff] ^ ctx->Te3[s3 & 0xff] ^ rk[52];
-            t1 = ctx->Te0[s1 >> 24] ^ ctx->Te1[(s2 >> 16) & 0xff] ^ ctx->Te2[(s3 >>  8) & 0xff] ^ ctx->Te3[s0 & 0xff] ^ rk[53];
-            t2 = ctx->Te0[s2 >> 24] ^ ctx->Te1[(s3 >> 16) & 0xff] ^ ctx->Te2[(s0 >>  8) & 0xff] ^ ctx->Te3[s1 & 0xff] ^ rk[54];
-            t3 = ctx->Te0[s3 >> 24] ^ ctx->Te1[(s0 >> 16) & 0xff] ^ ctx->Te2[(s1 >>  8) & 0xff] ^ ctx->Te3[s2 & 0xff] ^ rk[55];
+            t0 = B5Te0_S[s0 >> 24] ^ B5Te1_S[(s1 >> 16) & 0xff] ^ B5Te2_S[(s2 >>  8) & 0xff] ^ B5Te3_S[s3 & 0xff] ^ rk[52];
+            t1 = B5Te0_S[s1 >> 24] ^ B5Te1_S[(s2 >> 16) & 0xff] ^ B5Te2_S[(s3 >>  8) & 0xff] ^ B5Te3_S[s0 & 0xff] ^ rk[53];
+            t2 = B5Te0_S[s2 >> 24] ^ B5Te1_S[(s3 >> 16) & 0xff] ^ B5Te2_S[(s0 >>  8) & 0xff] ^ B5Te3_S[s1 & 0xff] ^ rk[54];
+            t3 = B5Te0_S[s3 >> 24] ^ B5Te1_S[(s0 >> 16) & 0xff] ^ B5Te2_S[(s1 >>  8) & 0xff] ^ B5Te3_S[s2 & 0xff] ^ rk[55];
         }
     }
     rk += Nr << 2;
@@ -1009,31 +1011,31 @@ static void B5_rijndaelEncrypt (B5_tAesCtx *ctx, uint32_t *rk, int16_t Nr, const
      * map cipher Te to Te array block:
      */
     s0 =
-            (ctx->Te4[(t0 >> 24)       ] & 0xff000000) ^
-            (ctx->Te4[(t1 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Te4[(t2 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Te4[(t3      ) & 0xff] & 0x000000ff) ^
+            (B5Te4_S[(t0 >> 24)       ] & 0xff000000) ^
+            (B5Te4_S[(t1 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Te4_S[(t2 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Te4_S[(t3      ) & 0xff] & 0x000000ff) ^
             rk[0];
     B5_AES256_PUTUINT32(ct     , s0);
     s1 =
-            (ctx->Te4[(t1 >> 24)       ] & 0xff000000) ^
-            (ctx->Te4[(t2 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Te4[(t3 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Te4[(t0      ) & 0xff] & 0x000000ff) ^
+            (B5Te4_S[(t1 >> 24)       ] & 0xff000000) ^
+            (B5Te4_S[(t2 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Te4_S[(t3 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Te4_S[(t0      ) & 0xff] & 0x000000ff) ^
             rk[1];
     B5_AES256_PUTUINT32(ct +  4, s1);
     s2 =
-            (ctx->Te4[(t2 >> 24)       ] & 0xff000000) ^
-            (ctx->Te4[(t3 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Te4[(t0 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Te4[(t1      ) & 0xff] & 0x000000ff) ^
+            (B5Te4_S[(t2 >> 24)       ] & 0xff000000) ^
+            (B5Te4_S[(t3 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Te4_S[(t0 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Te4_S[(t1      ) & 0xff] & 0x000000ff) ^
             rk[2];
     B5_AES256_PUTUINT32(ct +  8, s2);
     s3 =
-            (ctx->Te4[(t3 >> 24)       ] & 0xff000000) ^
-            (ctx->Te4[(t0 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Te4[(t1 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Te4[(t2      ) & 0xff] & 0x000000ff) ^
+            (B5Te4_S[(t3 >> 24)       ] & 0xff000000) ^
+            (B5Te4_S[(t0 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Te4_S[(t1 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Te4_S[(t2      ) & 0xff] & 0x000000ff) ^
             rk[3];
     B5_AES256_PUTUINT32(ct + 12, s3);
 }
@@ -1061,72 +1063,72 @@ void B5_rijndaelDecrypt (B5_tAesCtx *ctx, uint32_t *rk, int16_t Nr, const uint8_
     
     
     /* round 1: */
-    t0 = ctx->Td0[s0 >> 24] ^ ctx->Td1[(s3 >> 16) & 0xff] ^ ctx->Td2[(s2 >>  8) & 0xff] ^ ctx->Td3[s1 & 0xff] ^ rk[ 4];
-    t1 = ctx->Td0[s1 >> 24] ^ ctx->Td1[(s0 >> 16) & 0xff] ^ ctx->Td2[(s3 >>  8) & 0xff] ^ ctx->Td3[s2 & 0xff] ^ rk[ 5];
-    t2 = ctx->Td0[s2 >> 24] ^ ctx->Td1[(s1 >> 16) & 0xff] ^ ctx->Td2[(s0 >>  8) & 0xff] ^ ctx->Td3[s3 & 0xff] ^ rk[ 6];
-    t3 = ctx->Td0[s3 >> 24] ^ ctx->Td1[(s2 >> 16) & 0xff] ^ ctx->Td2[(s1 >>  8) & 0xff] ^ ctx->Td3[s0 & 0xff] ^ rk[ 7];
+    t0 = B5Td0_S[s0 >> 24] ^ B5Td1_S[(s3 >> 16) & 0xff] ^ B5Td2_S[(s2 >>  8) & 0xff] ^ B5Td3_S[s1 & 0xff] ^ rk[ 4];
+    t1 = B5Td0_S[s1 >> 24] ^ B5Td1_S[(s0 >> 16) & 0xff] ^ B5Td2_S[(s3 >>  8) & 0xff] ^ B5Td3_S[s2 & 0xff] ^ rk[ 5];
+    t2 = B5Td0_S[s2 >> 24] ^ B5Td1_S[(s1 >> 16) & 0xff] ^ B5Td2_S[(s0 >>  8) & 0xff] ^ B5Td3_S[s3 & 0xff] ^ rk[ 6];
+    t3 = B5Td0_S[s3 >> 24] ^ B5Td1_S[(s2 >> 16) & 0xff] ^ B5Td2_S[(s1 >>  8) & 0xff] ^ B5Td3_S[s0 & 0xff] ^ rk[ 7];
     /* round 2: */
-    s0 = ctx->Td0[t0 >> 24] ^ ctx->Td1[(t3 >> 16) & 0xff] ^ ctx->Td2[(t2 >>  8) & 0xff] ^ ctx->Td3[t1 & 0xff] ^ rk[ 8];
-    s1 = ctx->Td0[t1 >> 24] ^ ctx->Td1[(t0 >> 16) & 0xff] ^ ctx->Td2[(t3 >>  8) & 0xff] ^ ctx->Td3[t2 & 0xff] ^ rk[ 9];
-    s2 = ctx->Td0[t2 >> 24] ^ ctx->Td1[(t1 >> 16) & 0xff] ^ ctx->Td2[(t0 >>  8) & 0xff] ^ ctx->Td3[t3 & 0xff] ^ rk[10];
-    s3 = ctx->Td0[t3 >> 24] ^ ctx->Td1[(t2 >> 16) & 0xff] ^ ctx->Td2[(t1 >>  8) & 0xff] ^ ctx->Td3[t0 & 0xff] ^ rk[11];
+    s0 = B5Td0_S[t0 >> 24] ^ B5Td1_S[(t3 >> 16) & 0xff] ^ B5Td2_S[(t2 >>  8) & 0xff] ^ B5Td3_S[t1 & 0xff] ^ rk[ 8];
+    s1 = B5Td0_S[t1 >> 24] ^ B5Td1_S[(t0 >> 16) & 0xff] ^ B5Td2_S[(t3 >>  8) & 0xff] ^ B5Td3_S[t2 & 0xff] ^ rk[ 9];
+    s2 = B5Td0_S[t2 >> 24] ^ B5Td1_S[(t1 >> 16) & 0xff] ^ B5Td2_S[(t0 >>  8) & 0xff] ^ B5Td3_S[t3 & 0xff] ^ rk[10];
+    s3 = B5Td0_S[t3 >> 24] ^ B5Td1_S[(t2 >> 16) & 0xff] ^ B5Td2_S[(t1 >>  8) & 0xff] ^ B5Td3_S[t0 & 0xff] ^ rk[11];
     /* round 3: */
-    t0 = ctx->Td0[s0 >> 24] ^ ctx->Td1[(s3 >> 16) & 0xff] ^ ctx->Td2[(s2 >>  8) & 0xff] ^ ctx->Td3[s1 & 0xff] ^ rk[12];
-    t1 = ctx->Td0[s1 >> 24] ^ ctx->Td1[(s0 >> 16) & 0xff] ^ ctx->Td2[(s3 >>  8) & 0xff] ^ ctx->Td3[s2 & 0xff] ^ rk[13];
-    t2 = ctx->Td0[s2 >> 24] ^ ctx->Td1[(s1 >> 16) & 0xff] ^ ctx->Td2[(s0 >>  8) & 0xff] ^ ctx->Td3[s3 & 0xff] ^ rk[14];
-    t3 = ctx->Td0[s3 >> 24] ^ ctx->Td1[(s2 >> 16) & 0xff] ^ ctx->Td2[(s1 >>  8) & 0xff] ^ ctx->Td3[s0 & 0xff] ^ rk[15];
+    t0 = B5Td0_S[s0 >> 24] ^ B5Td1_S[(s3 >> 16) & 0xff] ^ B5Td2_S[(s2 >>  8) & 0xff] ^ B5Td3_S[s1 & 0xff] ^ rk[12];
+    t1 = B5Td0_S[s1 >> 24] ^ B5Td1_S[(s0 >> 16) & 0xff] ^ B5Td2_S[(s3 >>  8) & 0xff] ^ B5Td3_S[s2 & 0xff] ^ rk[13];
+    t2 = B5Td0_S[s2 >> 24] ^ B5Td1_S[(s1 >> 16) & 0xff] ^ B5Td2_S[(s0 >>  8) & 0xff] ^ B5Td3_S[s3 & 0xff] ^ rk[14];
+    t3 = B5Td0_S[s3 >> 24] ^ B5Td1_S[(s2 >> 16) & 0xff] ^ B5Td2_S[(s1 >>  8) & 0xff] ^ B5Td3_S[s0 & 0xff] ^ rk[15];
     /* round 4: */
-    s0 = ctx->Td0[t0 >> 24] ^ ctx->Td1[(t3 >> 16) & 0xff] ^ ctx->Td2[(t2 >>  8) & 0xff] ^ ctx->Td3[t1 & 0xff] ^ rk[16];
-    s1 = ctx->Td0[t1 >> 24] ^ ctx->Td1[(t0 >> 16) & 0xff] ^ ctx->Td2[(t3 >>  8) & 0xff] ^ ctx->Td3[t2 & 0xff] ^ rk[17];
-    s2 = ctx->Td0[t2 >> 24] ^ ctx->Td1[(t1 >> 16) & 0xff] ^ ctx->Td2[(t0 >>  8) & 0xff] ^ ctx->Td3[t3 & 0xff] ^ rk[18];
-    s3 = ctx->Td0[t3 >> 24] ^ ctx->Td1[(t2 >> 16) & 0xff] ^ ctx->Td2[(t1 >>  8) & 0xff] ^ ctx->Td3[t0 & 0xff] ^ rk[19];
+    s0 = B5Td0_S[t0 >> 24] ^ B5Td1_S[(t3 >> 16) & 0xff] ^ B5Td2_S[(t2 >>  8) & 0xff] ^ B5Td3_S[t1 & 0xff] ^ rk[16];
+    s1 = B5Td0_S[t1 >> 24] ^ B5Td1_S[(t0 >> 16) & 0xff] ^ B5Td2_S[(t3 >>  8) & 0xff] ^ B5Td3_S[t2 & 0xff] ^ rk[17];
+    s2 = B5Td0_S[t2 >> 24] ^ B5Td1_S[(t1 >> 16) & 0xff] ^ B5Td2_S[(t0 >>  8) & 0xff] ^ B5Td3_S[t3 & 0xff] ^ rk[18];
+    s3 = B5Td0_S[t3 >> 24] ^ B5Td1_S[(t2 >> 16) & 0xff] ^ B5Td2_S[(t1 >>  8) & 0xff] ^ B5Td3_S[t0 & 0xff] ^ rk[19];
     /* round 5: */
-    t0 = ctx->Td0[s0 >> 24] ^ ctx->Td1[(s3 >> 16) & 0xff] ^ ctx->Td2[(s2 >>  8) & 0xff] ^ ctx->Td3[s1 & 0xff] ^ rk[20];
-    t1 = ctx->Td0[s1 >> 24] ^ ctx->Td1[(s0 >> 16) & 0xff] ^ ctx->Td2[(s3 >>  8) & 0xff] ^ ctx->Td3[s2 & 0xff] ^ rk[21];
-    t2 = ctx->Td0[s2 >> 24] ^ ctx->Td1[(s1 >> 16) & 0xff] ^ ctx->Td2[(s0 >>  8) & 0xff] ^ ctx->Td3[s3 & 0xff] ^ rk[22];
-    t3 = ctx->Td0[s3 >> 24] ^ ctx->Td1[(s2 >> 16) & 0xff] ^ ctx->Td2[(s1 >>  8) & 0xff] ^ ctx->Td3[s0 & 0xff] ^ rk[23];
+    t0 = B5Td0_S[s0 >> 24] ^ B5Td1_S[(s3 >> 16) & 0xff] ^ B5Td2_S[(s2 >>  8) & 0xff] ^ B5Td3_S[s1 & 0xff] ^ rk[20];
+    t1 = B5Td0_S[s1 >> 24] ^ B5Td1_S[(s0 >> 16) & 0xff] ^ B5Td2_S[(s3 >>  8) & 0xff] ^ B5Td3_S[s2 & 0xff] ^ rk[21];
+    t2 = B5Td0_S[s2 >> 24] ^ B5Td1_S[(s1 >> 16) & 0xff] ^ B5Td2_S[(s0 >>  8) & 0xff] ^ B5Td3_S[s3 & 0xff] ^ rk[22];
+    t3 = B5Td0_S[s3 >> 24] ^ B5Td1_S[(s2 >> 16) & 0xff] ^ B5Td2_S[(s1 >>  8) & 0xff] ^ B5Td3_S[s0 & 0xff] ^ rk[23];
     /* round 6: */
-    s0 = ctx->Td0[t0 >> 24] ^ ctx->Td1[(t3 >> 16) & 0xff] ^ ctx->Td2[(t2 >>  8) & 0xff] ^ ctx->Td3[t1 & 0xff] ^ rk[24];
-    s1 = ctx->Td0[t1 >> 24] ^ ctx->Td1[(t0 >> 16) & 0xff] ^ ctx->Td2[(t3 >>  8) & 0xff] ^ ctx->Td3[t2 & 0xff] ^ rk[25];
-    s2 = ctx->Td0[t2 >> 24] ^ ctx->Td1[(t1 >> 16) & 0xff] ^ ctx->Td2[(t0 >>  8) & 0xff] ^ ctx->Td3[t3 & 0xff] ^ rk[26];
-    s3 = ctx->Td0[t3 >> 24] ^ ctx->Td1[(t2 >> 16) & 0xff] ^ ctx->Td2[(t1 >>  8) & 0xff] ^ ctx->Td3[t0 & 0xff] ^ rk[27];
+    s0 = B5Td0_S[t0 >> 24] ^ B5Td1_S[(t3 >> 16) & 0xff] ^ B5Td2_S[(t2 >>  8) & 0xff] ^ B5Td3_S[t1 & 0xff] ^ rk[24];
+    s1 = B5Td0_S[t1 >> 24] ^ B5Td1_S[(t0 >> 16) & 0xff] ^ B5Td2_S[(t3 >>  8) & 0xff] ^ B5Td3_S[t2 & 0xff] ^ rk[25];
+    s2 = B5Td0_S[t2 >> 24] ^ B5Td1_S[(t1 >> 16) & 0xff] ^ B5Td2_S[(t0 >>  8) & 0xff] ^ B5Td3_S[t3 & 0xff] ^ rk[26];
+    s3 = B5Td0_S[t3 >> 24] ^ B5Td1_S[(t2 >> 16) & 0xff] ^ B5Td2_S[(t1 >>  8) & 0xff] ^ B5Td3_S[t0 & 0xff] ^ rk[27];
     /* round 7: */
-    t0 = ctx->Td0[s0 >> 24] ^ ctx->Td1[(s3 >> 16) & 0xff] ^ ctx->Td2[(s2 >>  8) & 0xff] ^ ctx->Td3[s1 & 0xff] ^ rk[28];
-    t1 = ctx->Td0[s1 >> 24] ^ ctx->Td1[(s0 >> 16) & 0xff] ^ ctx->Td2[(s3 >>  8) & 0xff] ^ ctx->Td3[s2 & 0xff] ^ rk[29];
-    t2 = ctx->Td0[s2 >> 24] ^ ctx->Td1[(s1 >> 16) & 0xff] ^ ctx->Td2[(s0 >>  8) & 0xff] ^ ctx->Td3[s3 & 0xff] ^ rk[30];
-    t3 = ctx->Td0[s3 >> 24] ^ ctx->Td1[(s2 >> 16) & 0xff] ^ ctx->Td2[(s1 >>  8) & 0xff] ^ ctx->Td3[s0 & 0xff] ^ rk[31];
+    t0 = B5Td0_S[s0 >> 24] ^ B5Td1_S[(s3 >> 16) & 0xff] ^ B5Td2_S[(s2 >>  8) & 0xff] ^ B5Td3_S[s1 & 0xff] ^ rk[28];
+    t1 = B5Td0_S[s1 >> 24] ^ B5Td1_S[(s0 >> 16) & 0xff] ^ B5Td2_S[(s3 >>  8) & 0xff] ^ B5Td3_S[s2 & 0xff] ^ rk[29];
+    t2 = B5Td0_S[s2 >> 24] ^ B5Td1_S[(s1 >> 16) & 0xff] ^ B5Td2_S[(s0 >>  8) & 0xff] ^ B5Td3_S[s3 & 0xff] ^ rk[30];
+    t3 = B5Td0_S[s3 >> 24] ^ B5Td1_S[(s2 >> 16) & 0xff] ^ B5Td2_S[(s1 >>  8) & 0xff] ^ B5Td3_S[s0 & 0xff] ^ rk[31];
     /* round 8: */
-    s0 = ctx->Td0[t0 >> 24] ^ ctx->Td1[(t3 >> 16) & 0xff] ^ ctx->Td2[(t2 >>  8) & 0xff] ^ ctx->Td3[t1 & 0xff] ^ rk[32];
-    s1 = ctx->Td0[t1 >> 24] ^ ctx->Td1[(t0 >> 16) & 0xff] ^ ctx->Td2[(t3 >>  8) & 0xff] ^ ctx->Td3[t2 & 0xff] ^ rk[33];
-    s2 = ctx->Td0[t2 >> 24] ^ ctx->Td1[(t1 >> 16) & 0xff] ^ ctx->Td2[(t0 >>  8) & 0xff] ^ ctx->Td3[t3 & 0xff] ^ rk[34];
-    s3 = ctx->Td0[t3 >> 24] ^ ctx->Td1[(t2 >> 16) & 0xff] ^ ctx->Td2[(t1 >>  8) & 0xff] ^ ctx->Td3[t0 & 0xff] ^ rk[35];
+    s0 = B5Td0_S[t0 >> 24] ^ B5Td1_S[(t3 >> 16) & 0xff] ^ B5Td2_S[(t2 >>  8) & 0xff] ^ B5Td3_S[t1 & 0xff] ^ rk[32];
+    s1 = B5Td0_S[t1 >> 24] ^ B5Td1_S[(t0 >> 16) & 0xff] ^ B5Td2_S[(t3 >>  8) & 0xff] ^ B5Td3_S[t2 & 0xff] ^ rk[33];
+    s2 = B5Td0_S[t2 >> 24] ^ B5Td1_S[(t1 >> 16) & 0xff] ^ B5Td2_S[(t0 >>  8) & 0xff] ^ B5Td3_S[t3 & 0xff] ^ rk[34];
+    s3 = B5Td0_S[t3 >> 24] ^ B5Td1_S[(t2 >> 16) & 0xff] ^ B5Td2_S[(t1 >>  8) & 0xff] ^ B5Td3_S[t0 & 0xff] ^ rk[35];
     /* round 9: */
-    t0 = ctx->Td0[s0 >> 24] ^ ctx->Td1[(s3 >> 16) & 0xff] ^ ctx->Td2[(s2 >>  8) & 0xff] ^ ctx->Td3[s1 & 0xff] ^ rk[36];
-    t1 = ctx->Td0[s1 >> 24] ^ ctx->Td1[(s0 >> 16) & 0xff] ^ ctx->Td2[(s3 >>  8) & 0xff] ^ ctx->Td3[s2 & 0xff] ^ rk[37];
-    t2 = ctx->Td0[s2 >> 24] ^ ctx->Td1[(s1 >> 16) & 0xff] ^ ctx->Td2[(s0 >>  8) & 0xff] ^ ctx->Td3[s3 & 0xff] ^ rk[38];
-    t3 = ctx->Td0[s3 >> 24] ^ ctx->Td1[(s2 >> 16) & 0xff] ^ ctx->Td2[(s1 >>  8) & 0xff] ^ ctx->Td3[s0 & 0xff] ^ rk[39];
+    t0 = B5Td0_S[s0 >> 24] ^ B5Td1_S[(s3 >> 16) & 0xff] ^ B5Td2_S[(s2 >>  8) & 0xff] ^ B5Td3_S[s1 & 0xff] ^ rk[36];
+    t1 = B5Td0_S[s1 >> 24] ^ B5Td1_S[(s0 >> 16) & 0xff] ^ B5Td2_S[(s3 >>  8) & 0xff] ^ B5Td3_S[s2 & 0xff] ^ rk[37];
+    t2 = B5Td0_S[s2 >> 24] ^ B5Td1_S[(s1 >> 16) & 0xff] ^ B5Td2_S[(s0 >>  8) & 0xff] ^ B5Td3_S[s3 & 0xff] ^ rk[38];
+    t3 = B5Td0_S[s3 >> 24] ^ B5Td1_S[(s2 >> 16) & 0xff] ^ B5Td2_S[(s1 >>  8) & 0xff] ^ B5Td3_S[s0 & 0xff] ^ rk[39];
     if (Nr > 10) {
         /* round 10: */
-        s0 = ctx->Td0[t0 >> 24] ^ ctx->Td1[(t3 >> 16) & 0xff] ^ ctx->Td2[(t2 >>  8) & 0xff] ^ ctx->Td3[t1 & 0xff] ^ rk[40];
-        s1 = ctx->Td0[t1 >> 24] ^ ctx->Td1[(t0 >> 16) & 0xff] ^ ctx->Td2[(t3 >>  8) & 0xff] ^ ctx->Td3[t2 & 0xff] ^ rk[41];
-        s2 = ctx->Td0[t2 >> 24] ^ ctx->Td1[(t1 >> 16) & 0xff] ^ ctx->Td2[(t0 >>  8) & 0xff] ^ ctx->Td3[t3 & 0xff] ^ rk[42];
-        s3 = ctx->Td0[t3 >> 24] ^ ctx->Td1[(t2 >> 16) & 0xff] ^ ctx->Td2[(t1 >>  8) & 0xff] ^ ctx->Td3[t0 & 0xff] ^ rk[43];
+        s0 = B5Td0_S[t0 >> 24] ^ B5Td1_S[(t3 >> 16) & 0xff] ^ B5Td2_S[(t2 >>  8) & 0xff] ^ B5Td3_S[t1 & 0xff] ^ rk[40];
+        s1 = B5Td0_S[t1 >> 24] ^ B5Td1_S[(t0 >> 16) & 0xff] ^ B5Td2_S[(t3 >>  8) & 0xff] ^ B5Td3_S[t2 & 0xff] ^ rk[41];
+        s2 = B5Td0_S[t2 >> 24] ^ B5Td1_S[(t1 >> 16) & 0xff] ^ B5Td2_S[(t0 >>  8) & 0xff] ^ B5Td3_S[t3 & 0xff] ^ rk[42];
+        s3 = B5Td0_S[t3 >> 24] ^ B5Td1_S[(t2 >> 16) & 0xff] ^ B5Td2_S[(t1 >>  8) & 0xff] ^ B5Td3_S[t0 & 0xff] ^ rk[43];
         /* round 11: */
-        t0 = ctx->Td0[s0 >> 24] ^ ctx->Td1[(s3 >> 16) & 0xff] ^ ctx->Td2[(s2 >>  8) & 0xff] ^ ctx->Td3[s1 & 0xff] ^ rk[44];
-        t1 = ctx->Td0[s1 >> 24] ^ ctx->Td1[(s0 >> 16) & 0xff] ^ ctx->Td2[(s3 >>  8) & 0xff] ^ ctx->Td3[s2 & 0xff] ^ rk[45];
-        t2 = ctx->Td0[s2 >> 24] ^ ctx->Td1[(s1 >> 16) & 0xff] ^ ctx->Td2[(s0 >>  8) & 0xff] ^ ctx->Td3[s3 & 0xff] ^ rk[46];
-        t3 = ctx->Td0[s3 >> 24] ^ ctx->Td1[(s2 >> 16) & 0xff] ^ ctx->Td2[(s1 >>  8) & 0xff] ^ ctx->Td3[s0 & 0xff] ^ rk[47];
+        t0 = B5Td0_S[s0 >> 24] ^ B5Td1_S[(s3 >> 16) & 0xff] ^ B5Td2_S[(s2 >>  8) & 0xff] ^ B5Td3_S[s1 & 0xff] ^ rk[44];
+        t1 = B5Td0_S[s1 >> 24] ^ B5Td1_S[(s0 >> 16) & 0xff] ^ B5Td2_S[(s3 >>  8) & 0xff] ^ B5Td3_S[s2 & 0xff] ^ rk[45];
+        t2 = B5Td0_S[s2 >> 24] ^ B5Td1_S[(s1 >> 16) & 0xff] ^ B5Td2_S[(s0 >>  8) & 0xff] ^ B5Td3_S[s3 & 0xff] ^ rk[46];
+        t3 = B5Td0_S[s3 >> 24] ^ B5Td1_S[(s2 >> 16) & 0xff] ^ B5Td2_S[(s1 >>  8) & 0xff] ^ B5Td3_S[s0 & 0xff] ^ rk[47];
         if (Nr > 12) {
             /* round 12: */
-            s0 = ctx->Td0[t0 >> 24] ^ ctx->Td1[(t3 >> 16) & 0xff] ^ ctx->Td2[(t2 >>  8) & 0xff] ^ ctx->Td3[t1 & 0xff] ^ rk[48];
-            s1 = ctx->Td0[t1 >> 24] ^ ctx->Td1[(t0 >> 16) & 0xff] ^ ctx->Td2[(t3 >>  8) & 0xff] ^ ctx->Td3[t2 & 0xff] ^ rk[49];
-            s2 = ctx->Td0[t2 >> 24] ^ ctx->Td1[(t1 >> 16) & 0xff] ^ ctx->Td2[(t0 >>  8) & 0xff] ^ ctx->Td3[t3 & 0xff] ^ rk[50];
-            s3 = ctx->Td0[t3 >> 24] ^ ctx->Td1[(t2 >> 16) & 0xff] ^ ctx->Td2[(t1 >>  8) & 0xff] ^ ctx->Td3[t0 & 0xff] ^ rk[51];
+            s0 = B5Td0_S[t0 >> 24] ^ B5Td1_S[(t3 >> 16) & 0xff] ^ B5Td2_S[(t2 >>  8) & 0xff] ^ B5Td3_S[t1 & 0xff] ^ rk[48];
+            s1 = B5Td0_S[t1 >> 24] ^ B5Td1_S[(t0 >> 16) & 0xff] ^ B5Td2_S[(t3 >>  8) & 0xff] ^ B5Td3_S[t2 & 0xff] ^ rk[49];
+            s2 = B5Td0_S[t2 >> 24] ^ B5Td1_S[(t1 >> 16) & 0xff] ^ B5Td2_S[(t0 >>  8) & 0xff] ^ B5Td3_S[t3 & 0xff] ^ rk[50];
+            s3 = B5Td0_S[t3 >> 24] ^ B5Td1_S[(t2 >> 16) & 0xff] ^ B5Td2_S[(t1 >>  8) & 0xff] ^ B5Td3_S[t0 & 0xff] ^ rk[51];
             /* round 13: */
-            t0 = ctx->Td0[s0 >> 24] ^ ctx->Td1[(s3 >> 16) & 0xff] ^ ctx->Td2[(s2 >>  8) & 0xff] ^ ctx->Td3[s1 & 0xff] ^ rk[52];
-            t1 = ctx->Td0[s1 >> 24] ^ ctx->Td1[(s0 >> 16) & 0xff] ^ ctx->Td2[(s3 >>  8) & 0xff] ^ ctx->Td3[s2 & 0xff] ^ rk[53];
-            t2 = ctx->Td0[s2 >> 24] ^ ctx->Td1[(s1 >> 16) & 0xff] ^ ctx->Td2[(s0 >>  8) & 0xff] ^ ctx->Td3[s3 & 0xff] ^ rk[54];
-            t3 = ctx->Td0[s3 >> 24] ^ ctx->Td1[(s2 >> 16) & 0xff] ^ ctx->Td2[(s1 >>  8) & 0xff] ^ ctx->Td3[s0 & 0xff] ^ rk[55];
+            t0 = B5Td0_S[s0 >> 24] ^ B5Td1_S[(s3 >> 16) & 0xff] ^ B5Td2_S[(s2 >>  8) & 0xff] ^ B5Td3_S[s1 & 0xff] ^ rk[52];
+            t1 = B5Td0_S[s1 >> 24] ^ B5Td1_S[(s0 >> 16) & 0xff] ^ B5Td2_S[(s3 >>  8) & 0xff] ^ B5Td3_S[s2 & 0xff] ^ rk[53];
+            t2 = B5Td0_S[s2 >> 24] ^ B5Td1_S[(s1 >> 16) & 0xff] ^ B5Td2_S[(s0 >>  8) & 0xff] ^ B5Td3_S[s3 & 0xff] ^ rk[54];
+            t3 = B5Td0_S[s3 >> 24] ^ B5Td1_S[(s2 >> 16) & 0xff] ^ B5Td2_S[(s1 >>  8) & 0xff] ^ B5Td3_S[s0 & 0xff] ^ rk[55];
         }
     }
     rk += Nr << 2;
@@ -1135,35 +1137,71 @@ void B5_rijndaelDecrypt (B5_tAesCtx *ctx, uint32_t *rk, int16_t Nr, const uint8_
      * map cipher state to byte array block:
      */
     s0 =
-            (ctx->Td4[(t0 >> 24)       ] & 0xff000000) ^
-            (ctx->Td4[(t3 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Td4[(t2 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Td4[(t1      ) & 0xff] & 0x000000ff) ^
+            (B5Td4_S[(t0 >> 24)       ] & 0xff000000) ^
+            (B5Td4_S[(t3 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Td4_S[(t2 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Td4_S[(t1      ) & 0xff] & 0x000000ff) ^
             rk[0];
     B5_AES256_PUTUINT32(pt     , s0);
     s1 =
-            (ctx->Td4[(t1 >> 24)       ] & 0xff000000) ^
-            (ctx->Td4[(t0 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Td4[(t3 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Td4[(t2      ) & 0xff] & 0x000000ff) ^
+            (B5Td4_S[(t1 >> 24)       ] & 0xff000000) ^
+            (B5Td4_S[(t0 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Td4_S[(t3 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Td4_S[(t2      ) & 0xff] & 0x000000ff) ^
             rk[1];
     B5_AES256_PUTUINT32(pt +  4, s1);
     s2 =
-            (ctx->Td4[(t2 >> 24)       ] & 0xff000000) ^
-            (ctx->Td4[(t1 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Td4[(t0 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Td4[(t3      ) & 0xff] & 0x000000ff) ^
+            (B5Td4_S[(t2 >> 24)       ] & 0xff000000) ^
+            (B5Td4_S[(t1 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Td4_S[(t0 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Td4_S[(t3      ) & 0xff] & 0x000000ff) ^
             rk[2];
     B5_AES256_PUTUINT32(pt +  8, s2);
     s3 =
-            (ctx->Td4[(t3 >> 24)       ] & 0xff000000) ^
-            (ctx->Td4[(t2 >> 16) & 0xff] & 0x00ff0000) ^
-            (ctx->Td4[(t1 >>  8) & 0xff] & 0x0000ff00) ^
-            (ctx->Td4[(t0      ) & 0xff] & 0x000000ff) ^
+            (B5Td4_S[(t3 >> 24)       ] & 0xff000000) ^
+            (B5Td4_S[(t2 >> 16) & 0xff] & 0x00ff0000) ^
+            (B5Td4_S[(t1 >>  8) & 0xff] & 0x0000ff00) ^
+            (B5Td4_S[(t0      ) & 0xff] & 0x000000ff) ^
             rk[3];
     B5_AES256_PUTUINT32(pt + 12, s3);
 }
 
+/**
+ * @brief XOR two blocks a word at a time.
+ * @param dst Output block, may be the same as a or b.
+ * @param a First input block.
+ * @param b Second input block.
+ */
+static inline void B5_AesXorBlock (uint8_t *dst, const uint8_t *a, const uint8_t *b)
+{
+    uint32_t x[4], y[4];
+    
+    memcpy(x, a, B5_AES_BLK_SIZE);
+    memcpy(y, b, B5_AES_BLK_SIZE);
+    x[0] ^= y[0];
+    x[1] ^= y[1];
+    x[2] ^= y[2];
+    x[3] ^= y[3];
+    memcpy(dst, x, B5_AES_BLK_SIZE);
+}
+
+/**
+ * @brief Increment the 128-bit big-endian counter block, 32 bits at a time.
+ * @param ctr Counter block.
+ */
+static inline void B5_AesIncCounter (uint8_t *ctr)
+{
+    int16_t i;
+    uint32_t w;
+    
+    for (i = 12; i >= 0; i -= 4) {
+        w = B5_AES256_GETUINT32(ctr + i) + 1;
+        B5_AES256_PUTUINT32(ctr + i, w);
+        if (w != 0)
+            break;
+    }
+}
+
 int32_t B5_Aes256_Init (B5_tAesCtx *ctx, const uint8_t *Key, int16_t keySize, uint8_t aesMode)
 {
     if(Key == NULL) 
@@ -1182,17 +1220,6 @@ int32_t B5_Aes256_Init (B5_tAesCtx *ctx, const uint8_t *Key, int16_t keySize, ui
     
     ctx->mode = aesMode;
     
-    ctx->Te0 = B5Te0_S;
-    ctx->Te1 = B5Te1_S;
-    ctx->Te2 = B5Te2_S;
-    ctx->Te3 = B5Te3_S;
-    ctx->Te4 = B5Te4_S;
-    ctx->Td0 = B5Td0_S;
-    ctx->Td1 = B5Td1_S;
-    ctx->Td2 = B5Td2_S;
-    ctx->Td3 = B5Td3_S;
-    ctx->Td4 = B5Td4_S;
-    
     memset(ctx->InitVector, 0x55, B5_AES_IV_SIZE);
     
     if ((ctx->mode == B5_AES256_ECB_ENC) || (ctx->mode == B5_AES256_OFB) || (ctx->mode == B5_AES256_CBC_ENC) || (ctx->mode == B5_AES256_CTR) || (ctx->mode == B5_AES256_CFB_ENC) || (ctx->mode == B5_AES256_CFB_DEC)) 
@@ -1232,8 +1259,9 @@ int32_t B5_Aes256_SetIV (B5_tAesCtx    *ctx, const uint8_t *IV)
 
 int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, int16_t nBlk)
 {
-    int16_t    i, j, cb;
+    int16_t    i, j, n;
     uint8_t    tmp[B5_AES_BLK_SIZE];
+    uint8_t    ks[B5_AES_PIPELINE * B5_AES_BLK_SIZE];
     
     
     
@@ -1250,24 +1278,21 @@ int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, i
         
         case B5_AES256_CTR: 
         {
-            for (i = 0; i < nBlk; i++) 
+            // generate the keystream for up to B5_AES_PIPELINE blocks, then apply it
+            for (i = 0; i < nBlk; i += n) 
             {
-                B5_rijndaelEncrypt(ctx, ctx->rk, ctx->Nr, ctx->InitVector, encData);
-                for (j = 0; j < B5_AES_BLK_SIZE; j++) 
+                n = ((nBlk - i) < B5_AES_PIPELINE) ? (nBlk - i) : (B5_AES_PIPELINE);
+                for (j = 0; j < n; j++) 
                 {
-                    //*encData = *clrData++ ^ encData[j];
-                    //*encData++;
-                    /*Working*/
-					*encData = *encData ^ *clrData;
-					encData++;
-					clrData++;
+                    B5_rijndaelEncrypt(ctx, ctx->rk, ctx->Nr, ctx->InitVector, ks + (j << 4));
+                    B5_AesIncCounter(ctx->InitVector);
+                }
+                for (j = 0; j < n; j++) 
+                {
+                    B5_AesXorBlock(encData, clrData, ks + (j << 4));
+                    clrData += 16;
+                    encData += 16;
                 }
-                
-                j = 15;
-                do {
-                    ctx->InitVector[j]++;
-                    cb = ctx->InitVector[j] == 0;
-                } while( j-- && cb ); 
             }
             
             break;
@@ -1279,10 +1304,9 @@ int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, i
             for (i = 0; i < nBlk; i++) 
             {
                 B5_rijndaelEncrypt(ctx, ctx->rk, ctx->Nr, ctx->InitVector, ctx->InitVector);
-                for (j = 0; j < 16; j++) 
-                {
-                    *encData++ = *clrData++ ^ ctx->InitVector[j];
-                }
+                B5_AesXorBlock(encData, clrData, ctx->InitVector);
+                clrData += 16;
+                encData += 16;
             }
             
             break;
@@ -1320,16 +1344,9 @@ int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, i
         {
             for (i = 0; i < nBlk; i++) 
             {
-                for (j = 0; j < 16; j++) 
-                {
-                    tmp[j] = clrData[j] ^ ctx->InitVector[j];
-                }      
-                
+                B5_AesXorBlock(tmp, clrData, ctx->InitVector);
                 B5_rijndaelEncrypt(ctx, ctx->rk, ctx->Nr, tmp, encData);
-                for (j = 0; j < 16; j++) 
-                {
-                    ctx->InitVector[j] = encData[j];
-                }
+                memcpy(ctx->InitVector, encData, B5_AES_BLK_SIZE);
                 
                 clrData += 16;
                 encData += 16;
@@ -1343,17 +1360,10 @@ int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, i
         {
             for (i = 0; i < nBlk; i++) 
             {
-                for (j = 0; j < 16; j++) 
-                {
-                    tmp[j] = encData[j];
-                }
-                
+                memcpy(tmp, encData, B5_AES_BLK_SIZE);
                 B5_rijndaelDecrypt(ctx, ctx->rk, ctx->Nr, encData, clrData);
-                for (j = 0; j < 16; j++) 
-                {
-                    clrData[j] ^= ctx->InitVector[j];
-                    ctx->InitVector[j] = tmp[j];
-                }            
+                B5_AesXorBlock(clrData, clrData, ctx->InitVector);
+                memcpy(ctx->InitVector, tmp, B5_AES_BLK_SIZE);
                 
                 clrData += 16;
                 encData += 16;
@@ -1368,12 +1378,8 @@ int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, i
             for (i = 0; i < nBlk; i++) 
             {
                 B5_rijndaelEncrypt(ctx, ctx->rk, ctx->Nr, ctx->InitVector, tmp);             
-                for (j = 0; j < 16; j++) 
-                {
-                    encData[j] = clrData[j] ^ tmp[j];
-                    ctx->InitVector[j] = encData[j]; 
-                }      
-                
+                B5_AesXorBlock(encData, clrData, tmp);
+                memcpy(ctx->InitVector, encData, B5_AES_BLK_SIZE);
                 
                 clrData += 16;
                 encData += 16;
@@ -1388,11 +1394,8 @@ int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, i
             for (i = 0; i < nBlk; i++) 
             {
                 B5_rijndaelEncrypt(ctx, ctx->rk, ctx->Nr, ctx->InitVector, tmp);
-                for (j = 0; j < 16; j++) 
-                {
-                    ctx->InitVector[j] = encData[j];
-                    clrData[j] = encData[j] ^ tmp[j];
-                }            
+                memcpy(ctx->InitVector, encData, B5_AES_BLK_SIZE);
+                B5_AesXorBlock(clrData, encData, tmp);
                 
                 clrData += 16;
                 encData += 16;
@@ -1414,6 +1417,30 @@ int32_t B5_Aes256_Update (B5_tAesCtx	*ctx, uint8_t *encData, uint8_t *clrData, i
     return B5_AES256_RES_OK;
 }
 
+int32_t B5_Aes256_Keystream (B5_tAesCtx *ctx, uint8_t *keystream, int16_t nBlk)
+{
+    int16_t    i;
+    
+    
+    if(ctx == NULL)
+        return  B5_AES256_RES_INVALID_CONTEXT;
+    
+    if((keystream == NULL) || (nBlk <= 0))
+        return B5_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx->mode != B5_AES256_CTR)
+        return B5_AES256_RES_INVALID_MODE;
+    
+    for (i = 0; i < nBlk; i++) 
+    {
+        B5_rijndaelEncrypt(ctx, ctx->rk, ctx->Nr, ctx->InitVector, keystream);
+        B5_AesIncCounter(ctx->InitVector);
+        keystream += 16;
+    }
+    
+    return B5_AES256_RES_OK;
+}
+
 int32_t B5_Aes256_Finit (B5_tAesCtx    *ctx)
 {
     return B5_AES256_RES_OK;
@@ -1665,3 +1692,543 @@ int32_t B5_CmacAes256_Reset (B5_tCmacAesCtx *ctx)
     
     return B5_CMAC_AES256_RES_OK;
 }
+
+enum {
+    B5_GCM_STATE_IDLE = 0,  /**< No message in progress, B5_GcmAes256_Start must be called */
+    B5_GCM_STATE_AAD = 1,   /**< Accepting additional authenticated data */
+    B5_GCM_STATE_DATA = 2   /**< Accepting data */
+};
+
+/* Reduction of the four bits shifted out of the GHASH accumulator (Shoup's method). */
+static const uint16_t B5_GcmLast4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+/**
+ * @brief Multiply the GHASH accumulator by H, four bits at a time.
+ * @param ctx Pointer to the current AES-GCM context.
+ */
+static void B5_GcmAes256_Mult (B5_tGcmAes256Ctx *ctx)
+{
+    int16_t    i;
+    uint8_t    lo, hi, rem;
+    uint64_t   zh, zl;
+    
+    lo = ctx->X[15] & 0x0F;
+    zh = ctx->HH[lo];
+    zl = ctx->HL[lo];
+    
+    for (i = 15; i >= 0; i--) 
+    {
+        lo = ctx->X[i] & 0x0F;
+        hi = (ctx->X[i] >> 4) & 0x0F;
+        
+        if (i != 15) 
+        {
+            rem = (uint8_t)(zl & 0x0F);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ ((uint64_t)B5_GcmLast4[rem] << 48);
+            zh ^= ctx->HH[lo];
+            zl ^= ctx->HL[lo];
+        }
+        
+        rem = (uint8_t)(zl & 0x0F);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ ((uint64_t)B5_GcmLast4[rem] << 48);
+        zh ^= ctx->HH[hi];
+        zl ^= ctx->HL[hi];
+    }
+    
+    B5_AES256_PUTUINT32(ctx->X, (uint32_t)(zh >> 32));
+    B5_AES256_PUTUINT32(ctx->X + 4, (uint32_t)zh);
+    B5_AES256_PUTUINT32(ctx->X + 8, (uint32_t)(zl >> 32));
+    B5_AES256_PUTUINT32(ctx->X + 12, (uint32_t)zl);
+}
+
+/**
+ * @brief Absorb data into the GHASH accumulator.
+ * @param ctx Pointer to the current AES-GCM context.
+ * @param data Pointer to the data.
+ * @param dataLen Bytes to be absorbed.
+ * @param pos Bytes of the current block already absorbed.
+ */
+static void B5_GcmAes256_Hash (B5_tGcmAes256Ctx *ctx, const uint8_t *data, int32_t dataLen, uint8_t pos)
+{
+    while (dataLen > 0) 
+    {
+        if ((pos == 0) && (dataLen >= B5_AES_BLK_SIZE)) 
+        {
+            B5_AesXorBlock(ctx->X, ctx->X, data);
+            B5_GcmAes256_Mult(ctx);
+            data += B5_AES_BLK_SIZE;
+            dataLen -= B5_AES_BLK_SIZE;
+            continue;
+        }
+        ctx->X[pos++] ^= *data++;
+        dataLen--;
+        if (pos == B5_AES_BLK_SIZE) 
+        {
+            B5_GcmAes256_Mult(ctx);
+            pos = 0;
+        }
+    }
+}
+
+/**
+ * @brief Run the GCM counter over whole blocks. Only the low 32 bits of the counter are incremented.
+ * @param ctx Pointer to the current AES-GCM context.
+ * @param outData Output blocks.
+ * @param inData Input blocks, may be the same as outData.
+ * @param nBlk Number of blocks.
+ */
+static void B5_GcmAes256_Ctr (B5_tGcmAes256Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t nBlk)
+{
+    uint32_t   n, room;
+    
+    while (nBlk > 0) 
+    {
+        // blocks left before the low word wraps, 0 stands for 2^32
+        room = 0 - B5_AES256_GETUINT32(ctx->aesCtx.InitVector + 12);
+        n = (nBlk > 0x4000) ? 0x4000 : (uint32_t)nBlk;
+        if ((room != 0) && (n > room))
+            n = room;
+        
+        B5_Aes256_Update(&ctx->aesCtx, outData, (uint8_t*)inData, (int16_t)n);
+        // drop any carry out of the low word
+        memcpy(ctx->aesCtx.InitVector, ctx->J0, B5_AES_BLK_SIZE - 4);
+        
+        outData += n << 4;
+        inData += n << 4;
+        nBlk -= (int32_t)n;
+    }
+}
+
+int32_t B5_GcmAes256_Init (B5_tGcmAes256Ctx *ctx, const uint8_t *Key, int16_t keySize, uint8_t gcmMode)
+{
+    uint8_t    H[B5_AES_BLK_SIZE];
+    uint64_t   vh, vl;
+    uint32_t   T;
+    int16_t    i, j;
+    
+    
+    if(Key == NULL) 
+        return B5_GCM_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx == NULL)
+        return  B5_GCM_AES256_RES_INVALID_CONTEXT;
+    
+    memset(ctx, 0, sizeof(B5_tGcmAes256Ctx));
+    
+    if((gcmMode != B5_GCM_AES256_ENC) && (gcmMode != B5_GCM_AES256_DEC))
+        return B5_GCM_AES256_RES_INVALID_ARGUMENT;
+    
+    if(B5_Aes256_Init(&ctx->aesCtx, Key, keySize, B5_AES256_CTR) != B5_AES256_RES_OK)
+        return B5_GCM_AES256_RES_INVALID_KEY_SIZE;
+    
+    ctx->mode = gcmMode;
+    
+    
+    // H = E(K, 0^128)
+    memset(H, 0x00, sizeof(H));
+    B5_rijndaelEncrypt(&ctx->aesCtx, ctx->aesCtx.rk, ctx->aesCtx.Nr, H, H);
+    
+    vh = ((uint64_t)B5_AES256_GETUINT32(H) << 32) | B5_AES256_GETUINT32(H + 4);
+    vl = ((uint64_t)B5_AES256_GETUINT32(H + 8) << 32) | B5_AES256_GETUINT32(H + 12);
+    
+    // Multiples of H for every 4-bit value: first the powers of two, then their sums
+    ctx->HL[8] = vl;
+    ctx->HH[8] = vh;
+    for (i = 4; i > 0; i >>= 1) 
+    {
+        T = (uint32_t)(vl & 1) * 0xE1000000U;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)T << 32);
+        ctx->HL[i] = vl;
+        ctx->HH[i] = vh;
+    }
+    for (i = 2; i <= 8; i <<= 1) 
+    {
+        for (j = 1; j < i; j++) 
+        {
+            ctx->HH[i + j] = ctx->HH[i] ^ ctx->HH[j];
+            ctx->HL[i + j] = ctx->HL[i] ^ ctx->HL[j];
+        }
+    }
+    
+    memset(H, 0x00, sizeof(H));
+    ctx->state = B5_GCM_STATE_IDLE;
+    
+    return B5_GCM_AES256_RES_OK;
+}
+
+int32_t B5_GcmAes256_Start (B5_tGcmAes256Ctx *ctx, const uint8_t *IV, int32_t ivLen)
+{
+    uint8_t    lenBlk[B5_AES_BLK_SIZE];
+    
+    
+    if(ctx == NULL)
+        return  B5_GCM_AES256_RES_INVALID_CONTEXT;
+    
+    if((IV == NULL) || (ivLen <= 0))
+        return B5_GCM_AES256_RES_INVALID_ARGUMENT;
+    
+    
+    memset(ctx->X, 0x00, sizeof(ctx->X));
+    
+    if (ivLen == B5_GCM_AES_IV_SIZE) 
+    {
+        // J0 = IV || 0^31 || 1
+        memcpy(ctx->J0, IV, B5_GCM_AES_IV_SIZE);
+        B5_AES256_PUTUINT32(ctx->J0 + 12, 1);
+    }
+    else
+    {
+        // J0 = GHASH(IV || 0^s || 0^64 || [len(IV)]64)
+        B5_GcmAes256_Hash(ctx, IV, ivLen, 0);
+        if ((ivLen & 0x0F) != 0)
+            B5_GcmAes256_Mult(ctx);
+        memset(lenBlk, 0x00, sizeof(lenBlk));
+        B5_AES256_PUTUINT32(lenBlk + 8, (uint32_t)ivLen >> 29);
+        B5_AES256_PUTUINT32(lenBlk + 12, (uint32_t)ivLen << 3);
+        B5_GcmAes256_Hash(ctx, lenBlk, B5_AES_BLK_SIZE, 0);
+        memcpy(ctx->J0, ctx->X, B5_AES_BLK_SIZE);
+        memset(ctx->X, 0x00, sizeof(ctx->X));
+    }
+    
+    // The first data block uses inc32(J0)
+    memcpy(ctx->aesCtx.InitVector, ctx->J0, B5_AES_BLK_SIZE);
+    B5_AES256_PUTUINT32(ctx->aesCtx.InitVector + 12, B5_AES256_GETUINT32(ctx->J0 + 12) + 1);
+    
+    ctx->aadLen = 0;
+    ctx->dataLen = 0;
+    ctx->state = B5_GCM_STATE_AAD;
+    
+    return B5_GCM_AES256_RES_OK;
+}
+
+int32_t B5_GcmAes256_Aad (B5_tGcmAes256Ctx *ctx, const uint8_t *aad, int32_t aadLen)
+{
+    if(ctx == NULL)
+        return  B5_GCM_AES256_RES_INVALID_CONTEXT;
+    
+    if((aad == NULL) || (aadLen < 0))
+        return B5_GCM_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state != B5_GCM_STATE_AAD)
+        return B5_GCM_AES256_RES_INVALID_STATE;
+    
+    
+    B5_GcmAes256_Hash(ctx, aad, aadLen, (uint8_t)(ctx->aadLen & 0x0F));
+    ctx->aadLen += (uint64_t)aadLen;
+    
+    return B5_GCM_AES256_RES_OK;
+}
+
+int32_t B5_GcmAes256_Update (B5_tGcmAes256Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t dataLen)
+{
+    int32_t    i, n;
+    uint8_t    pos, c;
+    
+    
+    if(ctx == NULL)
+        return  B5_GCM_AES256_RES_INVALID_CONTEXT;
+    
+    if((outData == NULL) || (inData == NULL) || (dataLen < 0))
+        return B5_GCM_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state == B5_GCM_STATE_IDLE)
+        return B5_GCM_AES256_RES_INVALID_STATE;
+    
+    
+    if(ctx->state == B5_GCM_STATE_AAD)
+    {
+        // Pad the AAD with zeros up to the block boundary
+        if ((ctx->aadLen & 0x0F) != 0)
+            B5_GcmAes256_Mult(ctx);
+        ctx->state = B5_GCM_STATE_DATA;
+    }
+    
+    
+    // Finish the block left open by the previous call
+    pos = (uint8_t)(ctx->dataLen & 0x0F);
+    while ((dataLen > 0) && (pos != 0)) 
+    {
+        c = *inData ^ ctx->ks[pos];
+        ctx->X[pos] ^= (ctx->mode == B5_GCM_AES256_ENC) ? c : *inData;
+        *outData++ = c;
+        inData++;
+        dataLen--;
+        ctx->dataLen++;
+        pos = (pos + 1) & 0x0F;
+        if (pos == 0)
+            B5_GcmAes256_Mult(ctx);
+    }
+    
+    
+    // Whole blocks: the ciphertext is hashed before decryption, as outData may alias inData
+    n = dataLen >> 4;
+    if (n > 0) 
+    {
+        if (ctx->mode == B5_GCM_AES256_DEC)
+            B5_GcmAes256_Hash(ctx, inData, n << 4, 0);
+        B5_GcmAes256_Ctr(ctx, outData, inData, n);
+        if (ctx->mode == B5_GCM_AES256_ENC)
+            B5_GcmAes256_Hash(ctx, outData, n << 4, 0);
+        
+        inData += n << 4;
+        outData += n << 4;
+        dataLen -= n << 4;
+        ctx->dataLen += (uint64_t)(n << 4);
+    }
+    
+    
+    // Open a new block with the remaining bytes
+    if (dataLen > 0) 
+    {
+        memset(ctx->ks, 0x00, sizeof(ctx->ks));
+        B5_GcmAes256_Ctr(ctx, ctx->ks, ctx->ks, 1);
+        for (i = 0; i < dataLen; i++) 
+        {
+            c = inData[i] ^ ctx->ks[i];
+            ctx->X[i] ^= (ctx->mode == B5_GCM_AES256_ENC) ? c : inData[i];
+            outData[i] = c;
+        }
+        ctx->dataLen += (uint64_t)dataLen;
+    }
+    
+    return B5_GCM_AES256_RES_OK;
+}
+
+int32_t B5_GcmAes256_Finit (B5_tGcmAes256Ctx *ctx, uint8_t *rTag)
+{
+    uint8_t    lenBlk[B5_AES_BLK_SIZE];
+    uint8_t    EkJ0[B5_AES_BLK_SIZE];
+    
+    
+    if(ctx == NULL)
+        return B5_GCM_AES256_RES_INVALID_CONTEXT;
+    
+    if(rTag == NULL)
+        return B5_GCM_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state == B5_GCM_STATE_IDLE)
+        return B5_GCM_AES256_RES_INVALID_STATE;
+    
+    
+    // Close the last partial block
+    if (((ctx->state == B5_GCM_STATE_AAD) && ((ctx->aadLen & 0x0F) != 0)) ||
+        ((ctx->state == B5_GCM_STATE_DATA) && ((ctx->dataLen & 0x0F) != 0)))
+        B5_GcmAes256_Mult(ctx);
+    
+    // [len(A)]64 || [len(C)]64, in bits
+    B5_AES256_PUTUINT32(lenBlk, (uint32_t)(ctx->aadLen >> 29));
+    B5_AES256_PUTUINT32(lenBlk + 4, (uint32_t)(ctx->aadLen << 3));
+    B5_AES256_PUTUINT32(lenBlk + 8, (uint32_t)(ctx->dataLen >> 29));
+    B5_AES256_PUTUINT32(lenBlk + 12, (uint32_t)(ctx->dataLen << 3));
+    B5_AesXorBlock(ctx->X, ctx->X, lenBlk);
+    B5_GcmAes256_Mult(ctx);
+    
+    // T = E(K, J0) ^ S
+    B5_rijndaelEncrypt(&ctx->aesCtx, ctx->aesCtx.rk, ctx->aesCtx.Nr, ctx->J0, EkJ0);
+    B5_AesXorBlock(rTag, ctx->X, EkJ0);
+    
+    memset(EkJ0, 0x00, sizeof(EkJ0));
+    ctx->state = B5_GCM_STATE_IDLE;
+    
+    return B5_GCM_AES256_RES_OK;
+}
+
+enum {
+    B5_EAX_STATE_IDLE = 0,  /**< No message in progress, B5_EaxAes256_Start must be called */
+    B5_EAX_STATE_AAD = 1,   /**< Accepting additional authenticated data */
+    B5_EAX_STATE_DATA = 2   /**< Accepting data */
+};
+
+/**
+ * @brief Restart the CMAC with the EAX domain separation block [t]_16 (15 zero bytes and t).
+ * @param ctx Pointer to the current AES-EAX context.
+ * @param t Tweak, 0 for the nonce, 1 for the additional data, 2 for the ciphertext.
+ */
+static void B5_EaxAes256_Omac (B5_tEaxAes256Ctx *ctx, uint8_t t)
+{
+    uint8_t    tBlk[B5_AES_BLK_SIZE];
+    
+    memset(tBlk, 0x00, sizeof(tBlk));
+    tBlk[B5_AES_BLK_SIZE - 1] = t;
+    B5_CmacAes256_Reset(&ctx->cmacCtx);
+    B5_CmacAes256_Update(&ctx->cmacCtx, tBlk, B5_AES_BLK_SIZE);
+}
+
+/**
+ * @brief XOR data with the CTR keystream, continuing a partial block left by the previous call.
+ * @param ctx Pointer to the current AES-EAX context.
+ * @param outData Output data, may be the same as inData.
+ * @param inData Input data.
+ * @param dataLen Bytes to be processed.
+ */
+static void B5_EaxAes256_Ctr (B5_tEaxAes256Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t dataLen)
+{
+    B5_tAesCtx *aes = &ctx->cmacCtx.aesCtx;
+    int32_t    i;
+    
+    while ((ctx->ksPos != 0) && (dataLen > 0))
+    {
+        *outData++ = *inData++ ^ ctx->ks[ctx->ksPos];
+        ctx->ksPos = (ctx->ksPos + 1) & 0x0F;
+        dataLen--;
+    }
+    
+    while (dataLen >= B5_AES_BLK_SIZE)
+    {
+        B5_rijndaelEncrypt(aes, aes->rk, aes->Nr, ctx->ctr, ctx->ks);
+        B5_AesIncCounter(ctx->ctr);
+        B5_AesXorBlock(outData, inData, ctx->ks);
+        inData += B5_AES_BLK_SIZE;
+        outData += B5_AES_BLK_SIZE;
+        dataLen -= B5_AES_BLK_SIZE;
+    }
+    
+    if (dataLen > 0)
+    {
+        B5_rijndaelEncrypt(aes, aes->rk, aes->Nr, ctx->ctr, ctx->ks);
+        B5_AesIncCounter(ctx->ctr);
+        for (i = 0; i < dataLen; i++)
+            outData[i] = inData[i] ^ ctx->ks[i];
+        ctx->ksPos = (uint8_t)dataLen;
+    }
+}
+
+int32_t B5_EaxAes256_Init (B5_tEaxAes256Ctx *ctx, const uint8_t *Key, int16_t keySize, uint8_t eaxMode)
+{
+    if(Key == NULL) 
+        return B5_EAX_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx == NULL)
+        return  B5_EAX_AES256_RES_INVALID_CONTEXT;
+    
+    memset(ctx, 0, sizeof(B5_tEaxAes256Ctx));
+    
+    if((eaxMode != B5_EAX_AES256_ENC) && (eaxMode != B5_EAX_AES256_DEC))
+        return B5_EAX_AES256_RES_INVALID_ARGUMENT;
+    
+    if((keySize != B5_AES_128) && (keySize != B5_AES_192) && (keySize != B5_AES_256)) 
+        return B5_EAX_AES256_RES_INVALID_KEY_SIZE;
+    
+    if(B5_CmacAes256_Init(&ctx->cmacCtx, Key, keySize) != B5_CMAC_AES256_RES_OK)
+        return B5_EAX_AES256_RES_INVALID_KEY_SIZE;
+    
+    ctx->mode = eaxMode;
+    ctx->state = B5_EAX_STATE_IDLE;
+    
+    return B5_EAX_AES256_RES_OK;
+}
+
+int32_t B5_EaxAes256_Start (B5_tEaxAes256Ctx *ctx, const uint8_t *nonce, int32_t nonceLen)
+{
+    if(ctx == NULL)
+        return  B5_EAX_AES256_RES_INVALID_CONTEXT;
+    
+    if((nonce == NULL) || (nonceLen < 0))
+        return B5_EAX_AES256_RES_INVALID_ARGUMENT;
+    
+    
+    // N = OMAC0(nonce), also the first counter block
+    B5_EaxAes256_Omac(ctx, 0);
+    B5_CmacAes256_Update(&ctx->cmacCtx, nonce, nonceLen);
+    B5_CmacAes256_Finit(&ctx->cmacCtx, ctx->N);
+    memcpy(ctx->ctr, ctx->N, B5_AES_BLK_SIZE);
+    ctx->ksPos = 0;
+    
+    // The additional data goes to OMAC1 until the first data arrives
+    B5_EaxAes256_Omac(ctx, 1);
+    ctx->state = B5_EAX_STATE_AAD;
+    
+    return B5_EAX_AES256_RES_OK;
+}
+
+int32_t B5_EaxAes256_Aad (B5_tEaxAes256Ctx *ctx, const uint8_t *aad, int32_t aadLen)
+{
+    if(ctx == NULL)
+        return  B5_EAX_AES256_RES_INVALID_CONTEXT;
+    
+    if((aad == NULL) || (aadLen < 0))
+        return B5_EAX_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state != B5_EAX_STATE_AAD)
+        return B5_EAX_AES256_RES_INVALID_STATE;
+    
+    
+    B5_CmacAes256_Update(&ctx->cmacCtx, aad, aadLen);
+    
+    return B5_EAX_AES256_RES_OK;
+}
+
+int32_t B5_EaxAes256_Update (B5_tEaxAes256Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t dataLen)
+{
+    if(ctx == NULL)
+        return  B5_EAX_AES256_RES_INVALID_CONTEXT;
+    
+    if((outData == NULL) || (inData == NULL) || (dataLen < 0))
+        return B5_EAX_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state == B5_EAX_STATE_IDLE)
+        return B5_EAX_AES256_RES_INVALID_STATE;
+    
+    
+    // H = OMAC1(aad), then the ciphertext goes to OMAC2
+    if(ctx->state == B5_EAX_STATE_AAD)
+    {
+        B5_CmacAes256_Finit(&ctx->cmacCtx, ctx->H);
+        B5_EaxAes256_Omac(ctx, 2);
+        ctx->state = B5_EAX_STATE_DATA;
+    }
+    
+    // The ciphertext is authenticated before decryption, as outData may alias inData
+    if(ctx->mode == B5_EAX_AES256_DEC)
+    {
+        B5_CmacAes256_Update(&ctx->cmacCtx, inData, dataLen);
+        B5_EaxAes256_Ctr(ctx, outData, inData, dataLen);
+    }
+    else
+    {
+        B5_EaxAes256_Ctr(ctx, outData, inData, dataLen);
+        B5_CmacAes256_Update(&ctx->cmacCtx, outData, dataLen);
+    }
+    
+    return B5_EAX_AES256_RES_OK;
+}
+
+int32_t B5_EaxAes256_Finit (B5_tEaxAes256Ctx *ctx, uint8_t *rTag)
+{
+    uint8_t    C[B5_AES_BLK_SIZE];
+    
+    
+    if(ctx == NULL)
+        return B5_EAX_AES256_RES_INVALID_CONTEXT;
+    
+    if(rTag == NULL)
+        return B5_EAX_AES256_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state == B5_EAX_STATE_IDLE)
+        return B5_EAX_AES256_RES_INVALID_STATE;
+    
+    
+    // A message without data still authenticates an empty ciphertext
+    if(ctx->state == B5_EAX_STATE_AAD)
+    {
+        B5_CmacAes256_Finit(&ctx->cmacCtx, ctx->H);
+        B5_EaxAes256_Omac(ctx, 2);
+    }
+    B5_CmacAes256_Finit(&ctx->cmacCtx, C);
+    
+    // T = N ^ H ^ C
+    B5_AesXorBlock(rTag, ctx->N, ctx->H);
+    B5_AesXorBlock(rTag, rTag, C);
+    
+    memset(C, 0x00, sizeof(C));
+    memset(ctx->ks, 0x00, sizeof(ctx->ks));
+    ctx->state = B5_EAX_STATE_IDLE;
+    
+    return B5_EAX_AES256_RES_OK;
+}
@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+  * File Name          : blake2s.c
+  * Description        : This file includes the implementation of the functions
+  *                      for computing the BLAKE2s-256 digest (RFC 7693).
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#include "blake2s.h"
+
+static const uint32_t B5_Blake2s_IV[8] =
+{
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint8_t B5_Blake2s_Sigma[10][16] =
+{
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define GETUINT32_LE(n,b,i)                             \
+{                                                       \
+    (n) = ( (uint32_t) (b)[(i)    ]       )             \
+        | ( (uint32_t) (b)[(i) + 1] <<  8 )             \
+        | ( (uint32_t) (b)[(i) + 2] << 16 )             \
+        | ( (uint32_t) (b)[(i) + 3] << 24 );            \
+}
+
+#define PUTUINT32_LE(n,b,i)                             \
+{                                                       \
+    (b)[(i)    ] = (uint8_t) ( (n)       );             \
+    (b)[(i) + 1] = (uint8_t) ( (n) >>  8 );             \
+    (b)[(i) + 2] = (uint8_t) ( (n) >> 16 );             \
+    (b)[(i) + 3] = (uint8_t) ( (n) >> 24 );             \
+}
+
+#define B5_BLAKE2S_ROTR(x,n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define B5_BLAKE2S_G(a,b,c,d,x,y)                       \
+do {                                                    \
+    a = a + b + (x); d = B5_BLAKE2S_ROTR(d ^ a, 16);    \
+    c = c + d;       b = B5_BLAKE2S_ROTR(b ^ c, 12);    \
+    a = a + b + (y); d = B5_BLAKE2S_ROTR(d ^ a,  8);    \
+    c = c + d;       b = B5_BLAKE2S_ROTR(b ^ c,  7);    \
+} while(0)
+
+/**
+ * @brief Compress one block into the chained state.
+ * @param ctx Pointer to the current BLAKE2s context.
+ * @param data 64 bytes block.
+ * @param last 1 for the final block of the message.
+ */
+static void B5_Blake2s_Compress (B5_tBlake2sCtx *ctx, const uint8_t data[64], uint8_t last)
+{
+    uint32_t m[16];
+    uint32_t v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15;
+    const uint8_t *s;
+    int32_t i;
+    
+    for (i = 0; i < 16; i++)
+        GETUINT32_LE(m[i], data, 4 * i);
+    
+    v0 = ctx->h[0]; v1 = ctx->h[1]; v2 = ctx->h[2]; v3 = ctx->h[3];
+    v4 = ctx->h[4]; v5 = ctx->h[5]; v6 = ctx->h[6]; v7 = ctx->h[7];
+    v8 = B5_Blake2s_IV[0]; v9 = B5_Blake2s_IV[1]; v10 = B5_Blake2s_IV[2]; v11 = B5_Blake2s_IV[3];
+    v12 = B5_Blake2s_IV[4] ^ ctx->t[0];
+    v13 = B5_Blake2s_IV[5] ^ ctx->t[1];
+    v14 = last ? ~B5_Blake2s_IV[6] : B5_Blake2s_IV[6];
+    v15 = B5_Blake2s_IV[7];
+    
+    for (i = 0; i < 10; i++)
+    {
+        s = B5_Blake2s_Sigma[i];
+        B5_BLAKE2S_G(v0, v4,  v8, v12, m[s[ 0]], m[s[ 1]]);
+        B5_BLAKE2S_G(v1, v5,  v9, v13, m[s[ 2]], m[s[ 3]]);
+        B5_BLAKE2S_G(v2, v6, v10, v14, m[s[ 4]], m[s[ 5]]);
+        B5_BLAKE2S_G(v3, v7, v11, v15, m[s[ 6]], m[s[ 7]]);
+        B5_BLAKE2S_G(v0, v5, v10, v15, m[s[ 8]], m[s[ 9]]);
+        B5_BLAKE2S_G(v1, v6, v11, v12, m[s[10]], m[s[11]]);
+        B5_BLAKE2S_G(v2, v7,  v8, v13, m[s[12]], m[s[13]]);
+        B5_BLAKE2S_G(v3, v4,  v9, v14, m[s[14]], m[s[15]]);
+    }
+    
+    ctx->h[0] ^= v0 ^ v8;  ctx->h[1] ^= v1 ^ v9;
+    ctx->h[2] ^= v2 ^ v10; ctx->h[3] ^= v3 ^ v11;
+    ctx->h[4] ^= v4 ^ v12; ctx->h[5] ^= v5 ^ v13;
+    ctx->h[6] ^= v6 ^ v14; ctx->h[7] ^= v7 ^ v15;
+}
+
+/**
+ * @brief Add the bytes of the next block to the counter.
+ * @param ctx Pointer to the current BLAKE2s context.
+ * @param inc Bytes to add.
+ */
+static void B5_Blake2s_Increment (B5_tBlake2sCtx *ctx, uint32_t inc)
+{
+    ctx->t[0] += inc;
+    if (ctx->t[0] < inc)
+        ctx->t[1]++;
+}
+
+int32_t B5_Blake2s_Init (B5_tBlake2sCtx *ctx, const uint8_t *Key, int16_t keySize)
+{
+    int32_t i;
+    
+    
+    if(ctx == NULL)
+        return B5_BLAKE2S_RES_INVALID_CONTEXT;
+    
+    if((keySize < 0) || (keySize > B5_BLAKE2S_MAX_KEY_SIZE))
+        return B5_BLAKE2S_RES_INVALID_KEY_SIZE;
+    
+    if((keySize > 0) && (Key == NULL))
+        return B5_BLAKE2S_RES_INVALID_ARGUMENT;
+    
+    
+    memset(ctx, 0, sizeof(B5_tBlake2sCtx));
+    
+    for (i = 0; i < 8; i++)
+        ctx->h[i] = B5_Blake2s_IV[i];
+    
+    // parameter block: digest length, key length, fanout = depth = 1
+    ctx->h[0] ^= 0x01010000 ^ ((uint32_t)keySize << 8) ^ B5_BLAKE2S_DIGEST_SIZE;
+    
+    // a key is absorbed as a whole zero-padded first block
+    if (keySize > 0)
+    {
+        memcpy(ctx->buffer, Key, keySize);
+        ctx->bufLen = B5_BLAKE2S_BLOCK_SIZE;
+    }
+    
+    return B5_BLAKE2S_RES_OK;
+}
+
+int32_t B5_Blake2s_Update (B5_tBlake2sCtx *ctx, const uint8_t *data, int32_t dataLen)
+{
+    int32_t fill;
+    
+    
+    if(ctx == NULL)
+        return B5_BLAKE2S_RES_INVALID_CONTEXT;
+    
+    if((data == NULL) || (dataLen < 0))
+        return B5_BLAKE2S_RES_INVALID_ARGUMENT;
+    
+    if(dataLen == 0)
+        return B5_BLAKE2S_RES_OK;
+    
+    
+    // The last block needs the final flag, so a full buffer is compressed only once more data is known to follow
+    fill = B5_BLAKE2S_BLOCK_SIZE - ctx->bufLen;
+    if (dataLen > fill)
+    {
+        memcpy(ctx->buffer + ctx->bufLen, data, fill);
+        B5_Blake2s_Increment(ctx, B5_BLAKE2S_BLOCK_SIZE);
+        B5_Blake2s_Compress(ctx, ctx->buffer, 0);
+        ctx->bufLen = 0;
+        data += fill;
+        dataLen -= fill;
+        
+        while (dataLen > B5_BLAKE2S_BLOCK_SIZE)
+        {
+            B5_Blake2s_Increment(ctx, B5_BLAKE2S_BLOCK_SIZE);
+            B5_Blake2s_Compress(ctx, data, 0);
+            data += B5_BLAKE2S_BLOCK_SIZE;
+            dataLen -= B5_BLAKE2S_BLOCK_SIZE;
+        }
+    }
+    
+    memcpy(ctx->buffer + ctx->bufLen, data, dataLen);
+    ctx->bufLen += (uint8_t)dataLen;
+    
+    return B5_BLAKE2S_RES_OK;
+}
+
+int32_t B5_Blake2s_Finit (B5_tBlake2sCtx *ctx, uint8_t *rDigest)
+{
+    int32_t i;
+    
+    
+    if(ctx == NULL)
+        return B5_BLAKE2S_RES_INVALID_CONTEXT;
+    
+    if(rDigest == NULL)
+        return B5_BLAKE2S_RES_INVALID_ARGUMENT;
+    
+    
+    B5_Blake2s_Increment(ctx, ctx->bufLen);
+    memset(ctx->buffer + ctx->bufLen, 0, B5_BLAKE2S_BLOCK_SIZE - ctx->bufLen);
+    B5_Blake2s_Compress(ctx, ctx->buffer, 1);
+    
+    for (i = 0; i < 8; i++)
+        PUTUINT32_LE(ctx->h[i], rDigest, 4 * i);
+    
+    memset(ctx, 0, sizeof(B5_tBlake2sCtx));
+    
+    return B5_BLAKE2S_RES_OK;
+}
@@ -0,0 +1,488 @@
+/**
+  ******************************************************************************
+  * File Name          : chacha20poly1305.c
+  * Description        : This file includes the implementation of the functions
+  *                      for computing the ChaCha20-Poly1305 AEAD (RFC 8439).
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+
+#include "chacha20poly1305.h"
+
+enum {
+    B5_CHACHA20_STATE_IDLE = 0,  /**< No message in progress, B5_ChaCha20Poly1305_Start must be called */
+    B5_CHACHA20_STATE_AAD = 1,   /**< Accepting additional authenticated data */
+    B5_CHACHA20_STATE_DATA = 2   /**< Accepting data */
+};
+
+#define B5_CHACHA20_U8TO32(p)                                           \
+(                                                                       \
+      ( (uint32_t) (p)[0]       )                                       \
+    | ( (uint32_t) (p)[1] <<  8 )                                       \
+    | ( (uint32_t) (p)[2] << 16 )                                       \
+    | ( (uint32_t) (p)[3] << 24 )                                       \
+)
+
+#define B5_CHACHA20_U32TO8(p,v)                                         \
+do {                                                                    \
+    (p)[0] = (uint8_t) ( (v)       );                                   \
+    (p)[1] = (uint8_t) ( (v) >>  8 );                                   \
+    (p)[2] = (uint8_t) ( (v) >> 16 );                                   \
+    (p)[3] = (uint8_t) ( (v) >> 24 );                                   \
+} while(0)
+
+#define B5_CHACHA20_ROTL(x,n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define B5_CHACHA20_QR(a,b,c,d)                                         \
+do {                                                                    \
+    a += b; d ^= a; d = B5_CHACHA20_ROTL(d, 16);                        \
+    c += d; b ^= c; b = B5_CHACHA20_ROTL(b, 12);                        \
+    a += b; d ^= a; d = B5_CHACHA20_ROTL(d,  8);                        \
+    c += d; b ^= c; b = B5_CHACHA20_ROTL(b,  7);                        \
+} while(0)
+
+/**
+ * @brief Compute the next ChaCha20 keystream block and advance the block counter.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param out 64 bytes output.
+ */
+static void B5_ChaCha20_Block (B5_tChaCha20Poly1305Ctx *ctx, uint8_t *out)
+{
+    uint32_t x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
+    int32_t i;
+    
+    x0 = ctx->input[0];   x1 = ctx->input[1];   x2 = ctx->input[2];   x3 = ctx->input[3];
+    x4 = ctx->input[4];   x5 = ctx->input[5];   x6 = ctx->input[6];   x7 = ctx->input[7];
+    x8 = ctx->input[8];   x9 = ctx->input[9];   x10 = ctx->input[10]; x11 = ctx->input[11];
+    x12 = ctx->input[12]; x13 = ctx->input[13]; x14 = ctx->input[14]; x15 = ctx->input[15];
+    
+    for (i = 0; i < 10; i++)
+    {
+        // column round
+        B5_CHACHA20_QR(x0, x4,  x8, x12);
+        B5_CHACHA20_QR(x1, x5,  x9, x13);
+        B5_CHACHA20_QR(x2, x6, x10, x14);
+        B5_CHACHA20_QR(x3, x7, x11, x15);
+        // diagonal round
+        B5_CHACHA20_QR(x0, x5, x10, x15);
+        B5_CHACHA20_QR(x1, x6, x11, x12);
+        B5_CHACHA20_QR(x2, x7,  x8, x13);
+        B5_CHACHA20_QR(x3, x4,  x9, x14);
+    }
+    
+    x0 += ctx->input[0];   x1 += ctx->input[1];   x2 += ctx->input[2];   x3 += ctx->input[3];
+    x4 += ctx->input[4];   x5 += ctx->input[5];   x6 += ctx->input[6];   x7 += ctx->input[7];
+    x8 += ctx->input[8];   x9 += ctx->input[9];   x10 += ctx->input[10]; x11 += ctx->input[11];
+    x12 += ctx->input[12]; x13 += ctx->input[13]; x14 += ctx->input[14]; x15 += ctx->input[15];
+    
+    B5_CHACHA20_U32TO8(out +  0, x0);  B5_CHACHA20_U32TO8(out +  4, x1);
+    B5_CHACHA20_U32TO8(out +  8, x2);  B5_CHACHA20_U32TO8(out + 12, x3);
+    B5_CHACHA20_U32TO8(out + 16, x4);  B5_CHACHA20_U32TO8(out + 20, x5);
+    B5_CHACHA20_U32TO8(out + 24, x6);  B5_CHACHA20_U32TO8(out + 28, x7);
+    B5_CHACHA20_U32TO8(out + 32, x8);  B5_CHACHA20_U32TO8(out + 36, x9);
+    B5_CHACHA20_U32TO8(out + 40, x10); B5_CHACHA20_U32TO8(out + 44, x11);
+    B5_CHACHA20_U32TO8(out + 48, x12); B5_CHACHA20_U32TO8(out + 52, x13);
+    B5_CHACHA20_U32TO8(out + 56, x14); B5_CHACHA20_U32TO8(out + 60, x15);
+    
+    ctx->input[12]++;
+}
+
+/**
+ * @brief XOR a 64 bytes block with the keystream a word at a time.
+ * @param dst Output block, may be the same as src.
+ * @param src Input block.
+ * @param ks Keystream block.
+ */
+static void B5_ChaCha20_XorBlock (uint8_t *dst, const uint8_t *src, const uint8_t *ks)
+{
+    uint32_t x[16], y[16];
+    int32_t i;
+    
+    memcpy(x, src, B5_CHACHA20_BLOCK_SIZE);
+    memcpy(y, ks, B5_CHACHA20_BLOCK_SIZE);
+    for (i = 0; i < 16; i++)
+        x[i] ^= y[i];
+    memcpy(dst, x, B5_CHACHA20_BLOCK_SIZE);
+}
+
+/**
+ * @brief Absorb whole 16 bytes blocks into the Poly1305 accumulator.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param m Pointer to the blocks.
+ * @param bytes Number of bytes, multiple of 16.
+ * @param hibit 1 << 24 for full blocks, 0 for the padded final block.
+ */
+static void B5_Poly1305_Blocks (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *m, int32_t bytes, uint32_t hibit)
+{
+    uint32_t r0, r1, r2, r3, r4;
+    uint32_t s1, s2, s3, s4;
+    uint32_t h0, h1, h2, h3, h4;
+    uint64_t d0, d1, d2, d3, d4;
+    uint32_t c;
+    
+    r0 = ctx->r[0]; r1 = ctx->r[1]; r2 = ctx->r[2]; r3 = ctx->r[3]; r4 = ctx->r[4];
+    s1 = r1 * 5; s2 = r2 * 5; s3 = r3 * 5; s4 = r4 * 5;
+    h0 = ctx->h[0]; h1 = ctx->h[1]; h2 = ctx->h[2]; h3 = ctx->h[3]; h4 = ctx->h[4];
+    
+    while (bytes >= 16)
+    {
+        // h += m[i]
+        h0 += (B5_CHACHA20_U8TO32(m +  0)     ) & 0x3ffffff;
+        h1 += (B5_CHACHA20_U8TO32(m +  3) >> 2) & 0x3ffffff;
+        h2 += (B5_CHACHA20_U8TO32(m +  6) >> 4) & 0x3ffffff;
+        h3 += (B5_CHACHA20_U8TO32(m +  9) >> 6) & 0x3ffffff;
+        h4 += (B5_CHACHA20_U8TO32(m + 12) >> 8) | hibit;
+        
+        // h *= r
+        d0 = ((uint64_t)h0 * r0) + ((uint64_t)h1 * s4) + ((uint64_t)h2 * s3) + ((uint64_t)h3 * s2) + ((uint64_t)h4 * s1);
+        d1 = ((uint64_t)h0 * r1) + ((uint64_t)h1 * r0) + ((uint64_t)h2 * s4) + ((uint64_t)h3 * s3) + ((uint64_t)h4 * s2);
+        d2 = ((uint64_t)h0 * r2) + ((uint64_t)h1 * r1) + ((uint64_t)h2 * r0) + ((uint64_t)h3 * s4) + ((uint64_t)h4 * s3);
+        d3 = ((uint64_t)h0 * r3) + ((uint64_t)h1 * r2) + ((uint64_t)h2 * r1) + ((uint64_t)h3 * r0) + ((uint64_t)h4 * s4);
+        d4 = ((uint64_t)h0 * r4) + ((uint64_t)h1 * r3) + ((uint64_t)h2 * r2) + ((uint64_t)h3 * r1) + ((uint64_t)h4 * r0);
+        
+        // (partial) h %= p
+                  c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+        d1 += c;  c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+        d2 += c;  c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+        d3 += c;  c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+        d4 += c;  c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+        h0 += c * 5;  c = (h0 >> 26); h0 = h0 & 0x3ffffff;
+        h1 += c;
+        
+        m += 16;
+        bytes -= 16;
+    }
+    
+    ctx->h[0] = h0; ctx->h[1] = h1; ctx->h[2] = h2; ctx->h[3] = h3; ctx->h[4] = h4;
+}
+
+/**
+ * @brief Absorb data into Poly1305, keeping the last partial block in the context.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param m Pointer to the data.
+ * @param bytes Bytes to be absorbed.
+ */
+static void B5_Poly1305_Update (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *m, int32_t bytes)
+{
+    int32_t want;
+    
+    if (ctx->leftover)
+    {
+        want = 16 - ctx->leftover;
+        if (want > bytes)
+            want = bytes;
+        memcpy(ctx->buffer + ctx->leftover, m, want);
+        bytes -= want;
+        m += want;
+        ctx->leftover += (uint8_t)want;
+        if (ctx->leftover < 16)
+            return;
+        B5_Poly1305_Blocks(ctx, ctx->buffer, 16, (uint32_t)1 << 24);
+        ctx->leftover = 0;
+    }
+    
+    if (bytes >= 16)
+    {
+        want = bytes & ~15;
+        B5_Poly1305_Blocks(ctx, m, want, (uint32_t)1 << 24);
+        m += want;
+        bytes -= want;
+    }
+    
+    if (bytes)
+    {
+        memcpy(ctx->buffer, m, bytes);
+        ctx->leftover = (uint8_t)bytes;
+    }
+}
+
+/**
+ * @brief Pad the data absorbed so far with zeros up to a multiple of 16 bytes.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ */
+static void B5_Poly1305_Pad16 (B5_tChaCha20Poly1305Ctx *ctx)
+{
+    if (ctx->leftover)
+    {
+        memset(ctx->buffer + ctx->leftover, 0, 16 - ctx->leftover);
+        B5_Poly1305_Blocks(ctx, ctx->buffer, 16, (uint32_t)1 << 24);
+        ctx->leftover = 0;
+    }
+}
+
+/**
+ * @brief Compute the Poly1305 tag.
+ * @param ctx Pointer to the current ChaCha20-Poly1305 context.
+ * @param mac 16 bytes output.
+ */
+static void B5_Poly1305_Finish (B5_tChaCha20Poly1305Ctx *ctx, uint8_t *mac)
+{
+    uint32_t h0, h1, h2, h3, h4, c;
+    uint32_t g0, g1, g2, g3, g4;
+    uint64_t f;
+    uint32_t mask;
+    
+    // process the remaining block
+    if (ctx->leftover)
+    {
+        ctx->buffer[ctx->leftover] = 1;
+        memset(ctx->buffer + ctx->leftover + 1, 0, 15 - ctx->leftover);
+        B5_Poly1305_Blocks(ctx, ctx->buffer, 16, 0);
+        ctx->leftover = 0;
+    }
+    
+    // fully carry h
+    h0 = ctx->h[0]; h1 = ctx->h[1]; h2 = ctx->h[2]; h3 = ctx->h[3]; h4 = ctx->h[4];
+    
+                 c = h1 >> 26; h1 = h1 & 0x3ffffff;
+    h2 +=     c; c = h2 >> 26; h2 = h2 & 0x3ffffff;
+    h3 +=     c; c = h3 >> 26; h3 = h3 & 0x3ffffff;
+    h4 +=     c; c = h4 >> 26; h4 = h4 & 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 = h0 & 0x3ffffff;
+    h1 +=     c;
+    
+    // compute h + -p
+    g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    g4 = h4 + c - (1UL << 26);
+    
+    // select h if h < p, or h + -p if h >= p, without branches
+    mask = (g4 >> 31) - 1;
+    g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+    
+    // h = h % (2^128)
+    h0 = ((h0      ) | (h1 << 26));
+    h1 = ((h1 >>  6) | (h2 << 20));
+    h2 = ((h2 >> 12) | (h3 << 14));
+    h3 = ((h3 >> 18) | (h4 <<  8));
+    
+    // mac = (h + pad) % (2^128)
+    f = (uint64_t)h0 + ctx->pad[0];             h0 = (uint32_t)f;
+    f = (uint64_t)h1 + ctx->pad[1] + (f >> 32); h1 = (uint32_t)f;
+    f = (uint64_t)h2 + ctx->pad[2] + (f >> 32); h2 = (uint32_t)f;
+    f = (uint64_t)h3 + ctx->pad[3] + (f >> 32); h3 = (uint32_t)f;
+    
+    B5_CHACHA20_U32TO8(mac +  0, h0);
+    B5_CHACHA20_U32TO8(mac +  4, h1);
+    B5_CHACHA20_U32TO8(mac +  8, h2);
+    B5_CHACHA20_U32TO8(mac + 12, h3);
+}
+
+int32_t B5_ChaCha20Poly1305_Init (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *Key, int16_t keySize, uint8_t mode)
+{
+    int32_t i;
+    
+    
+    if(Key == NULL)
+        return B5_CHACHA20_POLY1305_RES_INVALID_ARGUMENT;
+    
+    if(ctx == NULL)
+        return  B5_CHACHA20_POLY1305_RES_INVALID_CONTEXT;
+    
+    memset(ctx, 0, sizeof(B5_tChaCha20Poly1305Ctx));
+    
+    if(keySize != B5_CHACHA20_KEY_SIZE)
+        return B5_CHACHA20_POLY1305_RES_INVALID_KEY_SIZE;
+    
+    if((mode != B5_CHACHA20_POLY1305_ENC) && (mode != B5_CHACHA20_POLY1305_DEC))
+        return B5_CHACHA20_POLY1305_RES_INVALID_ARGUMENT;
+    
+    
+    // "expand 32-byte k"
+    ctx->input[0] = 0x61707865;
+    ctx->input[1] = 0x3320646e;
+    ctx->input[2] = 0x79622d32;
+    ctx->input[3] = 0x6b206574;
+    for (i = 0; i < 8; i++)
+        ctx->input[4 + i] = B5_CHACHA20_U8TO32(Key + 4 * i);
+    
+    ctx->mode = mode;
+    ctx->state = B5_CHACHA20_STATE_IDLE;
+    
+    return B5_CHACHA20_POLY1305_RES_OK;
+}
+
+int32_t B5_ChaCha20Poly1305_Start (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *nonce)
+{
+    uint8_t block[B5_CHACHA20_BLOCK_SIZE];
+    
+    
+    if(ctx == NULL)
+        return  B5_CHACHA20_POLY1305_RES_INVALID_CONTEXT;
+    
+    if(nonce == NULL)
+        return B5_CHACHA20_POLY1305_RES_INVALID_ARGUMENT;
+    
+    
+    ctx->input[12] = 0;
+    ctx->input[13] = B5_CHACHA20_U8TO32(nonce + 0);
+    ctx->input[14] = B5_CHACHA20_U8TO32(nonce + 4);
+    ctx->input[15] = B5_CHACHA20_U8TO32(nonce + 8);
+    
+    // The one-time Poly1305 key is the first half of block 0, data starts at block 1
+    B5_ChaCha20_Block(ctx, block);
+    
+    ctx->r[0] = (B5_CHACHA20_U8TO32(block +  0)     ) & 0x3ffffff;
+    ctx->r[1] = (B5_CHACHA20_U8TO32(block +  3) >> 2) & 0x3ffff03;
+    ctx->r[2] = (B5_CHACHA20_U8TO32(block +  6) >> 4) & 0x3ffc0ff;
+    ctx->r[3] = (B5_CHACHA20_U8TO32(block +  9) >> 6) & 0x3f03fff;
+    ctx->r[4] = (B5_CHACHA20_U8TO32(block + 12) >> 8) & 0x00fffff;
+    
+    ctx->pad[0] = B5_CHACHA20_U8TO32(block + 16);
+    ctx->pad[1] = B5_CHACHA20_U8TO32(block + 20);
+    ctx->pad[2] = B5_CHACHA20_U8TO32(block + 24);
+    ctx->pad[3] = B5_CHACHA20_U8TO32(block + 28);
+    
+    memset(ctx->h, 0, sizeof(ctx->h));
+    ctx->leftover = 0;
+    ctx->aadLen = 0;
+    ctx->dataLen = 0;
+    ctx->state = B5_CHACHA20_STATE_AAD;
+    
+    memset(block, 0, sizeof(block));
+    
+    return B5_CHACHA20_POLY1305_RES_OK;
+}
+
+int32_t B5_ChaCha20Poly1305_Aad (B5_tChaCha20Poly1305Ctx *ctx, const uint8_t *aad, int32_t aadLen)
+{
+    if(ctx == NULL)
+        return  B5_CHACHA20_POLY1305_RES_INVALID_CONTEXT;
+    
+    if((aad == NULL) || (aadLen < 0))
+        return B5_CHACHA20_POLY1305_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state != B5_CHACHA20_STATE_AAD)
+        return B5_CHACHA20_POLY1305_RES_INVALID_STATE;
+    
+    
+    B5_Poly1305_Update(ctx, aad, aadLen);
+    ctx->aadLen += (uint64_t)aadLen;
+    
+    return B5_CHACHA20_POLY1305_RES_OK;
+}
+
+int32_t B5_ChaCha20Poly1305_Update (B5_tChaCha20Poly1305Ctx *ctx, uint8_t *outData, const uint8_t *inData, int32_t dataLen)
+{
+    int32_t    i, n;
+    uint8_t    pos;
+    uint8_t    *outStart = outData;
+    int32_t    totLen = dataLen;
+    
+    
+    if(ctx == NULL)
+        return  B5_CHACHA20_POLY1305_RES_INVALID_CONTEXT;
+    
+    if((outData == NULL) || (inData == NULL) || (dataLen < 0))
+        return B5_CHACHA20_POLY1305_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state == B5_CHACHA20_STATE_IDLE)
+        return B5_CHACHA20_POLY1305_RES_INVALID_STATE;
+    
+    
+    if(ctx->state == B5_CHACHA20_STATE_AAD)
+    {
+        B5_Poly1305_Pad16(ctx);
+        ctx->state = B5_CHACHA20_STATE_DATA;
+    }
+    
+    // The ciphertext is authenticated before decryption, as outData may alias inData
+    if(ctx->mode == B5_CHACHA20_POLY1305_DEC)
+        B5_Poly1305_Update(ctx, inData, dataLen);
+    
+    
+    // Finish the block left open by the previous call
+    pos = (uint8_t)(ctx->dataLen & 0x3F);
+    if (pos != 0)
+    {
+        n = B5_CHACHA20_BLOCK_SIZE - pos;
+        if (n > dataLen)
+            n = dataLen;
+        for (i = 0; i < n; i++)
+            outData[i] = inData[i] ^ ctx->ks[pos + i];
+        inData += n;
+        outData += n;
+        dataLen -= n;
+        ctx->dataLen += (uint64_t)n;
+    }
+    
+    // Whole blocks
+    while (dataLen >= B5_CHACHA20_BLOCK_SIZE)
+    {
+        B5_ChaCha20_Block(ctx, ctx->ks);
+        B5_ChaCha20_XorBlock(outData, inData, ctx->ks);
+        inData += B5_CHACHA20_BLOCK_SIZE;
+        outData += B5_CHACHA20_BLOCK_SIZE;
+        dataLen -= B5_CHACHA20_BLOCK_SIZE;
+        ctx->dataLen += B5_CHACHA20_BLOCK_SIZE;
+    }
+    
+    // Open a new block with the remaining bytes
+    if (dataLen > 0)
+    {
+        B5_ChaCha20_Block(ctx, ctx->ks);
+        for (i = 0; i < dataLen; i++)
+            outData[i] = inData[i] ^ ctx->ks[i];
+        ctx->dataLen += (uint64_t)dataLen;
+    }
+    
+    if(ctx->mode == B5_CHACHA20_POLY1305_ENC)
+        B5_Poly1305_Update(ctx, outStart, totLen);
+    
+    return B5_CHACHA20_POLY1305_RES_OK;
+}
+
+int32_t B5_ChaCha20Poly1305_Finit (B5_tChaCha20Poly1305Ctx *ctx, uint8_t *rTag)
+{
+    uint8_t lenBlk[16];
+    
+    
+    if(ctx == NULL)
+        return B5_CHACHA20_POLY1305_RES_INVALID_CONTEXT;
+    
+    if(rTag == NULL)
+        return B5_CHACHA20_POLY1305_RES_INVALID_ARGUMENT;
+    
+    if(ctx->state == B5_CHACHA20_STATE_IDLE)
+        return B5_CHACHA20_POLY1305_RES_INVALID_STATE;
+    
+    
+    // AAD || pad16 || C || pad16 || le64(len(AAD)) || le64(len(C))
+    B5_Poly1305_Pad16(ctx);
+    B5_CHACHA20_U32TO8(lenBlk +  0, (uint32_t)ctx->aadLen);
+    B5_CHACHA20_U32TO8(lenBlk +  4, (uint32_t)(ctx->aadLen >> 32));
+    B5_CHACHA20_U32TO8(lenBlk +  8, (uint32_t)ctx->dataLen);
+    B5_CHACHA20_U32TO8(lenBlk + 12, (uint32_t)(ctx->dataLen >> 32));
+    B5_Poly1305_Update(ctx, lenBlk, 16);
+    B5_Poly1305_Finish(ctx, rTag);
+    
+    memset(ctx->ks, 0, sizeof(ctx->ks));
+    ctx->state = B5_CHACHA20_STATE_IDLE;
+    
+    return B5_CHACHA20_POLY1305_RES_OK;
+}
@@ -25,7 +25,8 @@
 #include "se3_algo_Aes.h"
 
 uint16_t se3_algo_Aes_init(se3_flash_key* key, uint16_t mode, uint8_t* ctx){
-    B5_tAesCtx* aes = (B5_tAesCtx*)ctx;
+    se3_algo_Aes_ctx* aes_ctx = (se3_algo_Aes_ctx*)ctx;
+    B5_tAesCtx* aes = &(aes_ctx->aes);
 	uint16_t feedback = mode & 0x07;
 	uint16_t direction = (mode & SE3_DIR_ENCRYPT) ? SE3_DIR_ENCRYPT : SE3_DIR_DECRYPT;
 	uint8_t b5_mode = 0;
@@ -92,6 +93,7 @@ uint16_t se3_algo_Aes_init(se3_flash_key* key, uint16_t mode, uint8_t* ctx){
         SE3_TRACE(("[algo_aes256.init] B5_Aes256_Init failed\n"));
         return SE3_ERR_PARAMS;
     }
+    aes_ctx->keystream = (b5_mode == B5_AES256_CTR) && !(key->policy & SE3_KEY_POLICY_NO_KEYSTREAM);
 
     return SE3_OK;
 }
@@ -102,18 +104,26 @@ uint16_t se3_algo_Aes_update(
     uint16_t datain2_len, const uint8_t* datain2,
     uint16_t* dataout_len, uint8_t* dataout)
 {
-    B5_tAesCtx* aes = (B5_tAesCtx*)ctx;
+    se3_algo_Aes_ctx* aes_ctx = (se3_algo_Aes_ctx*)ctx;
+    B5_tAesCtx* aes = &(aes_ctx->aes);
     size_t nblocks = 0;
     uint8_t* data_enc, *data_dec;
     bool do_setiv = false;
     bool do_update = false;
+    bool do_keystream = false;
     bool do_finit = false;
 	
 
 	do_setiv = flags & SE3_CRYPTO_FLAG_SETIV;
 	do_update = datain2_len > 0;
+	do_keystream = flags & SE3_CRYPTO_FLAG_KEYSTREAM;
 	do_finit = flags & SE3_CRYPTO_FLAG_FINIT;
 
+	if (do_keystream && !aes_ctx->keystream) {
+		SE3_TRACE(("[algo_aes256.update] keystream not allowed for this session\n"));
+		return SE3_ERR_ACCESS;
+	}
+
     // check params
 	if (do_setiv && (datain1_len != B5_AES_BLK_SIZE)) {
 		SE3_TRACE(("[algo_aes256.update] invalid IV size\n"));
@@ -135,7 +145,15 @@ uint16_t se3_algo_Aes_update(
         }
     }
 
-    if (do_update) { // update
+    if (do_update && do_keystream) { // keystream only, the host applies it
+		nblocks = datain2_len / B5_AES_BLK_SIZE;
+        if (B5_AES256_RES_OK != B5_Aes256_Keystream(aes, dataout, (int16_t)nblocks)) {
+            SE3_TRACE(("[algo_aes256.update] B5_Aes256_Keystream failed\n"));
+            return SE3_ERR_HW;
+        }
+        *dataout_len = datain2_len;
+    }
+    else if (do_update) { // update
 		nblocks = datain2_len / B5_AES_BLK_SIZE;
 
         switch (aes->mode) {
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_algo_AesCmac.c
+  * Description        : AES-CMAC primitives/crypto handlers
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#include "se3_algo_AesCmac.h"
+
+
+// mode is not used
+uint16_t se3_algo_AesCmac_init(se3_flash_key* key, uint16_t mode, uint8_t* ctx)
+{
+	B5_tCmacAesCtx* cmac = (B5_tCmacAesCtx *) ctx;
+
+	switch (key->data_size) {
+		case B5_CMAC_AES_256:
+			break;
+		case B5_CMAC_AES_192:
+			break;
+		case B5_CMAC_AES_128:
+			break;
+		default: // unsupported key size
+			return SE3_ERR_PARAMS;
+	}
+	if (B5_CMAC_AES256_RES_OK != B5_CmacAes256_Init(cmac, key->data, (int16_t)key->data_size)) {
+		SE3_TRACE(("[algo_aescmac.init] B5_CmacAes256_Init failed\n"));
+		return (SE3_ERR_PARAMS);
+	}
+
+	return (SE3_OK);
+}
+
+
+// datain2 is not used; datain2_len is not used
+uint16_t se3_algo_AesCmac_update(
+	uint8_t* ctx, uint16_t flags,
+	uint16_t datain1_len, const uint8_t* datain1,
+	uint16_t datain2_len, const uint8_t* datain2,
+	uint16_t* dataout_len, uint8_t* dataout)
+{
+
+	B5_tCmacAesCtx* cmac = (B5_tCmacAesCtx *)ctx;
+
+	bool do_update = (datain1_len > 0);
+	bool do_finit = (flags & SE3_CRYPTO_FLAG_FINIT);
+
+	if (do_update) {
+		// update
+		if (B5_CMAC_AES256_RES_OK != B5_CmacAes256_Update(cmac, datain1, datain1_len)) {
+			SE3_TRACE(("[algo_aescmac.update] B5_CmacAes256_Update failed\n"));
+			return SE3_ERR_HW;
+		}
+	}
+
+	if (do_finit) {
+		if (B5_CMAC_AES256_RES_OK != B5_CmacAes256_Finit(cmac, dataout)) {
+			SE3_TRACE(("[algo_aescmac.update] B5_CmacAes256_Finit failed\n"));
+			return SE3_ERR_HW;
+		}
+		*dataout_len = B5_CMAC_AES_BLK_SIZE;
+	}
+
+	return(SE3_OK);
+}
@@ -193,7 +193,7 @@ uint16_t se3_algo_AesHmacSha256s_update(
 			if (datain1_len > 0) {
 				B5_Aes256_SetIV(myctx.aes, datain1);
 			}
-			B5_HmacSha256_Init(myctx.hmac, myctx.keys + (*(myctx.key_size)), *(myctx.key_size));
+			B5_HmacSha256_Reset(myctx.hmac);
 			if (datain1_len > 0) {
 				B5_HmacSha256_Update(myctx.hmac, datain1, datain1_len);
 			}
@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_algo_ChaCha20Poly1305.c
+  * Description        : ChaCha20-Poly1305 crypto handlers
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+/**
+*  \file se3_algo_ChaCha20Poly1305.c
+*  \brief SE3_ALGO_CHACHA20_POLY1305 crypto handlers
+*/
+
+#include "se3_algo_ChaCha20Poly1305.h"
+
+uint16_t se3_algo_ChaCha20Poly1305_init(se3_flash_key* key, uint16_t mode, uint8_t* ctx){
+	B5_tChaCha20Poly1305Ctx* aead = (B5_tChaCha20Poly1305Ctx*)ctx;
+	uint16_t direction = (mode & SE3_DIR_ENCRYPT) ? SE3_DIR_ENCRYPT : SE3_DIR_DECRYPT;
+
+	if (key->data_size != B5_CHACHA20_KEY_SIZE) {
+		return SE3_ERR_PARAMS;
+	}
+
+	if (B5_CHACHA20_POLY1305_RES_OK != B5_ChaCha20Poly1305_Init(aead, key->data, (int16_t)key->data_size,
+		(direction == SE3_DIR_ENCRYPT) ? B5_CHACHA20_POLY1305_ENC : B5_CHACHA20_POLY1305_DEC)) {
+		SE3_TRACE(("[algo_chacha20poly1305.init] B5_ChaCha20Poly1305_Init failed\n"));
+		return SE3_ERR_PARAMS;
+	}
+
+	return SE3_OK;
+}
+
+uint16_t se3_algo_ChaCha20Poly1305_update(
+	uint8_t* ctx, uint16_t flags,
+	uint16_t datain1_len, const uint8_t* datain1,
+	uint16_t datain2_len, const uint8_t* datain2,
+	uint16_t* dataout_len, uint8_t* dataout)
+{
+	B5_tChaCha20Poly1305Ctx* aead = (B5_tChaCha20Poly1305Ctx*)ctx;
+	size_t outsize = 0;
+	int32_t ret;
+
+	bool do_reset = (flags & SE3_CRYPTO_FLAG_RESET);
+	bool do_update = (datain2_len > 0);
+	bool do_auth = (flags & SE3_CRYPTO_FLAG_AUTH);
+
+	// check params
+	if (flags & SE3_CRYPTO_FLAG_SETNONCE) {
+		return SE3_ERR_PARAMS;
+	}
+	if (do_reset && (datain1_len < B5_CHACHA20_NONCE_SIZE)) {
+		SE3_TRACE(("[algo_chacha20poly1305.update] invalid nonce size\n"));
+		return SE3_ERR_PARAMS;
+	}
+
+	// compute output size
+	outsize = datain2_len;
+	if (do_auth) {
+		outsize += B5_POLY1305_TAG_SIZE;
+	}
+	if (outsize > SE3_CRYPTO_MAX_DATAOUT) {
+		return SE3_ERR_PARAMS;
+	}
+
+	if (do_reset) {
+		B5_ChaCha20Poly1305_Start(aead, datain1);
+		datain1 += B5_CHACHA20_NONCE_SIZE;
+		datain1_len -= B5_CHACHA20_NONCE_SIZE;
+	}
+
+	if (datain1_len > 0) {
+		ret = B5_ChaCha20Poly1305_Aad(aead, datain1, datain1_len);
+		if (ret != B5_CHACHA20_POLY1305_RES_OK) {
+			return (ret == B5_CHACHA20_POLY1305_RES_INVALID_STATE) ? SE3_ERR_STATE : SE3_ERR_PARAMS;
+		}
+	}
+
+	if (do_update) {
+		ret = B5_ChaCha20Poly1305_Update(aead, dataout, datain2, datain2_len);
+		if (ret != B5_CHACHA20_POLY1305_RES_OK) {
+			return (ret == B5_CHACHA20_POLY1305_RES_INVALID_STATE) ? SE3_ERR_STATE : SE3_ERR_HW;
+		}
+	}
+
+	if (do_auth) {
+		ret = B5_ChaCha20Poly1305_Finit(aead, dataout + datain2_len);
+		if (ret != B5_CHACHA20_POLY1305_RES_OK) {
+			return (ret == B5_CHACHA20_POLY1305_RES_INVALID_STATE) ? SE3_ERR_STATE : SE3_ERR_HW;
+		}
+	}
+
+	*dataout_len = (uint16_t)outsize;
+	return SE3_OK;
+}
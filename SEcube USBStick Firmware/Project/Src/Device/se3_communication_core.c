@@ -23,16 +23,18 @@
   */
 
 #include "se3_communication_core.h"
-#ifndef CUBESIM
 #include <se3_sdio.h>
+#include "se3_perf.h"
+#ifndef CUBESIM
+#include "stm32f4xx_hal.h"
 #endif
 
 SE3_COMM_STATUS comm;
 se3_comm_req_header req_hdr;
 se3_comm_resp_header resp_hdr;
 
-uint8_t se3_comm_request_buffer[SE3_COMM_N*SE3_COMM_BLOCK];
-uint8_t se3_comm_response_buffer[SE3_COMM_N*SE3_COMM_BLOCK];
+uint8_t se3_comm_request_buffer[SE3_COMM_SLOTS][SE3_COMM_N*SE3_COMM_BLOCK];
+uint8_t se3_comm_response_buffer[SE3_COMM_SLOTS][SE3_COMM_N*SE3_COMM_BLOCK];
 const uint8_t se3_hello[SE3_HELLO_SIZE] = {
 	'H', 'e', 'l', 'l', 'o', ' ', 'S', 'E',
     'c', 'u', 'b', 'e', 0, 0, 0, 0,
@@ -54,25 +56,236 @@ typedef struct s3_storage_range_ {
 /**\brief Initializes the communication core structures */
 void se3_communication_core_init()
 {
+    size_t i;
 	memset(&comm, 0, sizeof(SE3_COMM_STATUS));
 	memset(&req_hdr, 0, sizeof(se3_comm_req_header));
 	memset(&resp_hdr, 0, sizeof(se3_comm_resp_header));
 	memset(&serial, 0, sizeof(SE3_SERIAL));
 
-    comm.req_hdr = se3_comm_request_buffer;
-    comm.req_data = se3_comm_request_buffer + SE3_REQ_SIZE_HEADER;
-    comm.resp_hdr = se3_comm_response_buffer;
-    comm.resp_data = se3_comm_response_buffer + SE3_RESP_SIZE_HEADER;
+    for (i = 0; i < SE3_COMM_SLOTS; i++) {
+        comm.slots[i].state = SE3_COMM_SLOT_FREE;
+        comm.slots[i].req_bmap = SE3_BMAP_MAKE(32);
+        comm.slots[i].resp_bmap = 0;
+        comm.slots[i].req_buf = se3_comm_request_buffer[i];
+        comm.slots[i].resp_buf = se3_comm_response_buffer[i];
+    }
+    comm.recv = NULL;
+    comm.exec = &(comm.slots[0]);
+    comm.req_hdr = comm.exec->req_buf;
+    comm.req_data = comm.exec->req_buf + SE3_REQ_SIZE_HEADER;
+    comm.resp_hdr = comm.exec->resp_buf;
+    comm.resp_data = comm.exec->resp_buf + SE3_RESP_SIZE_HEADER;
     comm.magic_bmap = SE3_BMAP_MAKE(16);
     comm.magic_ready = false;
-    comm.req_bmap = SE3_BMAP_MAKE(1);
+    memset(comm.block_table, -1, sizeof(comm.block_table));
+    comm.block_min = 0xFFFFFFFF;
+    comm.block_max = 0;
     comm.locked = false;
-    comm.req_ready = false;
-    comm.req_bmap = SE3_BMAP_MAKE(32);
-    comm.resp_ready = true;
     comm.resp_bmap = 0;
+    comm.holding = false;
+    comm.hold_start = 0;
+}
+
+/** \brief true if slot a received its request before slot b */
+static bool slot_older(const se3_comm_slot* a, const se3_comm_slot* b)
+{
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+/** \brief Find the slot for an incoming request header
+ *  \param token cmdtoken of the header block
+ *  \return the slot, or NULL if both slots hold requests not executed yet
+ *
+ *  A header written again goes to the same slot. Otherwise a free slot is preferred, then
+ *    the oldest answered one, then a slot whose request was never completed (abandoned by
+ *    the host). The host keeps at most SE3_COMM_SLOTS requests outstanding, so an answered
+ *    slot is only reused once its response is no longer needed.
+ */
+static se3_comm_slot* slot_for_request(uint32_t token)
+{
+    size_t i;
+    se3_comm_slot* s;
+    se3_comm_slot* done = NULL;
+    se3_comm_slot* receiving = NULL;
+    for (i = 0; i < SE3_COMM_SLOTS; i++) {
+        s = &(comm.slots[i]);
+        if (s->state == SE3_COMM_SLOT_RECEIVING && s->req.cmdtok[0] == token) {
+            return s;
+        }
+    }
+    for (i = 0; i < SE3_COMM_SLOTS; i++) {
+        s = &(comm.slots[i]);
+        switch (s->state) {
+        case SE3_COMM_SLOT_FREE:
+            return s;
+        case SE3_COMM_SLOT_DONE:
+            if (done == NULL || slot_older(s, done)) {
+                done = s;
+            }
+            break;
+        case SE3_COMM_SLOT_RECEIVING:
+            receiving = s;
+            break;
+        default:
+            break;
+        }
+    }
+    return (done != NULL) ? (done) : (receiving);
 }
 
+/** \brief Find the slot for an incoming request data block
+ *  \param index index of the block in the special protocol file
+ *  \param token cmdtoken of the block
+ *  \return the slot, or NULL if no request is being received
+ */
+static se3_comm_slot* slot_for_request_data(int index, uint32_t token)
+{
+    size_t i;
+    se3_comm_slot* s;
+    for (i = 0; i < SE3_COMM_SLOTS; i++) {
+        s = &(comm.slots[i]);
+        if (s->state == SE3_COMM_SLOT_RECEIVING && s->req.cmdtok[0] + (uint32_t)index == token) {
+            return s;
+        }
+    }
+    // tokens are checked again before execution
+    if (comm.recv != NULL && comm.recv->state == SE3_COMM_SLOT_RECEIVING) {
+        return comm.recv;
+    }
+    return NULL;
+}
+
+/** \brief Find the slot whose response is to be read
+ *  \return the slot of the oldest request not answered or not read yet, or NULL
+ */
+static se3_comm_slot* slot_for_response()
+{
+    size_t i;
+    se3_comm_slot* s;
+    se3_comm_slot* best = NULL;
+    for (i = 0; i < SE3_COMM_SLOTS; i++) {
+        s = &(comm.slots[i]);
+        if (s->state == SE3_COMM_SLOT_READY || s->state == SE3_COMM_SLOT_EXEC || s->state == SE3_COMM_SLOT_DONE) {
+            if (best == NULL || slot_older(s, best)) {
+                best = s;
+            }
+        }
+    }
+    return best;
+}
+
+/** \brief Find the slot whose first response block is to be read
+ *  \return the slot, as slot_for_response
+ *
+ *  A response whose first block is read again while the response to a newer request is
+ *    ready has been passed over: its host exited or gave up before reading the other
+ *    blocks, and the host waiting for the newer response would be served the old one
+ *    forever. Such a slot is released.
+ */
+static se3_comm_slot* slot_for_response_first()
+{
+    size_t i;
+    se3_comm_slot* s = slot_for_response();
+    bool newer;
+    while (s != NULL && s->state == SE3_COMM_SLOT_DONE && s->served) {
+        newer = false;
+        for (i = 0; i < SE3_COMM_SLOTS; i++) {
+            if (comm.slots[i].state == SE3_COMM_SLOT_DONE && slot_older(s, &(comm.slots[i]))) {
+                newer = true;
+            }
+        }
+        if (!newer) {
+            break;
+        }
+        SE3_TRACE(("P R00 response %u passed over, released", (unsigned)s->resp.cmdtok[0]));
+        s->state = SE3_COMM_SLOT_FREE;
+        s = slot_for_response();
+    }
+    return s;
+}
+
+bool se3_proto_request_next()
+{
+    size_t i;
+    se3_comm_slot* s;
+    se3_comm_slot* best = NULL;
+    for (i = 0; i < SE3_COMM_SLOTS; i++) {
+        s = &(comm.slots[i]);
+        if (s->state == SE3_COMM_SLOT_READY && (best == NULL || slot_older(s, best))) {
+            best = s;
+        }
+    }
+    if (best == NULL) {
+        return false;
+    }
+    best->state = SE3_COMM_SLOT_EXEC;
+    comm.exec = best;
+    comm.req_hdr = best->req_buf;
+    comm.req_data = best->req_buf + SE3_REQ_SIZE_HEADER;
+    comm.resp_hdr = best->resp_buf;
+    comm.resp_data = best->resp_buf + SE3_RESP_SIZE_HEADER;
+    comm.resp_bmap = 0;
+    memcpy(&req_hdr, &(best->req), sizeof(se3_comm_req_header));
+    return true;
+}
+
+void se3_proto_response_done()
+{
+    se3_comm_slot* s = comm.exec;
+    uint16_t n = 0;
+    memcpy(&(s->resp), &resp_hdr, sizeof(se3_comm_resp_header));
+    s->resp_bmap = comm.resp_bmap;
+    while (n < 32 && SE3_BIT_TEST(s->resp_bmap, n)) {
+        n++;
+    }
+    s->resp_blocks = n;
+    s->served = false;
+    // a request without response (malformed) has nothing to be read
+    s->state = (n > 0) ? (SE3_COMM_SLOT_DONE) : (SE3_COMM_SLOT_FREE);
+}
+
+
+/** \brief Check the first word of a block against the magic sequence
+ *  \param buf pointer to block data
+ *  \return false if the block cannot contain the magic sequence
+ *
+ *  A single word comparison rejects almost all ordinary data blocks, without running
+ *    the full comparison of block_is_magic.
+ */
+static bool block_tag_is_magic(const uint8_t* buf)
+{
+	uint32_t tag, magic_tag;
+	memcpy(&tag, buf, sizeof(uint32_t));
+	memcpy(&magic_tag, se3_magic, sizeof(uint32_t));
+	return (tag == magic_tag);
+}
+
+/** \brief Check if a write can be forwarded to the storage as a whole
+ *  \param buf pointer to data
+ *  \param blk_addr first block
+ *  \param blk_len number of blocks
+ *  \return true if no block of the write is handled by the protocol
+ *
+ *  The write must not include block 0, must not overlap the special protocol file
+ *    and none of its blocks may start with the magic sequence.
+ */
+static bool range_is_storage(const uint8_t* buf, uint32_t blk_addr, uint16_t blk_len)
+{
+	uint16_t i;
+	if (blk_addr == 0) {
+		return false;
+	}
+	if (comm.magic_ready && blk_addr <= comm.block_max && blk_addr + blk_len > comm.block_min) {
+		return false;
+	}
+	for (i = 0; i < blk_len; i++) {
+		if (block_tag_is_magic(buf)) {
+			return false;
+		}
+		buf += SE3_COMM_BLOCK;
+	}
+	return true;
+}
 
 /** \brief Check if block contains the magic sequence
  *  \param buf pointer to block data
@@ -86,6 +299,7 @@ static bool block_is_magic(const uint8_t* buf)
 	const uint8_t* a = buf;
 	const uint8_t* b = se3_magic;
 	size_t i;
+	if (!block_tag_is_magic(buf)) return false;
 	for (i = 0; i < SE3_COMM_BLOCK / SE3_MAGIC_SIZE - 1; i++) {
 		if (memcmp(a, b, SE3_MAGIC_SIZE))return false;
         a += SE3_MAGIC_SIZE;
@@ -100,20 +314,66 @@ static bool block_is_magic(const uint8_t* buf)
  *    belong to the protocol file.
  *  
  *  The special protocol file is made up of multiple blocks. Each block is mapped to a block
- *    on the physical storage
+ *    on the physical storage. Blocks outside the range of the file are rejected at once,
+ *    the others are looked up in a table indexed by the low bits of the block number, which
+ *    has no collisions when the file is contiguous on the storage.
  */
 static int find_magic_index(uint32_t block)
 {
-	int i; size_t k;
-	for (i = 0, k = comm.block_guess; i < SE3_COMM_N; i++, k = (k+1)%(SE3_COMM_N) ) {
-		if (block == comm.blocks[i]) {
-			comm.block_guess = (size_t)((i + 1) % 16);
-			return i;
+	size_t i, k;
+	int8_t index;
+	if (block < comm.block_min || block > comm.block_max) {
+		return -1;
+	}
+	for (i = 0, k = block & (SE3_COMM_TABLE - 1); i < SE3_COMM_TABLE; i++, k = (k + 1) & (SE3_COMM_TABLE - 1)) {
+		index = comm.block_table[k];
+		if (index < 0) {
+			break;
+		}
+		if (comm.blocks[index] == block) {
+			return index;
 		}
 	}
 	return -1;
 }
 
+/** \brief Map a block of the special protocol file
+ *  \param index index of the block in the special protocol file
+ *  \param block block number
+ *
+ *  Entries left by a previous mapping of the same index are skipped by find_magic_index, since
+ *    it checks the block number in the blocks map.
+ */
+static void magic_index_add(int index, uint32_t block)
+{
+	size_t i, k;
+	comm.blocks[index] = block;
+	for (i = 0, k = block & (SE3_COMM_TABLE - 1); i < SE3_COMM_TABLE; i++, k = (k + 1) & (SE3_COMM_TABLE - 1)) {
+		if (comm.block_table[k] < 0 || comm.block_table[k] == index) {
+			comm.block_table[k] = (int8_t)index;
+			break;
+		}
+	}
+	if (block < comm.block_min) {
+		comm.block_min = block;
+	}
+	if (block > comm.block_max) {
+		comm.block_max = block;
+	}
+}
+
+/** \brief Forget the blocks of the special protocol file */
+static void magic_index_reset()
+{
+	size_t i;
+	for (i = 0; i < SE3_COMM_N; i++) {
+		comm.blocks[i] = 0;
+	}
+	memset(comm.block_table, -1, sizeof(comm.block_table));
+	comm.block_min = 0xFFFFFFFF;
+	comm.block_max = 0;
+}
+
 
 /** \brief add request to SDIO read/write buffer
  *  \param range context; the count field must be initialized to zero on first usage
@@ -146,7 +406,10 @@ static int32_t se3_storage_range_add(s3_storage_range* range, uint8_t lun, uint8
 				ret = secube_sdio_read(lun, range->buf, range->first, range->count);
 				SE3_TRACE(("%d: read buf=%u count=%u from block=%u", ret, (unsigned)range->buf, range->count, range->first));
 			}
-			range->count = 0;
+			// start a new range with the current block
+			range->buf = buf;
+			range->first = block;
+			range->count = 1;
 		}
 	}
 
@@ -159,8 +422,14 @@ static int32_t se3_storage_range_add(s3_storage_range* range, uint8_t lun, uint8
  */
 void se3_proto_request_reset()
 {
-    comm.req_ready = false;
-    comm.req_bmap = SE3_BMAP_MAKE(32);
+    size_t i;
+    for (i = 0; i < SE3_COMM_SLOTS; i++) {
+        if (comm.slots[i].state == SE3_COMM_SLOT_RECEIVING || comm.slots[i].state == SE3_COMM_SLOT_READY) {
+            comm.slots[i].state = SE3_COMM_SLOT_FREE;
+            comm.slots[i].req_bmap = SE3_BMAP_MAKE(32);
+        }
+    }
+    comm.recv = NULL;
 }
 
 /** \brief Handle request for incoming protocol block
@@ -168,65 +437,83 @@ void se3_proto_request_reset()
  *  \param blockdata data
  *  
  *  Handle a single block belonging to a protocol request. The data is stored in the
- *    request buffer. As soon as the request data is received completely, the device
- *    will start processing the request
+ *    request buffer of a free slot, so that a request can be received while the previous
+ *    one is executing. As soon as the request data is received completely, the slot is
+ *    queued for execution.
  */
 static void handle_req_recv(int index, const uint8_t* blockdata)
 {
     uint16_t nblocks;
+    uint32_t token;
+    se3_comm_slot* s;
     if (index == SE3_COMM_N - 1) {
         SE3_TRACE(("P data write to block %d ignored", index));
         return;
     }
-
-    comm.resp_ready = false;
+    se3_perf.bytes_in += SE3_COMM_BLOCK;
 
     if (index == 0) {
         // REQ block
-
-        // read and decode header
-        memcpy(comm.req_hdr, blockdata, SE3_REQ_SIZE_HEADER);
-        SE3_GET16(comm.req_hdr, SE3_REQ_OFFSET_CMD, req_hdr.cmd);
-        SE3_GET16(comm.req_hdr, SE3_REQ_OFFSET_CMDFLAGS, req_hdr.cmd_flags);
-        SE3_GET16(comm.req_hdr, SE3_REQ_OFFSET_LEN, req_hdr.len);
-        SE3_GET32(comm.req_hdr, SE3_REQ_OFFSET_CMDTOKEN, req_hdr.cmdtok[0]);
+        SE3_GET32(blockdata, SE3_REQ_OFFSET_CMDTOKEN, token);
+        s = slot_for_request(token);
+        if (s == NULL) {
+            // both slots hold requests not executed yet. ignore
+            SE3_TRACE(("P W00 no free request slot"));
+            return;
+        }
+        if (s->state != SE3_COMM_SLOT_RECEIVING) {
+            s->state = SE3_COMM_SLOT_RECEIVING;
+            s->req_bmap = SE3_BMAP_MAKE(32);
+            s->seq = comm.seq++;
+        }
+        comm.recv = s;
+
+        // header and data are stored with a single copy, the data follows the header
+        memcpy(s->req_buf, blockdata, SE3_COMM_BLOCK);
+        // decode header
+        SE3_GET16(s->req_buf, SE3_REQ_OFFSET_CMD, s->req.cmd);
+        SE3_GET16(s->req_buf, SE3_REQ_OFFSET_CMDFLAGS, s->req.cmd_flags);
+        SE3_GET16(s->req_buf, SE3_REQ_OFFSET_LEN, s->req.len);
+        s->longpoll = (s->req.cmd_flags & SE3_CMDFLAG_LONGPOLL) ? (true) : (false);
+        s->req.cmdtok[0] = token;
 #if SE3_CONF_CRC
-		SE3_GET16(comm.req_hdr, SE3_REQ_OFFSET_CRC, req_hdr.crc);
+		SE3_GET16(s->req_buf, SE3_REQ_OFFSET_CRC, s->req.crc);
 #endif
-        // read data
-        memcpy(comm.req_data, blockdata + SE3_REQ_SIZE_HEADER, SE3_COMM_BLOCK - SE3_REQ_SIZE_HEADER);
 
-        nblocks = req_hdr.len / SE3_COMM_BLOCK;
-        if (req_hdr.len%SE3_COMM_BLOCK != 0) {
+        nblocks = s->req.len / SE3_COMM_BLOCK;
+        if (s->req.len%SE3_COMM_BLOCK != 0) {
             nblocks++;
         }
         if (nblocks > SE3_COMM_N - 1) {
-            resp_hdr.status = SE3_ERR_COMM;
-            comm.req_bmap = 0;
-            comm.resp_ready = true;
+            // rejected when executed
+            s->req_bmap = 0;
         }
         // update bit map
-        comm.req_bmap &= SE3_BMAP_MAKE(nblocks);
-        SE3_BIT_CLEAR(comm.req_bmap, 0);
+        s->req_bmap &= SE3_BMAP_MAKE(nblocks);
+        SE3_BIT_CLEAR(s->req_bmap, 0);
     }
     else {
         // REQDATA block
         // read header
-        SE3_GET32(blockdata, SE3_REQDATA_OFFSET_CMDTOKEN, req_hdr.cmdtok[index]);
+        SE3_GET32(blockdata, SE3_REQDATA_OFFSET_CMDTOKEN, token);
+        s = slot_for_request_data(index, token);
+        if (s == NULL) {
+            SE3_TRACE(("P W%02u no request being received", (unsigned)index));
+            return;
+        }
+        s->req.cmdtok[index] = token;
         // read data
         memcpy(
-            comm.req_data + 1 * (SE3_COMM_BLOCK - SE3_REQ_SIZE_HEADER) + (index - 1)*(SE3_COMM_BLOCK - SE3_REQDATA_SIZE_HEADER),
+            s->req_buf + SE3_REQ_SIZE_HEADER + 1 * (SE3_COMM_BLOCK - SE3_REQ_SIZE_HEADER) + (index - 1)*(SE3_COMM_BLOCK - SE3_REQDATA_SIZE_HEADER),
             blockdata + SE3_REQDATA_SIZE_HEADER,
             SE3_COMM_BLOCK - SE3_REQDATA_SIZE_HEADER);
-        SE3_GET32(blockdata, 0, req_hdr.cmdtok[index]);
         // update bit map
-        SE3_BIT_CLEAR(comm.req_bmap, index);
+        SE3_BIT_CLEAR(s->req_bmap, index);
     }
 
-    if (comm.req_bmap == 0) {
-        comm.req_ready = true;
-        comm.req_bmap = SE3_BMAP_MAKE(32);
-        comm.block_guess = 0;
+    if (s->req_bmap == 0) {
+        s->req_bmap = SE3_BMAP_MAKE(32);
+        s->state = SE3_COMM_SLOT_READY;
     }
 }
 
@@ -241,6 +528,7 @@ int32_t se3_proto_recv(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint1
 {
 	int32_t r = SE3_PROTO_OK;
 	uint32_t block;
+	uint32_t start;
 	int index;
 	const uint8_t* data = buf;
 
@@ -249,7 +537,12 @@ int32_t se3_proto_recv(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint1
 		.count = 0
 	};
 
-	for (block = blk_addr; block < blk_addr + blk_len; block++) {
+	if (range_is_storage(buf, blk_addr, blk_len)) {
+		// plain file data, no need to inspect single blocks
+		return (secube_sdio_write(lun, buf, blk_addr, blk_len)) ? (SE3_PROTO_OK) : (SE3_PROTO_FAIL);
+	}
+
+	for (block = blk_addr; block < blk_addr + blk_len; block++, data += SE3_COMM_BLOCK) {
 		if (block == 0) {
 			r = se3_storage_range_add(&range, lun, (uint8_t*)data, block, range_write);
 			if (SE3_PROTO_OK != r) return r;
@@ -265,12 +558,11 @@ int32_t se3_proto_recv(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint1
                     // if magic already initialized, reset
                     comm.magic_ready = false;
                     comm.magic_bmap = SE3_BMAP_MAKE(16);
-                    for (index = 0; index < 16; index++)
-                        comm.blocks[index] = 0;
+                    magic_index_reset();
                 }
                 // store block in blocks map
                 index = data[SE3_COMM_BLOCK - 1];
-                comm.blocks[index] = block;
+                magic_index_add(index, block);
                 SE3_BIT_CLEAR(comm.magic_bmap, index);
                 if (comm.magic_bmap == 0) {
                     comm.magic_ready = true;
@@ -285,6 +577,7 @@ int32_t se3_proto_recv(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint1
                 }
                 else {
                     // magic file has been written. may be a command
+                    start = se3_perf_cycles();
                     index = find_magic_index(block);
                     if (index == -1) {
                         // block is not a request. forward
@@ -293,19 +586,12 @@ int32_t se3_proto_recv(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint1
                     }
                     else {
                         // block is a request
-                        if (comm.req_ready) {
-                            // already processing request. ignore
-                            SE3_TRACE(("P W%02u request already fully received", (unsigned)index));
-                            continue;
-                        }
-                        else {
-                            handle_req_recv(index, data);
-                        }
+                        handle_req_recv(index, data);
+                        se3_perf_add(&(se3_perf.proto[SE3_PERF_PROTO_RECV]), start, SE3_COMM_BLOCK);
                     }
                 }
             }
 		}
-		data += SE3_COMM_BLOCK;
 	}
 
 	//flush any remaining block
@@ -316,13 +602,16 @@ int32_t se3_proto_recv(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint1
  *  \param index index of block in the special protocol file
  *  \param blockdata output data
  *
- *  Output a single block of a protocol response. If the response is ready,
- *    the data is taken from the response buffer. Otherwise the 'not ready' state is
- *    returned.
+ *  Output a single block of a protocol response. Responses are read in the order the
+ *    requests were received. If the oldest response is ready, the data is taken from the
+ *    response buffer of its slot, and the slot is released once its last block has been
+ *    read, or once it has been passed over (see slot_for_response_first). Otherwise the
+ *    'not ready' state is returned.
  */
 static void handle_resp_send(int index, uint8_t* blockdata)
 {
     uint16_t u16tmp;
+    se3_comm_slot* s;
     
     if (index == SE3_COMM_N - 1) {
         // discover
@@ -330,41 +619,49 @@ static void handle_resp_send(int index, uint8_t* blockdata)
         memcpy(blockdata + SE3_DISCO_OFFSET_MAGIC + SE3_MAGIC_SIZE / 2, se3_magic, SE3_MAGIC_SIZE / 2);
         memcpy(blockdata + SE3_DISCO_OFFSET_SERIAL, serial.data, SE3_SERIAL_SIZE);
         memcpy(blockdata + SE3_DISCO_OFFSET_HELLO, se3_hello, SE3_HELLO_SIZE);
-        u16tmp = (comm.locked) ? (1) : (0);
+        u16tmp = (comm.locked) ? (SE3_DISCO_STATUS_LOCKED) : (0);
+        u16tmp |= SE3_DISCO_STATUS_PIPELINE | SE3_DISCO_STATUS_LONGPOLL;
         SE3_SET16(blockdata, SE3_DISCO_OFFSET_STATUS, u16tmp);
     }
     else {
-        if (comm.resp_ready) {
+        s = (index == 0) ? (slot_for_response_first()) : (slot_for_response());
+        if (s != NULL && s->state == SE3_COMM_SLOT_DONE) {
             // response ready
-            if (SE3_BIT_TEST(comm.resp_bmap, index)) {
+            if (SE3_BIT_TEST(s->resp_bmap, index)) {
                 // read valid block
                 if (index == 0) {
                     // RESP block
 
                     // encode and write header
                     u16tmp = 1;
-                    SE3_SET16(comm.resp_hdr, SE3_RESP_OFFSET_READY, u16tmp);
-                    SE3_SET16(comm.resp_hdr, SE3_RESP_OFFSET_STATUS, resp_hdr.status);
-                    SE3_SET16(comm.resp_hdr, SE3_RESP_OFFSET_LEN, resp_hdr.len);
-                    SE3_SET32(comm.resp_hdr, SE3_RESP_OFFSET_CMDTOKEN, resp_hdr.cmdtok[0]);
+                    SE3_SET16(s->resp_buf, SE3_RESP_OFFSET_READY, u16tmp);
+                    SE3_SET16(s->resp_buf, SE3_RESP_OFFSET_STATUS, s->resp.status);
+                    SE3_SET16(s->resp_buf, SE3_RESP_OFFSET_LEN, s->resp.len);
+                    SE3_SET32(s->resp_buf, SE3_RESP_OFFSET_CMDTOKEN, s->resp.cmdtok[0]);
 #if SE3_CONF_CRC
-                    SE3_SET16(comm.resp_hdr, SE3_RESP_OFFSET_CRC, resp_hdr.crc);
+                    SE3_SET16(s->resp_buf, SE3_RESP_OFFSET_CRC, s->resp.crc);
 #endif
-                    memcpy(blockdata, comm.resp_hdr, SE3_RESP_SIZE_HEADER);
+                    memcpy(blockdata, s->resp_buf, SE3_RESP_SIZE_HEADER);
 
                     // write data
-                    memcpy(blockdata + SE3_RESP_SIZE_HEADER, comm.resp_data, SE3_COMM_BLOCK - SE3_RESP_SIZE_HEADER);
+                    memcpy(blockdata + SE3_RESP_SIZE_HEADER, s->resp_buf + SE3_RESP_SIZE_HEADER, SE3_COMM_BLOCK - SE3_RESP_SIZE_HEADER);
+                    s->served = true;
                 }
                 else {
                     // RESPDATA block
                     // write header
-                    SE3_SET32(blockdata, SE3_RESPDATA_OFFSET_CMDTOKEN, resp_hdr.cmdtok[index]);
+                    SE3_SET32(blockdata, SE3_RESPDATA_OFFSET_CMDTOKEN, s->resp.cmdtok[index]);
                     // write data
                     memcpy(
                         blockdata + SE3_RESPDATA_SIZE_HEADER,
-                        comm.resp_data + 1 * (SE3_COMM_BLOCK - SE3_RESP_SIZE_HEADER) + (index - 1)*(SE3_COMM_BLOCK - SE3_RESPDATA_SIZE_HEADER),
+                        s->resp_buf + SE3_RESP_SIZE_HEADER + 1 * (SE3_COMM_BLOCK - SE3_RESP_SIZE_HEADER) + (index - 1)*(SE3_COMM_BLOCK - SE3_RESPDATA_SIZE_HEADER),
                         SE3_COMM_BLOCK - SE3_RESPDATA_SIZE_HEADER);
                 }
+                se3_perf.bytes_out += SE3_COMM_BLOCK;
+                if (index == s->resp_blocks - 1) {
+                    // the whole response has been read, the slot can take a new request
+                    s->state = SE3_COMM_SLOT_FREE;
+                }
             }
             else {
                 // read invalid block
@@ -374,11 +671,54 @@ static void handle_resp_send(int index, uint8_t* blockdata)
         else {
             // response not ready
             memset(blockdata, SE3_RESP_OFFSET_READY, sizeof(uint16_t));
+            if (index == 0) {
+                (se3_perf.busy_polls)++;
+            }
         }
     }
 }
 
 
+/** \brief Check if a read of the first response block must be held
+ *  \return true if the response has been requested with SE3_CMDFLAG_LONGPOLL, it is not
+ *    ready and the read has been held for less than SE3_COMM_HOLD_TIME.
+ */
+static bool response_hold_first()
+{
+    se3_comm_slot* s;
+    uint32_t now;
+    s = slot_for_response();
+    if (s == NULL || s->state == SE3_COMM_SLOT_DONE || !s->longpoll) {
+        comm.holding = false;
+        return false;
+    }
+    now = HAL_GetTick();
+    if (!comm.holding) {
+        comm.holding = true;
+        comm.hold_start = now;
+        return true;
+    }
+    if (now - comm.hold_start < SE3_COMM_HOLD_TIME) {
+        return true;
+    }
+    // expired, the host will read the response again
+    comm.holding = false;
+    return false;
+}
+
+/** \brief Check if a read must be held until the response is ready
+ *  \param blk_addr first block
+ *  \param blk_len number of blocks
+ *  \return true if the read includes the first response block and response_hold_first()
+ *    holds it.
+ */
+static bool response_hold(uint32_t blk_addr, uint16_t blk_len)
+{
+    if (!comm.magic_ready || blk_addr > comm.blocks[0] || blk_addr + blk_len <= comm.blocks[0]) {
+        return false;
+    }
+    return response_hold_first();
+}
 
 /*	User-written USB interface that implements the read operation of the
  * 	driver; it sends the data on the SD card if the data block does not
@@ -388,6 +728,7 @@ int32_t se3_proto_send(uint8_t lun, uint8_t* buf, uint32_t blk_addr, uint16_t bl
 {
 	int32_t r = SE3_PROTO_OK;
 	uint32_t block;
+	uint32_t start;
 	int index;
 	uint8_t* data = buf;
 	s3_storage_range range = {
@@ -395,12 +736,18 @@ int32_t se3_proto_send(uint8_t lun, uint8_t* buf, uint32_t blk_addr, uint16_t bl
 		.count = 0
 	};
 
+	if (response_hold(blk_addr, blk_len)) {
+		(se3_perf.held_reads)++;
+		return SE3_PROTO_BUSY;
+	}
+
 	for (block = blk_addr; block < blk_addr + blk_len; block++) {
 		if(block==0) {
             // forward
 			if (r == SE3_PROTO_OK) r = se3_storage_range_add(&range, lun, data, block, range_read);
 		}
 		else{
+			start = se3_perf_cycles();
 			index = find_magic_index(block);
             if (index == -1) {
                 // forward
@@ -408,6 +755,9 @@ int32_t se3_proto_send(uint8_t lun, uint8_t* buf, uint32_t blk_addr, uint16_t bl
             }
             else {
                 handle_resp_send(index, data);
+                if (index != SE3_COMM_N - 1) {
+                    se3_perf_add(&(se3_perf.proto[SE3_PERF_PROTO_SEND]), start, SE3_COMM_BLOCK);
+                }
             }
 		}
 		data += SE3_COMM_BLOCK;
@@ -418,4 +768,46 @@ int32_t se3_proto_send(uint8_t lun, uint8_t* buf, uint32_t blk_addr, uint16_t bl
     return r;
 }
 
+/*	Vendor command handler for the host-to-device direction: the blocks are
+ *	addressed by their index in the special protocol file, no magic file is needed.
+ */
+int32_t se3_proto_vendor_recv(const uint8_t* buf, uint32_t index, uint16_t blk_len)
+{
+	uint16_t i;
+	uint32_t start;
+	if (index >= SE3_COMM_N - 1 || blk_len > SE3_COMM_N - 1 - index) {
+		return SE3_PROTO_FAIL;
+	}
+	for (i = 0; i < blk_len; i++) {
+		start = se3_perf_cycles();
+		handle_req_recv((int)(index + i), buf + i * SE3_COMM_BLOCK);
+		se3_perf_add(&(se3_perf.proto[SE3_PERF_PROTO_RECV]), start, SE3_COMM_BLOCK);
+	}
+	return SE3_PROTO_OK;
+}
+
+/*	Vendor command handler for the device-to-host direction: the blocks are
+ *	addressed by their index in the special protocol file, no magic file is needed.
+ */
+int32_t se3_proto_vendor_send(uint8_t* buf, uint32_t index, uint16_t blk_len)
+{
+	uint16_t i;
+	uint32_t start;
+	if (index >= SE3_COMM_N || blk_len > SE3_COMM_N - index) {
+		return SE3_PROTO_FAIL;
+	}
+	if (index == 0 && response_hold_first()) {
+		(se3_perf.held_reads)++;
+		return SE3_PROTO_BUSY;
+	}
+	for (i = 0; i < blk_len; i++) {
+		start = se3_perf_cycles();
+		handle_resp_send((int)(index + i), buf + i * SE3_COMM_BLOCK);
+		if (index + i != SE3_COMM_N - 1) {
+			se3_perf_add(&(se3_perf.proto[SE3_PERF_PROTO_SEND]), start, SE3_COMM_BLOCK);
+		}
+	}
+	return SE3_PROTO_OK;
+}
+
 
@@ -27,15 +27,22 @@
 #include "se3_dispatcher_core.h"
 #include "crc16.h"
 #include "se3_rand.h"
+#include "se3_sdio.h"
+#include "se3_perf.h"
+#include "se3_evtrace.h"
+#ifndef CUBESIM
+#include "usbd_storage_if.h"
+#endif
 
 #define SE3_FLASH_SIGNATURE_ADDR  ((uint32_t)0x08020000)
 #define SE3_FLASH_SIGNATURE_SIZE  ((size_t)0x40)
 
-uint8_t se3_sessions_buf[SE3_SESSIONS_BUF];
+SE3_ALIGN_16 uint8_t se3_sessions_buf[SE3_SESSIONS_BUF];
 uint8_t* se3_sessions_index[SE3_SESSIONS_MAX];
 
 void device_init()
 {
+	se3_perf_init();
 	se3_communication_core_init();
 //	se3_time_init();
 	se3_flash_init();
@@ -45,12 +52,16 @@ void device_init()
 void device_loop()
 {
 	for (;;) {
-		if (comm.req_ready) {
-			comm.resp_ready = false;
+		if (se3_proto_request_next()) {
             se3_cmd_execute();
-			comm.req_ready = false;
-			comm.resp_ready = true;
+			se3_proto_response_done();
+		}
+		else {
+			se3_sessions_expire();
+			secube_sdio_idle();
 		}
+		// complete a read of the response held by the USB handler
+		STORAGE_Poll_HS();
 	}
 }
 
@@ -71,16 +82,22 @@ static uint16_t se3_exec(se3_cmd_func handler)
 #endif
 
     data_len = se3_req_len_data(req_hdr.len);
+    if (handler == NULL) {
+        // the request does not fit the request buffer, its data was not received
+        status = SE3_ERR_COMM;
+    }
 
 #if SE3_CONF_CRC
 	// compute CRC
-	crc = se3_crc16_update(SE3_REQ_OFFSET_CRC, comm.req_hdr, 0);
-	if (data_len > 0) {
-		crc = se3_crc16_update(data_len, comm.req_data, crc);
-	}
-	if (req_hdr.crc != crc) {
-		status = SE3_ERR_COMM;
-		resp_size = 0;
+	if (status == SE3_OK) {
+		crc = se3_crc16_update(SE3_REQ_OFFSET_CRC, comm.req_hdr, 0);
+		if (data_len > 0) {
+			crc = se3_crc16_update(data_len, comm.req_data, crc);
+		}
+		if (req_hdr.crc != crc) {
+			status = SE3_ERR_COMM;
+			resp_size = 0;
+		}
 	}
 #endif
 
@@ -139,24 +156,23 @@ void se3_cmd_execute()
     size_t i;
     se3_cmd_func handler = NULL;
 	uint32_t cmdtok0;
+	uint32_t start;
+	bool oversize;
 
     req_blocks = req_hdr.len / SE3_COMM_BLOCK;
     if (req_hdr.len % SE3_COMM_BLOCK != 0) {
         req_blocks++;
     }
-    if (req_blocks > SE3_COMM_N - 1) {
-        // should not happen anyway
-        resp_blocks = 0;
-        goto update_comm;
-    }
-    for (i = 1; i < req_blocks; i++) {
+    oversize = (req_blocks > SE3_COMM_N - 1);
+    for (i = 1; i < req_blocks && !oversize; i++) {
         if (req_hdr.cmdtok[i] != req_hdr.cmdtok[i - 1] + 1) {
             resp_blocks = 0;
             goto update_comm;
         }
     }
 
-	if (handler == NULL) {
+	// an oversize request is answered with SE3_ERR_COMM by se3_exec (no handler)
+	if (!oversize) {
 		switch (req_hdr.cmd) {
 		case SE3_CMD0_MIX:
 			set_req_hdr(req_hdr);
@@ -176,7 +192,13 @@ void se3_cmd_execute()
 		}
 	}
 
+    se3_evt(SE3_EVT_CMD0_BEGIN, req_hdr.cmd, req_hdr.len);
+    start = se3_perf_cycles();
     resp_blocks = se3_exec(handler);
+    se3_evt(SE3_EVT_CMD0_END, req_hdr.cmd, resp_blocks);
+    if (req_hdr.cmd < SE3_PERF_CMD0_MAX) {
+        se3_perf_add(&(se3_perf.cmd0[req_hdr.cmd]), start, req_hdr.len);
+    }
 
     // set cmdtok
 	cmdtok0 = req_hdr.cmdtok[0];
@@ -348,10 +348,12 @@ uint16_t key_edit(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, ui
         uint32_t id;
         uint16_t data_len;
         const uint8_t* data;
+        uint16_t policy;
     } req_params;
     se3_flash_key key;
     se3_flash_it it = { .addr = NULL };
     uint8_t *trng_keydata = NULL;
+    uint16_t policy_off;
 
     if (req_size < SE3_CMD1_KEY_EDIT_REQ_OFF_DATA) {
         SE3_TRACE(("[key_edit] req size mismatch\n"));
@@ -380,11 +382,18 @@ uint16_t key_edit(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, ui
     } else {
     	req_params.data = req + SE3_CMD1_KEY_EDIT_REQ_OFF_DATA;
     }
+    // the policy is optional, it follows the key data (if any)
+    policy_off = SE3_CMD1_KEY_EDIT_REQ_OFF_DATA + ((req_params.data != NULL) ? req_params.data_len : 0);
+    req_params.policy = 0;
+    if((req_params.op != SE3_KEY_OP_DELETE) && (req_size >= policy_off + 2)){
+    	SE3_GET16(req, policy_off, req_params.policy);
+    }
 
     // copy values in key structure
     key.id = req_params.id;
     key.data_size = req_params.data_len;
     key.data = (uint8_t*)req_params.data;
+    key.policy = req_params.policy;
 
     /* check if key ID meets requirements
      * this function is dedicated to manual key management, therefore we do not allow
@@ -396,6 +405,9 @@ uint16_t key_edit(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, ui
     	return SE3_ERR_PARAMS;
     }
 
+    // any cached context derived from this key ID becomes stale
+    se3_key_cache_invalidate(key.id);
+
     // check if there is already a key with same ID
     se3_flash_it_init(&it);
     if (!se3_key_find(key.id, &it)) {
@@ -481,6 +493,7 @@ uint16_t dispatcher_call(uint16_t req_size, const uint8_t* req, uint16_t* resp_s
     const uint8_t* req1;
     uint8_t* resp1;
     uint16_t status;
+    uint32_t start;
     struct {
         const uint8_t* auth;
         const uint8_t* iv;
@@ -551,7 +564,7 @@ uint16_t dispatcher_call(uint16_t req_size, const uint8_t* req, uint16_t* resp_s
     SE3_GET16(req, SE3_REQ1_OFFSET_CMD, req_params.cmd);
 
     if (req_params.cmd < SE3_CMD1_MAX) {
-    	if (req_params.cmd > 6 && req_params.cmd < 11 && !login_struct.y) {
+    	if (((req_params.cmd > 6 && req_params.cmd < 11) || req_params.cmd == SE3_CMD1_CRYPTO_SESSIONS || req_params.cmd == SE3_CMD1_PERF) && !login_struct.y) {
     		SE3_TRACE(("[crypto_init] not logged in\n"));
     		return SE3_ERR_ACCESS;
     	}
@@ -570,7 +583,13 @@ uint16_t dispatcher_call(uint16_t req_size, const uint8_t* req, uint16_t* resp_s
     resp1 = resp + SE3_RESP1_OFFSET_DATA;
     resp1_size = 0;
 
+    se3_evt(SE3_EVT_CMD1_BEGIN, req_params.cmd, req1_size);
+    start = se3_perf_cycles();
     status = handler(req1_size, req1, &resp1_size, resp1);
+    se3_evt(SE3_EVT_CMD1_END, req_params.cmd, status);
+    if (req_params.cmd < SE3_PERF_CMD1_MAX) {
+        se3_perf_add(&(se3_perf.cmd1[req_params.cmd]), start, req1_size);
+    }
 
     resp_params.len = resp1_size;
     resp_params.auth = resp + SE3_RESP1_OFFSET_AUTH;
@@ -624,6 +643,7 @@ uint16_t dispatcher_call(uint16_t req_size, const uint8_t* req, uint16_t* resp_s
 
 void se3_dispatcher_init()
 {
+    size_t i;
 	se3_security_core_init();
     memset(&login_struct, 0, sizeof(login_struct));
     se3_security_info.records[SE3_RECORD_TYPE_USERPIN].read_access = SE3_ACCESS_MAX;
@@ -631,6 +651,13 @@ void se3_dispatcher_init()
     se3_security_info.records[SE3_RECORD_TYPE_ADMINPIN].read_access = SE3_ACCESS_MAX;
     se3_security_info.records[SE3_RECORD_TYPE_ADMINPIN].write_access = SE3_ACCESS_ADMIN;
     se3_mem_init(&(se3_security_info.sessions), SE3_SESSIONS_MAX, se3_sessions_index, SE3_SESSIONS_BUF, se3_sessions_buf);
+    // one slab size class for each context size in the algorithm table
+    for (i = 0; i < SE3_ALGO_MAX; i++) {
+        if (algo_table[i].init != NULL && !se3_mem_add_class(&(se3_security_info.sessions), algo_table[i].size)) {
+            // sessions of this algorithm would take the slots of a larger class
+            SE3_TRACE(("[se3_dispatcher_init] no size class for algorithm %u\n", (unsigned)i));
+        }
+    }
     login_cleanup();
 }
 
@@ -642,6 +669,7 @@ static void login_cleanup()
 {
     size_t i;
     se3_mem_reset(&(se3_security_info.sessions));
+    se3_key_cache_reset();
     login_struct.y = false;
     login_struct.access = 0;
     login_struct.challenge_access = SE3_ACCESS_MAX;
@@ -651,4 +679,6 @@ static void login_cleanup()
     for (i = 0; i < SE3_SESSIONS_MAX; i++) {
         se3_security_info.sessions_algo[i] = SE3_ALGO_INVALID;
     }
+    se3_security_info.sessions_timeout = SE3_SESSIONS_TIMEOUT_DEFAULT;
+    se3_security_info.sessions_reclaimed = 0;
 }
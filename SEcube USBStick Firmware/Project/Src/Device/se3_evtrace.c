@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_evtrace.c
+  * Description        : Event trace ring
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#include "se3_evtrace.h"
+
+se3_evtrace_ring se3_evtrace;
+
+uint16_t se3_evtrace_drain(uint8_t* buf, uint16_t max, uint16_t* pending, uint32_t* lost)
+{
+	uint16_t n = 0;
+	const se3_evtrace_entry* e;
+#ifndef CUBESIM
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+#endif
+	if (se3_evtrace.head - se3_evtrace.tail > SE3_EVTRACE_SIZE) {
+		se3_evtrace.lost += se3_evtrace.head - se3_evtrace.tail - SE3_EVTRACE_SIZE;
+		se3_evtrace.tail = se3_evtrace.head - SE3_EVTRACE_SIZE;
+	}
+	while (n < max && se3_evtrace.tail != se3_evtrace.head) {
+		e = &(se3_evtrace.entries[se3_evtrace.tail & (SE3_EVTRACE_SIZE - 1)]);
+		SE3_SET32(buf, SE3_EVTRACE_ENTRY_OFF_TS, e->ts);
+		SE3_SET16(buf, SE3_EVTRACE_ENTRY_OFF_ID, e->id);
+		SE3_SET16(buf, SE3_EVTRACE_ENTRY_OFF_A, e->a);
+		SE3_SET32(buf, SE3_EVTRACE_ENTRY_OFF_B, e->b);
+		buf += SE3_EVTRACE_ENTRY_SIZE;
+		(se3_evtrace.tail)++;
+		n++;
+	}
+	*pending = (uint16_t)(se3_evtrace.head - se3_evtrace.tail);
+	*lost = se3_evtrace.lost;
+	se3_evtrace.lost = 0;
+#ifndef CUBESIM
+	__set_PRIMASK(primask);
+#endif
+	return n;
+}
@@ -24,12 +24,16 @@
 
 #include "se3_flash.h"
 #include "se3_common.h"
+#include "se3_perf.h"
+#include "se3_evtrace.h"
 
 SE3_FLASH_INFO flash;
 
 static bool flash_fill(uint32_t addr, uint8_t val, size_t size)
 {
 	bool success = true;
+	(se3_perf.flash_program)++;
+	se3_perf.flash_program_bytes += (uint32_t)size;
 	HAL_FLASH_Unlock();
 	while (size) {
 		if (HAL_OK != HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, addr, (uint64_t)val)) {
@@ -47,6 +51,8 @@ static bool flash_fill(uint32_t addr, uint8_t val, size_t size)
 static bool flash_zero(uint32_t addr, size_t size)
 {
 	bool success = true;
+	(se3_perf.flash_program)++;
+	se3_perf.flash_program_bytes += (uint32_t)size;
 	HAL_FLASH_Unlock();
 	while (size) {
 		if (HAL_OK != HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, addr, 0)) {
@@ -64,6 +70,8 @@ static bool flash_zero(uint32_t addr, size_t size)
 static bool flash_program(uint32_t addr, const uint8_t* data, size_t size)
 {
 	bool success = true;
+	(se3_perf.flash_program)++;
+	se3_perf.flash_program_bytes += (uint32_t)size;
 	HAL_FLASH_Unlock();
 	while (size) {
 		if (HAL_OK != HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, addr, (uint64_t)*data)) {
@@ -83,6 +91,7 @@ static bool flash_program(uint32_t addr, const uint8_t* data, size_t size)
 
 static bool flash_erase(uint32_t sector) {
     bool success = true;
+    (se3_perf.flash_erase)++;
 #ifdef CUBESIM
     memset((sector == SE3_FLASH_S0) ? (uint8_t*)(SE3_FLASH_S0_ADDR) : (uint8_t*)(SE3_FLASH_S1_ADDR), 0xFF, SE3_FLASH_SECTOR_SIZE);
 #else
@@ -128,6 +137,7 @@ static bool flash_swap()
 	else {
 		return false;
 	}
+	(se3_perf.flash_swap)++;
 	other_index = other_base + SE3_FLASH_MAGIC_SIZE;
 	//erase other sector
 	flash_erase(other);
@@ -324,6 +334,7 @@ bool se3_flash_it_new(se3_flash_it* it, uint8_t type, uint16_t size)
 {
 	size_t pos, nblocks;
 	const uint8_t* node;
+	bool success;
 	size_t avail = SE3_FLASH_SECTOR_SIZE - flash.allocated;
 	uint16_t size_on_flash = size + 2;
 	if (size_on_flash > SE3_FLASH_NODE_MAX)return false;
@@ -332,7 +343,10 @@ bool se3_flash_it_new(se3_flash_it* it, uint8_t type, uint16_t size)
 	}
 	if (size_on_flash > avail) {
 		// swap sector
-		if (!flash_swap()) {
+		se3_evt(SE3_EVT_FLASH_SWAP_BEGIN, (uint16_t)flash.sector, (uint32_t)flash.used);
+		success = flash_swap();
+		se3_evt(SE3_EVT_FLASH_SWAP_END, success, (uint32_t)flash.used);
+		if (!success) {
 			return false;
 		}
 	}
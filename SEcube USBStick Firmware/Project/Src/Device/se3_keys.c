@@ -48,6 +48,9 @@ bool se3_key_find(uint32_t id, se3_flash_it* it)
 bool se3_key_new(se3_flash_it* it, se3_flash_key* key)
 {
 	uint16_t size = (SE3_FLASH_KEY_SIZE_HEADER + key->data_size);
+	if (key->policy != 0) {
+		size += 2;
+	}
     if (size > SE3_FLASH_NODE_DATA_MAX) {
         return false;
     }
@@ -65,6 +68,11 @@ void se3_key_read(se3_flash_it* it, se3_flash_key* key)
 	if (key->data) {
 		memcpy(key->data, it->addr + SE3_KEY_OFFSET_DATA, key->data_size);
 	}
+	// keys written without a policy have no restrictions
+	key->policy = 0;
+	if (it->size >= SE3_KEY_OFFSET_DATA + key->data_size + 2) {
+		SE3_GET16(it->addr, SE3_KEY_OFFSET_DATA + key->data_size, key->policy);
+	}
 }
 
 bool se3_key_equal(se3_flash_it* it, se3_flash_key* key)
@@ -99,6 +107,11 @@ bool se3_key_write(se3_flash_it* it, se3_flash_key* key)
 				break;
 			}
 		}
+		if (key->policy != 0) {
+			if (!se3_flash_it_write(it, SE3_KEY_OFFSET_DATA + key->data_size, (uint8_t*)&(key->policy), 2)) { // policy is uint16_t
+				break;
+			}
+		}
 		success = true;
 	} while (0);
 
@@ -23,224 +23,220 @@
   */
 
 #include "se3_memory.h"
+#include "se3_perf.h"
 #include <stdlib.h>
 
-#define SE3_MEM_SIZE_GET(x, val) SE3_GET16(x, 0, (val))
-#define SE3_MEM_SIZE_SET(x, val) SE3_SET16(x, 0, (val))
-#define SE3_MEM_INFO_GET(x, info) SE3_GET16(x, 2, info)
-#define SE3_MEM_INFO_SET(x, info) SE3_SET16(x, 2, info)
-#define SE3_MEM_INFO_MAKE(id, valid) ((id) | ((valid)?(1):(0)) << 15 )
-#define SE3_MEM_INFO_ISVALID(info) SE3_BIT_TEST(info, 15)
-#define SE3_MEM_INFO_ID(info) ((info) & ~(1<<15))
+/* Sessions are served by a slab allocator: the buffer is split in pages of SE3_MEM_PAGE bytes,
+ * each page is assigned on demand to one size class and carved into equally sized slots.
+ * Allocation and release are O(1) and entries never move, so no defragmentation is needed. */
+
+#define SE3_MEM_SLOT_NEXT_GET(p, val) SE3_GET16(p, 0, val)
+#define SE3_MEM_SLOT_NEXT_SET(p, val) SE3_SET16(p, 0, val)
+
+static void se3_mem_page_unlink(se3_mem* mem, uint8_t pg)
+{
+	se3_mem_page* page = &(mem->pages[pg]);
+	if (page->prev != SE3_MEM_NONE) {
+		mem->pages[page->prev].next = page->next;
+	}
+	else {
+		mem->classes[page->cls].partial = page->next;
+	}
+	if (page->next != SE3_MEM_NONE) {
+		mem->pages[page->next].prev = page->prev;
+	}
+	page->next = SE3_MEM_NONE;
+	page->prev = SE3_MEM_NONE;
+}
+
+static void se3_mem_page_link(se3_mem* mem, uint8_t pg)
+{
+	se3_mem_page* page = &(mem->pages[pg]);
+	se3_mem_class* cls = &(mem->classes[page->cls]);
+	page->prev = SE3_MEM_NONE;
+	page->next = cls->partial;
+	if (cls->partial != SE3_MEM_NONE) {
+		mem->pages[cls->partial].prev = pg;
+	}
+	cls->partial = pg;
+}
 
 void se3_mem_reset(se3_mem* mem)
 {
 	size_t i;
-	uint16_t tmp;
-    mem->used = 0;
-    memset(mem->dat, 0, (mem->dat_size)*SE3_MEM_BLOCK);
-	
+	mem->used = 0;
+	memset(mem->dat, 0, mem->dat_size);
+
 	for (i = 0; i < mem->max_count; i++) {
 		mem->ptr[i] = NULL;
+		mem->requested[i] = 0;
+	}
+	// ids are handed out in ascending order after a reset
+	mem->nids = (uint16_t)mem->max_count;
+	for (i = 0; i < mem->max_count; i++) {
+		mem->ids[i] = (uint16_t)(mem->max_count - 1 - i);
+	}
+
+	// all pages go back to the free list
+	mem->free_pages = (mem->npages > 0) ? (0) : (SE3_MEM_NONE);
+	for (i = 0; i < mem->npages; i++) {
+		mem->pages[i].cls = SE3_MEM_NONE;
+		mem->pages[i].next = (i + 1 < mem->npages) ? ((uint8_t)(i + 1)) : (SE3_MEM_NONE);
+		mem->pages[i].prev = SE3_MEM_NONE;
+		mem->pages[i].used = 0;
+		mem->pages[i].bump = 0;
+		mem->pages[i].free = SE3_MEM_NONE;
+	}
+	for (i = 0; i < mem->nclasses; i++) {
+		mem->classes[i].partial = SE3_MEM_NONE;
 	}
 
-    // first entry is an invalid entry filling the whole buffer
-    tmp = (uint16_t)mem->dat_size;
-    SE3_MEM_SIZE_SET(mem->dat, tmp);
-    tmp = SE3_MEM_INFO_MAKE(0, 0);
-    SE3_MEM_INFO_SET(mem->dat, tmp);
+	mem->allocs = 0;
+	mem->failures = 0;
+	mem->peak = 0;
 }
 
 void se3_mem_init(se3_mem* mem, size_t index_size, uint8_t** index, size_t buf_size, uint8_t* buf)
 {
-    uint16_t nblocks;
+	size_t skip;
+	if (index_size > SE3_MEM_INDEX_MAX) {
+		index_size = SE3_MEM_INDEX_MAX;
+	}
 	mem->max_count = index_size;
 	mem->ptr = index;
 
-    nblocks = (uint16_t)(buf_size / SE3_MEM_BLOCK);
-    mem->dat_size = nblocks;
-    mem->dat = buf;
+	// align the first page, then use only whole pages
+	skip = (SE3_MEM_ALIGN - ((uintptr_t)buf % SE3_MEM_ALIGN)) % SE3_MEM_ALIGN;
+	buf_size = (buf_size > skip) ? (buf_size - skip) : (0);
+	mem->npages = (uint8_t)((buf_size / SE3_MEM_PAGE > SE3_MEM_PAGES_MAX) ? (SE3_MEM_PAGES_MAX) : (buf_size / SE3_MEM_PAGE));
+	mem->dat_size = mem->npages * SE3_MEM_PAGE;
+	mem->dat = buf + skip;
+	mem->nclasses = 0;
 
-    se3_mem_reset(mem);
+	se3_mem_reset(mem);
 }
 
-static void se3_mem_compact(uint8_t* p, uint8_t* end)
+bool se3_mem_add_class(se3_mem* mem, size_t size)
 {
-	uint8_t* p2 = p;
-	bool empty = false;
-    uint16_t size;
-    uint16_t info;
+	size_t i, j;
+	size_t slots;
 
-	while (p2 < end) {
-        SE3_MEM_INFO_GET(p2, info);
-        if (SE3_MEM_INFO_ISVALID(info)) {
-            break;
-        }
-        SE3_MEM_SIZE_GET(p2, size);
-        p2 += size*SE3_MEM_BLOCK;
-		empty = true;
-	}
-	if (empty) {
-        size = (uint16_t)(((uint32_t)(p2 - p)) / SE3_MEM_BLOCK);
-		SE3_MEM_SIZE_SET(p, size);
+	if (mem->used != 0) {
+		SE3_TRACE(("[se3_mem_add_class] cannot add classes while entries are allocated\n"));
+		return false;
 	}
-}
-
-static uint8_t* se3_mem_defrag(se3_mem* mem)
-{
-	uint8_t* p1, *p2;
-	uint16_t p2_size;
-	bool p2_valid;
-	uint16_t id;
-	uint8_t* end = mem->dat + mem->dat_size*SE3_MEM_BLOCK;
-    uint16_t info, size;
-
-	//find first free block
-	p1 = mem->dat;
-	while (p1 < end) {
-        SE3_MEM_INFO_GET(p1, info);
-		if (!SE3_MEM_INFO_ISVALID(info)) {
+	if (size < sizeof(uint16_t)) {
+		size = sizeof(uint16_t);
+	}
+	size = ((size + SE3_MEM_ALIGN - 1) / SE3_MEM_ALIGN) * SE3_MEM_ALIGN;
+	if (size > SE3_MEM_PAGE) {
+		SE3_TRACE(("[se3_mem_add_class] size %u exceeds page size\n", (unsigned)size));
+		return false;
+	}
+	for (i = 0; i < mem->nclasses; i++) {
+		if (mem->classes[i].size == size) {
+			return true;
+		}
+		if (mem->classes[i].size > size) {
 			break;
 		}
-        SE3_MEM_SIZE_GET(p1, size);
-        p1 += size*SE3_MEM_BLOCK;
 	}
-	if (p1 >= end) {
-		return p1;
+	if (mem->nclasses >= SE3_MEM_CLASS_MAX) {
+		SE3_TRACE(("[se3_mem_add_class] no more size classes\n"));
+		return false;
 	}
-
-    SE3_MEM_SIZE_GET(p1, size);
-	p2 = p1 + size*SE3_MEM_BLOCK;
-	while(p2<end) {
-        SE3_MEM_SIZE_GET(p2, p2_size);
-        SE3_MEM_INFO_GET(p2, info);
-        p2_valid = SE3_MEM_INFO_ISVALID(info);
-		if ( p2_valid ) {
-			memmove(p1, p2, p2_size*SE3_MEM_BLOCK);
-			p1 += p2_size*SE3_MEM_BLOCK;
-		}
-		p2 += p2_size*SE3_MEM_BLOCK;
+	// no page is assigned, so shifting the table is safe
+	for (j = mem->nclasses; j > i; j--) {
+		mem->classes[j] = mem->classes[j - 1];
 	}
-	if (p1 < end) {
-        size = (uint16_t)(((uint32_t)(end - p1))/SE3_MEM_BLOCK);
-		SE3_MEM_SIZE_SET(p1, size);
-
-        // clear valid
-        SE3_MEM_INFO_GET(p1, info);
-        info = SE3_MEM_INFO_MAKE(SE3_MEM_INFO_ID(info), 0);
-        SE3_MEM_INFO_SET(p1, info);
-	}
-	
-	//rebuild ptr table
-	
-	p2 = mem->dat;
-	while (p2 < end) {
-        SE3_MEM_INFO_GET(p2, info);
-		if (SE3_MEM_INFO_ISVALID(info)) {
-			id = SE3_MEM_INFO_ID(info);
-			mem->ptr[id] = p2;
-		}
-        SE3_MEM_SIZE_GET(p2, size);
-        p2 += size*SE3_MEM_BLOCK;
+	slots = SE3_MEM_PAGE / size;
+	if (slots >= SE3_MEM_NONE) {
+		slots = SE3_MEM_NONE - 1;
 	}
-
-	//return first empty block;
-	return p1;
+	mem->classes[i].size = (uint16_t)size;
+	mem->classes[i].slots = (uint8_t)slots;
+	mem->classes[i].partial = SE3_MEM_NONE;
+	(mem->nclasses)++;
+	return true;
 }
 
 int32_t se3_mem_alloc(se3_mem* mem, size_t size)
 {
-	uint8_t* p = mem->dat, *p2;
-	uint8_t* dat_end = mem->dat + (mem->dat_size)*SE3_MEM_BLOCK;
-	size_t i;
-    uint16_t p_info;
-	uint16_t p_size;
-    uint16_t u16tmp;
-    uint16_t nblocks;
-	bool valid;
-
-	// header size
-	size += SE3_MEM_HEADER;
+	uint8_t c, pg;
+	uint8_t slot;
+	uint16_t id;
+	se3_mem_page* page;
+	se3_mem_class* cls;
+	uint8_t* p;
 
-    // number of blocks
-    nblocks = (uint16_t)(size / SE3_MEM_BLOCK);
-    if (size % SE3_MEM_BLOCK != 0) {
-        nblocks++;
-    }
-    
-	if (mem->used + nblocks > mem->dat_size) {
-		//no more space
-		return -1;
-	}
-	
-	for (i = 0; i < mem->max_count; i++) {
-		if (mem->ptr[i] == NULL) {
+	for (c = 0; c < mem->nclasses; c++) {
+		if (mem->classes[c].size >= size) {
 			break;
 		}
 	}
-	if (i >= mem->max_count) {
-		// no more slots
+	if (c >= mem->nclasses) {
+		SE3_TRACE(("[se3_mem_alloc] no size class for %u bytes\n", (unsigned)size));
+		(mem->failures)++;
+		(se3_perf.mem_failures)++;
 		return -1;
 	}
-	while (p < dat_end) {
-        SE3_MEM_SIZE_GET(p, p_size);
-        SE3_MEM_INFO_GET(p, p_info);
-		valid = SE3_MEM_INFO_ISVALID(p_info);
-		if (p_size == 0 ) {
-			SE3_TRACE(("E mem_alloc memory corrupted, block with size=0\n"));
-			return -1;
-		}
-		else if (!valid) {
-			// try to aggregate blocks ahead
-            if (p_size < nblocks) {
-				se3_mem_compact(p, dat_end);
-			}
-            
-			if (p_size == nblocks) {
-                // ok, no need to resize entry
-				break;
-			}
-            else if (p_size > nblocks) {
-                // ok, resize entry
-                p2 = p + nblocks*SE3_MEM_BLOCK;
-                u16tmp = p_size - nblocks;
-                SE3_MEM_SIZE_SET(p2, u16tmp);
-                u16tmp = SE3_MEM_INFO_MAKE(0, 0);
-                SE3_MEM_INFO_SET(p2, u16tmp);
-                break;
-            }
-		}
-        p += p_size*SE3_MEM_BLOCK;
+	cls = &(mem->classes[c]);
+
+	if (mem->nids == 0) {
+		// no more slots
+		(mem->failures)++;
+		(se3_perf.mem_failures)++;
+		return -1;
 	}
-	if (p >= dat_end) {
-        // there enough free memory but it is fragmented
-		p = se3_mem_defrag(mem);
-		SE3_TRACE(("[se3_mem_alloc] defragging session memory\n"));
 
-		if (p < dat_end) {
-			SE3_MEM_SIZE_GET(p, p_size);
-			p2 = p + nblocks*SE3_MEM_BLOCK;
-			u16tmp = p_size - nblocks;
-			SE3_MEM_SIZE_SET(p2, u16tmp);
-			u16tmp = SE3_MEM_INFO_MAKE(0, 0);
-			SE3_MEM_INFO_SET(p2, u16tmp);
-		}
-		else {
-			SE3_TRACE(("[se3_mem_alloc] memory corrupted, usage reports free memory while none\n"));
+	pg = cls->partial;
+	if (pg == SE3_MEM_NONE) {
+		// take a fresh page for this class
+		pg = mem->free_pages;
+		if (pg == SE3_MEM_NONE) {
+			// no more space
+			(mem->failures)++;
+			(se3_perf.mem_failures)++;
 			return -1;
 		}
+		(se3_perf.mem_refills)++;
+		mem->free_pages = mem->pages[pg].next;
+		page = &(mem->pages[pg]);
+		page->cls = c;
+		page->used = 0;
+		page->bump = 0;
+		page->free = SE3_MEM_NONE;
+		se3_mem_page_link(mem, pg);
 	}
+	page = &(mem->pages[pg]);
 
-    // update entry header
-    SE3_MEM_SIZE_SET(p, nblocks);
-    u16tmp = SE3_MEM_INFO_MAKE((uint16_t)i, 1);
-    SE3_MEM_INFO_SET(p, u16tmp);
+	if (page->free != SE3_MEM_NONE) {
+		slot = page->free;
+		p = mem->dat + pg * SE3_MEM_PAGE + slot * cls->size;
+		SE3_MEM_SLOT_NEXT_GET(p, id);
+		page->free = (uint8_t)id;
+	}
+	else {
+		slot = (page->bump)++;
+		p = mem->dat + pg * SE3_MEM_PAGE + slot * cls->size;
+	}
+	(page->used)++;
+	if (page->used == cls->slots) {
+		// page is full, stop looking at it
+		se3_mem_page_unlink(mem, pg);
+	}
 
-    // update index
-	mem->ptr[i] = p;
-	(mem->used) += nblocks;
+	// update index
+	id = mem->ids[--(mem->nids)];
+	mem->ptr[id] = p;
+	mem->requested[id] = (uint16_t)size;
+	mem->used += cls->size;
+	(mem->allocs)++;
+	if (mem->max_count - mem->nids > mem->peak) {
+		mem->peak = (uint16_t)(mem->max_count - mem->nids);
+	}
 
-	return (int32_t)i;
+	return (int32_t)id;
 }
 
 uint8_t* se3_mem_ptr(se3_mem* mem, int32_t id)
@@ -253,7 +249,7 @@ uint8_t* se3_mem_ptr(se3_mem* mem, int32_t id)
 			SE3_TRACE(("E mem_ptr index points to NULL\n"));
 			return NULL;
 		}
-        return mem->ptr[id] + SE3_MEM_HEADER;
+        return mem->ptr[id];
 	}
 	else {
 		SE3_TRACE(("E mem_ptr index out of range\n"));
@@ -264,20 +260,77 @@ uint8_t* se3_mem_ptr(se3_mem* mem, int32_t id)
 void se3_mem_free(se3_mem* mem, int32_t id)
 {
 	uint8_t* p;
-    uint16_t info;
-    uint16_t size;
+	uint8_t pg;
+	uint8_t slot;
+	uint16_t next;
+	bool full;
+	se3_mem_page* page;
+	se3_mem_class* cls;
+
     if (id < 0) {
         return;
     }
-	if ((uint32_t)id < mem->max_count) {
-		p = mem->ptr[id];
-		mem->ptr[id] = NULL;
-        SE3_MEM_SIZE_GET(p, size);
-        SE3_MEM_INFO_GET(p, info);
-        info = SE3_MEM_INFO_MAKE(SE3_MEM_INFO_ID(info), 0);
-        SE3_MEM_INFO_SET(p, info);
-        (mem->used) -= size;
+	if ((uint32_t)id >= mem->max_count) {
+		return;
+	}
+	p = mem->ptr[id];
+	if (p == NULL) {
+		// already released
+		return;
+	}
+	mem->ptr[id] = NULL;
+	mem->requested[id] = 0;
+	mem->ids[(mem->nids)++] = (uint16_t)id;
+
+	pg = (uint8_t)((uint32_t)(p - mem->dat) / SE3_MEM_PAGE);
+	page = &(mem->pages[pg]);
+	cls = &(mem->classes[page->cls]);
+	slot = (uint8_t)((uint32_t)(p - (mem->dat + pg * SE3_MEM_PAGE)) / cls->size);
+	full = (page->used == cls->slots);
+
+	next = page->free;
+	SE3_MEM_SLOT_NEXT_SET(p, next);
+	page->free = slot;
+	(page->used)--;
+	mem->used -= cls->size;
+
+	if (page->used == 0) {
+		// give the page back, it can be reused by any class
+		if (!full) {
+			se3_mem_page_unlink(mem, pg);
+		}
+		page->cls = SE3_MEM_NONE;
+		page->next = mem->free_pages;
+		mem->free_pages = pg;
+	}
+	else if (full) {
+		se3_mem_page_link(mem, pg);
 	}
 }
 
+void se3_mem_stats_get(se3_mem* mem, se3_mem_stats* stats)
+{
+	size_t i;
+	se3_mem_page* page;
 
+	memset(stats, 0, sizeof(se3_mem_stats));
+	stats->allocs = mem->allocs;
+	stats->failures = mem->failures;
+	stats->entries = (uint16_t)(mem->max_count - mem->nids);
+	stats->entries_peak = mem->peak;
+	stats->pages = mem->npages;
+	stats->bytes_used = (uint32_t)mem->used;
+	for (i = 0; i < mem->max_count; i++) {
+		stats->bytes_requested += mem->requested[i];
+	}
+	stats->bytes_internal = stats->bytes_used - stats->bytes_requested;
+	for (i = 0; i < mem->npages; i++) {
+		page = &(mem->pages[i]);
+		if (page->cls == SE3_MEM_NONE) {
+			(stats->pages_free)++;
+		}
+		else {
+			stats->bytes_external += (uint32_t)(mem->classes[page->cls].slots - page->used) * mem->classes[page->cls].size;
+		}
+	}
+}
@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * File Name          : se3_perf.c
+  * Description        : Performance counters
+  ******************************************************************************
+  *
+  * Copyright(c) 2016-present Blu5 Group <https://www.blu5group.com>
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License as published by the Free Software Foundation; either
+  * version 3 of the License, or (at your option) any later version.
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public
+  * License along with this library; if not, see <https://www.gnu.org/licenses/>.
+  *
+  ******************************************************************************
+  */
+
+#include "se3_perf.h"
+#include "se3_evtrace.h"
+
+se3_perf_counters se3_perf;
+
+void se3_perf_init()
+{
+#ifndef CUBESIM
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	se3_perf_reset();
+}
+
+void se3_perf_reset()
+{
+	memset(&se3_perf, 0, sizeof(se3_perf_counters));
+	se3_perf.reset_tick = HAL_GetTick();
+}
+
+static void perf_entries_write(uint8_t* p, const se3_perf_entry* e, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; i++) {
+		SE3_SET32(p, SE3_CMD1_PERF_ENTRY_OFF_COUNT, e[i].count);
+		SE3_SET32(p, SE3_CMD1_PERF_ENTRY_OFF_BYTES, e[i].bytes);
+		SE3_SET64(p, SE3_CMD1_PERF_ENTRY_OFF_CYCLES, e[i].cycles);
+		p += SE3_CMD1_PERF_ENTRY_SIZE;
+	}
+}
+
+uint16_t perf(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, uint8_t* resp)
+{
+	uint16_t op;
+	uint16_t u16tmp;
+	uint32_t u32tmp;
+	uint8_t* p;
+	uint16_t pending;
+
+	if (req_size != SE3_CMD1_PERF_REQ_SIZE) {
+		SE3_TRACE(("[perf] req size mismatch\n"));
+		return SE3_ERR_PARAMS;
+	}
+	SE3_GET16(req, SE3_CMD1_PERF_REQ_OFF_OP, op);
+	if (op == 0 || (op & ~(SE3_PERF_OP_GET | SE3_PERF_OP_RESET | SE3_PERF_OP_TRACE))
+		|| ((op & SE3_PERF_OP_TRACE) && op != SE3_PERF_OP_TRACE)) {
+		SE3_TRACE(("[perf] invalid op\n"));
+		return SE3_ERR_PARAMS;
+	}
+
+	if (op == SE3_PERF_OP_TRACE) {
+		u16tmp = SE3_EVTRACE_VERSION;
+		SE3_SET16(resp, SE3_EVTRACE_RESP_OFF_VERSION, u16tmp);
+		u16tmp = SE3_EVTRACE_ENTRY_SIZE;
+		SE3_SET16(resp, SE3_EVTRACE_RESP_OFF_ENTRY_SIZE, u16tmp);
+		u32tmp = SE3_PERF_CLOCK_HZ;
+		SE3_SET32(resp, SE3_EVTRACE_RESP_OFF_CLOCK_HZ, u32tmp);
+		u16tmp = se3_evtrace_drain(resp + SE3_EVTRACE_RESP_OFF_ENTRIES, SE3_EVTRACE_MAX_ENTRIES, &pending, &u32tmp);
+		SE3_SET16(resp, SE3_EVTRACE_RESP_OFF_COUNT, u16tmp);
+		SE3_SET16(resp, SE3_EVTRACE_RESP_OFF_PENDING, pending);
+		SE3_SET32(resp, SE3_EVTRACE_RESP_OFF_LOST, u32tmp);
+		u32tmp = se3_perf_cycles();
+		SE3_SET32(resp, SE3_EVTRACE_RESP_OFF_NOW, u32tmp);
+		*resp_size = (uint16_t)(SE3_EVTRACE_RESP_OFF_ENTRIES + u16tmp * SE3_EVTRACE_ENTRY_SIZE);
+		return SE3_OK;
+	}
+
+	*resp_size = 0;
+	if (op & SE3_PERF_OP_GET) {
+		u16tmp = SE3_PERF_VERSION;
+		SE3_SET16(resp, SE3_CMD1_PERF_RESP_OFF_VERSION, u16tmp);
+		u16tmp = SE3_PERF_CMD0_MAX;
+		SE3_SET16(resp, SE3_CMD1_PERF_RESP_OFF_N_CMD0, u16tmp);
+		u16tmp = SE3_PERF_CMD1_MAX;
+		SE3_SET16(resp, SE3_CMD1_PERF_RESP_OFF_N_CMD1, u16tmp);
+		u16tmp = SE3_ALGO_MAX;
+		SE3_SET16(resp, SE3_CMD1_PERF_RESP_OFF_N_ALGO, u16tmp);
+		u32tmp = SE3_PERF_CLOCK_HZ;
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_CLOCK_HZ, u32tmp);
+		u32tmp = HAL_GetTick() - se3_perf.reset_tick;
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_ELAPSED, u32tmp);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_BUSY_POLLS, se3_perf.busy_polls);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_HELD_READS, se3_perf.held_reads);
+		SE3_SET64(resp, SE3_CMD1_PERF_RESP_OFF_BYTES_IN, se3_perf.bytes_in);
+		SE3_SET64(resp, SE3_CMD1_PERF_RESP_OFF_BYTES_OUT, se3_perf.bytes_out);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_FLASH_PROGRAM, se3_perf.flash_program);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_FLASH_PROGRAM_BYTES, se3_perf.flash_program_bytes);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_FLASH_ERASE, se3_perf.flash_erase);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_FLASH_SWAP, se3_perf.flash_swap);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_MEM_REFILLS, se3_perf.mem_refills);
+		SE3_SET32(resp, SE3_CMD1_PERF_RESP_OFF_MEM_FAILURES, se3_perf.mem_failures);
+		p = resp + SE3_CMD1_PERF_RESP_OFF_ENTRIES;
+		perf_entries_write(p, se3_perf.cmd0, SE3_PERF_CMD0_MAX);
+		p += SE3_PERF_CMD0_MAX * SE3_CMD1_PERF_ENTRY_SIZE;
+		perf_entries_write(p, se3_perf.cmd1, SE3_PERF_CMD1_MAX);
+		p += SE3_PERF_CMD1_MAX * SE3_CMD1_PERF_ENTRY_SIZE;
+		perf_entries_write(p, se3_perf.algo, SE3_ALGO_MAX);
+		p += SE3_ALGO_MAX * SE3_CMD1_PERF_ENTRY_SIZE;
+		perf_entries_write(p, se3_perf.proto, SE3_PERF_PROTO_MAX);
+		p += SE3_PERF_PROTO_MAX * SE3_CMD1_PERF_ENTRY_SIZE;
+		*resp_size = (uint16_t)(p - resp);
+	}
+	if (op & SE3_PERF_OP_RESET) {
+		se3_perf_reset();
+	}
+	return SE3_OK;
+}
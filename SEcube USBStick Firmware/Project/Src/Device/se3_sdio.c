@@ -23,25 +23,155 @@
   */
 
 #include "se3_sdio.h"
+#ifndef CUBESIM
 #include "usbd_storage_if.h"
 #include "sdio.h"
+#endif
+#include "se3_evtrace.h"
 
 
-bool secube_sdio_write(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint16_t blk_len)
+#include <string.h>
+
+/* Writes are copied to one of two buffers and programmed by DMA in the background, so the
+ * next USB transfer is received while the card is busy. At most one write is in flight; it
+ * is completed before the card is used again. A queued write has already been acknowledged
+ * when it fails, so the failure is reported by the next flush (SYNCHRONIZE CACHE) and does
+ * not affect other commands. Small sequential reads are served from a read-ahead window,
+ * which is invalidated by overlapping writes.
+ */
+static uint32_t sdio_wb_buf[2][SE3_SDIO_WB_BLOCKS * STORAGE_BLK_SIZ / sizeof(uint32_t)];
+static uint32_t sdio_ra_buf[SE3_SDIO_RA_BLOCKS * STORAGE_BLK_SIZ / sizeof(uint32_t)];
+
+static struct {
+	int wb_pending;  ///< write buffer being programmed, -1 if none
+	bool wb_error;  ///< a queued write failed after being acknowledged
+	uint32_t wb_tick;  ///< time of the last write
+	uint32_t ra_first;  ///< first block of the read-ahead window
+	uint16_t ra_count;  ///< blocks in the read-ahead window, 0 if invalid
+	uint32_t ra_next;  ///< block following the last read
+} sdio = {
+	.wb_pending = -1,
+	.wb_error = false,
+	.wb_tick = 0,
+	.ra_first = 0,
+	.ra_count = 0,
+	.ra_next = 0
+};
+
+static void sdio_write_wait(void)
 {
-	if (HAL_SD_WriteBlocks_DMA(&hsd, (uint32_t *)buf, blk_addr * STORAGE_BLK_SIZ, STORAGE_BLK_SIZ, blk_len) == SD_OK)
-		if (HAL_SD_CheckWriteOperation(&hsd, (uint32_t)SD_DATATIMEOUT) == SD_OK)
+	bool ret;
+	if (sdio.wb_pending < 0) {
+		return;
+	}
+	ret = (HAL_SD_CheckWriteOperation(&hsd, (uint32_t)SD_DATATIMEOUT) == SD_OK);
+	sdio.wb_pending = -1;
+	se3_evt(SE3_EVT_SDIO_WRITE_DONE, ret, 0);
+	if (!ret) {
+		sdio.wb_error = true;
+	}
+}
+
+static bool sdio_read_blocks(uint32_t* buf, uint32_t blk_addr, uint16_t blk_len)
+{
+	if (HAL_SD_ReadBlocks_DMA(&hsd, buf, (uint64_t)blk_addr * STORAGE_BLK_SIZ, STORAGE_BLK_SIZ, blk_len) == SD_OK)
+		if (HAL_SD_CheckReadOperation(&hsd, (uint32_t)SD_DATATIMEOUT) == SD_OK)
 			return true;
 
 	return false;
 }
+
+static bool sdio_write(const uint8_t* buf, uint32_t blk_addr, uint16_t blk_len)
+{
+	uint16_t n;
+	int next;
+
+	if (sdio.ra_count > 0 && blk_addr < sdio.ra_first + sdio.ra_count && blk_addr + blk_len > sdio.ra_first) {
+		sdio.ra_count = 0;
+	}
+	while (blk_len > 0) {
+		n = (blk_len < SE3_SDIO_WB_BLOCKS) ? (blk_len) : (SE3_SDIO_WB_BLOCKS);
+		// fill the free buffer while the other one is programmed
+		next = (sdio.wb_pending == 0) ? (1) : (0);
+		memcpy(sdio_wb_buf[next], buf, n * STORAGE_BLK_SIZ);
+		sdio_write_wait();
+		if (HAL_SD_WriteBlocks_DMA(&hsd, sdio_wb_buf[next], (uint64_t)blk_addr * STORAGE_BLK_SIZ, STORAGE_BLK_SIZ, n) != SD_OK) {
+			return false;
+		}
+		sdio.wb_pending = next;
+		buf += n * STORAGE_BLK_SIZ;
+		blk_addr += n;
+		blk_len -= n;
+	}
+	sdio.wb_tick = HAL_GetTick();
+	return true;
+}
+
+bool secube_sdio_write(uint8_t lun, const uint8_t* buf, uint32_t blk_addr, uint16_t blk_len)
+{
+	bool ret;
+	se3_evt(SE3_EVT_SDIO_WRITE_BEGIN, blk_len, blk_addr);
+	ret = sdio_write(buf, blk_addr, blk_len);
+	se3_evt(SE3_EVT_SDIO_WRITE_END, ret, blk_addr);
+	return ret;
+}
+
+static bool sdio_read(uint8_t* buf, uint32_t blk_addr, uint16_t blk_len)
+{
+	bool hit = false;
+
+	sdio_write_wait();
+	if (blk_len <= SE3_SDIO_RA_BLOCKS) {
+		if (sdio.ra_count > 0 && blk_addr >= sdio.ra_first && blk_addr + blk_len <= sdio.ra_first + sdio.ra_count) {
+			hit = true;
+		}
+		else if (blk_addr == sdio.ra_next) {
+			// sequential access, read the whole window. may fail at the end of the card
+			sdio.ra_count = 0;
+			if (sdio_read_blocks(sdio_ra_buf, blk_addr, SE3_SDIO_RA_BLOCKS)) {
+				sdio.ra_first = blk_addr;
+				sdio.ra_count = SE3_SDIO_RA_BLOCKS;
+				hit = true;
+			}
+		}
+	}
+	sdio.ra_next = blk_addr + blk_len;
+	if (hit) {
+		memcpy(buf, (uint8_t*)sdio_ra_buf + (blk_addr - sdio.ra_first) * STORAGE_BLK_SIZ, blk_len * STORAGE_BLK_SIZ);
+		return true;
+	}
+	return sdio_read_blocks((uint32_t*)buf, blk_addr, blk_len);
+}
+
 bool secube_sdio_read(uint8_t lun, uint8_t* buf, uint32_t blk_addr, uint16_t blk_len)
 {
-	if (HAL_SD_ReadBlocks_DMA(&hsd, (uint32_t *)buf, blk_addr * STORAGE_BLK_SIZ, STORAGE_BLK_SIZ, blk_len) == SD_OK)
-		if (HAL_SD_CheckReadOperation(&hsd, (uint32_t)SD_DATATIMEOUT) == SD_OK)
-			return true;
+	bool ret;
+	se3_evt(SE3_EVT_SDIO_READ_BEGIN, blk_len, blk_addr);
+	ret = sdio_read(buf, blk_addr, blk_len);
+	se3_evt(SE3_EVT_SDIO_READ_END, ret, blk_addr);
+	return ret;
+}
 
-	return false;
+bool secube_sdio_flush(void)
+{
+	bool ret;
+	sdio_write_wait();
+	ret = !sdio.wb_error;
+	sdio.wb_error = false;
+	return ret;
+}
+
+void secube_sdio_idle(void)
+{
+	if (sdio.wb_pending < 0 || (HAL_GetTick() - sdio.wb_tick) < SE3_SDIO_IDLE_FLUSH) {
+		return;
+	}
+	HAL_NVIC_DisableIRQ(OTG_HS_IRQn);
+	// check again, a USB write may have waited for the queue or queued a new write meanwhile
+	if (sdio.wb_pending >= 0 && (HAL_GetTick() - sdio.wb_tick) >= SE3_SDIO_IDLE_FLUSH) {
+		sdio_write_wait();
+	}
+	HAL_NVIC_EnableIRQ(OTG_HS_IRQn);
 }
 
 bool secube_sdio_capacity(uint32_t *block_num, uint16_t *block_size)
@@ -58,6 +188,8 @@ bool secube_sdio_capacity(uint32_t *block_num, uint16_t *block_size)
 
 bool secube_sdio_isready(void)
 {
+	// the card cannot be queried while a write is in progress
+	sdio_write_wait();
 
 	if (HAL_SD_GetStatus(&hsd) != SD_TRANSFER_OK)
 		return false;
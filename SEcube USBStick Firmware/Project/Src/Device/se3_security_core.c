@@ -28,16 +28,46 @@
 #include "se3_algo_sha256.h"
 #include "se3_algo_HmacSha256.h"
 #include "se3_algo_AesHmacSha256s.h"
+#include "se3_algo_AesGcm.h"
+#include "se3_algo_ChaCha20Poly1305.h"
+#include "se3_algo_Blake2s.h"
+#include "se3_algo_AesCmac.h"
+#include "se3_algo_AesEax.h"
 #include "se3_common.h"
+#include "se3_perf.h"
+#include "se3_evtrace.h"
+#ifndef CUBESIM
+#include "stm32f4xx_hal.h"
+#endif
 
 SE3_SECURITY_INFO se3_security_info;
 
+/** \brief key cache entry
+ *
+ *  Context produced by the init handler of an algorithm for a given key and mode.
+ *  The context of a hot key is copied into the new session instead of reading
+ *  the key from flash and expanding it again.
+ */
+typedef struct se3_key_cache_entry_ {
+	bool valid;
+	uint32_t key_id;
+	uint16_t algo;
+	uint16_t mode;
+	uint32_t stamp;  ///< last use, for LRU replacement
+	uint8_t ctx[SE3_KEY_CACHE_DATA];
+} se3_key_cache_entry;
+
+static struct {
+	se3_key_cache_entry entries[SE3_KEY_CACHE_ENTRIES];
+	uint32_t clock;
+} key_cache;
+
 /* Cryptographic algorithms handlers and display info for the security core ONLY. */
 se3_algo_descriptor algo_table[SE3_ALGO_MAX] = {
 	{
 		se3_algo_Aes_init,
 		se3_algo_Aes_update,
-		sizeof(B5_tAesCtx),
+		sizeof(se3_algo_Aes_ctx),
 		"AES",
 		SE3_CRYPTO_TYPE_BLOCKCIPHER,
 		B5_AES_BLK_SIZE,
@@ -65,6 +95,54 @@ se3_algo_descriptor algo_table[SE3_ALGO_MAX] = {
 		"AES-HMAC-SHA256",
 		SE3_CRYPTO_TYPE_BLOCKCIPHER_AUTH,
 		B5_AES_BLK_SIZE,
+		{B5_AES_128*8, B5_AES_192*8, B5_AES_256*8, 0, 0, 0, 0, 0, 0, 0}},
+	{
+		se3_algo_AesGcm_init,
+		se3_algo_AesGcm_update,
+		sizeof(B5_tGcmAes256Ctx),
+		"AES-GCM",
+		SE3_CRYPTO_TYPE_BLOCKCIPHER_AUTH,
+		B5_AES_BLK_SIZE,
+		{B5_AES_128*8, B5_AES_192*8, B5_AES_256*8, 0, 0, 0, 0, 0, 0, 0}},
+	{
+		se3_algo_ChaCha20Poly1305_init,
+		se3_algo_ChaCha20Poly1305_update,
+		sizeof(B5_tChaCha20Poly1305Ctx),
+		"CHACHA20-POLY",
+		SE3_CRYPTO_TYPE_STREAMCIPHER_AUTH,
+		B5_CHACHA20_BLOCK_SIZE,
+		{B5_CHACHA20_KEY_SIZE*8, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+	{
+		se3_algo_Blake2s_init,
+		se3_algo_Blake2s_update,
+		sizeof(B5_tBlake2sCtx),
+		"BLAKE2S",
+		SE3_CRYPTO_TYPE_DIGEST,
+		B5_BLAKE2S_DIGEST_SIZE,
+		{0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+	{
+		se3_algo_Blake2sKeyed_init,
+		se3_algo_Blake2s_update,
+		sizeof(B5_tBlake2sCtx),
+		"BLAKE2S-KEYED",
+		SE3_CRYPTO_TYPE_DIGEST,
+		B5_BLAKE2S_DIGEST_SIZE,
+		{B5_AES_128*8, B5_AES_192*8, B5_AES_256*8, 0, 0, 0, 0, 0, 0, 0}},
+	{
+		se3_algo_AesCmac_init,
+		se3_algo_AesCmac_update,
+		sizeof(B5_tCmacAesCtx),
+		"AES-CMAC",
+		SE3_CRYPTO_TYPE_DIGEST,
+		B5_CMAC_AES_BLK_SIZE,
+		{B5_AES_128*8, B5_AES_192*8, B5_AES_256*8, 0, 0, 0, 0, 0, 0, 0}},
+	{
+		se3_algo_AesEax_init,
+		se3_algo_AesEax_update,
+		sizeof(B5_tEaxAes256Ctx),
+		"AES-EAX",
+		SE3_CRYPTO_TYPE_BLOCKCIPHER_AUTH,
+		B5_AES_BLK_SIZE,
 		{B5_AES_128*8, B5_AES_192*8, B5_AES_256*8, 0, 0, 0, 0, 0, 0, 0}}
 };
 
@@ -76,6 +154,94 @@ union {
 void se3_security_core_init(){
     memset(&ctx, 0, sizeof(ctx));
     memset((void*)&se3_security_info, 0, sizeof(SE3_SECURITY_INFO));
+    se3_security_info.sessions_timeout = SE3_SESSIONS_TIMEOUT_DEFAULT;
+    se3_key_cache_reset();
+}
+
+static void sessions_release(uint32_t sid)
+{
+    se3_mem_free(&(se3_security_info.sessions), (int32_t)sid);
+    se3_security_info.sessions_algo[sid] = SE3_ALGO_INVALID;
+}
+
+static bool sessions_alive(uint32_t sid)
+{
+    return (sid < SE3_SESSIONS_MAX) && (se3_security_info.sessions_algo[sid] < SE3_ALGO_MAX) &&
+        (se3_mem_ptr(&(se3_security_info.sessions), (int32_t)sid) != NULL);
+}
+
+void se3_sessions_expire()
+{
+    uint32_t now, sid;
+    if (se3_security_info.sessions_timeout == 0 || se3_security_info.sessions.used == 0) {
+        return;
+    }
+    now = HAL_GetTick();
+    if (now - se3_security_info.sessions_expire_tick < SE3_SESSIONS_EXPIRE_PERIOD) {
+        return;
+    }
+    se3_security_info.sessions_expire_tick = now;
+    for (sid = 0; sid < SE3_SESSIONS_MAX; sid++) {
+        if (sessions_alive(sid) && now - se3_security_info.sessions_tick[sid] >= se3_security_info.sessions_timeout) {
+            SE3_TRACE(("[se3_sessions_expire] reclaiming idle session %u\n", (unsigned)sid));
+            sessions_release(sid);
+            se3_security_info.sessions_reclaimed++;
+        }
+    }
+}
+
+void se3_key_cache_reset()
+{
+    memset(&key_cache, 0, sizeof(key_cache));
+}
+
+void se3_key_cache_invalidate(uint32_t key_id)
+{
+    size_t i;
+    for (i = 0; i < SE3_KEY_CACHE_ENTRIES; i++) {
+        if (key_cache.entries[i].valid && key_cache.entries[i].key_id == key_id) {
+            memset(&(key_cache.entries[i]), 0, sizeof(se3_key_cache_entry));
+        }
+    }
+}
+
+static se3_key_cache_entry* key_cache_find(uint32_t key_id, uint16_t algo, uint16_t mode)
+{
+    size_t i;
+    se3_key_cache_entry* e;
+    for (i = 0; i < SE3_KEY_CACHE_ENTRIES; i++) {
+        e = &(key_cache.entries[i]);
+        if (e->valid && e->key_id == key_id && e->algo == algo && e->mode == mode) {
+            e->stamp = ++(key_cache.clock);
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void key_cache_store(uint32_t key_id, uint16_t algo, uint16_t mode, const uint8_t* ctx, uint16_t size)
+{
+    size_t i;
+    se3_key_cache_entry* e = &(key_cache.entries[0]);
+    if (size > SE3_KEY_CACHE_DATA) {
+        return;
+    }
+    // take a free entry, or evict the least recently used one
+    for (i = 0; i < SE3_KEY_CACHE_ENTRIES; i++) {
+        if (!key_cache.entries[i].valid) {
+            e = &(key_cache.entries[i]);
+            break;
+        }
+        if (key_cache.entries[i].stamp < e->stamp) {
+            e = &(key_cache.entries[i]);
+        }
+    }
+    e->valid = true;
+    e->key_id = key_id;
+    e->algo = algo;
+    e->mode = mode;
+    e->stamp = ++(key_cache.clock);
+    memcpy(e->ctx, ctx, size);
 }
 
 static bool record_find(uint16_t record_type, se3_flash_it* it)
@@ -161,6 +327,7 @@ uint16_t crypto_init(uint16_t req_size, const uint8_t* req, uint16_t* resp_size,
     se3_flash_key key;
     se3_flash_it it = { .addr = NULL };
     se3_crypto_init_handler handler = NULL;
+    se3_key_cache_entry* cached = NULL;
     uint32_t status;
     int sid;
     uint8_t* ctx_;
@@ -182,10 +349,14 @@ uint16_t crypto_init(uint16_t req_size, const uint8_t* req, uint16_t* resp_size,
     // !! modifying request buffer
     key.data = (uint8_t*)req + SE3_CMD1_CRYPTO_INIT_REQ_OFF_KEY_ID + SE3_FLASH_KEY_OFF_DATA;
     key.id = req_params.key_id;
+    key.policy = 0;
     // SE3_KEY_INVALID (value 0xFFFFFFFF) must be passed to crypto_init whenever a key is NOT needed (i.e. SHA-256)
     if (key.id == SE3_KEY_INVALID) {
         memset(key.data, 0, SE3_KEY_DATA_MAX);
     }
+    else if ((cached = key_cache_find(key.id, req_params.algo, req_params.mode)) != NULL) {
+        // context already initialized for this key and mode, no need to read the key
+    }
     else {
         se3_flash_it_init(&it);
         if (!se3_key_find(key.id, &it)) {
@@ -213,16 +384,28 @@ uint16_t crypto_init(uint16_t req_size, const uint8_t* req, uint16_t* resp_size,
         SE3_TRACE(("[crypto_init] NULL session pointer\n"));
         return SE3_ERR_HW;
     }
-    status = handler(&key, req_params.mode, ctx_);
-    if (SE3_OK != status) {
-        // free the allocated session
-        se3_mem_free(&(se3_security_info.sessions), (int32_t)resp_params.sid);
-
-        SE3_TRACE(("[crypto_init] crypto handler failed\n"));
-        return status;
+    se3_evt(SE3_EVT_CRYPTO_INIT_BEGIN, req_params.algo, req_params.mode);
+    if (cached != NULL) {
+        memcpy(ctx_, cached->ctx, algo_table[req_params.algo].size);
+        se3_evt(SE3_EVT_CRYPTO_INIT_END, req_params.algo, SE3_OK);
+    }
+    else {
+        status = handler(&key, req_params.mode, ctx_);
+        se3_evt(SE3_EVT_CRYPTO_INIT_END, req_params.algo, status);
+        if (SE3_OK != status) {
+            // free the allocated session
+            se3_mem_free(&(se3_security_info.sessions), (int32_t)resp_params.sid);
+
+            SE3_TRACE(("[crypto_init] crypto handler failed\n"));
+            return status;
+        }
+        if (key.id != SE3_KEY_INVALID) {
+            key_cache_store(key.id, req_params.algo, req_params.mode, ctx_, algo_table[req_params.algo].size);
+        }
     }
     // link session to algo
     se3_security_info.sessions_algo[resp_params.sid] = req_params.algo;
+    se3_security_info.sessions_tick[resp_params.sid] = HAL_GetTick();
     SE3_SET32(resp, SE3_CMD1_CRYPTO_INIT_RESP_OFF_SID, resp_params.sid);
     *resp_size = SE3_CMD1_CRYPTO_INIT_RESP_SIZE;
 	return SE3_OK;
@@ -254,6 +437,7 @@ uint16_t crypto_update(uint16_t req_size, const uint8_t* req, uint16_t* resp_siz
     uint16_t algo;
     uint8_t* ctx_;
     uint16_t status;
+    uint32_t start;
 
     if (req_size < SE3_CMD1_CRYPTO_UPDATE_REQ_OFF_DATA) {
         SE3_TRACE(("[crypto_update] req size mismatch\n"));
@@ -273,7 +457,16 @@ uint16_t crypto_update(uint16_t req_size, const uint8_t* req, uint16_t* resp_siz
     }
     req_params.datain2 = req + SE3_CMD1_CRYPTO_UPDATE_REQ_OFF_DATA + datain1_len_padded;
 
-    if (SE3_CMD1_CRYPTO_UPDATE_REQ_OFF_DATA + datain1_len_padded + req_params.datain2_len > SE3_REQ1_MAX_DATA) {
+    if (req_params.flags & SE3_CRYPTO_FLAG_KEYSTREAM) {
+        // datain2-len is the amount of keystream to return, datain2 is not sent
+        req_params.datain2 = NULL;
+        if ((SE3_CMD1_CRYPTO_UPDATE_REQ_OFF_DATA + datain1_len_padded > SE3_REQ1_MAX_DATA) ||
+            (req_params.datain2_len > SE3_CRYPTO_MAX_DATAOUT)) {
+            SE3_TRACE(("[crypto_update] data size exceeds packet limit\n"));
+            return SE3_ERR_PARAMS;
+        }
+    }
+    else if (SE3_CMD1_CRYPTO_UPDATE_REQ_OFF_DATA + datain1_len_padded + req_params.datain2_len > SE3_REQ1_MAX_DATA) {
         SE3_TRACE(("[crypto_update] data size exceeds packet limit\n"));
         return SE3_ERR_PARAMS;
     }
@@ -288,6 +481,10 @@ uint16_t crypto_update(uint16_t req_size, const uint8_t* req, uint16_t* resp_siz
         SE3_TRACE(("[crypto_update] invalid algo for this sid (wrong sid?)\n"));
         return SE3_ERR_RESOURCE;
     }
+    if ((req_params.flags & SE3_CRYPTO_FLAG_KEYSTREAM) && (algo != SE3_ALGO_AES)) {
+        SE3_TRACE(("[crypto_update] keystream only available with AES\n"));
+        return SE3_ERR_PARAMS;
+    }
 
     handler = algo_table[algo].update;
     if (handler == NULL) {
@@ -304,11 +501,15 @@ uint16_t crypto_update(uint16_t req_size, const uint8_t* req, uint16_t* resp_siz
     resp_params.dataout_len = 0;
     resp_params.dataout = resp + SE3_CMD1_CRYPTO_UPDATE_RESP_OFF_DATA;
 
+    se3_evt(SE3_EVT_CRYPTO_UPDATE_BEGIN, algo, (uint32_t)req_params.datain1_len + req_params.datain2_len);
+    start = se3_perf_cycles();
     status = handler(
         ctx_, req_params.flags,
         req_params.datain1_len, req_params.datain1,
         req_params.datain2_len, req_params.datain2,
         &(resp_params.dataout_len), resp_params.dataout);
+    se3_perf_add(&(se3_perf.algo[algo]), start, (uint32_t)req_params.datain1_len + req_params.datain2_len);
+    se3_evt(SE3_EVT_CRYPTO_UPDATE_END, algo, status);
 
     if (SE3_OK != status) {
         SE3_TRACE(("[crypto_update] crypto handler failed\n"));
@@ -316,7 +517,10 @@ uint16_t crypto_update(uint16_t req_size, const uint8_t* req, uint16_t* resp_siz
     }
 
     if (req_params.flags & SE3_CRYPTO_FLAG_FINIT) {
-        se3_mem_free(&(se3_security_info.sessions), (int32_t)req_params.sid);
+        sessions_release(req_params.sid);
+    }
+    else {
+        se3_security_info.sessions_tick[req_params.sid] = HAL_GetTick();
     }
 
     SE3_SET16(resp, SE3_CMD1_CRYPTO_UPDATE_RESP_OFF_DATAOUT_LEN, resp_params.dataout_len);
@@ -325,6 +529,115 @@ uint16_t crypto_update(uint16_t req_size, const uint8_t* req, uint16_t* resp_siz
     return SE3_OK;
 }
 
+/** \brief list, release or renew crypto sessions
+ *
+ *  crypto_sessions : LIST (op:ui16)
+ *      => (timeout:ui32, count:ui16, reclaimed:ui16, bytes-used:ui32, bytes-internal:ui32,
+ *          bytes-external:ui32, peak:ui16, failures:ui16, (sid:ui32, algo:ui16, pad[2], idle:ui32)[count])
+ *  crypto_sessions : RELEASE|RENEW (op:ui16, count:ui16, sid:ui32[count]) => (count:ui16)
+ *  crypto_sessions : SET_TIMEOUT (op:ui16, pad[2], timeout:ui32) => ()
+ */
+uint16_t crypto_sessions(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, uint8_t* resp)
+{
+    struct {
+        uint16_t op;
+        uint16_t count;
+        uint32_t timeout;
+    } req_params;
+    uint16_t done = 0;
+    uint32_t now, sid, idle;
+    uint16_t i, u16tmp;
+    uint8_t* p;
+    se3_mem_stats stats;
+
+    if (req_size < SE3_CMD1_CRYPTO_SESSIONS_LIST_REQ_SIZE) {
+        SE3_TRACE(("[crypto_sessions] req size mismatch\n"));
+        return SE3_ERR_PARAMS;
+    }
+    SE3_GET16(req, SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_OP, req_params.op);
+    now = HAL_GetTick();
+
+    switch (req_params.op) {
+    case SE3_CRYPTO_SESSIONS_OP_LIST:
+        p = resp + SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_INFO;
+        for (sid = 0; sid < SE3_SESSIONS_MAX; sid++) {
+            if (!sessions_alive(sid)) {
+                continue;
+            }
+            SE3_SET32(p, SE3_CMD1_CRYPTO_SESSIONS_INFO_OFF_SID, sid);
+            SE3_SET16(p, SE3_CMD1_CRYPTO_SESSIONS_INFO_OFF_ALGO, se3_security_info.sessions_algo[sid]);
+            memset(p + SE3_CMD1_CRYPTO_SESSIONS_INFO_OFF_ALGO + 2, 0, 2);
+            idle = now - se3_security_info.sessions_tick[sid];
+            SE3_SET32(p, SE3_CMD1_CRYPTO_SESSIONS_INFO_OFF_IDLE, idle);
+            p += SE3_CMD1_CRYPTO_SESSIONS_INFO_SIZE;
+            done++;
+        }
+        se3_mem_stats_get(&(se3_security_info.sessions), &stats);
+        SE3_SET32(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_TIMEOUT, se3_security_info.sessions_timeout);
+        SE3_SET16(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_COUNT, done);
+        SE3_SET16(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_RECLAIMED, se3_security_info.sessions_reclaimed);
+        SE3_SET32(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_BYTES_USED, stats.bytes_used);
+        SE3_SET32(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_BYTES_INTERNAL, stats.bytes_internal);
+        SE3_SET32(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_BYTES_EXTERNAL, stats.bytes_external);
+        SE3_SET16(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_PEAK, stats.entries_peak);
+        u16tmp = (uint16_t)stats.failures;
+        SE3_SET16(resp, SE3_CMD1_CRYPTO_SESSIONS_LIST_RESP_OFF_FAILURES, u16tmp);
+        *resp_size = (uint16_t)(p - resp);
+        return SE3_OK;
+
+    case SE3_CRYPTO_SESSIONS_OP_RELEASE:
+    case SE3_CRYPTO_SESSIONS_OP_RENEW:
+        if (req_size < SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_SIDS) {
+            SE3_TRACE(("[crypto_sessions] req size mismatch\n"));
+            return SE3_ERR_PARAMS;
+        }
+        SE3_GET16(req, SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_COUNT, req_params.count);
+        if (req_size != SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_SIDS + 4 * (uint32_t)req_params.count) {
+            SE3_TRACE(("[crypto_sessions] req size mismatch\n"));
+            return SE3_ERR_PARAMS;
+        }
+        for (i = 0; i < ((req_params.count == 0) ? (SE3_SESSIONS_MAX) : (req_params.count)); i++) {
+            if (req_params.count == 0) {
+                sid = i;
+            }
+            else {
+                SE3_GET32(req, SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_SIDS + 4 * i, sid);
+            }
+            if (!sessions_alive(sid)) {
+                continue;
+            }
+            if (req_params.op == SE3_CRYPTO_SESSIONS_OP_RELEASE) {
+                sessions_release(sid);
+            }
+            else {
+                se3_security_info.sessions_tick[sid] = now;
+            }
+            done++;
+        }
+        SE3_SET16(resp, SE3_CMD1_CRYPTO_SESSIONS_RESP_OFF_COUNT, done);
+        *resp_size = SE3_CMD1_CRYPTO_SESSIONS_RESP_SIZE;
+        return SE3_OK;
+
+    case SE3_CRYPTO_SESSIONS_OP_SET_TIMEOUT:
+        if (req_size != SE3_CMD1_CRYPTO_SESSIONS_SET_TIMEOUT_REQ_SIZE) {
+            SE3_TRACE(("[crypto_sessions] req size mismatch\n"));
+            return SE3_ERR_PARAMS;
+        }
+        SE3_GET32(req, SE3_CMD1_CRYPTO_SESSIONS_REQ_OFF_TIMEOUT, req_params.timeout);
+        se3_security_info.sessions_timeout = req_params.timeout;
+        // leases start over with the new timeout
+        for (sid = 0; sid < SE3_SESSIONS_MAX; sid++) {
+            se3_security_info.sessions_tick[sid] = now;
+        }
+        *resp_size = 0;
+        return SE3_OK;
+
+    default:
+        SE3_TRACE(("[crypto_sessions] invalid operation\n"));
+        return SE3_ERR_PARAMS;
+    }
+}
+
 uint16_t crypto_list(uint16_t req_size, const uint8_t* req, uint16_t* resp_size, uint8_t* resp)
 {
     struct {
@@ -368,7 +681,7 @@ void se3_payload_cryptoinit(se3_payload_cryptoctx* ctx_, const uint8_t* key)
 	PBKDF2HmacSha256(key, B5_AES_256, NULL, 0, 1, keys, 2 * B5_AES_256);
     B5_Aes256_Init(&(ctx_->aesenc), keys, B5_AES_256, B5_AES256_CBC_ENC);
     B5_Aes256_Init(&(ctx_->aesdec), keys, B5_AES_256, B5_AES256_CBC_DEC);
-	memcpy(ctx_->hmac_key, keys + B5_AES_256, B5_AES_256);
+	B5_HmacSha256_Init(&(ctx_->hmac), keys + B5_AES_256, B5_AES_256);
 	memset(keys, 0, 2 * B5_AES_256);
 }
 
@@ -394,7 +707,7 @@ bool se3_payload_encrypt(se3_payload_cryptoctx* ctx_, uint8_t* auth, uint8_t* iv
 	}
 
     if (flags & SE3_CMDFLAG_SIGN) {
-        B5_HmacSha256_Init(&(ctx_->hmac), ctx_->hmac_key, B5_AES_256);
+        B5_HmacSha256_Reset(&(ctx_->hmac));
         B5_HmacSha256_Update(&(ctx_->hmac), iv, B5_AES_IV_SIZE);
         B5_HmacSha256_Update(&(ctx_->hmac), data, nblocks*B5_AES_BLK_SIZE);
         B5_HmacSha256_Finit(&(ctx_->hmac), ctx_->auth);
@@ -409,7 +722,7 @@ bool se3_payload_encrypt(se3_payload_cryptoctx* ctx_, uint8_t* auth, uint8_t* iv
 bool se3_payload_decrypt(se3_payload_cryptoctx* ctx_, const uint8_t* auth, const uint8_t* iv, uint8_t* data, uint16_t nblocks, uint16_t flags, uint8_t crypto_algo)
 {
     if (flags & SE3_CMDFLAG_SIGN) {
-        B5_HmacSha256_Init(&(ctx_->hmac), ctx_->hmac_key, B5_AES_256);
+        B5_HmacSha256_Reset(&(ctx_->hmac));
         B5_HmacSha256_Update(&(ctx_->hmac), iv, B5_AES_IV_SIZE);
         B5_HmacSha256_Update(&(ctx_->hmac), data, nblocks*B5_AES_BLK_SIZE);
         B5_HmacSha256_Finit(&(ctx_->hmac), ctx_->auth);
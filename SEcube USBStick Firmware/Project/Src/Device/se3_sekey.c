@@ -414,6 +414,7 @@ uint16_t delete_all_keys(uint16_t req_size, const uint8_t* req, uint16_t* resp_s
 				skip = false;
 				continue;
 			}
+			se3_key_cache_invalidate(key_id);
 			if (!se3_flash_it_delete(&it)) {
 				error_ = true;
 			}
@@ -440,6 +441,7 @@ uint16_t delete_key(uint16_t req_size, const uint8_t* req, uint16_t* resp_size,
 		return SE3_ERR_PARAMS;
 	}
 	memcpy(&kid, req, 4); // retrieve the key id from the input buffer
+	se3_key_cache_invalidate(kid);
 	se3_flash_it_init(&it);
 	while (se3_flash_it_next(&it)){
 		if (it.type == SE3_TYPE_KEY){
@@ -616,6 +618,8 @@ uint16_t insert_key(uint16_t req_size, const uint8_t* req, uint16_t* resp_size,
 	key.id = key_id;
 	key.data_size = key_data_len;
 	key.data = key_data;
+	key.policy = 0;
+	se3_key_cache_invalidate(key.id);
 
 	/* strategy for key insertion into flash: retrieve the data sent by the host, check if in memory there is already
 	 * a key with the same id and the same content, if the key is already there (same id, same length, same key value...)
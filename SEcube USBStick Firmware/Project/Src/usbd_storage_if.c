@@ -292,6 +292,68 @@ int8_t STORAGE_GetMaxLun_HS (void)
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+
+/*******************************************************************************
+* Function Name  : USBD_MSC_SynchronizeCache
+* Description    : Write the pending blocks of the write-behind queue to the SD card
+* Input          : None.
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+int8_t USBD_MSC_SynchronizeCache(uint8_t lun)
+{
+	if (!secube_sdio_flush())
+		return USBD_FAIL;
+	return USBD_OK;
+}
+
+/*******************************************************************************
+* Function Name  : USBD_MSC_VendorWrite
+* Description    : Pass the blocks of a SCSI_SE3_CMD_OUT command to the
+*                  communication core, bypassing the magic file
+* Input          : None.
+* Output         : None.
+* Return         : -1 if the blocks are out of the protocol file.
+*******************************************************************************/
+int8_t USBD_MSC_VendorWrite(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+	if (SE3_PROTO_OK != se3_proto_vendor_recv(buf, blk_addr, blk_len))
+		return -1;
+	return USBD_OK;
+}
+
+/*******************************************************************************
+* Function Name  : USBD_MSC_VendorRead
+* Description    : Take the blocks of a SCSI_SE3_RESP_IN command from the
+*                  communication core, bypassing the magic file
+* Input          : None.
+* Output         : None.
+* Return         : USBD_BUSY while the read is held, -1 on failure.
+*******************************************************************************/
+int8_t USBD_MSC_VendorRead(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+	int32_t r = se3_proto_vendor_send(buf, blk_addr, blk_len);
+	if (r == SE3_PROTO_BUSY)
+		return USBD_BUSY;
+	if (r != SE3_PROTO_OK)
+		return -1;
+	return USBD_OK;
+}
+
+/*******************************************************************************
+* Function Name  : STORAGE_Poll_HS
+* Description    : Complete a read held by STORAGE_Read_HS, if any. To be called
+*                  from the main loop.
+* Input          : None.
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+void STORAGE_Poll_HS(void)
+{
+	HAL_NVIC_DisableIRQ(OTG_HS_IRQn);
+	USBD_MSC_ResumeRead();
+	HAL_NVIC_EnableIRQ(OTG_HS_IRQn);
+}
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**